@@ -0,0 +1,172 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-19 11:08:30
+ * @LastEditTime: 2019-08-19 11:08:30
+ * @Description: Corpora and allocation counting shared by benchmarks.
+ */
+#include "BenchmarkSupport.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<size_t> allocations(0);
+
+} // namespace
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+namespace corpus {
+/**
+ * @description:
+ *     A small HTTP request header.
+ */
+const std::string &httpRequest() {
+    static const std::string message =
+        "Host: www.example.com\r\n"
+        "User-Agent: curl/7.16.3 libcurl/7.16.3 OpenSSL/0.9.7l zlib/1.2.3\r\n"
+        "Accept: */*\r\n"
+        "Accept-Language: en, mi\r\n"
+        "\r\n";
+    return message;
+}
+
+/**
+ * @description:
+ *     A header heavy HTTP response with a short body.
+ */
+const std::string &httpResponse() {
+    static const std::string message =
+        "Date: Mon, 27 Jul 2009 12:28:53 GMT\r\n"
+        "Server: Apache/2.2.14 (Unix) mod_ssl/2.2.14 OpenSSL/0.9.8l\r\n"
+        "Last-Modified: Wed, 22 Jul 2009 19:15:56 GMT\r\n"
+        "ETag: \"34aa387-d-1568eb00\"\r\n"
+        "Accept-Ranges: bytes\r\n"
+        "Cache-Control: private, max-age=0, must-revalidate\r\n"
+        "Expires: Mon, 27 Jul 2009 12:28:53 GMT\r\n"
+        "Strict-Transport-Security: max-age=31536000; includeSubDomains\r\n"
+        "X-Content-Type-Options: nosniff\r\n"
+        "X-Frame-Options: SAMEORIGIN\r\n"
+        "X-XSS-Protection: 1; mode=block\r\n"
+        "Set-Cookie: session=38afes7a8; Path=/; Secure; HttpOnly\r\n"
+        "Set-Cookie: lang=en-US; Path=/; Max-Age=2592000\r\n"
+        "Set-Cookie: theme=dark; Path=/; SameSite=Lax\r\n"
+        "Vary: Accept-Encoding\r\n"
+        "Content-Encoding: identity\r\n"
+        "Content-Type: text/plain; charset=utf-8\r\n"
+        "Content-Length: 51\r\n"
+        "Connection: keep-alive\r\n"
+        "Keep-Alive: timeout=5, max=1000\r\n"
+        "\r\n"
+        "Hello World! My payload includes a trailing CRLF.\r\n";
+    return message;
+}
+
+/**
+ * @description:
+ *     A SIP INVITE passed through many proxies with its SDP body.
+ */
+const std::string &sipInvite() {
+    static const std::string message = [] {
+        std::string s;
+        for (int hop = 0; hop < 12; ++hop) {
+            s += "Via: SIP/2.0/UDP proxy" + std::to_string(hop) +
+                 ".atlanta.example.com:5060\r\n"
+                 "    ;branch=z9hG4bK776asdhds" +
+                 std::to_string(hop) + ";received=192.0.2." +
+                 std::to_string(hop + 1) + "\r\n";
+        }
+        s += "Max-Forwards: 58\r\n"
+             "To: Bob <sip:bob@biloxi.example.com>\r\n"
+             "From: Alice <sip:alice@atlanta.example.com>;tag=1928301774\r\n"
+             "Call-ID: a84b4c76e66710@pc33.atlanta.example.com\r\n"
+             "CSeq: 314159 INVITE\r\n"
+             "Contact: <sip:alice@pc33.atlanta.example.com>\r\n"
+             "Content-Type: application/sdp\r\n"
+             "Content-Length: 149\r\n"
+             "\r\n"
+             "v=0\r\n"
+             "o=alice 2890844526 2890844526 IN IP4 pc33.atlanta.example.com\r\n"
+             "s=-\r\n"
+             "c=IN IP4 192.0.2.101\r\n"
+             "t=0 0\r\n"
+             "m=audio 49172 RTP/AVP 0\r\n"
+             "a=rtpmap:0 PCMU/8000\r\n";
+        return s;
+    }();
+    return message;
+}
+
+/**
+ * @description:
+ *     Internet message headers with long folded fields.
+ */
+const std::string &mailHeaders() {
+    static const std::string message =
+        "Return-Path: <jdoe@machine.example>\r\n"
+        "Received: from mail.example.net (mail.example.net [192.0.2.25])\r\n"
+        "\tby mx.example.org (Postfix) with ESMTPS id 4F2A61C0041\r\n"
+        "\tfor <mary@example.net>; Fri, 21 Nov 1997 09:55:06 -0600\r\n"
+        "Received: from machine.example (machine.example [192.0.2.77])\r\n"
+        "\tby mail.example.net (Postfix) with ESMTP id 9C1B2A3D4E\r\n"
+        "\tfor <mary@example.net>; Fri, 21 Nov 1997 09:54:58 -0600\r\n"
+        "DKIM-Signature: v=1; a=rsa-sha256; c=relaxed/relaxed;\r\n"
+        " d=machine.example; s=selector1; t=880127706;\r\n"
+        " h=from:to:subject:date:message-id;\r\n"
+        " bh=2jUSOH9NhtVGCQWNr9BrIAPreKQjO6Sn7XIkfJVOzv8=;\r\n"
+        " b=AuUoFEfDxTDkHlLXSZEpZj79LICEps6eda7W3deTVFOk4yAUoqOB4nujc7YopdG5\r\n"
+        "  dWLSdNg6xNAZpOPr+kHxt1IrE+NahM6L/LbvaHutKVdkLLkpVaVVQPzeRDI009SO2I\r\n"
+        "  l5Lu7rDNH6mZckBdrIx0orEtZV4bmp/YzhwvcubU4=\r\n"
+        "From: John Doe <jdoe@machine.example>\r\n"
+        "To: Mary Smith <mary@example.net>\r\n"
+        "Subject: Saying Hello to everybody on the list with a subject line\r\n"
+        " that is long enough to be folded by the sender\r\n"
+        "Date: Fri, 21 Nov 1997 09:55:06 -0600\r\n"
+        "Message-ID: <1234@local.machine.example>\r\n"
+        "MIME-Version: 1.0\r\n"
+        "Content-Type: text/plain; charset=us-ascii\r\n"
+        "\r\n"
+        "This is a message just to say hello.\r\n"
+        "So, \"Hello\".\r\n";
+    return message;
+}
+
+} // namespace corpus
+
+/**
+ * @description:
+ *     Start counting allocations of a benchmark.
+ * @param[in] state
+ *     The state of the running benchmark.
+ */
+AllocationCounter::AllocationCounter(benchmark::State &state)
+    : state_(state), start_(count()) {}
+
+/**
+ * @description:
+ *     Report the average allocations per iteration.
+ */
+AllocationCounter::~AllocationCounter() {
+    double iterations = static_cast<double>(state_.iterations());
+    state_.counters["allocs/op"] =
+        iterations ? (count() - start_) / iterations : 0.0;
+}
+
+/**
+ * @description:
+ *     Get the number of allocations made by the process so far.
+ */
+size_t AllocationCounter::count() {
+    return allocations.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,42 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-19 11:07:45
+ * @LastEditTime: 2019-08-19 11:07:45
+ * @Description: Corpora and allocation counting shared by benchmarks.
+ */
+#ifndef MESSAGE_BENCHMARKSUPPORT_HPP
+#define MESSAGE_BENCHMARKSUPPORT_HPP
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <string>
+
+namespace corpus {
+
+const std::string &httpRequest();
+const std::string &httpResponse();
+const std::string &sipInvite();
+const std::string &mailHeaders();
+
+} // namespace corpus
+
+/**
+ * @description:
+ *     Count heap allocations made by the benchmark loop, the result is
+ *     reported as the allocs/op counter.
+ */
+class AllocationCounter {
+public:
+    explicit AllocationCounter(benchmark::State &state);
+    ~AllocationCounter();
+
+    static size_t count();
+
+private:
+    benchmark::State &state_;
+    size_t start_;
+};
+
+#endif // MESSAGE_BENCHMARKSUPPORT_HPP
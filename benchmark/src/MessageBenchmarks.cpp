@@ -0,0 +1,951 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-19 11:20:04
+ * @LastEditTime: 2019-09-05 21:58:10
+ * @Description: Benchmarks of class msg::Message, msg::MessageParser,
+ *     msg::ArchiveReader and scanning kernels.
+ */
+#include "BenchmarkSupport.hpp"
+#include "Syntax.hpp"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <memory>
+#include <message/ArchiveReader.hpp>
+#include <message/Dialect.hpp>
+#include <message/EventLoop.hpp>
+#include <message/HeaderList.hpp>
+#include <message/Hpack.hpp>
+#include <message/Message.hpp>
+#include <message/MessageParser.hpp>
+#include <message/MessageReader.hpp>
+#include <message/MessageTemplate.hpp>
+#include <message/MessageView.hpp>
+#include <message/MessageWriter.hpp>
+#include <message/ParseLimits.hpp>
+#include <message/SharedMessage.hpp>
+#include <message/SnapshotView.hpp>
+#include <message/StartLine.hpp>
+#include <message/Stats.hpp>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+/**
+ * @description:
+ *     Report bytes/s and messages/s of a benchmark over a message.
+ */
+void setProcessed(benchmark::State &state, size_t messageLength) {
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(messageLength));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+/**
+ * @description:
+ *     Report header fields/s of a benchmark over a header block.
+ */
+void setFieldsProcessed(benchmark::State &state, size_t fieldCount) {
+    state.counters["fields/s"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * fieldCount),
+        benchmark::Counter::kIsRate);
+}
+
+/**
+ * @description:
+ *     The fields of a response that change from message to message, an
+ *     empty name stands for the body.
+ */
+struct VariableFields {
+    std::vector<std::string> names;
+    std::vector<std::string> values;
+};
+
+const VariableFields &httpFields() {
+    static const VariableFields fields{
+        {"Date", "Content-Length", ""},
+        {"Tue, 28 Jul 2009 08:00:00 GMT", "13", "Hello World!\n"}};
+    return fields;
+}
+
+const VariableFields &sipFields() {
+    static const VariableFields fields{
+        {"Call-ID", "CSeq"},
+        {"f81d4fae7dec11d0a76500a0c91e6bf6@pc33.atlanta.example.com",
+         "314160 INVITE"}};
+    return fields;
+}
+
+/**
+ * @description:
+ *     Encode a message twice over a fresh connection, the second block
+ *     shows the steady state of the dynamic table.
+ */
+std::string encodeHpack(const msg::Message &msg, size_t tableSize,
+                        msg::HpackDecoder &decoder, size_t &fieldCount) {
+    msg::HpackEncoder encoder;
+    encoder.setMaxTableSize(tableSize);
+    decoder.setMaxTableSize(tableSize);
+    std::string block;
+    for (int i = 0; i < 2; ++i) {
+        block.clear();
+        msg.produceToHpack(block, encoder);
+        fieldCount = 0;
+        decoder.decode(block.data(), block.size(),
+                       [&fieldCount](msg::StringView, msg::StringView) {
+                           ++fieldCount;
+                       });
+    }
+    return block;
+}
+
+typedef bool (*DialectParse)(msg::MessageView &view,
+                             const std::string &rawMessage);
+
+/**
+ * @description:
+ *     Parse a message into a view by the rules of a dialect.
+ */
+template <typename Dialect>
+bool parseAs(msg::MessageView &view, const std::string &rawMessage) {
+    return view.parse<Dialect>(rawMessage.data(), rawMessage.size());
+}
+
+} // namespace
+
+static void BM_ParseFromMessage(benchmark::State &state,
+                                const std::string &rawMessage) {
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        msg::Message msg;
+        benchmark::DoNotOptimize(msg.parseFromMessage(rawMessage));
+    }
+    setProcessed(state, rawMessage.size());
+}
+BENCHMARK_CAPTURE(BM_ParseFromMessage, HttpRequest, corpus::httpRequest());
+BENCHMARK_CAPTURE(BM_ParseFromMessage, HttpResponse, corpus::httpResponse());
+BENCHMARK_CAPTURE(BM_ParseFromMessage, SipInvite, corpus::sipInvite());
+BENCHMARK_CAPTURE(BM_ParseFromMessage, MailHeaders, corpus::mailHeaders());
+
+// A message reset between parses keeps its memory.
+static void BM_ParseMessageView(benchmark::State &state,
+                                const std::string &rawMessage) {
+    msg::MessageView view;
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(view.parse(rawMessage));
+    }
+    setProcessed(state, rawMessage.size());
+}
+BENCHMARK_CAPTURE(BM_ParseMessageView, HttpRequest, corpus::httpRequest());
+BENCHMARK_CAPTURE(BM_ParseMessageView, HttpResponse, corpus::httpResponse());
+BENCHMARK_CAPTURE(BM_ParseMessageView, SipInvite, corpus::sipInvite());
+BENCHMARK_CAPTURE(BM_ParseMessageView, MailHeaders, corpus::mailHeaders());
+
+// A hostile message of one header line that never ends, rejected at the
+// header section limit or only once it was all scanned without one.
+static void BM_RejectHeaderFlood(benchmark::State &state) {
+    std::string flood = "GET / HTTP/1.1\r\nX-Flood: ";
+    flood.append(static_cast<size_t>(state.range(0)), 'a');
+    msg::ParseLimits limits;
+    limits.maxHeaderBytes = 8192;
+    limits.maxFieldBytes = 8192;
+    msg::MessageView view;
+    view.setLineLength(static_cast<size_t>(state.range(0)));
+    if (state.range(1))
+        view.setLimits(limits);
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(view.parse(flood));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_RejectHeaderFlood)
+    ->ArgNames({"bytes", "limited"})
+    ->Args({64 << 10, 0})
+    ->Args({64 << 10, 1})
+    ->Args({16 << 20, 0})
+    ->Args({16 << 20, 1});
+
+// Each protocol parsed by its own dialect against the generic rules, the
+// HTTP and SIP messages get the start line their dialects require.
+static void BM_ParseDialect(benchmark::State &state, DialectParse parse,
+                            const char *startLine, const std::string &headers) {
+    std::string rawMessage = startLine + headers;
+    msg::MessageView view;
+    if (!parse(view, rawMessage)) {
+        state.SkipWithError("The message doesn't conform to the dialect");
+        return;
+    }
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parse(view, rawMessage));
+    }
+    setProcessed(state, rawMessage.size());
+}
+BENCHMARK_CAPTURE(BM_ParseDialect, HttpRequestGeneric,
+                  parseAs<msg::GenericDialect>, "GET / HTTP/1.1\r\n",
+                  corpus::httpRequest());
+BENCHMARK_CAPTURE(BM_ParseDialect, HttpRequestHttp, parseAs<msg::HttpDialect>,
+                  "GET / HTTP/1.1\r\n", corpus::httpRequest());
+BENCHMARK_CAPTURE(BM_ParseDialect, HttpResponseGeneric,
+                  parseAs<msg::GenericDialect>, "HTTP/1.1 200 OK\r\n",
+                  corpus::httpResponse());
+BENCHMARK_CAPTURE(BM_ParseDialect, HttpResponseHttp, parseAs<msg::HttpDialect>,
+                  "HTTP/1.1 200 OK\r\n", corpus::httpResponse());
+BENCHMARK_CAPTURE(BM_ParseDialect, SipInviteGeneric,
+                  parseAs<msg::GenericDialect>,
+                  "INVITE sip:bob@biloxi.example.com SIP/2.0\r\n",
+                  corpus::sipInvite());
+BENCHMARK_CAPTURE(BM_ParseDialect, SipInviteSip, parseAs<msg::SipDialect>,
+                  "INVITE sip:bob@biloxi.example.com SIP/2.0\r\n",
+                  corpus::sipInvite());
+BENCHMARK_CAPTURE(BM_ParseDialect, MailHeadersGeneric,
+                  parseAs<msg::GenericDialect>, "", corpus::mailHeaders());
+BENCHMARK_CAPTURE(BM_ParseDialect, MailHeadersMail, parseAs<msg::MailDialect>,
+                  "", corpus::mailHeaders());
+
+// A router reads Via, Call-ID and CSeq, the rest of the message is
+// framed only.
+static void BM_ParseSelectedHeaders(benchmark::State &state,
+                                    const std::string &rawMessage) {
+    msg::MessageView view;
+    view.selectHeader(msg::HeaderId::Via);
+    view.selectHeader(msg::HeaderId::CallId);
+    view.selectHeader(msg::HeaderId::CSeq);
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(view.parse(rawMessage));
+        benchmark::DoNotOptimize(view.getHeaderValue(msg::HeaderId::Via));
+        benchmark::DoNotOptimize(view.getHeaderValue(msg::HeaderId::CallId));
+        benchmark::DoNotOptimize(view.getHeaderValue(msg::HeaderId::CSeq));
+    }
+    setProcessed(state, rawMessage.size());
+}
+BENCHMARK_CAPTURE(BM_ParseSelectedHeaders, SipInvite, corpus::sipInvite());
+BENCHMARK_CAPTURE(BM_ParseSelectedHeaders, MailHeaders, corpus::mailHeaders());
+
+static void BM_ParseStartLine(benchmark::State &state,
+                              const std::string &line) {
+    msg::StartLine startLine;
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(startLine.parse(line.data(), line.size()));
+        benchmark::DoNotOptimize(startLine.getMethod());
+    }
+    setProcessed(state, line.size());
+}
+BENCHMARK_CAPTURE(BM_ParseStartLine, HttpRequest,
+                  std::string("GET /index.html HTTP/1.1"));
+BENCHMARK_CAPTURE(BM_ParseStartLine, SipRequest,
+                  std::string("INVITE sip:bob@biloxi.example.com SIP/2.0"));
+BENCHMARK_CAPTURE(BM_ParseStartLine, SipStatus,
+                  std::string("SIP/2.0 180 Ringing"));
+
+// A kernel scans a line of the given length for its structure.
+static void BM_ScanLine(benchmark::State &state,
+                        msg::syntax::LineScanner kernel, bool supported) {
+    if (!supported) {
+        state.SkipWithError("The CPU doesn't support the kernel");
+        return;
+    }
+    std::string line(state.range(0), 'v');
+    line.replace(line.size() / 2, 1, ":");
+    line += "\r\n";
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernel(line.data(), line.size()));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            state.range(0));
+}
+BENCHMARK_CAPTURE(BM_ScanLine, Scalar, msg::syntax::scanLineScalar, true)
+    ->Arg(32)
+    ->Arg(1024);
+BENCHMARK_CAPTURE(BM_ScanLine, Sse2, msg::syntax::scanLineSse2,
+                  msg::syntax::hasSse2())
+    ->Arg(32)
+    ->Arg(1024);
+BENCHMARK_CAPTURE(BM_ScanLine, Avx2, msg::syntax::scanLineAvx2,
+                  msg::syntax::hasAvx2())
+    ->Arg(32)
+    ->Arg(1024);
+
+static void BM_ParseFromMessageWithReset(benchmark::State &state,
+                                         const std::string &rawMessage) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        msg.reset();
+        benchmark::DoNotOptimize(msg.parseFromMessage(rawMessage));
+    }
+    setProcessed(state, rawMessage.size());
+}
+BENCHMARK_CAPTURE(BM_ParseFromMessageWithReset, HttpRequest,
+                  corpus::httpRequest());
+BENCHMARK_CAPTURE(BM_ParseFromMessageWithReset, HttpResponse,
+                  corpus::httpResponse());
+BENCHMARK_CAPTURE(BM_ParseFromMessageWithReset, SipInvite,
+                  corpus::sipInvite());
+BENCHMARK_CAPTURE(BM_ParseFromMessageWithReset, MailHeaders,
+                  corpus::mailHeaders());
+
+// Reloading a spooled message, compared with parsing its text again.
+static void BM_ParseFromSnapshot(benchmark::State &state,
+                                 const std::string &rawMessage) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    std::string snapshot;
+    msg.produceToSnapshot(snapshot);
+    msg.parseFromSnapshot(snapshot.data(), snapshot.size());
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            msg.parseFromSnapshot(snapshot.data(), snapshot.size()));
+    }
+    setProcessed(state, rawMessage.size());
+}
+BENCHMARK_CAPTURE(BM_ParseFromSnapshot, HttpRequest, corpus::httpRequest());
+BENCHMARK_CAPTURE(BM_ParseFromSnapshot, HttpResponse, corpus::httpResponse());
+BENCHMARK_CAPTURE(BM_ParseFromSnapshot, SipInvite, corpus::sipInvite());
+BENCHMARK_CAPTURE(BM_ParseFromSnapshot, MailHeaders, corpus::mailHeaders());
+
+static void BM_ReadSnapshotView(benchmark::State &state,
+                                const std::string &rawMessage) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    std::string snapshot;
+    msg.produceToSnapshot(snapshot);
+    msg::SnapshotView view;
+    view.parse(snapshot.data(), snapshot.size());
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(view.parse(snapshot.data(), snapshot.size()));
+    }
+    setProcessed(state, rawMessage.size());
+}
+BENCHMARK_CAPTURE(BM_ReadSnapshotView, SipInvite, corpus::sipInvite());
+BENCHMARK_CAPTURE(BM_ReadSnapshotView, MailHeaders, corpus::mailHeaders());
+
+static void BM_ProduceToSnapshot(benchmark::State &state,
+                                 const std::string &rawMessage) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    std::string snapshot;
+    msg.produceToSnapshot(snapshot);
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        snapshot.clear();
+        msg.produceToSnapshot(snapshot);
+        benchmark::DoNotOptimize(snapshot.data());
+    }
+    setProcessed(state, snapshot.size());
+}
+BENCHMARK_CAPTURE(BM_ProduceToSnapshot, SipInvite, corpus::sipInvite());
+BENCHMARK_CAPTURE(BM_ProduceToSnapshot, MailHeaders, corpus::mailHeaders());
+
+static void BM_ProduceToHpack(benchmark::State &state,
+                              const std::string &rawMessage,
+                              size_t tableSize) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    msg::HpackDecoder decoder;
+    size_t fieldCount = 0;
+    encodeHpack(msg, tableSize, decoder, fieldCount);
+    msg::HpackEncoder encoder;
+    encoder.setMaxTableSize(tableSize);
+    std::string block;
+    msg.produceToHpack(block, encoder);
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        block.clear();
+        msg.produceToHpack(block, encoder);
+        benchmark::DoNotOptimize(block.data());
+    }
+    setProcessed(state, block.size());
+    setFieldsProcessed(state, fieldCount);
+}
+BENCHMARK_CAPTURE(BM_ProduceToHpack, HttpRequest, corpus::httpRequest(), 4096);
+BENCHMARK_CAPTURE(BM_ProduceToHpack, HttpResponse, corpus::httpResponse(),
+                  4096);
+BENCHMARK_CAPTURE(BM_ProduceToHpack, HttpResponseNoTable,
+                  corpus::httpResponse(), 0);
+
+static void BM_DecodeHpack(benchmark::State &state,
+                           const std::string &rawMessage, size_t tableSize) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    msg::HpackDecoder decoder;
+    size_t fieldCount = 0;
+    std::string block = encodeHpack(msg, tableSize, decoder, fieldCount);
+    size_t length = 0;
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        // The steady block only refers to the table, so it decodes again.
+        decoder.decode(block.data(), block.size(),
+                       [&length](msg::StringView name, msg::StringView value) {
+                           length += name.size() + value.size();
+                       });
+    }
+    benchmark::DoNotOptimize(length);
+    setProcessed(state, block.size());
+    setFieldsProcessed(state, fieldCount);
+}
+BENCHMARK_CAPTURE(BM_DecodeHpack, HttpRequest, corpus::httpRequest(), 4096);
+BENCHMARK_CAPTURE(BM_DecodeHpack, HttpResponse, corpus::httpResponse(), 4096);
+BENCHMARK_CAPTURE(BM_DecodeHpack, HttpResponseNoTable, corpus::httpResponse(),
+                  0);
+
+static void BM_ParseFromHpack(benchmark::State &state,
+                              const std::string &rawMessage,
+                              size_t tableSize) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    msg::HpackDecoder decoder;
+    size_t fieldCount = 0;
+    std::string block = encodeHpack(msg, tableSize, decoder, fieldCount);
+    msg.parseFromHpack(block.data(), block.size(), decoder);
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            msg.parseFromHpack(block.data(), block.size(), decoder));
+    }
+    setProcessed(state, block.size());
+    setFieldsProcessed(state, fieldCount);
+}
+BENCHMARK_CAPTURE(BM_ParseFromHpack, HttpRequest, corpus::httpRequest(), 4096);
+BENCHMARK_CAPTURE(BM_ParseFromHpack, HttpResponse, corpus::httpResponse(),
+                  4096);
+BENCHMARK_CAPTURE(BM_ParseFromHpack, HttpResponseNoTable,
+                  corpus::httpResponse(), 0);
+
+static void BM_ProduceResponse(benchmark::State &state,
+                               const std::string &rawMessage,
+                               const VariableFields &fields) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    std::string buffer;
+    msg.produceToMessage(buffer);
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        for (size_t i = 0; i < fields.names.size(); ++i) {
+            if (fields.names[i].empty())
+                msg.setBody(fields.values[i]);
+            else
+                msg.setHeader(fields.names[i], fields.values[i], true);
+        }
+        buffer.clear();
+        msg.produceToMessage(buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    setProcessed(state, buffer.size());
+}
+BENCHMARK_CAPTURE(BM_ProduceResponse, HttpResponse, corpus::httpResponse(),
+                  httpFields());
+BENCHMARK_CAPTURE(BM_ProduceResponse, SipInvite, corpus::sipInvite(),
+                  sipFields());
+
+static void BM_ProduceFromTemplate(benchmark::State &state,
+                                   const std::string &rawMessage,
+                                   const VariableFields &fields) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    msg::MessageTemplate tmpl;
+    std::vector<msg::StringView> values;
+    for (size_t i = 0; i < fields.names.size(); ++i) {
+        if (fields.names[i].empty())
+            tmpl.addBodySlot();
+        else
+            tmpl.addSlot(fields.names[i]);
+        values.push_back(fields.values[i]);
+    }
+    msg.produceToTemplate(tmpl);
+    std::string buffer;
+    tmpl.produceToMessage(buffer, values.data(), values.size());
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        buffer.clear();
+        tmpl.produceToMessage(buffer, values.data(), values.size());
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    setProcessed(state, buffer.size());
+}
+BENCHMARK_CAPTURE(BM_ProduceFromTemplate, HttpResponse,
+                  corpus::httpResponse(), httpFields());
+BENCHMARK_CAPTURE(BM_ProduceFromTemplate, SipInvite, corpus::sipInvite(),
+                  sipFields());
+
+static void BM_ProduceToMessage(benchmark::State &state,
+                                const std::string &rawMessage) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    size_t length = msg.produceToMessage().size();
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(msg.produceToMessage());
+    }
+    setProcessed(state, length);
+}
+BENCHMARK_CAPTURE(BM_ProduceToMessage, HttpRequest, corpus::httpRequest());
+BENCHMARK_CAPTURE(BM_ProduceToMessage, HttpResponse, corpus::httpResponse());
+BENCHMARK_CAPTURE(BM_ProduceToMessage, SipInvite, corpus::sipInvite());
+BENCHMARK_CAPTURE(BM_ProduceToMessage, MailHeaders, corpus::mailHeaders());
+
+static void BM_ProduceToBuffer(benchmark::State &state,
+                               const std::string &rawMessage) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    std::string buffer;
+    msg.produceToMessage(buffer);
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        buffer.clear();
+        msg.produceToMessage(buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    setProcessed(state, buffer.size());
+}
+BENCHMARK_CAPTURE(BM_ProduceToBuffer, HttpRequest, corpus::httpRequest());
+BENCHMARK_CAPTURE(BM_ProduceToBuffer, HttpResponse, corpus::httpResponse());
+BENCHMARK_CAPTURE(BM_ProduceToBuffer, SipInvite, corpus::sipInvite());
+
+static void BM_ProduceToIovec(benchmark::State &state,
+                              const std::string &rawMessage) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    std::vector<iovec> iov;
+    std::string foldBuffer;
+    msg.produceToIovec(iov, foldBuffer);
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        iov.clear();
+        msg.produceToIovec(iov, foldBuffer);
+        benchmark::DoNotOptimize(iov.data());
+    }
+    setProcessed(state, msg.getMessageLength());
+}
+BENCHMARK_CAPTURE(BM_ProduceToIovec, HttpRequest, corpus::httpRequest());
+BENCHMARK_CAPTURE(BM_ProduceToIovec, HttpResponse, corpus::httpResponse());
+BENCHMARK_CAPTURE(BM_ProduceToIovec, SipInvite, corpus::sipInvite());
+
+// Folding is done by produceToMessage once a line length is set.
+static void BM_ProduceToMessageByFolding(benchmark::State &state,
+                                         const std::string &rawMessage) {
+    msg::Message msg;
+    msg.parseFromMessage(rawMessage);
+    msg.setLineLength(78);
+    size_t length = msg.produceToMessage().size();
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(msg.produceToMessage());
+    }
+    setProcessed(state, length);
+}
+BENCHMARK_CAPTURE(BM_ProduceToMessageByFolding, SipInvite,
+                  corpus::sipInvite());
+BENCHMARK_CAPTURE(BM_ProduceToMessageByFolding, MailHeaders,
+                  corpus::mailHeaders());
+
+// A long header is folded in time linear to its length.
+static void BM_FoldLongHeader(benchmark::State &state) {
+    std::string value;
+    while (value.size() < static_cast<size_t>(state.range(0)))
+        value += "v=1; a=rsa-sha256; bh=2jUSOH9NhtVGCQWNr9BrIAPreKQjO6Sn7XIk; ";
+    value.resize(state.range(0));
+
+    msg::Message msg;
+    msg.setHeader("DKIM-Signature", value);
+    msg.setLineLength(78);
+    std::string buffer;
+    msg.produceToMessage(buffer);
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        buffer.clear();
+        msg.produceToMessage(buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    setProcessed(state, buffer.size());
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FoldLongHeader)->RangeMultiplier(4)->Range(1 << 10, 1 << 16)
+    ->Complexity(benchmark::oN);
+
+static void BM_SetHeader(benchmark::State &state) {
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        msg::Message msg;
+        for (int i = 0; i < state.range(0); ++i) {
+            msg.setHeader("X-Header-" + std::to_string(i), "value", true);
+        }
+        benchmark::DoNotOptimize(msg.hasHeader("X-Header-0"));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            state.range(0));
+}
+BENCHMARK(BM_SetHeader)->Arg(8)->Arg(40)->Arg(128);
+
+static void BM_GetHeaderValue(benchmark::State &state) {
+    msg::Message msg;
+    msg.parseFromMessage(corpus::httpResponse());
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(msg.getHeaderValue("Content-Length"));
+        benchmark::DoNotOptimize(msg.getHeaderValue("Keep-Alive"));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 2);
+}
+BENCHMARK(BM_GetHeaderValue);
+
+static void BM_GetHeaderValueById(benchmark::State &state) {
+    msg::Message msg;
+    msg.parseFromMessage(corpus::httpResponse());
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            msg.getHeaderValue(msg::HeaderId::ContentLength));
+        benchmark::DoNotOptimize(msg.getHeaderValue(msg::HeaderId::KeepAlive));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 2);
+}
+BENCHMARK(BM_GetHeaderValueById);
+
+// Every proxy walks the Via hops of a request.
+static void BM_IterateViaHops(benchmark::State &state) {
+    msg::Message msg;
+    msg.parseFromMessage(corpus::sipInvite());
+    size_t hops = msg::HeaderList(msg.getHeaderValue(msg::HeaderId::Via)).size();
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        for (msg::StringView hop :
+             msg::HeaderList(msg.getHeaderValue(msg::HeaderId::Via))) {
+            benchmark::DoNotOptimize(hop.data());
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * hops));
+}
+BENCHMARK(BM_IterateViaHops);
+
+static void BM_RemoveHeader(benchmark::State &state) {
+    size_t allocations = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        msg::Message msg;
+        msg.parseFromMessage(corpus::httpResponse());
+        size_t start = AllocationCounter::count();
+        state.ResumeTiming();
+        msg.removeHeader("ETag");
+        msg.removeHeader("Set-Cookie");
+        msg.removeHeader("Keep-Alive");
+        allocations += AllocationCounter::count() - start;
+    }
+    state.counters["allocs/op"] =
+        static_cast<double>(allocations) / state.iterations();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 3);
+}
+BENCHMARK(BM_RemoveHeader);
+
+static void BM_GetHeaders(benchmark::State &state) {
+    msg::Message msg;
+    msg.parseFromMessage(corpus::httpResponse());
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(msg.getHeaders());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_GetHeaders);
+
+// A large chunked body streams to a sink in network sized reads.
+static void BM_StreamChunkedBody(benchmark::State &state) {
+    std::string rawMessage = "Transfer-Encoding: chunked\r\n\r\n";
+    std::string chunk(16 * 1024, 'x');
+    for (int64_t size = 0; size < state.range(0); size += chunk.size()) {
+        rawMessage += "4000\r\n" + chunk + "\r\n";
+    }
+    rawMessage += "0\r\n\r\n";
+
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    size_t received = 0;
+    parser.setBodySink(
+        [&received](const char *, size_t length) { received += length; });
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        msg.reset();
+        parser.reset();
+        size_t pos = 0;
+        while (pos < rawMessage.size()) {
+            size_t length = std::min<size_t>(64 * 1024, rawMessage.size() - pos);
+            parser.feed(rawMessage.data() + pos, length);
+            pos += parser.getConsumed();
+        }
+        benchmark::DoNotOptimize(received);
+    }
+    setProcessed(state, rawMessage.size());
+}
+BENCHMARK(BM_StreamChunkedBody)->Arg(1 << 20)->Arg(16 << 20);
+
+// Back-to-back messages of one read are parsed in a batch.
+static void BM_FeedPipelinedMessages(benchmark::State &state,
+                                     const std::string &rawMessage) {
+    std::string buffer;
+    for (int i = 0; i < state.range(0); ++i) {
+        buffer += rawMessage;
+    }
+
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    int64_t messages = 0;
+    auto onMessage = [&messages](msg::Message &, size_t) { ++messages; };
+    parser.feedMessages(buffer.data(), buffer.size(), onMessage);
+    if (messages != state.range(0))
+        state.SkipWithError("Messages aren't framed by Content-Length");
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        parser.feedMessages(buffer.data(), buffer.size(), onMessage);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(buffer.size()));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            state.range(0));
+}
+BENCHMARK_CAPTURE(BM_FeedPipelinedMessages, HttpResponse,
+                  corpus::httpResponse())
+    ->Arg(32);
+BENCHMARK_CAPTURE(BM_FeedPipelinedMessages, SipInvite, corpus::sipInvite())
+    ->Arg(32);
+
+// An mbox of mail headers is parsed by a growing number of threads.
+static void BM_ParseMboxArchive(benchmark::State &state) {
+    std::string content;
+    std::string message = corpus::mailHeaders();
+    for (size_t pos = message.find("\r\n"); pos != std::string::npos;
+         pos = message.find("\r\n", pos)) {
+        message.erase(pos, 1);
+    }
+    for (int i = 0; i < 20000; ++i) {
+        content += "From jdoe@machine.example Fri Nov 21 09:55:06 1997\n" +
+                   message + "\n";
+    }
+    char path[] = "/tmp/MessageBenchmarksXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, content.data(), content.size()) !=
+                      static_cast<ssize_t>(content.size())) {
+        state.SkipWithError("Failed to write the archive");
+        return;
+    }
+    close(fd);
+
+    msg::ArchiveReader reader;
+    reader.open(path, msg::ArchiveReader::Format::Mbox);
+    std::remove(path);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(reader.parse(
+            [](size_t, msg::Message &message) {
+                benchmark::DoNotOptimize(message.getBody().data());
+            },
+            state.range(0)));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(content.size()));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(reader.getMessageCount()));
+}
+BENCHMARK(BM_ParseMboxArchive)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// A metrics agent polls the totals while threads keep counting, the
+// cost grows with the number of threads that ever counted.
+static void BM_TakeStatsSnapshot(benchmark::State &state) {
+    msg::Message msg;
+    msg.parseFromMessage(corpus::sipInvite());
+    msg::StatsSnapshot snapshot;
+
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        msg::Stats::takeSnapshot(snapshot);
+        benchmark::DoNotOptimize(
+            snapshot.getPhase(msg::Phase::Parse).getPercentile(99));
+    }
+    state.counters["enabled"] = msg::Stats::isEnabled();
+}
+BENCHMARK(BM_TakeStatsSnapshot);
+
+// Each connection sends a request and waits for its echo, all of them
+// through one event loop.
+static void BM_EchoOverSocketPairs(benchmark::State &state) {
+    struct Connection {
+        int fds[2];
+        std::unique_ptr<msg::MessageReader> serverReader;
+        std::unique_ptr<msg::MessageWriter> serverWriter;
+        std::unique_ptr<msg::MessageReader> clientReader;
+        std::unique_ptr<msg::MessageWriter> clientWriter;
+    };
+
+    msg::EventLoop loop;
+    msg::Message request;
+    request.parseFromMessage(corpus::sipInvite());
+    // The parsed body is trimmed, frame it by its own length.
+    request.setHeader("Content-Length",
+                      std::to_string(request.getBody().size()), true);
+    std::vector<Connection> connections(static_cast<size_t>(state.range(0)));
+    size_t echoes = 0;
+    for (auto &connection : connections) {
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0,
+                       connection.fds) != 0) {
+            state.SkipWithError("Failed to make a socket pair");
+            return;
+        }
+        connection.serverReader.reset(
+            new msg::MessageReader(loop, connection.fds[0]));
+        connection.serverWriter.reset(
+            new msg::MessageWriter(loop, connection.fds[0]));
+        connection.clientReader.reset(
+            new msg::MessageReader(loop, connection.fds[1]));
+        connection.clientWriter.reset(
+            new msg::MessageWriter(loop, connection.fds[1]));
+        msg::MessageWriter &serverWriter = *connection.serverWriter;
+        connection.serverReader->start(
+            [&serverWriter](msg::Message &message) {
+                serverWriter.send(message);
+            },
+            nullptr);
+        connection.clientReader->start(
+            [&echoes](msg::Message &) { ++echoes; }, nullptr);
+    }
+
+    for (auto _ : state) {
+        echoes = 0;
+        for (auto &connection : connections) {
+            connection.clientWriter->send(request);
+        }
+        while (echoes < connections.size()) {
+            loop.runOnce();
+        }
+    }
+    for (auto &connection : connections) {
+        connection.serverReader->stop();
+        connection.clientReader->stop();
+        close(connection.fds[0]);
+        close(connection.fds[1]);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            state.range(0));
+}
+BENCHMARK(BM_EchoOverSocketPairs)->Arg(1)->Arg(64)->Arg(1024);
+
+/**
+ * @description:
+ *     Get the corpus INVITE frozen once for all threads.
+ */
+static const msg::SharedMessage &sharedInvite() {
+    static const msg::SharedMessage shared = []() {
+        msg::Message msg;
+        msg.parseFromMessage(corpus::sipInvite());
+        msg::SharedMessage frozen;
+        msg.produceToShared(frozen);
+        return frozen;
+    }();
+    return shared;
+}
+
+// Worker threads each take a handle of one received message and read
+// its routing headers, as a proxy fans a request out.
+static void BM_FanOutSharedMessage(benchmark::State &state) {
+    const msg::SharedMessage &shared = sharedInvite();
+    for (auto _ : state) {
+        msg::SharedMessage handle = shared;
+        benchmark::DoNotOptimize(
+            handle.getHeaderField(msg::HeaderId::Via, 0).data());
+        benchmark::DoNotOptimize(
+            handle.getHeaderValue(msg::HeaderId::CallId).data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_FanOutSharedMessage)->ThreadRange(1, 8)->UseRealTime();
+
+// The same fan-out by a message of its own parsed by each worker, as
+// messages can't be copied.
+static void BM_FanOutByParse(benchmark::State &state) {
+    const std::string raw = corpus::sipInvite();
+    for (auto _ : state) {
+        msg::Message copy;
+        copy.parseFromMessage(raw);
+        benchmark::DoNotOptimize(
+            copy.getHeaderField(msg::HeaderId::Via, 0).data());
+        benchmark::DoNotOptimize(copy.getHeaderValue(msg::HeaderId::CallId));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_FanOutByParse)->ThreadRange(1, 8)->UseRealTime();
+
+// Each forked branch adds its own Via on top of a shared request.
+static void BM_ForkSharedMessage(benchmark::State &state) {
+    const msg::SharedMessage &shared = sharedInvite();
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        auto mutation = shared.mutate();
+        mutation.prependHeader("Via", "SIP/2.0/UDP proxy.biloxi.com;"
+                                      "branch=z9hG4bK776asdhds");
+        msg::SharedMessage branch = mutation.commit();
+        benchmark::DoNotOptimize(branch.getHeaderCount());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_ForkSharedMessage);
+
+// The same fork by a message parsed per branch.
+static void BM_ForkByParse(benchmark::State &state) {
+    const std::string raw = corpus::sipInvite();
+    msg::Message msg;
+    msg.parseFromMessage(raw);
+    const std::string via = msg.getHeaderValue(msg::HeaderId::Via);
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        msg::Message branch;
+        branch.parseFromMessage(raw);
+        branch.setHeader(msg::HeaderId::Via,
+                         "SIP/2.0/UDP proxy.biloxi.com;"
+                         "branch=z9hG4bK776asdhds, " + via,
+                         true);
+        benchmark::DoNotOptimize(branch.getHeaders().size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_ForkByParse);
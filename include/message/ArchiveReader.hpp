@@ -0,0 +1,74 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-28 10:12:36
+ * @LastEditTime: 2019-09-06 11:09:52
+ * @Description: A declaration of class msg::ArchiveReader.
+ */
+#ifndef MESSAGE_ARCHIVEREADER_HPP
+#define MESSAGE_ARCHIVEREADER_HPP
+
+#include <functional>
+#include <message/Message.hpp>
+#include <message/StringView.hpp>
+#include <string>
+#include <vector>
+
+namespace msg {
+
+/**
+ * @description:
+ *     A reader of archives holding many messages. The archive is mapped
+ *     into memory and split into messages once, then messages are parsed
+ *     by a pool of threads, each thread reuses one message object. Mbox
+ *     messages are parsed by the rules of Internet messages, so bodies
+ *     keep their lines, length prefixed ones by the generic rules.
+ */
+class ArchiveReader {
+public:
+    ArchiveReader() = default;
+    ~ArchiveReader();
+    ArchiveReader(const ArchiveReader &) = delete;
+    ArchiveReader(ArchiveReader &&) = delete;
+    ArchiveReader &operator=(const ArchiveReader &) = delete;
+    ArchiveReader &operator=(ArchiveReader &&) = delete;
+
+public:
+    enum class Format {
+        Mbox,           // Messages start with "From " lines, LF ended.
+        LengthPrefixed, // A decimal length and LF precede each message.
+    };
+    // Receives a parsed message, it is called from the parsing threads
+    // concurrently and the message is reused after the call.
+    typedef std::function<void(size_t index, Message &message)>
+        MessageHandler;
+
+    bool open(const std::string &path, Format format);
+    void close();
+    size_t getMessageCount() const;
+    StringView getRawMessage(size_t index) const;
+    size_t parse(const MessageHandler &onMessage, size_t threadCount = 0);
+    std::vector<Message> parseAll(size_t threadCount = 0);
+
+private:
+    struct Span {
+        size_t offset;
+        size_t length;
+    };
+
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    Format format_ = Format::Mbox;
+    std::vector<Span> messages_;
+
+private:
+    bool splitMbox();
+    bool splitLengthPrefixed();
+    bool parseMessage(size_t index, Message &message,
+                      std::string &buffer) const;
+};
+
+} // namespace msg
+
+#endif // MESSAGE_ARCHIVEREADER_HPP
@@ -0,0 +1,50 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 18:02:51
+ * @LastEditTime: 2019-09-05 18:02:51
+ * @Description: Protocol dialects a message is parsed as.
+ */
+#ifndef MESSAGE_DIALECT_HPP
+#define MESSAGE_DIALECT_HPP
+
+namespace msg {
+
+/**
+ * @description:
+ *     Dialects select the rules of one protocol for MessageView::parse()
+ *     and Message::parseFromMessage(). The rules are fixed at compile
+ *     time, so each dialect gets a parse loop of its own without any
+ *     runtime check of the protocol. Only the dialects below are
+ *     instantiated by the library.
+ */
+
+// The rules of all protocols at once, as parse() without a dialect has
+// always applied them: an optional start line, field text names, folding
+// by any line without colon, SIP compact forms, the line length limit set
+// at runtime, and a body joined from its lines and trimmed.
+struct GenericDialect {};
+
+// HTTP/1.1 of RFC 7230: an HTTP/1.x start line, token names directly
+// followed by the colon, no obsolete line folding, values may contain
+// obs-text, no compact forms, and a body kept as it is. Repeated fields
+// are comma-separated lists.
+struct HttpDialect {};
+
+// SIP/2.0 of RFC 3261: a SIP/2.0 start line, token names maybe followed by
+// whitespace before the colon, folding by lines starting with whitespace,
+// UTF-8 values, compact forms, and a body kept as it is. Repeated fields
+// are comma-separated lists.
+struct SipDialect {};
+
+// Internet Message Format of RFC 5322: no start line, field text names
+// maybe followed by whitespace before the colon, folding by lines
+// starting with whitespace, US-ASCII values, lines of at most 998
+// characters, no compact forms, and a body kept as it is. Repeated
+// fields such as Received are kept apart.
+struct MailDialect {};
+
+} // namespace msg
+
+#endif // MESSAGE_DIALECT_HPP
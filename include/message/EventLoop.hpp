@@ -0,0 +1,77 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 14:10:37
+ * @LastEditTime: 2019-09-06 09:41:12
+ * @Description: A declaration of class msg::EventLoop.
+ */
+#ifndef MESSAGE_EVENTLOOP_HPP
+#define MESSAGE_EVENTLOOP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace msg {
+
+/**
+ * @description:
+ *     A loop dispatching readiness of non-blocking file descriptors with
+ *     epoll. A descriptor has a handler for reading and one for writing,
+ *     so a reader and a writer can share a socket. Hang-ups and errors
+ *     wake both handlers, which find them from read() or write().
+ *
+ *     The loop and its handlers run on one thread. Handlers may be
+ *     changed or removed from within handlers, a removed handler is
+ *     destroyed after the events at hand were dispatched.
+ */
+class EventLoop {
+public:
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop &) = delete;
+    EventLoop(EventLoop &&) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+    EventLoop &operator=(EventLoop &&) = delete;
+
+public:
+    typedef std::function<void()> Handler;
+
+    bool isOpen() const;
+    bool setReadHandler(int fd, Handler handler);
+    bool setWriteHandler(int fd, Handler handler);
+    size_t getWatchCount() const;
+    size_t runOnce(int timeout = -1);
+    void run();
+    void stop();
+
+private:
+    // The handlers of a descriptor. The generation changes each time the
+    // descriptor leaves epoll, so events for a closed descriptor whose
+    // number was reused are dropped.
+    struct Watch {
+        Handler onRead;
+        Handler onWrite;
+        uint32_t events = 0;
+        uint32_t generation = 0;
+    };
+
+    int epollFd_ = -1;
+    // Indexed by descriptor. A deque grows without moving the watches, so
+    // a running handler survives registering a higher descriptor.
+    std::deque<Watch> watches_;
+    size_t watchCount_ = 0;
+    bool dispatching_ = false;
+    bool stopped_ = false;
+    std::vector<Handler> retired_; // Removed while dispatching.
+
+private:
+    bool setHandler(int fd, Handler Watch::*slot, Handler &&handler);
+};
+
+} // namespace msg
+
+#endif // MESSAGE_EVENTLOOP_HPP
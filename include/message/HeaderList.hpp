@@ -0,0 +1,79 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-01 09:14:26
+ * @LastEditTime: 2019-09-01 09:14:26
+ * @Description: A declaration of class msg::HeaderList.
+ */
+#ifndef MESSAGE_HEADERLIST_HPP
+#define MESSAGE_HEADERLIST_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <message/StringView.hpp>
+
+namespace msg {
+
+/**
+ * @description:
+ *     The elements of a comma separated header value, such as the hops of
+ *     Via. Commas in quoted-strings and comments don't separate elements,
+ *     elements are trimmed and empty ones are skipped. Elements are views
+ *     of the value, which must outlive the list.
+ */
+class HeaderList {
+public:
+    explicit HeaderList(StringView headerValue) : value_(headerValue) {}
+    ~HeaderList() = default;
+    HeaderList(const HeaderList &) = default;
+    HeaderList(HeaderList &&) = default;
+    HeaderList &operator=(const HeaderList &) = default;
+    HeaderList &operator=(HeaderList &&) = default;
+
+public:
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef StringView value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const StringView *pointer;
+        typedef const StringView &reference;
+
+        const_iterator() = default;
+        const_iterator(const char *next, const char *end);
+
+        reference operator*() const { return element_; }
+        pointer operator->() const { return &element_; }
+        const_iterator &operator++();
+        const_iterator operator++(int) {
+            const_iterator before = *this;
+            ++*this;
+            return before;
+        }
+        friend bool operator==(const const_iterator &lhs,
+                               const const_iterator &rhs) {
+            return lhs.element_.data() == rhs.element_.data();
+        }
+        friend bool operator!=(const const_iterator &lhs,
+                               const const_iterator &rhs) {
+            return !(lhs == rhs);
+        }
+
+    private:
+        StringView element_;
+        const char *next_ = nullptr; // The first character after element_.
+        const char *end_ = nullptr;
+    };
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_t size() const;
+
+private:
+    StringView value_;
+};
+
+} // namespace msg
+
+#endif // MESSAGE_HEADERLIST_HPP
@@ -0,0 +1,128 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-21 10:12:40
+ * @LastEditTime: 2019-08-21 10:12:40
+ * @Description: Well-known header names of HTTP, SIP and Internet Message
+ *     Format.
+ */
+#ifndef MESSAGE_HEADERNAMES_HPP
+#define MESSAGE_HEADERNAMES_HPP
+
+#include <cstdint>
+#include <message/StringView.hpp>
+
+namespace msg {
+
+/**
+ * @description:
+ *     Identifiers of well-known header names, a name and its SIP compact
+ *     form share one identifier.
+ */
+enum class HeaderId : uint8_t {
+    Unknown = 0,
+    Accept,
+    AcceptCharset,
+    AcceptContact,
+    AcceptEncoding,
+    AcceptLanguage,
+    AcceptRanges,
+    Age,
+    AlertInfo,
+    Allow,
+    AllowEvents,
+    AuthenticationInfo,
+    Authorization,
+    Bcc,
+    CacheControl,
+    CallId,
+    CallInfo,
+    Cc,
+    Connection,
+    Contact,
+    ContentDisposition,
+    ContentEncoding,
+    ContentLanguage,
+    ContentLength,
+    ContentLocation,
+    ContentRange,
+    ContentTransferEncoding,
+    ContentType,
+    Cookie,
+    CSeq,
+    Date,
+    DkimSignature,
+    ErrorInfo,
+    ETag,
+    Event,
+    Expect,
+    Expires,
+    From,
+    Host,
+    Identity,
+    IfMatch,
+    IfModifiedSince,
+    IfNoneMatch,
+    IfUnmodifiedSince,
+    InReplyTo,
+    KeepAlive,
+    LastModified,
+    Location,
+    MaxForwards,
+    MessageId,
+    MimeVersion,
+    MinExpires,
+    Organization,
+    Origin,
+    Path,
+    Pragma,
+    Priority,
+    ProxyAuthenticate,
+    ProxyAuthorization,
+    ProxyRequire,
+    RAck,
+    Range,
+    Received,
+    RecordRoute,
+    References,
+    ReferredBy,
+    Referer,
+    ReferTo,
+    RejectContact,
+    ReplyTo,
+    RequestDisposition,
+    Require,
+    RetryAfter,
+    ReturnPath,
+    Route,
+    RSeq,
+    Sender,
+    Server,
+    ServiceRoute,
+    SessionExpires,
+    SetCookie,
+    Subject,
+    SubscriptionState,
+    Supported,
+    Te,
+    Timestamp,
+    To,
+    Trailer,
+    TransferEncoding,
+    Unsupported,
+    Upgrade,
+    UserAgent,
+    Vary,
+    Via,
+    Warning,
+    WwwAuthenticate,
+    Count, // The number of identifiers, not a header.
+};
+
+HeaderId lookupHeaderId(StringView headerName);
+StringView getHeaderName(HeaderId headerId);
+
+} // namespace msg
+
+#endif // MESSAGE_HEADERNAMES_HPP
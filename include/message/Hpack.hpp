@@ -0,0 +1,132 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-03 09:12:40
+ * @LastEditTime: 2019-09-03 09:12:40
+ * @Description: A declaration of HPACK header compression of HTTP/2.
+ */
+#ifndef MESSAGE_HPACK_HPP
+#define MESSAGE_HPACK_HPP
+
+#include <cstdint>
+#include <functional>
+#include <message/StringView.hpp>
+#include <string>
+#include <vector>
+
+namespace msg {
+
+/**
+ * @description:
+ *     The dynamic table of RFC 7541, one per direction of a connection.
+ *     Entries are indexed from the newest, the oldest ones are evicted
+ *     once the size exceeds the limit. Strings of evicted entries are
+ *     reused by later ones.
+ */
+class HpackTable {
+public:
+    HpackTable() = default;
+    ~HpackTable() = default;
+    HpackTable(const HpackTable &) = default;
+    HpackTable(HpackTable &&) = default;
+    HpackTable &operator=(const HpackTable &) = default;
+    HpackTable &operator=(HpackTable &&) = default;
+
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+    // The size an entry takes beyond its name and value.
+    static const size_t entryOverhead = 32;
+
+    size_t getCount() const;
+    size_t getSize() const;
+    size_t getMaxSize() const;
+    void setMaxSize(size_t maxSize);
+    void insert(StringView name, StringView value);
+    StringView getName(size_t index) const;
+    StringView getValue(size_t index) const;
+    size_t find(StringView name, StringView value, bool &matched) const;
+
+private:
+    struct Entry {
+        std::string name;
+        std::string value;
+        uint32_t nameHash; // Compared before the name by find().
+    };
+
+    // A ring of entries, the oldest one is at first_.
+    std::vector<Entry> entries_;
+    size_t first_ = 0;
+    size_t count_ = 0;
+    size_t size_ = 0;
+    size_t maxSize_ = 4096;
+
+private:
+    size_t slot(size_t index) const;
+    void evict(size_t maxSize);
+};
+
+/**
+ * @description:
+ *     An encoder of header blocks of one connection. Names are lowercased,
+ *     indexed when they or whole fields are in the tables, and strings are
+ *     Huffman coded when that is shorter.
+ */
+class HpackEncoder {
+public:
+    HpackEncoder() = default;
+    ~HpackEncoder() = default;
+    HpackEncoder(const HpackEncoder &) = delete;
+    HpackEncoder(HpackEncoder &&) = default;
+    HpackEncoder &operator=(const HpackEncoder &) = delete;
+    HpackEncoder &operator=(HpackEncoder &&) = default;
+
+public:
+    void setMaxTableSize(size_t maxSize);
+    void startBlock(std::string &targetBlock);
+    void encodeField(StringView name, StringView value,
+                     std::string &targetBlock, bool sensitive = false);
+    const HpackTable &getTable() const;
+
+private:
+    HpackTable table_;
+    // A size update is sent at the start of the next block, the smallest
+    // size since the last block first if it was smaller.
+    bool sizeChanged_ = false;
+    size_t minSize_ = 0;
+    std::string name_; // The lowercased name of the field being encoded.
+};
+
+/**
+ * @description:
+ *     A decoder of header blocks of one connection. A block is decoded as
+ *     a whole, the fields are handed over in order as views valid during
+ *     the call only.
+ */
+class HpackDecoder {
+public:
+    HpackDecoder() = default;
+    ~HpackDecoder() = default;
+    HpackDecoder(const HpackDecoder &) = delete;
+    HpackDecoder(HpackDecoder &&) = default;
+    HpackDecoder &operator=(const HpackDecoder &) = delete;
+    HpackDecoder &operator=(HpackDecoder &&) = default;
+
+public:
+    typedef std::function<void(StringView name, StringView value)>
+        FieldHandler;
+
+    void setMaxTableSize(size_t maxSize);
+    bool decode(const char *data, size_t length, const FieldHandler &onField);
+    const HpackTable &getTable() const;
+
+private:
+    HpackTable table_;
+    size_t maxTableSize_ = 4096; // SETTINGS_HEADER_TABLE_SIZE
+    std::string name_;           // Decoded Huffman or copied names.
+    std::string value_;          // Decoded Huffman values.
+};
+
+} // namespace msg
+
+#endif // MESSAGE_HPACK_HPP
@@ -3,52 +3,142 @@
  * @Author: shaqsnake
  * @Email: shaqsnake@gmail.com
  * @Date: 2019-07-25 09:27:32
- * @LastEditTime: 2019-08-15 17:02:40
+ * @LastEditTime: 2019-09-06 12:21:35
  * @Description: A declaration of class msg::Message.
  */
 #ifndef MESSAGE_MESSAGE_HPP
 #define MESSAGE_MESSAGE_HPP
 
+#include <cstdint>
 #include <memory>
+#include <message/Dialect.hpp>
+#include <message/HeaderNames.hpp>
+#include <message/ParseLimits.hpp>
+#include <message/StartLine.hpp>
+#include <message/Stats.hpp>
+#include <message/StringView.hpp>
 #include <string>
 #include <vector>
 
+struct iovec;
+
 namespace msg {
+class HpackDecoder;
+class HpackEncoder;
+class MessageTemplate;
+class SharedMessage;
 
 class Message {
 public:
     Message() = default;
     ~Message() = default;
     Message(const Message &) = delete;
-    Message(Message &&) = delete;
+    Message(Message &&) = default;
     Message &operator=(const Message &) = delete;
-    Message &operator=(Message &&) = delete;
+    Message &operator=(Message &&) = default;
 
 public:
     typedef std::pair<std::string, std::string> Header;
     typedef std::vector<Header> Headers;
+    // How repeated fields of a header are produced, Set-Cookie is always
+    // repeated since its values may contain commas.
+    enum class FieldForm {
+        Joined,   // One line with the values separated by commas.
+        Repeated, // One line per field as it was added.
+    };
 
     bool parseFromMessage(const std::string &rawMessge);
+    bool parseFromMessage(const char *data, size_t length);
+    template <typename Dialect>
+    bool parseFromMessage(const char *data, size_t length);
+    ParseError getParseError() const;
     std::string produceToMessage() const;
-    Headers getHeaders() const;
+    void produceToMessage(std::string &targetMessage) const;
+    void produceToIovec(std::vector<iovec> &dest,
+                        std::string &foldBuffer) const;
+    size_t getMessageLength() const;
+    bool parseFromSnapshot(const char *data, size_t length);
+    void produceToSnapshot(std::string &targetSnapshot) const;
+    bool parseFromHpack(const char *data, size_t length,
+                        HpackDecoder &decoder);
+    void produceToHpack(std::string &targetBlock, HpackEncoder &encoder,
+                        StringView scheme = "https") const;
+    void produceToTemplate(MessageTemplate &targetTemplate) const;
+    void produceToShared(SharedMessage &targetMessage) const;
+    const StartLine &getStartLine() const;
+    StartLine &getStartLine();
+    const Headers &getHeaders() const;
     bool hasHeader(const std::string &headerName) const;
+    bool hasHeader(HeaderId headerId) const;
     void setHeader(const std::string &headerName,
                    const std::string &headerValue, bool replace = false);
-    std::string getHeaderValue(const std::string &headerName) const;
+    void setHeader(const std::string &headerName, std::string &&headerValue,
+                   bool replace = false);
+    void setHeader(HeaderId headerId, const std::string &headerValue,
+                   bool replace = false);
+    void setHeader(HeaderId headerId, std::string &&headerValue,
+                   bool replace = false);
+    void addHeader(StringView headerName, StringView headerValue);
+    const std::string &getHeaderValue(const std::string &headerName) const;
+    const std::string &getHeaderValue(HeaderId headerId) const;
+    size_t getHeaderFieldCount(const std::string &headerName) const;
+    size_t getHeaderFieldCount(HeaderId headerId) const;
+    StringView getHeaderField(const std::string &headerName,
+                              size_t index) const;
+    StringView getHeaderField(HeaderId headerId, size_t index) const;
     void removeHeader(const std::string &headerName);
-    std::string getBody() const;
+    void removeHeader(HeaderId headerId);
+    const std::string &getBody() const;
+    std::string takeBody();
     void setBody(const std::string &bodyText);
+    void setBody(std::string &&bodyText);
     void setLineLength(size_t maxLength);
+    void setLimits(const ParseLimits &limits);
+    void setFieldForm(FieldForm form);
+    void reset();
 
 private:
+    // A boundary between two fields combined into the value of a header.
+    struct Repeat {
+        size_t position; // The position of the header in headers_.
+        size_t end;      // The end of the field before the separator.
+        size_t begin;    // The start of the field after the separator.
+    };
+
+    StartLine startLine_;
     Headers headers_;
+    std::vector<HeaderId> headerIds_; // Identifiers of headers_.
+    // Open addressing table of header positions plus one, keyed on the
+    // case folded hash of header names, zero marks an empty slot.
+    std::vector<uint32_t> index_;
+    // Boundaries in order of offset per header, empty while no header
+    // was repeated.
+    std::vector<Repeat> repeats_;
     std::string body_;
     size_t maxLineLength_ = 0;
+    ParseLimits limits_; // Of parseFromMessage().
+    FieldForm fieldForm_ = FieldForm::Joined;
+    // Single letter names are compact forms in the dialect parsed by.
+    bool compactForms_ = true;
+    ParseError parseError_ = ParseError::None; // Of the last parse.
 
 private:
-    void dumpToVec(std::vector<std::string> &dest) const;
-    void foldMessageLines(std::vector<std::string> &lines,
-                          size_t maxLength) const;
+    HeaderId identify(StringView headerName) const;
+    static size_t hashHeader(HeaderId headerId, StringView headerName);
+    size_t findHeader(HeaderId headerId, StringView headerName) const;
+    template <typename Value>
+    void storeHeader(HeaderId headerId, StringView headerName,
+                     Value &&headerValue, bool replace);
+    void appendHeader(HeaderId headerId, StringView headerName,
+                      StringView headerValue);
+    bool finishDecode(bool parsed, size_t length);
+    void eraseHeader(size_t position);
+    void rebuildIndex(size_t capacity);
+    void dropRepeats(size_t position);
+    StringView getField(size_t position, size_t index) const;
+    template <typename Function>
+    void forEachHeaderLine(Function &&function) const;
+    template <typename Sink> size_t foldMessage(Sink &sink) const;
 };
 
 } // namespace msg
@@ -0,0 +1,133 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-18 14:02:51
+ * @LastEditTime: 2019-09-06 12:07:44
+ * @Description: A declaration of class msg::MessageParser.
+ */
+#ifndef MESSAGE_MESSAGEPARSER_HPP
+#define MESSAGE_MESSAGEPARSER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <message/Message.hpp>
+#include <message/ParseLimits.hpp>
+#include <message/Stats.hpp>
+#include <string>
+
+namespace msg {
+
+/**
+ * @description:
+ *     A push parser fills a message from data arriving in chunks. Every
+ *     byte is scanned once, a line split across chunks is resumed where
+ *     the previous chunk stopped.
+ *
+ *     The body is framed by headers. With Transfer-Encoding: chunked it
+ *     is decoded chunk by chunk, with Content-Length exactly that many
+ *     bytes are taken, the bytes are kept as they are. Without both a
+ *     request or a SIP message has no body, as have 1xx, 204 and 304
+ *     responses. The body of another response lasts until finish() and
+ *     is kept as it is too. Only the body of a message without start line
+ *     is normalized as parseFromMessage() does. Empty lines before the
+ *     start line of a message after the first are ignored, as RFC 7230
+ *     3.5 and RFC 3261 7.5 ask of a stream.
+ *
+ *     A message is counted in the stats when it completes, each call of
+ *     feed() and finish() is timed as a parse.
+ */
+class MessageParser {
+public:
+    explicit MessageParser(Message &message);
+    ~MessageParser() = default;
+    MessageParser(const MessageParser &) = delete;
+    MessageParser(MessageParser &&) = delete;
+    MessageParser &operator=(const MessageParser &) = delete;
+    MessageParser &operator=(MessageParser &&) = delete;
+
+public:
+    enum class Status {
+        NeedMore,        // All data was consumed, feed more.
+        HeadersComplete, // The blank line after headers was consumed.
+        Complete,        // The message was completed.
+        Error,           // The message is malformed.
+    };
+    // Receives body bytes in place of the message, the bytes refer to the
+    // fed chunk and are valid during the call only.
+    typedef std::function<void(const char *data, size_t length)> BodySink;
+    // Receives a completed message and the number of bytes it used, the
+    // message is reset for the next one after the call.
+    typedef std::function<void(Message &message, size_t length)>
+        MessageHandler;
+
+    Status feed(const char *data, size_t length);
+    Status feedMessages(const char *data, size_t length,
+                        const MessageHandler &onMessage);
+    Status finish();
+    size_t getConsumed() const;
+    ParseError getError() const;
+    void reset();
+    void reset(Message &message);
+    void setLineLength(size_t maxLength);
+    void setLimits(const ParseLimits &limits);
+    void setBodySink(BodySink bodySink);
+
+private:
+    enum class State {
+        Headers,   // Header lines.
+        Body,      // A body lasts until finish().
+        Content,   // A body of Content-Length bytes.
+        ChunkSize, // The size line of a chunk.
+        ChunkData, // The data of a chunk.
+        ChunkEnd,  // The CRLF after the data of a chunk.
+        Trailers,  // Trailer lines after the last chunk.
+        Done,
+        Failed,
+    };
+
+    Message *message_;
+    State state_ = State::Headers;
+    bool firstLine_ = true; // The next line may be a start line.
+    bool afterMessage_ = false; // A message was completed, kept by reset().
+    std::string line_; // A line split across chunks.
+    bool pendingCR_ = false;
+    std::string name_;  // The header waiting for folded lines.
+    std::string value_;
+    bool pendingHeader_ = false;
+    std::string body_;
+    size_t bodyLineLength_ = 0;
+    char lastBodyChar_ = '\0';
+    uint64_t remaining_ = 0; // Bytes left of the content or the chunk.
+    size_t messageLength_ = 0; // Bytes used by the message so far.
+    size_t consumed_ = 0;
+    size_t maxLineLength_ = 0;
+    ParseLimits limits_;
+    size_t headerBytes_ = 0; // Of the lines of headers and trailers.
+    size_t headerCount_ = 0;
+    size_t fieldBytes_ = 0; // Of the pending header.
+    size_t continuations_ = 0; // Of the pending header.
+    size_t unfolds_ = 0;
+    uint64_t bodyBytes_ = 0;
+    ParseError error_ = ParseError::None;
+    BodySink bodySink_;
+
+private:
+    Status fail(ParseError error);
+    bool checkLine(size_t lineBytes);
+    bool readLine(const char *data, size_t length, size_t &pos,
+                  const char *&line, size_t &lineLength);
+    Status onLine(const char *line, size_t length);
+    bool onHeaderLine(const char *line, size_t length);
+    Status startBody();
+    bool onChunkSize(const char *line, size_t length);
+    void deliver(const char *data, size_t length);
+    Status completeBody();
+    void countMessage() const;
+    bool checkBodyLines(const char *data, size_t length);
+    void commitHeader();
+};
+
+} // namespace msg
+
+#endif // MESSAGE_MESSAGEPARSER_HPP
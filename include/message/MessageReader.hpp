@@ -0,0 +1,88 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 15:02:44
+ * @LastEditTime: 2019-09-06 09:52:18
+ * @Description: A declaration of class msg::MessageReader.
+ */
+#ifndef MESSAGE_MESSAGEREADER_HPP
+#define MESSAGE_MESSAGEREADER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <message/EventLoop.hpp>
+#include <message/Message.hpp>
+#include <message/MessageParser.hpp>
+#include <string>
+
+namespace msg {
+
+/**
+ * @description:
+ *     A reader of messages from a non-blocking descriptor driven by an
+ *     event loop. Data is read into one reusable buffer and framed by a
+ *     MessageParser, each completed message is handed to a handler. A
+ *     request or SIP message without Content-Length or chunked coding has
+ *     no body, an HTTP response without them lasts until the peer closes.
+ *
+ *     The reader doesn't own the descriptor, it must be stopped before
+ *     the descriptor is closed. It must not be destroyed from its own
+ *     handlers, stop() it there instead.
+ */
+class MessageReader {
+public:
+    MessageReader(EventLoop &loop, int fd);
+    ~MessageReader();
+    MessageReader(const MessageReader &) = delete;
+    MessageReader(MessageReader &&) = delete;
+    MessageReader &operator=(const MessageReader &) = delete;
+    MessageReader &operator=(MessageReader &&) = delete;
+
+public:
+    // Receives a completed message, it is reset after the call.
+    typedef std::function<void(Message &message)> MessageHandler;
+    // Called once when reading ends, failed is false if the peer closed
+    // between messages.
+    typedef std::function<void(bool failed)> CloseHandler;
+
+    static const size_t defaultBufferSize = 16384;
+
+    bool start(MessageHandler onMessage, CloseHandler onClose);
+    void pause();
+    void resume();
+    void stop();
+    bool isReading() const;
+    void setLineLength(size_t maxLength);
+    void setLimits(const ParseLimits &limits);
+    void setBufferSize(size_t size);
+    uint64_t getMessageCount() const;
+    ParseError getParseError() const;
+
+private:
+    EventLoop &loop_;
+    int fd_;
+    Message message_;
+    MessageParser parser_;
+    std::string buffer_;
+    size_t begin_ = 0; // Unparsed data of the buffer.
+    size_t end_ = 0;
+    size_t bufferSize_ = defaultBufferSize;
+    bool started_ = false;
+    bool paused_ = false;
+    bool dispatching_ = false;
+    bool partial_ = false; // A message was started but not completed.
+    uint64_t messageCount_ = 0;
+    MessageHandler onMessage_;
+    CloseHandler onClose_;
+
+private:
+    void onReadable();
+    bool dispatch();
+    void deliver();
+    void close(bool failed);
+};
+
+} // namespace msg
+
+#endif // MESSAGE_MESSAGEREADER_HPP
@@ -0,0 +1,90 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-04 10:05:42
+ * @LastEditTime: 2019-09-06 12:07:44
+ * @Description: A declaration of class msg::MessageTemplate.
+ */
+#ifndef MESSAGE_MESSAGETEMPLATE_HPP
+#define MESSAGE_MESSAGETEMPLATE_HPP
+
+#include <initializer_list>
+#include <message/HeaderNames.hpp>
+#include <message/StringView.hpp>
+#include <string>
+#include <vector>
+
+struct iovec;
+
+namespace msg {
+class Message;
+
+/**
+ * @description:
+ *     A message precompiled by Message::produceToTemplate(), for messages
+ *     of the same shape where only a few headers or the body change. The
+ *     fixed lines are produced and folded once, a message is then written
+ *     from the fixed text and the values of the slots in one pass.
+ *
+ *     A slot stands for a header, produced as one line at the place of the
+ *     header in the message or after the other headers if the message has
+ *     none, or for the body. Slots are added before the template is
+ *     compiled and values are given in the order the slots were added.
+ */
+class MessageTemplate {
+public:
+    MessageTemplate() = default;
+    ~MessageTemplate() = default;
+    MessageTemplate(const MessageTemplate &) = default;
+    MessageTemplate(MessageTemplate &&) = default;
+    MessageTemplate &operator=(const MessageTemplate &) = default;
+    MessageTemplate &operator=(MessageTemplate &&) = default;
+
+public:
+    size_t addSlot(HeaderId headerId);
+    size_t addSlot(StringView headerName);
+    size_t addBodySlot();
+    size_t getSlotCount() const;
+    bool isCompiled() const;
+    void clear();
+    bool produceToMessage(std::string &targetMessage, const StringView *values,
+                          size_t count) const;
+    bool produceToMessage(std::string &targetMessage,
+                          std::initializer_list<StringView> values) const;
+    bool produceToIovec(std::vector<iovec> &dest, const StringView *values,
+                        size_t count, std::string &foldBuffer) const;
+
+private:
+    friend class Message;
+
+    struct Slot {
+        HeaderId id;
+        std::string name; // The name of a header, empty for the body.
+    };
+
+    // A slot in the output, text_ from the end of the previous piece to
+    // textEnd is written before it and the line prefix "name: " up to
+    // prefixEnd. A header slot is followed by a line terminator.
+    struct Piece {
+        size_t textEnd;
+        size_t prefixEnd;
+        size_t slot;
+    };
+
+    std::vector<Slot> slots_;
+    std::string text_;
+    std::vector<Piece> pieces_;
+    size_t maxLineLength_ = 0;
+    bool compiled_ = false;
+
+private:
+    size_t findSlot(HeaderId headerId, StringView headerName) const;
+    void appendSlot(size_t slot, StringView headerName);
+    bool isBody(size_t slot) const;
+    bool isFolded(const Piece &piece, StringView value) const;
+};
+
+} // namespace msg
+
+#endif // MESSAGE_MESSAGETEMPLATE_HPP
@@ -0,0 +1,130 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-17 09:35:20
+ * @LastEditTime: 2019-09-06 10:17:26
+ * @Description: A declaration of class msg::MessageView.
+ */
+#ifndef MESSAGE_MESSAGEVIEW_HPP
+#define MESSAGE_MESSAGEVIEW_HPP
+
+#include <bitset>
+#include <cstdint>
+#include <message/Dialect.hpp>
+#include <message/HeaderNames.hpp>
+#include <message/ParseLimits.hpp>
+#include <message/StartLine.hpp>
+#include <message/Stats.hpp>
+#include <message/StringView.hpp>
+#include <string>
+#include <vector>
+
+namespace msg {
+
+/**
+ * @description:
+ *     A read-only message parsed in place. Names, values and body refer to
+ *     the caller's buffer, only folded values and multi-line bodies are
+ *     copied into an internal buffer. The raw message must outlive the view.
+ *     Once headers are selected, only the selected ones are unfolded while
+ *     parsing, the other values and the body are unfolded on first access.
+ *     A message is parsed by the rules of all protocols at once, or by
+ *     those of one protocol given as a dialect.
+ */
+class MessageView {
+public:
+    MessageView() = default;
+    ~MessageView() = default;
+    MessageView(const MessageView &) = delete;
+    MessageView(MessageView &&) = default;
+    MessageView &operator=(const MessageView &) = delete;
+    MessageView &operator=(MessageView &&) = default;
+
+public:
+    struct Field {
+        StringView name;
+        StringView value;
+    };
+
+    bool parse(const char *data, size_t length);
+    bool parse(const std::string &rawMessage);
+    template <typename Dialect> bool parse(const char *data, size_t length);
+    void clear();
+    ParseError getError() const;
+    const StartLine &getStartLine() const;
+    size_t getHeaderCount() const;
+    Field getHeader(size_t index) const;
+    bool hasHeader(StringView headerName) const;
+    StringView getHeaderValue(StringView headerName) const;
+    StringView getHeaderValue(HeaderId headerId) const;
+    StringView getBody() const;
+    void setLineLength(size_t maxLength);
+    void setLimits(const ParseLimits &limits);
+    void selectHeader(HeaderId headerId);
+    void selectHeader(StringView headerName);
+    void clearSelection();
+
+private:
+    // A range of either the raw message or the internal buffer.
+    struct Span {
+        size_t offset = 0;
+        size_t length = 0;
+        bool owned = false;
+    };
+    struct Entry {
+        Span name;
+        Span value;
+        // The raw value isn't unfolded and trimmed yet.
+        bool lazy = false;
+        // The raw value spans continuation lines.
+        bool folded = false;
+        // Set for selected headers only.
+        HeaderId id = HeaderId::Unknown;
+    };
+    struct Selection {
+        std::string name;
+        HeaderId id;
+    };
+
+    const char *data_ = nullptr;
+    size_t length_ = 0;
+    StartLine startLine_;
+    // Lazy values and the body are unfolded by the getters. The buffer
+    // never holds more than the raw message, it is reserved that large
+    // before it is first written so views handed out stay valid.
+    mutable std::vector<Entry> fields_;
+    mutable Span body_;
+    mutable std::string buffer_;
+    size_t maxLineLength_ = 0;
+    ParseLimits limits_;
+    mutable bool lazyBody_ = false;
+    // Single letter names are compact forms in the dialect parsed by.
+    bool compactForms_ = true;
+    ParseError error_ = ParseError::None;
+    // Continuation lines of the message being parsed.
+    size_t unfolds_ = 0;
+    // Bit n is set if a selected name is n characters long, the last bit
+    // stands for all longer names. No bit is set without a selection.
+    uint64_t selectedLengths_ = 0;
+    std::bitset<static_cast<size_t>(HeaderId::Count)> selectedIds_;
+    std::vector<Selection> selection_;
+
+private:
+    bool parseBody(const char *start, const char *end, size_t maxLength,
+                   bool raw);
+    bool joinBody(const char *start, const char *end, size_t maxLength) const;
+    bool fail(ParseError error);
+    bool isSelected(StringView headerName, bool compactForms,
+                    HeaderId &headerId) const;
+    void materialize(Entry &entry) const;
+    void materializeBody() const;
+    StringView resolve(const Span &span) const;
+    void own(Span &span) const;
+    void append(Span &span, size_t offset, size_t length) const;
+    void trim(Span &span) const;
+};
+
+} // namespace msg
+
+#endif // MESSAGE_MESSAGEVIEW_HPP
@@ -0,0 +1,78 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 15:48:09
+ * @LastEditTime: 2019-09-06 12:07:44
+ * @Description: A declaration of class msg::MessageWriter.
+ */
+#ifndef MESSAGE_MESSAGEWRITER_HPP
+#define MESSAGE_MESSAGEWRITER_HPP
+
+#include <functional>
+#include <message/EventLoop.hpp>
+#include <message/Message.hpp>
+#include <message/MessageTemplate.hpp>
+#include <message/StringView.hpp>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+namespace msg {
+
+/**
+ * @description:
+ *     A writer of messages to a non-blocking descriptor driven by an event
+ *     loop. A message is written at once with vectored I/O from its own
+ *     strings, only what the descriptor doesn't take is copied to a
+ *     pending buffer, written when the descriptor becomes writable.
+ *     Messages sent meanwhile are appended to the pending buffer in order.
+ *     So a message may be changed or destroyed as soon as send() returns.
+ *     A message is sent byte for byte as produceToMessage() produces it.
+ *
+ *     The writer doesn't own the descriptor, it must be destroyed or
+ *     emptied before the descriptor is closed.
+ */
+class MessageWriter {
+public:
+    MessageWriter(EventLoop &loop, int fd);
+    ~MessageWriter();
+    MessageWriter(const MessageWriter &) = delete;
+    MessageWriter(MessageWriter &&) = delete;
+    MessageWriter &operator=(const MessageWriter &) = delete;
+    MessageWriter &operator=(MessageWriter &&) = delete;
+
+public:
+    // Called when the pending buffer was written or writing failed.
+    typedef std::function<void()> DrainHandler;
+
+    bool send(const Message &message);
+    bool send(const MessageTemplate &messageTemplate, const StringView *values,
+              size_t count);
+    bool sendRaw(StringView data);
+    size_t getPendingLength() const;
+    int getError() const;
+    void setDrainHandler(DrainHandler onDrain);
+
+private:
+    EventLoop &loop_;
+    int fd_;
+    std::vector<iovec> iov_;   // Reused for each message.
+    std::string foldBuffer_;   // Holds a folded message.
+    std::string pending_;      // Data the descriptor didn't take yet.
+    size_t pendingOffset_ = 0; // Data of pending_ written already.
+    int error_ = 0;
+    bool socket_ = true; // Written with sendmsg() to avoid SIGPIPE.
+    DrainHandler onDrain_;
+
+private:
+    bool write();
+    ssize_t writeVectors(const iovec *vecs, size_t count);
+    void keep(size_t index);
+    void onWritable();
+    void fail(int error);
+};
+
+} // namespace msg
+
+#endif // MESSAGE_MESSAGEWRITER_HPP
@@ -0,0 +1,41 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 21:04:37
+ * @LastEditTime: 2019-09-06 10:52:44
+ * @Description: A declaration of struct msg::ParseLimits.
+ */
+#ifndef MESSAGE_PARSELIMITS_HPP
+#define MESSAGE_PARSELIMITS_HPP
+
+#include <cstddef>
+
+namespace msg {
+
+/**
+ * @description:
+ *     Bounds on the resources a message may take while it is parsed. Each
+ *     bound is checked as soon as the bytes it counts are seen, so hostile
+ *     input is rejected before it is scanned or copied any further. A
+ *     bound of 0 means none, as for the line length limit.
+ */
+struct ParseLimits {
+    // Header and trailer fields, repeated names are counted apart.
+    size_t maxHeaderCount = 0;
+    // Bytes of the start line, the header lines and the trailer lines with
+    // their line terminators, the blank lines aren't counted.
+    size_t maxHeaderBytes = 0;
+    // Bytes of one field over all its lines, without its last line
+    // terminator. A chunk size line is bounded by it too, by 4096 bytes
+    // without it.
+    size_t maxFieldBytes = 0;
+    // Continuation lines of one field.
+    size_t maxContinuations = 0;
+    // Bytes of the body as received, before it is joined or decoded.
+    size_t maxBodyBytes = 0;
+};
+
+} // namespace msg
+
+#endif // MESSAGE_PARSELIMITS_HPP
@@ -0,0 +1,179 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 19:48:33
+ * @LastEditTime: 2019-09-06 10:04:51
+ * @Description: A declaration of class msg::SharedMessage.
+ */
+#ifndef MESSAGE_SHAREDMESSAGE_HPP
+#define MESSAGE_SHAREDMESSAGE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <message/HeaderNames.hpp>
+#include <message/StartLine.hpp>
+#include <message/StringView.hpp>
+#include <string>
+#include <vector>
+
+namespace msg {
+
+/**
+ * @description:
+ *     An immutable message shared by reference count, made by
+ *     Message::produceToShared(). The start line, the header table and
+ *     all strings live in one allocation that is never written after it
+ *     was made, so any number of threads read it without locks. Copies
+ *     share the allocation, only copying and destroying a handle touch
+ *     the atomic count.
+ *
+ *     mutate() starts a copy on write. The committed message holds the
+ *     strings of changed headers only and refers to the original for the
+ *     rest, which it keeps alive, as long as the original holds all its
+ *     strings and the message keeps at least a quarter of them. Otherwise the
+ *     rest is copied too, so no message keeps more than one other alive
+ *     nor mostly dead text.
+ */
+class SharedMessage {
+public:
+    SharedMessage() = default;
+    ~SharedMessage();
+    SharedMessage(const SharedMessage &other);
+    SharedMessage(SharedMessage &&other) noexcept;
+    SharedMessage &operator=(const SharedMessage &other);
+    SharedMessage &operator=(SharedMessage &&other) noexcept;
+    friend class Message;
+
+public:
+    struct Field {
+        HeaderId id;
+        StringView name;
+        StringView value;
+    };
+    class Mutation;
+
+    bool empty() const;
+    size_t getUseCount() const;
+    StringView getStartLine() const;
+    Method getMethod() const;
+    StringView getTarget() const;
+    unsigned getStatusCode() const;
+    size_t getHeaderCount() const;
+    Field getHeader(size_t index) const;
+    bool hasHeader(HeaderId headerId) const;
+    bool hasHeader(StringView headerName) const;
+    StringView getHeaderValue(HeaderId headerId) const;
+    StringView getHeaderValue(StringView headerName) const;
+    size_t getHeaderFieldCount(HeaderId headerId) const;
+    StringView getHeaderField(HeaderId headerId, size_t index) const;
+    StringView getBody() const;
+    void produceToMessage(std::string &targetMessage) const;
+    Mutation mutate() const;
+
+private:
+    // The end of a field and the start of the next one in a value.
+    struct Boundary {
+        uint32_t end;
+        uint32_t begin;
+    };
+    struct Entry {
+        const char *name;
+        const char *value;
+        uint32_t nameLength;
+        uint32_t valueLength;
+        uint32_t boundaryIndex; // The first boundary in the block.
+        uint32_t boundaryCount;
+        HeaderId id;
+    };
+    // Followed by the entries, the boundaries and the text in the same
+    // allocation. Strings may refer to the text of the parent.
+    struct Block {
+        std::atomic<size_t> references;
+        Block *parent; // Holds strings of unchanged headers, or null.
+        const char *line;
+        uint32_t lineLength;
+        uint32_t targetOffset;
+        uint32_t targetLength;
+        unsigned statusCode;
+        Method method;
+        bool compactForms;
+        bool repeatsFields; // Every header is produced a line per field.
+        const char *body;
+        size_t bodyLength;
+        size_t textLength; // The text of this block, not of the parent.
+        uint32_t entryCount;
+        uint32_t boundaryCount;
+
+        Entry *entries();
+        Boundary *boundaries();
+        char *text();
+    };
+
+    Block *block_ = nullptr;
+
+private:
+    explicit SharedMessage(Block *block);
+    static Block *allocate(size_t entryCount, size_t boundaryCount,
+                           size_t textLength, Block *parent);
+    static void release(Block *block);
+    static char *writeStartLine(Block *block, const StartLine &startLine,
+                                char *text);
+    size_t findHeader(HeaderId headerId, StringView headerName) const;
+};
+
+/**
+ * @description:
+ *     Changes to a shared message applied by commit() to a new shared
+ *     message, the original stays unchanged. Changed headers are copied,
+ *     the others and the body are shared with the original.
+ */
+class SharedMessage::Mutation {
+public:
+    explicit Mutation(const SharedMessage &source);
+    ~Mutation() = default;
+    Mutation(const Mutation &) = delete;
+    Mutation(Mutation &&) = default;
+    Mutation &operator=(const Mutation &) = delete;
+    Mutation &operator=(Mutation &&) = default;
+
+public:
+    void setStartLine(const StartLine &startLine);
+    void setHeader(StringView headerName, StringView headerValue);
+    void addHeader(StringView headerName, StringView headerValue);
+    void prependHeader(StringView headerName, StringView headerValue);
+    void removeHeader(StringView headerName);
+    void setBody(StringView bodyText);
+    SharedMessage commit() const;
+
+private:
+    // A header copied for a change.
+    struct Change {
+        HeaderId id;
+        std::string name;
+        std::string value;
+        std::vector<Boundary> boundaries;
+    };
+    // A header of the result, either of the source or changed.
+    struct Slot {
+        size_t entry;  // The position in the source, npos if changed.
+        size_t change; // The position in changes_, npos if unchanged.
+    };
+
+    SharedMessage source_;
+    std::vector<Slot> slots_;
+    std::vector<Change> changes_;
+    StartLine startLine_;
+    bool startLineSet_ = false;
+    std::string body_;
+    bool bodySet_ = false;
+
+private:
+    size_t findSlot(StringView headerName) const;
+    Change &change(size_t position);
+    void addField(StringView headerName, StringView headerValue, bool first);
+};
+
+} // namespace msg
+
+#endif // MESSAGE_SHAREDMESSAGE_HPP
@@ -0,0 +1,88 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-02 10:20:37
+ * @LastEditTime: 2019-09-02 10:20:37
+ * @Description: A declaration of class msg::SnapshotView.
+ */
+#ifndef MESSAGE_SNAPSHOTVIEW_HPP
+#define MESSAGE_SNAPSHOTVIEW_HPP
+
+#include <cstdint>
+#include <message/HeaderNames.hpp>
+#include <message/StartLine.hpp>
+#include <message/StringView.hpp>
+#include <vector>
+
+namespace msg {
+
+/**
+ * @description:
+ *     A read-only message decoded in place from a binary snapshot written
+ *     by Message::produceToSnapshot(). Names, values and body refer to the
+ *     snapshot, which must outlive the view, so a snapshot is readable
+ *     straight from a mapped file.
+ *
+ *     A snapshot is a 16 bytes header of the magic "MSGS", the version,
+ *     three reserved zero bytes and the length of the whole snapshot as a
+ *     64-bit little-endian number. The start line, the number of headers,
+ *     each header and the body follow, then the CRC-32C of all preceding
+ *     bytes as a 32-bit little-endian number. A header is its identifier
+ *     in one byte, its name and value, the number of boundaries between
+ *     its fields and each boundary as the end of a field and the start of
+ *     the next one in the value. Strings are prefixed by their lengths,
+ *     lengths and numbers are LEB128 encoded.
+ */
+class SnapshotView {
+public:
+    SnapshotView() = default;
+    ~SnapshotView() = default;
+    SnapshotView(const SnapshotView &) = delete;
+    SnapshotView(SnapshotView &&) = default;
+    SnapshotView &operator=(const SnapshotView &) = delete;
+    SnapshotView &operator=(SnapshotView &&) = default;
+
+public:
+    static const char magic[4];
+    static const uint8_t version = 1;
+    static const size_t headerLength = 16;
+    static const size_t trailerLength = 4;
+
+    struct Field {
+        HeaderId id;
+        StringView name;
+        StringView value;
+    };
+
+    bool parse(const char *data, size_t length);
+    void clear();
+    size_t getLength() const;
+    const StartLine &getStartLine() const;
+    size_t getHeaderCount() const;
+    Field getHeader(size_t index) const;
+    size_t getHeaderFieldCount(size_t index) const;
+    StringView getHeaderField(size_t index, size_t field) const;
+    StringView getBody() const;
+
+private:
+    struct Entry {
+        HeaderId id;
+        StringView name;
+        StringView value;
+        const char *boundaries; // The encoded boundaries between fields.
+        size_t boundaryCount;
+    };
+
+    size_t length_ = 0;
+    StartLine startLine_;
+    std::vector<Entry> fields_;
+    StringView body_;
+
+private:
+    bool decode(const char *data, size_t length);
+};
+
+} // namespace msg
+
+#endif // MESSAGE_SNAPSHOTVIEW_HPP
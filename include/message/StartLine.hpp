@@ -0,0 +1,106 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-30 09:20:14
+ * @LastEditTime: 2019-08-30 09:20:14
+ * @Description: A declaration of class msg::StartLine.
+ */
+#ifndef MESSAGE_STARTLINE_HPP
+#define MESSAGE_STARTLINE_HPP
+
+#include <cstdint>
+#include <message/StringView.hpp>
+#include <string>
+
+namespace msg {
+
+/**
+ * @description:
+ *     Identifiers of HTTP and SIP request methods, method names are case
+ *     sensitive.
+ */
+enum class Method : uint8_t {
+    Unknown = 0,
+    Ack,
+    Bye,
+    Cancel,
+    Connect,
+    Delete,
+    Get,
+    Head,
+    Info,
+    Invite,
+    Message,
+    Notify,
+    Options,
+    Patch,
+    Post,
+    Prack,
+    Publish,
+    Put,
+    Refer,
+    Register,
+    Subscribe,
+    Trace,
+    Update,
+    Count, // The number of identifiers, not a method.
+};
+
+Method lookupMethod(StringView methodName);
+StringView getMethodName(Method method);
+
+/**
+ * @description:
+ *     The first line of an HTTP or SIP message, either a request line
+ *     "METHOD target VERSION" or a status line "VERSION code reason".
+ *     The line is kept as a whole and its parts are views into it.
+ */
+class StartLine {
+public:
+    StartLine() = default;
+    ~StartLine() = default;
+    StartLine(const StartLine &) = default;
+    StartLine(StartLine &&) = default;
+    StartLine &operator=(const StartLine &) = default;
+    StartLine &operator=(StartLine &&) = default;
+
+public:
+    enum class Type { None, Request, Status };
+
+    bool parse(const char *line, size_t length);
+    void clear();
+    Type getType() const;
+    Method getMethod() const;
+    StringView getMethodName() const;
+    StringView getTarget() const;
+    StringView getVersion() const;
+    unsigned getStatusCode() const;
+    StringView getReason() const;
+    StringView getText() const;
+    bool setRequest(StringView methodName, StringView target,
+                    StringView version);
+    bool setStatus(StringView version, unsigned statusCode,
+                   StringView reason);
+
+private:
+    struct Span {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    std::string text_;
+    Type type_ = Type::None;
+    Method method_ = Method::Unknown;
+    unsigned statusCode_ = 0;
+    // Method, target and version of a request, or version, code and
+    // reason of a status.
+    Span parts_[3];
+
+private:
+    StringView resolve(const Span &span) const;
+};
+
+} // namespace msg
+
+#endif // MESSAGE_STARTLINE_HPP
@@ -0,0 +1,160 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 09:20:34
+ * @LastEditTime: 2019-09-05 21:04:37
+ * @Description: A declaration of parse errors and of the instrumentation
+ *     of parsing and producing messages.
+ */
+#ifndef MESSAGE_STATS_HPP
+#define MESSAGE_STATS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <message/StringView.hpp>
+
+namespace msg {
+
+/**
+ * @description:
+ *     Reasons a message was rejected by the parser.
+ */
+enum class ParseError : uint8_t {
+    None = 0,
+    BareCarriageReturn,    // A CR not followed by LF.
+    LineTooLong,           // A line over the line length limit.
+    OrphanContinuation,    // A continuation line before any header.
+    InvalidName,           // A header name with invalid characters.
+    InvalidCharacter,      // A header line with invalid characters.
+    InvalidEncoding,       // A malformed snapshot or HTTP/2 header block.
+    InvalidStartLine,      // A missing start line or one of another protocol.
+    ObsoleteFolding,       // A continuation line where folding is obsolete.
+    InvalidFraming,        // A malformed length or chunk, or a cut body.
+    TooManyHeaders,        // More header fields than the limit.
+    HeaderSectionTooLarge, // A header section over the limit.
+    FieldTooLarge,         // A header field over the limit.
+    TooManyContinuations,  // More continuation lines than the limit.
+    BodyTooLarge,          // A body over the limit.
+    Count,                 // The number of reasons, not a reason.
+};
+
+/**
+ * @description:
+ *     Events counted per thread.
+ */
+enum class Counter : uint8_t {
+    Messages = 0,  // Messages parsed.
+    Bytes,         // Bytes of messages parsed.
+    Headers,       // Header fields parsed.
+    Unfolds,       // Continuation lines unfolded while parsing.
+    Produced,      // Messages produced.
+    ProducedBytes, // Bytes of messages produced.
+    Folds,         // Lines broken while producing.
+    Count,         // The number of counters, not a counter.
+};
+
+/**
+ * @description:
+ *     Phases of parsing and producing timed on sampled messages. Parse
+ *     and Produce are whole calls, the others are parts of them.
+ */
+enum class Phase : uint8_t {
+    Parse = 0,
+    SplitLines, // Finding line ends, colons and invalid characters.
+    Validate,   // Checking header names and start lines.
+    Unfold,     // Joining continuation lines.
+    Trim,       // Joining the body and trimming values.
+    Produce,
+    Fold,       // Breaking long lines.
+    Count,      // The number of phases, not a phase.
+};
+
+StringView getParseErrorName(ParseError error);
+StringView getCounterName(Counter counter);
+StringView getPhaseName(Phase phase);
+
+/**
+ * @description:
+ *     A histogram of latencies in nanoseconds with log-linear buckets in
+ *     the style of HdrHistogram, each power of two is split into 16
+ *     buckets so a value is kept within 6.25%. Values over half an hour
+ *     share the last bucket.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram() = default;
+    ~LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram &) = default;
+    LatencyHistogram(LatencyHistogram &&) = default;
+    LatencyHistogram &operator=(const LatencyHistogram &) = default;
+    LatencyHistogram &operator=(LatencyHistogram &&) = default;
+
+public:
+    static const size_t subBucketCount = 16;
+    static const size_t bucketCount = subBucketCount * 38;
+
+    static size_t getBucket(uint64_t value);
+    static uint64_t getBucketLimit(size_t bucket);
+
+    void record(uint64_t value, uint64_t count = 1);
+    void merge(const LatencyHistogram &other);
+    void clear();
+    uint64_t getCount() const;
+    uint64_t getBucketCount(size_t bucket) const;
+    uint64_t getPercentile(double percentile) const;
+
+private:
+    uint64_t buckets_[bucketCount] = {};
+    uint64_t count_ = 0;
+};
+
+/**
+ * @description:
+ *     Counters, rejects and phase latencies of all threads merged at one
+ *     point in time. Totals only grow, a poller takes deltas between
+ *     snapshots.
+ */
+class StatsSnapshot {
+public:
+    StatsSnapshot() = default;
+    ~StatsSnapshot() = default;
+    StatsSnapshot(const StatsSnapshot &) = default;
+    StatsSnapshot(StatsSnapshot &&) = default;
+    StatsSnapshot &operator=(const StatsSnapshot &) = default;
+    StatsSnapshot &operator=(StatsSnapshot &&) = default;
+
+public:
+    uint64_t getCounter(Counter counter) const;
+    uint64_t getRejects(ParseError error) const;
+    const LatencyHistogram &getPhase(Phase phase) const;
+    void clear();
+
+private:
+    friend class Stats;
+
+    uint64_t counters_[static_cast<size_t>(Counter::Count)] = {};
+    uint64_t rejects_[static_cast<size_t>(ParseError::Count)] = {};
+    LatencyHistogram phases_[static_cast<size_t>(Phase::Count)];
+};
+
+/**
+ * @description:
+ *     The instrumentation of parsing and producing, compiled in with
+ *     MESSAGE_ENABLE_STATS. Each thread counts into its own block without
+ *     locks or atomic read-modify-writes, a snapshot reads the blocks
+ *     while they are written. Phases are timed on one of every interval
+ *     messages per thread. Without the option nothing is counted and
+ *     snapshots stay empty.
+ */
+class Stats {
+public:
+    static bool isEnabled();
+    static void setSampleInterval(uint32_t interval);
+    static uint32_t getSampleInterval();
+    static void takeSnapshot(StatsSnapshot &snapshot);
+};
+
+} // namespace msg
+
+#endif // MESSAGE_STATS_HPP
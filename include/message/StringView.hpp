@@ -0,0 +1,80 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-17 09:31:47
+ * @LastEditTime: 2019-08-17 09:31:47
+ * @Description: A declaration of class msg::StringView.
+ */
+#ifndef MESSAGE_STRINGVIEW_HPP
+#define MESSAGE_STRINGVIEW_HPP
+
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace msg {
+
+/**
+ * @description:
+ *     A non-owning reference to a range of characters, the referenced
+ *     storage must outlive the view.
+ */
+class StringView {
+public:
+    typedef const char *const_iterator;
+    static const size_t npos = static_cast<size_t>(-1);
+
+    StringView() : data_(nullptr), size_(0) {}
+    StringView(const char *data, size_t size) : data_(data), size_(size) {}
+    StringView(const char *s) : data_(s), size_(s ? std::strlen(s) : 0) {}
+    StringView(const std::string &s) : data_(s.data()), size_(s.size()) {}
+
+public:
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t length() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+    char operator[](size_t pos) const { return data_[pos]; }
+
+    StringView substr(size_t pos, size_t count = npos) const {
+        if (pos > size_)
+            pos = size_;
+        if (count > size_ - pos)
+            count = size_ - pos;
+        return StringView(data_ + pos, count);
+    }
+
+    size_t find(char ch, size_t pos = 0) const {
+        if (pos >= size_)
+            return npos;
+        const void *found = std::memchr(data_ + pos, ch, size_ - pos);
+        if (!found)
+            return npos;
+        return static_cast<size_t>(static_cast<const char *>(found) - data_);
+    }
+
+    std::string toString() const { return std::string(data_, size_); }
+
+    friend bool operator==(StringView lhs, StringView rhs) {
+        return lhs.size_ == rhs.size_ &&
+               (lhs.size_ == 0 ||
+                std::memcmp(lhs.data_, rhs.data_, lhs.size_) == 0);
+    }
+    friend bool operator!=(StringView lhs, StringView rhs) {
+        return !(lhs == rhs);
+    }
+    friend std::ostream &operator<<(std::ostream &os, StringView view) {
+        return os.write(view.data_, view.size_);
+    }
+
+private:
+    const char *data_;
+    size_t size_;
+};
+
+} // namespace msg
+
+#endif // MESSAGE_STRINGVIEW_HPP
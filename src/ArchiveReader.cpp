@@ -0,0 +1,378 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-28 10:13:05
+ * @LastEditTime: 2019-09-06 11:09:52
+ * @Description: An implementation of class msg::ArchiveReader.
+ */
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <message/ArchiveReader.hpp>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+const char fromLine[] = "From ";
+
+/**
+ * @description:
+ *     A queue of message ranges owned by one thread. The owner takes
+ *     ranges from the front, idle threads steal from the back, so the
+ *     owner keeps walking the archive in order.
+ */
+class WorkQueue {
+public:
+    typedef std::pair<size_t, size_t> Range;
+
+    void push(Range range) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ranges_.push_back(range);
+    }
+
+    bool pop(Range &range) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ranges_.empty())
+            return false;
+        range = ranges_.front();
+        ranges_.pop_front();
+        return true;
+    }
+
+    bool steal(Range &range) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ranges_.empty())
+            return false;
+        range = ranges_.back();
+        ranges_.pop_back();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<Range> ranges_;
+};
+
+/**
+ * @description:
+ *     Copy a message of an mbox into a buffer as the parser expects it.
+ *     Lines ended by LF get CRLF, and the quoting of mboxrd is removed
+ *     from ">From " lines.
+ * @param[in] data
+ *     A pointer to the message without its "From " line.
+ * @param[in] length
+ *     The length of the message.
+ * @param[out] buffer
+ *     A buffer the message is copied to.
+ */
+void unquoteMbox(const char *data, size_t length, std::string &buffer) {
+    buffer.clear();
+    buffer.reserve(length + length / 16);
+    const char *end = data + length;
+    while (data != end) {
+        const char *lf =
+            static_cast<const char *>(std::memchr(data, '\n', end - data));
+        const char *lineEnd = lf ? lf : end;
+
+        const char *start = data;
+        if (*start == '>') {
+            const char *quote = start;
+            while (quote != lineEnd && *quote == '>')
+                ++quote;
+            if (static_cast<size_t>(lineEnd - quote) >= 5 &&
+                std::memcmp(quote, fromLine, 5) == 0)
+                ++start;
+        }
+        const char *stop = lineEnd;
+        if (stop != start && stop[-1] == '\r')
+            --stop;
+        buffer.append(start, stop - start);
+        if (lf)
+            buffer.append("\r\n", 2);
+        data = lf ? lf + 1 : end;
+    }
+}
+
+} // namespace
+
+namespace msg {
+/**
+ * @description:
+ *     Destruct the reader, the archive is unmapped.
+ */
+ArchiveReader::~ArchiveReader() { close(); }
+
+// Public methods
+/**
+ * @description:
+ *     Map an archive into memory and find the messages in it.
+ * @param[in] path
+ *     The path of the archive.
+ * @param[in] format
+ *     The format of the archive.
+ * @return:
+ *     An indicator of whether or not the archive was opened and well
+ *     formed.
+ */
+bool ArchiveReader::open(const std::string &path, Format format) {
+    close();
+    format_ = format;
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_) {
+        void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        // Messages are split in one sequential pass.
+        ::madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char *>(data);
+    }
+    ::close(fd);
+
+    bool split = format_ == Format::Mbox ? splitMbox() : splitLengthPrefixed();
+    if (!split) {
+        close();
+        return false;
+    }
+    if (size_)
+        ::madvise(const_cast<char *>(data_), size_, MADV_WILLNEED);
+    return true;
+}
+
+/**
+ * @description:
+ *     Unmap the archive, raw messages got before become invalid.
+ */
+void ArchiveReader::close() {
+    if (data_)
+        ::munmap(const_cast<char *>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+    messages_.clear();
+}
+
+/**
+ * @description:
+ *     Get the number of messages in the archive.
+ * @return:
+ *     The number of messages.
+ */
+size_t ArchiveReader::getMessageCount() const { return messages_.size(); }
+
+/**
+ * @description:
+ *     Get a message as it is in the archive, without the "From " line of
+ *     an mbox or the length of a length prefixed archive.
+ * @param[in] index
+ *     The index of the message.
+ * @return:
+ *     A view of the message, valid until the reader is closed.
+ */
+StringView ArchiveReader::getRawMessage(size_t index) const {
+    return StringView(data_ + messages_[index].offset,
+                      messages_[index].length);
+}
+
+/**
+ * @description:
+ *     Parse all messages by a pool of threads. Each thread starts with a
+ *     contiguous part of the archive in ranges and steals ranges from
+ *     busy threads once its own are done.
+ * @param[in] onMessage
+ *     A handler called for each well formed message, it must be thread
+ *     safe.
+ * @param[in] threadCount
+ *     The number of threads, zero uses one per hardware thread.
+ * @return:
+ *     The number of malformed messages.
+ */
+size_t ArchiveReader::parse(const MessageHandler &onMessage,
+                            size_t threadCount) {
+    size_t count = messages_.size();
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::max<size_t>(1, std::min(threadCount, count));
+
+    // Ranges are small enough to balance and large enough to keep
+    // locking off the hot path.
+    size_t rangeSize = std::max<size_t>(1, count / (threadCount * 16));
+    rangeSize = std::min<size_t>(rangeSize, 256);
+    std::vector<WorkQueue> queues(threadCount);
+    for (size_t thread = 0; thread < threadCount; ++thread) {
+        size_t begin = count * thread / threadCount;
+        size_t end = count * (thread + 1) / threadCount;
+        for (; begin < end; begin += rangeSize) {
+            queues[thread].push(
+                WorkQueue::Range(begin, std::min(begin + rangeSize, end)));
+        }
+    }
+
+    std::atomic<size_t> malformed(0);
+    auto work = [&](size_t self) {
+        Message message;
+        std::string buffer;
+        size_t failed = 0;
+        WorkQueue::Range range;
+        for (;;) {
+            bool found = queues[self].pop(range);
+            for (size_t i = 1; !found && i < threadCount; ++i) {
+                found = queues[(self + i) % threadCount].steal(range);
+            }
+            if (!found)
+                break;
+
+            for (size_t index = range.first; index < range.second; ++index) {
+                message.reset();
+                if (parseMessage(index, message, buffer))
+                    onMessage(index, message);
+                else
+                    ++failed;
+            }
+        }
+        malformed += failed;
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t thread = 1; thread < threadCount; ++thread) {
+        threads.emplace_back(work, thread);
+    }
+    work(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return malformed;
+}
+
+/**
+ * @description:
+ *     Parse all messages by a pool of threads and keep them in order.
+ * @param[in] threadCount
+ *     The number of threads, zero uses one per hardware thread.
+ * @return:
+ *     Messages in the order of the archive, a malformed one is empty.
+ */
+std::vector<Message> ArchiveReader::parseAll(size_t threadCount) {
+    std::vector<Message> messages(messages_.size());
+    parse(
+        [&messages](size_t index, Message &message) {
+            messages[index] = std::move(message);
+        },
+        threadCount);
+    return messages;
+}
+
+// Private methods
+/**
+ * @description:
+ *     Split an mbox into messages at lines starting with "From ".
+ * @return:
+ *     An indicator of whether or not the archive started with a "From "
+ *     line, an empty archive is well formed.
+ */
+bool ArchiveReader::splitMbox() {
+    if (size_ == 0)
+        return true;
+    if (size_ < 5 || std::memcmp(data_, fromLine, 5) != 0)
+        return false;
+
+    const char *end = data_ + size_;
+    const char *from = data_;
+    while (from) {
+        const char *lf =
+            static_cast<const char *>(std::memchr(from, '\n', end - from));
+        const char *start = lf ? lf + 1 : end;
+
+        // Find the next line starting with "From ", start follows an LF.
+        const char *found =
+            start == end
+                ? nullptr
+                : static_cast<const char *>(
+                      memmem(start - 1, end - start + 1, "\nFrom ", 6));
+        const char *boundary = found ? found + 1 : nullptr;
+        const char *stop = boundary ? boundary : end;
+        // The blank line before a "From " line belongs to the separator.
+        if (boundary && stop != start) {
+            --stop;
+            if (stop != start && stop[-1] == '\r')
+                --stop;
+        }
+        messages_.push_back(Span{static_cast<size_t>(start - data_),
+                                 static_cast<size_t>(stop - start)});
+        from = boundary;
+    }
+    return true;
+}
+
+/**
+ * @description:
+ *     Split a length prefixed archive into messages.
+ * @return:
+ *     An indicator of whether or not every length was valid and within
+ *     the archive.
+ */
+bool ArchiveReader::splitLengthPrefixed() {
+    size_t pos = 0;
+    while (pos < size_) {
+        size_t length = 0;
+        size_t digits = 0;
+        while (pos < size_ && data_[pos] >= '0' && data_[pos] <= '9') {
+            if (length > (size_ - (data_[pos] - '0')) / 10)
+                return false;
+            length = length * 10 + (data_[pos] - '0');
+            ++pos;
+            ++digits;
+        }
+        if (!digits || pos == size_ || data_[pos] != '\n')
+            return false;
+        ++pos;
+        if (length > size_ - pos)
+            return false;
+        messages_.push_back(Span{pos, length});
+        pos += length;
+    }
+    return true;
+}
+
+/**
+ * @description:
+ *     Parse a message of the archive.
+ * @param[in] index
+ *     The index of the message.
+ * @param[out] message
+ *     The message to be filled.
+ * @param[in|out] buffer
+ *     A buffer reused for an mbox message converted to CRLF lines.
+ * @return:
+ *     An indicator of whether or not the message was well formed.
+ */
+bool ArchiveReader::parseMessage(size_t index, Message &message,
+                                 std::string &buffer) const {
+    StringView raw = getRawMessage(index);
+    if (format_ == Format::LengthPrefixed)
+        return message.parseFromMessage(raw.data(), raw.size());
+
+    // An mbox holds Internet messages, whose bodies keep their lines.
+    unquoteMbox(raw.data(), raw.size(), buffer);
+    return message.parseFromMessage<MailDialect>(buffer.data(),
+                                                 buffer.size());
+}
+
+} // namespace msg
@@ -0,0 +1,129 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 18:14:09
+ * @LastEditTime: 2019-09-05 18:14:09
+ * @Description: The parse rules of each protocol dialect.
+ */
+#ifndef MESSAGE_DIALECTRULES_HPP
+#define MESSAGE_DIALECTRULES_HPP
+
+#include "Syntax.hpp"
+#include <cstddef>
+#include <message/Dialect.hpp>
+#include <message/HeaderNames.hpp>
+#include <message/StringView.hpp>
+
+namespace msg {
+
+/**
+ * @description:
+ *     How the first line of a message is taken.
+ */
+enum class StartRule {
+    Optional, // A line with a space before any colon may be a start line.
+    Required, // The first line is a start line of the dialect's protocol.
+    Absent,   // The first line is a header.
+};
+
+/**
+ * @description:
+ *     The rules a dialect is parsed by, all members are compile time
+ *     constants so the branches on them are folded away.
+ *
+ *     lenient          Lines without colon continue a value and empty
+ *                      names are taken.
+ *     nameClass        The characters of a header name.
+ *     valueClass       The characters of a header line, kFieldValue lines
+ *                      are told by the line scan alone.
+ *     startRule        How the first line is taken.
+ *     protocol()       The prefix of the version of a required start line.
+ *     folding          Lines starting with whitespace continue a value.
+ *     spaceBeforeColon Whitespace between a name and its colon is
+ *                      allowed and dropped.
+ *     compactForms     Single letter names stand for SIP headers.
+ *     maxLineLength    The line length limit including CRLF, 0 leaves it
+ *                      to setLineLength().
+ *     rawBody          The body is kept as it is instead of being joined
+ *                      from its lines and trimmed.
+ *     keepsFieldForm   A parsed message keeps its field form.
+ *     repeatsFields    Otherwise repeated fields are kept apart instead
+ *                      of being joined as a comma-separated list.
+ */
+template <typename Dialect> struct DialectRules;
+
+template <> struct DialectRules<GenericDialect> {
+    static constexpr bool lenient = true;
+    static constexpr syntax::CharClass nameClass = syntax::kFieldName;
+    static constexpr syntax::CharClass valueClass = syntax::kFieldValue;
+    static constexpr StartRule startRule = StartRule::Optional;
+    static StringView protocol() { return StringView(); }
+    static constexpr bool folding = true;
+    static constexpr bool spaceBeforeColon = false;
+    static constexpr bool compactForms = true;
+    static constexpr size_t maxLineLength = 0;
+    static constexpr bool rawBody = false;
+    static constexpr bool keepsFieldForm = true;
+    static constexpr bool repeatsFields = false;
+};
+
+template <> struct DialectRules<HttpDialect> {
+    static constexpr bool lenient = false;
+    static constexpr syntax::CharClass nameClass = syntax::kToken;
+    static constexpr syntax::CharClass valueClass = syntax::kFieldText;
+    static constexpr StartRule startRule = StartRule::Required;
+    static StringView protocol() { return "HTTP/1."; }
+    static constexpr bool folding = false;
+    static constexpr bool spaceBeforeColon = false;
+    static constexpr bool compactForms = false;
+    static constexpr size_t maxLineLength = 0;
+    static constexpr bool rawBody = true;
+    static constexpr bool keepsFieldForm = false;
+    static constexpr bool repeatsFields = false;
+};
+
+template <> struct DialectRules<SipDialect> {
+    static constexpr bool lenient = false;
+    static constexpr syntax::CharClass nameClass = syntax::kSipToken;
+    static constexpr syntax::CharClass valueClass = syntax::kFieldText;
+    static constexpr StartRule startRule = StartRule::Required;
+    static StringView protocol() { return "SIP/2.0"; }
+    static constexpr bool folding = true;
+    static constexpr bool spaceBeforeColon = true;
+    static constexpr bool compactForms = true;
+    static constexpr size_t maxLineLength = 0;
+    static constexpr bool rawBody = true;
+    static constexpr bool keepsFieldForm = false;
+    static constexpr bool repeatsFields = false;
+};
+
+template <> struct DialectRules<MailDialect> {
+    static constexpr bool lenient = false;
+    static constexpr syntax::CharClass nameClass = syntax::kFieldName;
+    static constexpr syntax::CharClass valueClass = syntax::kFieldValue;
+    static constexpr StartRule startRule = StartRule::Absent;
+    static StringView protocol() { return StringView(); }
+    static constexpr bool folding = true;
+    static constexpr bool spaceBeforeColon = true;
+    static constexpr bool compactForms = false;
+    static constexpr size_t maxLineLength = 998 + 2;
+    static constexpr bool rawBody = true;
+    static constexpr bool keepsFieldForm = false;
+    static constexpr bool repeatsFields = true;
+};
+
+/**
+ * @description:
+ *     Look up the identifier of a header name, single letter names are
+ *     compact forms only if the dialect has them.
+ */
+inline HeaderId lookupHeaderId(StringView headerName, bool compactForms) {
+    if (!compactForms && headerName.size() == 1)
+        return HeaderId::Unknown;
+    return lookupHeaderId(headerName);
+}
+
+} // namespace msg
+
+#endif // MESSAGE_DIALECTRULES_HPP
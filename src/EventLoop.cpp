@@ -0,0 +1,184 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 14:26:03
+ * @LastEditTime: 2019-09-06 09:44:30
+ * @Description: An implementation of class msg::EventLoop.
+ */
+#include <cerrno>
+#include <message/EventLoop.hpp>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace {
+const size_t maxEvents = 256;
+const uint32_t readEvents = EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR;
+const uint32_t writeEvents = EPOLLOUT | EPOLLHUP | EPOLLERR;
+
+/**
+ * @description:
+ *     Pack a descriptor and its generation into epoll user data.
+ */
+inline uint64_t makeKey(int fd, uint32_t generation) {
+    return static_cast<uint64_t>(generation) << 32 | static_cast<uint32_t>(fd);
+}
+
+} // namespace
+
+namespace msg {
+EventLoop::EventLoop() : epollFd_(epoll_create1(EPOLL_CLOEXEC)) {}
+
+EventLoop::~EventLoop() {
+    if (epollFd_ >= 0)
+        ::close(epollFd_);
+}
+
+// Public methods
+/**
+ * @description:
+ *     Check if the epoll instance was created.
+ */
+bool EventLoop::isOpen() const { return epollFd_ >= 0; }
+
+/**
+ * @description:
+ *     Set the handler called when a descriptor is readable.
+ * @param[in] fd
+ *     A non-blocking descriptor.
+ * @param[in] handler
+ *     The handler, an empty one stops watching for reads.
+ * @return:
+ *     An indicator of whether or not epoll accepted the descriptor.
+ */
+bool EventLoop::setReadHandler(int fd, Handler handler) {
+    return setHandler(fd, &Watch::onRead, std::move(handler));
+}
+
+/**
+ * @description:
+ *     Set the handler called when a descriptor is writable.
+ * @param[in] fd
+ *     A non-blocking descriptor.
+ * @param[in] handler
+ *     The handler, an empty one stops watching for writes.
+ * @return:
+ *     An indicator of whether or not epoll accepted the descriptor.
+ */
+bool EventLoop::setWriteHandler(int fd, Handler handler) {
+    return setHandler(fd, &Watch::onWrite, std::move(handler));
+}
+
+/**
+ * @description:
+ *     Get the number of descriptors with a handler.
+ */
+size_t EventLoop::getWatchCount() const { return watchCount_; }
+
+/**
+ * @description:
+ *     Wait for events once and dispatch them.
+ * @param[in] timeout
+ *     The longest wait in milliseconds, -1 waits until an event comes.
+ * @return:
+ *     The number of events dispatched.
+ */
+size_t EventLoop::runOnce(int timeout) {
+    epoll_event events[maxEvents];
+    int count = epoll_wait(epollFd_, events, maxEvents, timeout);
+    if (count <= 0)
+        return 0;
+
+    dispatching_ = true;
+    for (int i = 0; i < count; ++i) {
+        int fd = static_cast<int>(events[i].data.u64 & 0xFFFFFFFF);
+        uint32_t generation = static_cast<uint32_t>(events[i].data.u64 >> 32);
+        uint32_t ready = events[i].events;
+        // Check the watch before each handler, the one before may have
+        // removed it.
+        if ((ready & readEvents) && watches_[fd].generation == generation &&
+            watches_[fd].onRead)
+            watches_[fd].onRead();
+        if ((ready & writeEvents) && watches_[fd].generation == generation &&
+            watches_[fd].onWrite)
+            watches_[fd].onWrite();
+    }
+    dispatching_ = false;
+    retired_.clear();
+    return static_cast<size_t>(count);
+}
+
+/**
+ * @description:
+ *     Dispatch events until stop() is called or no descriptor is watched.
+ */
+void EventLoop::run() {
+    stopped_ = false;
+    while (!stopped_ && watchCount_)
+        runOnce();
+}
+
+/**
+ * @description:
+ *     Make run() return after the events at hand were dispatched.
+ */
+void EventLoop::stop() { stopped_ = true; }
+
+// Private methods
+/**
+ * @description:
+ *     Set a handler of a descriptor and update its events in epoll.
+ * @param[in] fd
+ *     A non-blocking descriptor.
+ * @param[in] slot
+ *     The handler to be set.
+ * @param[in] handler
+ *     The new handler, an empty one stops watching.
+ * @return:
+ *     An indicator of whether or not epoll accepted the descriptor.
+ */
+bool EventLoop::setHandler(int fd, Handler Watch::*slot, Handler &&handler) {
+    if (fd < 0 || epollFd_ < 0)
+        return false;
+    if (static_cast<size_t>(fd) >= watches_.size()) {
+        if (!handler)
+            return true;
+        watches_.resize(static_cast<size_t>(fd) + 1);
+    }
+
+    Watch &watch = watches_[fd];
+    // A running handler may remove itself.
+    if (dispatching_ && watch.*slot)
+        retired_.push_back(std::move(watch.*slot));
+    watch.*slot = std::move(handler);
+
+    uint32_t events =
+        (watch.onRead ? static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP) : 0u) |
+        (watch.onWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    if (events == watch.events)
+        return true;
+
+    epoll_event event;
+    event.events = events;
+    event.data.u64 = makeKey(fd, watch.generation);
+    if (!events) {
+        epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, &event);
+        ++watch.generation;
+        --watchCount_;
+    } else if (!watch.events) {
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            watch.*slot = Handler();
+            return false;
+        }
+        ++watchCount_;
+    } else if (epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &event) != 0 &&
+               // A descriptor closed while watched left epoll on its own.
+               (errno != ENOENT ||
+                epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0)) {
+        return false;
+    }
+    watch.events = events;
+    return true;
+}
+
+} // namespace msg
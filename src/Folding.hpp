@@ -0,0 +1,181 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-04 09:32:16
+ * @LastEditTime: 2019-09-05 11:20:05
+ * @Description: Private helpers of line folding, shared by message and
+ *     template production.
+ */
+#ifndef MESSAGE_FOLDING_HPP
+#define MESSAGE_FOLDING_HPP
+
+#include "Syntax.hpp"
+#include <algorithm>
+#include <message/StringView.hpp>
+#include <string>
+
+namespace msg {
+namespace syntax {
+const char lineTerminator[] = "\r\n";
+const char headerSeparator[] = ": ";
+
+/**
+ * @description:
+ *     Check a character is a WSP character a line may be folded at.
+ */
+inline bool isFoldSpace(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\f' || ch == '\v';
+}
+
+/**
+ * @description:
+ *     A line of the message made of up to three parts, so a header line
+ *     is folded in place of its name, separator and value without being
+ *     concatenated first.
+ */
+class Line {
+public:
+    Line(const char *data, size_t length) : count_(0), length_(0) {
+        add(data, length);
+    }
+
+    Line(StringView name, StringView value) : count_(0), length_(0) {
+        add(name.data(), name.size());
+        add(headerSeparator, 2);
+        add(value.data(), value.size());
+    }
+
+    size_t size() const { return length_; }
+
+    char at(size_t pos) const {
+        size_t part = 0;
+        while (pos >= sizes_[part]) {
+            pos -= sizes_[part];
+            ++part;
+        }
+        return parts_[part][pos];
+    }
+
+    /**
+     * @description:
+     *     Write a range of the line to a sink part by part.
+     */
+    template <typename Sink>
+    void write(size_t begin, size_t end, Sink &sink) const {
+        for (size_t part = 0; part < count_ && begin < end; ++part) {
+            if (begin < sizes_[part]) {
+                size_t stop = std::min(end, sizes_[part]);
+                sink(parts_[part] + begin, stop - begin);
+                begin = stop;
+            }
+            begin -= sizes_[part];
+            end -= sizes_[part];
+        }
+    }
+
+private:
+    const char *parts_[3];
+    size_t sizes_[3];
+    size_t count_;
+    size_t length_;
+
+    void add(const char *data, size_t length) {
+        parts_[count_] = data;
+        sizes_[count_] = length;
+        ++count_;
+        length_ += length;
+    }
+};
+
+/**
+ * @description:
+ *     A sink counts the bytes written to it.
+ */
+struct LengthSink {
+    size_t length = 0;
+
+    void operator()(const char *, size_t n) { length += n; }
+};
+
+/**
+ * @description:
+ *     A sink appends the bytes written to it to a string.
+ */
+struct StringSink {
+    std::string &dest;
+
+    void operator()(const char *data, size_t n) { dest.append(data, n); }
+};
+
+/**
+ * @description:
+ *     Fold a line by lenght limitation in a single pass, always break line
+ *     into segments at whitespace charater if any. A cursor walks the line
+ *     word by word while [begin, end) is the pending segment, a segment
+ *     exceeding the limit is broken at its last WSP and written at once.
+ *     Continuation lines start with exactly one space.
+ * @param[in] line
+ *     The line should be folded.
+ * @param[in] maxLength
+ *     The max characters limitation per line.
+ * @param[out] sink
+ *     The sink the folded lines are written to.
+ * @return:
+ *     The number of times the line was broken.
+ */
+template <typename Sink>
+size_t foldLine(const Line &line, size_t maxLength, Sink &sink) {
+    size_t length = line.size();
+    size_t cursor = 0;
+    size_t begin = 0;
+    size_t end = 0;
+    size_t lastWSP = npos;
+    size_t breaks = 0;
+
+    while (cursor < length) {
+        // Take a word and the WSP characters following it.
+        while (cursor < length && !isFoldSpace(line.at(cursor)))
+            ++cursor;
+        if (cursor < length) {
+            while (cursor < length && isFoldSpace(line.at(cursor)))
+                ++cursor;
+            lastWSP = cursor - 1;
+        }
+        end = cursor;
+
+        if (end - begin + 2 <= maxLength || lastWSP == begin)
+            continue;
+
+        // Break line at WSP, or write a segment without any WSP as a whole.
+        size_t breakPos = lastWSP == npos ? end : lastWSP;
+        size_t stop = breakPos;
+        while (stop > begin && isSpace(line.at(stop - 1)))
+            --stop;
+        line.write(begin, stop, sink);
+        sink(lineTerminator, 2);
+        begin = breakPos;
+        ++breaks;
+    }
+
+    if (length == 0) { // Keep the blank line.
+        sink(lineTerminator, 2);
+        return 0;
+    }
+    if (end == begin)
+        return breaks;
+    if (breaks) {
+        // Keep only one space at the head of a line.
+        while (begin < end && isSpace(line.at(begin)))
+            ++begin;
+        sink(" ", 1);
+    }
+    line.write(begin, end, sink);
+    sink(lineTerminator, 2);
+    return breaks;
+}
+
+} // namespace syntax
+} // namespace msg
+
+#endif // MESSAGE_FOLDING_HPP
@@ -0,0 +1,132 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-01 09:40:51
+ * @LastEditTime: 2019-09-01 09:40:51
+ * @Description: An implementation of class msg::HeaderList.
+ */
+#include "Syntax.hpp"
+#include <cstring>
+#include <message/HeaderList.hpp>
+
+namespace {
+/**
+ * @description:
+ *     Find a character in a range.
+ * @return:
+ *     A pointer to the character, end if there is none.
+ */
+inline const char *find(const char *begin, const char *end, char ch) {
+    const void *found = std::memchr(begin, ch, end - begin);
+    return found ? static_cast<const char *>(found) : end;
+}
+
+} // namespace
+
+namespace msg {
+/**
+ * @description:
+ *     Make an iterator at the first element of a range.
+ * @param[in] next
+ *     A pointer to the range.
+ * @param[in] end
+ *     A pointer to the end of the range.
+ */
+HeaderList::const_iterator::const_iterator(const char *next, const char *end)
+    : next_(next), end_(end) {
+    ++*this;
+}
+
+/**
+ * @description:
+ *     Move to the next element. An element ends at a comma outside of
+ *     quoted-strings and comments, a backslash quotes the next character
+ *     in both, comments may nest.
+ * @return:
+ *     The iterator, it equals end() after the last element.
+ */
+HeaderList::const_iterator &HeaderList::const_iterator::operator++() {
+    const char *pos = next_;
+    while (pos != end_ && (*pos == ',' || syntax::isSpace(*pos)))
+        ++pos;
+    if (pos == end_) {
+        element_ = StringView();
+        next_ = end_;
+        return *this;
+    }
+
+    const char *start = pos;
+    bool quoted = false;
+    size_t depth = 0;
+    while (pos != end_) {
+        if (!quoted && !depth) { // Skip to the next special character.
+            const char *from = pos;
+            pos = find(from, end_, ',');
+            pos = find(from, pos, '"');
+            pos = find(from, pos, '(');
+            if (pos == end_ || *pos == ',')
+                break;
+            if (*pos == '"')
+                quoted = true;
+            else
+                depth = 1;
+            ++pos;
+            continue;
+        }
+        char ch = *pos;
+        if (ch == '\\' && pos + 1 != end_)
+            ++pos;
+        else if (quoted && ch == '"')
+            quoted = false;
+        else if (!quoted && ch == '(')
+            ++depth;
+        else if (!quoted && ch == ')')
+            --depth;
+        ++pos;
+    }
+
+    const char *stop = pos;
+    while (syntax::isSpace(stop[-1]))
+        --stop;
+    element_ = StringView(start, stop - start);
+    next_ = pos;
+    return *this;
+}
+
+// Public methods
+/**
+ * @description:
+ *     Get an iterator at the first element.
+ * @return:
+ *     The iterator, it equals end() if there is no element.
+ */
+HeaderList::const_iterator HeaderList::begin() const {
+    return const_iterator(value_.data(), value_.data() + value_.size());
+}
+
+/**
+ * @description:
+ *     Get an iterator past the last element.
+ * @return:
+ *     The iterator.
+ */
+HeaderList::const_iterator HeaderList::end() const {
+    return const_iterator();
+}
+
+/**
+ * @description:
+ *     Count the elements, the value is scanned once.
+ * @return:
+ *     The number of elements.
+ */
+size_t HeaderList::size() const {
+    size_t count = 0;
+    for (auto it = begin(); it != end(); ++it) {
+        ++count;
+    }
+    return count;
+}
+
+} // namespace msg
@@ -0,0 +1,332 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-21 10:13:15
+ * @LastEditTime: 2019-09-06 11:31:42
+ * @Description: Well-known header names of HTTP, SIP and Internet Message
+ *     Format.
+ */
+#include "Syntax.hpp"
+#include <message/HeaderNames.hpp>
+
+namespace {
+constexpr size_t headerCount = static_cast<size_t>(msg::HeaderId::Count);
+
+// Canonical names indexed by msg::HeaderId.
+constexpr const char *headerNames[headerCount] = {
+    "",
+    "Accept",
+    "Accept-Charset",
+    "Accept-Contact",
+    "Accept-Encoding",
+    "Accept-Language",
+    "Accept-Ranges",
+    "Age",
+    "Alert-Info",
+    "Allow",
+    "Allow-Events",
+    "Authentication-Info",
+    "Authorization",
+    "Bcc",
+    "Cache-Control",
+    "Call-ID",
+    "Call-Info",
+    "Cc",
+    "Connection",
+    "Contact",
+    "Content-Disposition",
+    "Content-Encoding",
+    "Content-Language",
+    "Content-Length",
+    "Content-Location",
+    "Content-Range",
+    "Content-Transfer-Encoding",
+    "Content-Type",
+    "Cookie",
+    "CSeq",
+    "Date",
+    "DKIM-Signature",
+    "Error-Info",
+    "ETag",
+    "Event",
+    "Expect",
+    "Expires",
+    "From",
+    "Host",
+    "Identity",
+    "If-Match",
+    "If-Modified-Since",
+    "If-None-Match",
+    "If-Unmodified-Since",
+    "In-Reply-To",
+    "Keep-Alive",
+    "Last-Modified",
+    "Location",
+    "Max-Forwards",
+    "Message-ID",
+    "MIME-Version",
+    "Min-Expires",
+    "Organization",
+    "Origin",
+    "Path",
+    "Pragma",
+    "Priority",
+    "Proxy-Authenticate",
+    "Proxy-Authorization",
+    "Proxy-Require",
+    "RAck",
+    "Range",
+    "Received",
+    "Record-Route",
+    "References",
+    "Referred-By",
+    "Referer",
+    "Refer-To",
+    "Reject-Contact",
+    "Reply-To",
+    "Request-Disposition",
+    "Require",
+    "Retry-After",
+    "Return-Path",
+    "Route",
+    "RSeq",
+    "Sender",
+    "Server",
+    "Service-Route",
+    "Session-Expires",
+    "Set-Cookie",
+    "Subject",
+    "Subscription-State",
+    "Supported",
+    "TE",
+    "Timestamp",
+    "To",
+    "Trailer",
+    "Transfer-Encoding",
+    "Unsupported",
+    "Upgrade",
+    "User-Agent",
+    "Vary",
+    "Via",
+    "Warning",
+    "WWW-Authenticate",
+};
+
+constexpr size_t maxNameLength = 25; // Content-Transfer-Encoding
+
+// Identifiers grouped by the length of their names, so a lookup only
+// compares names of the same length. The tables are constant data checked
+// against headerNames when compiled, a new header goes in both.
+constexpr msg::HeaderId idsByLength[headerCount - 1] = {
+    // 2
+    msg::HeaderId::Cc, msg::HeaderId::Te, msg::HeaderId::To,
+    // 3
+    msg::HeaderId::Age, msg::HeaderId::Bcc, msg::HeaderId::Via,
+    // 4
+    msg::HeaderId::CSeq, msg::HeaderId::Date, msg::HeaderId::ETag,
+    msg::HeaderId::From, msg::HeaderId::Host, msg::HeaderId::Path,
+    msg::HeaderId::RAck, msg::HeaderId::RSeq, msg::HeaderId::Vary,
+    // 5
+    msg::HeaderId::Allow, msg::HeaderId::Event, msg::HeaderId::Range,
+    msg::HeaderId::Route,
+    // 6
+    msg::HeaderId::Accept, msg::HeaderId::Cookie, msg::HeaderId::Expect,
+    msg::HeaderId::Origin, msg::HeaderId::Pragma, msg::HeaderId::Sender,
+    msg::HeaderId::Server,
+    // 7
+    msg::HeaderId::CallId, msg::HeaderId::Contact, msg::HeaderId::Expires,
+    msg::HeaderId::Referer, msg::HeaderId::Require, msg::HeaderId::Subject,
+    msg::HeaderId::Trailer, msg::HeaderId::Upgrade, msg::HeaderId::Warning,
+    // 8
+    msg::HeaderId::Identity, msg::HeaderId::IfMatch, msg::HeaderId::Location,
+    msg::HeaderId::Priority, msg::HeaderId::Received, msg::HeaderId::ReferTo,
+    msg::HeaderId::ReplyTo,
+    // 9
+    msg::HeaderId::CallInfo, msg::HeaderId::Supported, msg::HeaderId::Timestamp,
+    // 10
+    msg::HeaderId::AlertInfo, msg::HeaderId::Connection,
+    msg::HeaderId::ErrorInfo, msg::HeaderId::KeepAlive,
+    msg::HeaderId::MessageId, msg::HeaderId::References,
+    msg::HeaderId::SetCookie, msg::HeaderId::UserAgent,
+    // 11
+    msg::HeaderId::InReplyTo, msg::HeaderId::MinExpires,
+    msg::HeaderId::ReferredBy, msg::HeaderId::RetryAfter,
+    msg::HeaderId::ReturnPath, msg::HeaderId::Unsupported,
+    // 12
+    msg::HeaderId::AllowEvents, msg::HeaderId::ContentType,
+    msg::HeaderId::MaxForwards, msg::HeaderId::MimeVersion,
+    msg::HeaderId::Organization, msg::HeaderId::RecordRoute,
+    // 13
+    msg::HeaderId::AcceptRanges, msg::HeaderId::Authorization,
+    msg::HeaderId::CacheControl, msg::HeaderId::ContentRange,
+    msg::HeaderId::IfNoneMatch, msg::HeaderId::LastModified,
+    msg::HeaderId::ProxyRequire, msg::HeaderId::ServiceRoute,
+    // 14
+    msg::HeaderId::AcceptCharset, msg::HeaderId::AcceptContact,
+    msg::HeaderId::ContentLength, msg::HeaderId::DkimSignature,
+    msg::HeaderId::RejectContact,
+    // 15
+    msg::HeaderId::AcceptEncoding, msg::HeaderId::AcceptLanguage,
+    msg::HeaderId::SessionExpires,
+    // 16
+    msg::HeaderId::ContentEncoding, msg::HeaderId::ContentLanguage,
+    msg::HeaderId::ContentLocation, msg::HeaderId::WwwAuthenticate,
+    // 17
+    msg::HeaderId::IfModifiedSince, msg::HeaderId::TransferEncoding,
+    // 18
+    msg::HeaderId::ProxyAuthenticate, msg::HeaderId::SubscriptionState,
+    // 19
+    msg::HeaderId::AuthenticationInfo, msg::HeaderId::ContentDisposition,
+    msg::HeaderId::IfUnmodifiedSince, msg::HeaderId::ProxyAuthorization,
+    msg::HeaderId::RequestDisposition,
+    // 25
+    msg::HeaderId::ContentTransferEncoding,
+};
+
+// Where the identifiers of each name length begin in idsByLength.
+constexpr unsigned char lengthBegin[maxNameLength + 2] = {
+    0,  0,  0,  3,  6,  15, 19, 26, 35, 42, 45, 53, 59, 65,
+    73, 78, 81, 85, 87, 89, 94, 94, 94, 94, 94, 94, 95,
+};
+
+constexpr size_t nameLength(const char *name) {
+    return *name == '\0' ? 0 : 1 + nameLength(name + 1);
+}
+
+constexpr size_t groupOf(size_t index) {
+    return nameLength(headerNames[static_cast<size_t>(idsByLength[index])]);
+}
+
+constexpr size_t countIds(msg::HeaderId id, size_t index) {
+    return index == headerCount - 1
+               ? 0
+               : (idsByLength[index] == id) + countIds(id, index + 1);
+}
+
+/**
+ * @description:
+ *     Check the groups of idsByLength from an index on: each identifier
+ *     lies in the group of its name length and appears once.
+ */
+constexpr bool checkIds(size_t index) {
+    return index == headerCount - 1 ||
+           (lengthBegin[groupOf(index)] <= index &&
+            index < lengthBegin[groupOf(index) + 1] &&
+            countIds(idsByLength[index], 0) == 1 && checkIds(index + 1));
+}
+
+/**
+ * @description:
+ *     Check lengthBegin from a length on: the groups follow each other and
+ *     the last ends with idsByLength.
+ */
+constexpr bool checkBegins(size_t length) {
+    return length == maxNameLength + 1
+               ? lengthBegin[length] == headerCount - 1
+               : lengthBegin[length] <= lengthBegin[length + 1] &&
+                     checkBegins(length + 1);
+}
+
+static_assert(lengthBegin[0] == 0 && checkBegins(0) && checkIds(0),
+              "idsByLength must group every header by its name length");
+
+/**
+ * @description:
+ *     Map a SIP compact form to its header, see RFC 3261 section 7.3.3
+ *     and the extensions registered with IANA.
+ * @param[in] ch
+ *     The single character name.
+ * @return:
+ *     The identifier of the header, Unknown if it isn't a compact form.
+ */
+msg::HeaderId lookupCompactForm(char ch) {
+    switch (msg::syntax::toLower(ch)) {
+    case 'a':
+        return msg::HeaderId::AcceptContact;
+    case 'b':
+        return msg::HeaderId::ReferredBy;
+    case 'c':
+        return msg::HeaderId::ContentType;
+    case 'd':
+        return msg::HeaderId::RequestDisposition;
+    case 'e':
+        return msg::HeaderId::ContentEncoding;
+    case 'f':
+        return msg::HeaderId::From;
+    case 'i':
+        return msg::HeaderId::CallId;
+    case 'j':
+        return msg::HeaderId::RejectContact;
+    case 'k':
+        return msg::HeaderId::Supported;
+    case 'l':
+        return msg::HeaderId::ContentLength;
+    case 'm':
+        return msg::HeaderId::Contact;
+    case 'o':
+        return msg::HeaderId::Event;
+    case 'r':
+        return msg::HeaderId::ReferTo;
+    case 's':
+        return msg::HeaderId::Subject;
+    case 't':
+        return msg::HeaderId::To;
+    case 'u':
+        return msg::HeaderId::AllowEvents;
+    case 'v':
+        return msg::HeaderId::Via;
+    case 'x':
+        return msg::HeaderId::SessionExpires;
+    case 'y':
+        return msg::HeaderId::Identity;
+    default:
+        return msg::HeaderId::Unknown;
+    }
+}
+
+} // namespace
+
+namespace msg {
+/**
+ * @description:
+ *     Get the identifier of a header name, names are compared
+ *     case-insensitively and SIP compact forms map to their full names.
+ * @param[in] headerName
+ *     A header's name.
+ * @return:
+ *     The identifier of the header, Unknown if it isn't well-known.
+ */
+HeaderId lookupHeaderId(StringView headerName) {
+    size_t length = headerName.size();
+    if (length == 1)
+        return lookupCompactForm(headerName[0]);
+    if (length == 0 || length > maxNameLength)
+        return HeaderId::Unknown;
+
+    char first = syntax::toLower(headerName[0]);
+    for (size_t i = lengthBegin[length]; i < lengthBegin[length + 1]; ++i) {
+        const char *name = headerNames[static_cast<size_t>(idsByLength[i])];
+        if (syntax::toLower(name[0]) == first &&
+            syntax::equalsName(name, length, headerName.data(), length))
+            return idsByLength[i];
+    }
+    return HeaderId::Unknown;
+}
+
+/**
+ * @description:
+ *     Get the canonical name of a header.
+ * @param[in] headerId
+ *     The identifier of a header.
+ * @return:
+ *     The canonical name, empty for Unknown.
+ */
+StringView getHeaderName(HeaderId headerId) {
+    size_t id = static_cast<size_t>(headerId);
+    if (id >= headerCount)
+        return StringView();
+    return headerNames[id];
+}
+
+} // namespace msg
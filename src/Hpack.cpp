@@ -0,0 +1,764 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-03 10:05:17
+ * @LastEditTime: 2019-09-03 10:05:17
+ * @Description: An implementation of HPACK header compression of HTTP/2.
+ */
+#include "Syntax.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <message/Hpack.hpp>
+
+namespace {
+const size_t staticCount = 61;
+
+/**
+ * @description:
+ *     The static table of RFC 7541 Appendix A, indexed from one.
+ */
+const msg::StringView staticTable[staticCount + 1][2] = {
+    {"", ""},
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+/**
+ * @description:
+ *     Hash a name by FNV-1a.
+ */
+inline uint32_t hashString(msg::StringView s) {
+    uint32_t hash = 2166136261u;
+    for (char ch : s) {
+        hash = (hash ^ static_cast<unsigned char>(ch)) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @description:
+ *     A table of the first static index of each name, keyed on the hash
+ *     of the name.
+ */
+struct StaticIndex {
+    static const size_t slotCount = 128;
+    uint8_t slots[slotCount] = {};
+
+    StaticIndex() {
+        for (size_t index = staticCount; index > 0; --index) {
+            size_t slot = find(staticTable[index][0]);
+            slots[slot] = static_cast<uint8_t>(index);
+        }
+    }
+
+    // The slot of a name, or the empty slot it would take. Names are
+    // lowercased already, and the character table of the case folding hash
+    // may not be initialized yet.
+    size_t find(msg::StringView name) const {
+        for (size_t slot = hashString(name);; ++slot) {
+            slot &= slotCount - 1;
+            if (!slots[slot] || staticTable[slots[slot]][0] == name)
+                return slot;
+        }
+    }
+
+    size_t lookup(msg::StringView name) const { return slots[find(name)]; }
+};
+
+const StaticIndex staticIndex;
+
+struct HuffmanCode {
+    uint32_t code;
+    uint8_t length;
+};
+
+/**
+ * @description:
+ *     The Huffman code of RFC 7541 Appendix B, the last one is EOS.
+ */
+const HuffmanCode huffmanCodes[257] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12}, {0x1ff9, 13}, {0x15, 6},
+    {0xf8, 8}, {0x7fa, 11}, {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6}, {0x0, 5}, {0x1, 5}, {0x2, 5},
+    {0x19, 6}, {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6}, {0x1e, 6}, {0x1f, 6},
+    {0x5c, 7}, {0xfb, 8}, {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7}, {0x5f, 7}, {0x60, 7},
+    {0x61, 7}, {0x62, 7}, {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7}, {0x67, 7},
+    {0x68, 7}, {0x69, 7}, {0x6a, 7}, {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7}, {0xfc, 8}, {0x73, 7}, {0xfd, 8},
+    {0x1ffb, 13}, {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5}, {0x24, 6}, {0x5, 5}, {0x25, 6},
+    {0x26, 6}, {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7}, {0x28, 6}, {0x29, 6},
+    {0x2a, 6}, {0x7, 5}, {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5}, {0x9, 5},
+    {0x2d, 6}, {0x77, 7}, {0x78, 7}, {0x79, 7}, {0x7a, 7}, {0x7b, 7},
+    {0x7ffe, 15}, {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20}, {0x3fffd3, 22},
+    {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23}, {0x3fffd6, 22},
+    {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23}, {0x7fffdd, 23},
+    {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23}, {0xffffec, 24},
+    {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23}, {0xffffee, 24},
+    {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23}, {0x7fffe4, 23},
+    {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23}, {0x3fffd9, 22},
+    {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24}, {0x3fffda, 22},
+    {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22}, {0x3fffdc, 22},
+    {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21}, {0x7fffea, 23},
+    {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24}, {0x1fffdf, 21},
+    {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23}, {0x1fffe0, 21},
+    {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21}, {0x7fffed, 23},
+    {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23}, {0xfffea, 20},
+    {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22}, {0x7ffff0, 23},
+    {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23}, {0x3ffffe0, 26},
+    {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19}, {0x3fffe7, 22},
+    {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25}, {0x3ffffe2, 26},
+    {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27}, {0x7ffffdf, 27},
+    {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25}, {0x7fff2, 19},
+    {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27}, {0x7ffffe1, 27},
+    {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24}, {0x1fffe4, 21},
+    {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26}, {0xffffffd, 28},
+    {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27}, {0xfffec, 20},
+    {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21}, {0x3fffe9, 22},
+    {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23}, {0x3fffea, 22},
+    {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25}, {0xfffff4, 24},
+    {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23}, {0x3ffffeb, 26},
+    {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26}, {0x7ffffe7, 27},
+    {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27}, {0x7ffffeb, 27},
+    {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27}, {0x7ffffee, 27},
+    {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26}, {0x3fffffff, 30},
+};
+
+/**
+ * @description:
+ *     A state machine decoding Huffman codes four bits at a time. A state
+ *     is an inner node of the code tree, the root is state zero.
+ */
+struct HuffmanDecoder {
+    enum Flag : uint8_t {
+        kEmit = 0x01, // A symbol was completed.
+        kFail = 0x02, // EOS was decoded.
+    };
+    struct Transition {
+        uint8_t next;
+        uint8_t symbol;
+        uint8_t flags;
+    };
+
+    Transition transitions[256][16];
+    // The bits since the last symbol may be padding, a prefix of EOS
+    // shorter than 8 bits.
+    bool accepting[256];
+
+    HuffmanDecoder() {
+        // Build the tree, leaves are symbols and inner nodes get states.
+        struct Node {
+            int16_t children[2];
+            int16_t symbol;
+            int16_t state;
+        };
+        std::vector<Node> nodes(1, Node{{-1, -1}, -1, 0});
+        int16_t states = 1;
+        std::vector<size_t> nodeOfState(256, 0);
+        for (int16_t symbol = 0; symbol < 257; ++symbol) {
+            const HuffmanCode &code = huffmanCodes[symbol];
+            size_t node = 0;
+            for (int bit = code.length - 1; bit >= 0; --bit) {
+                int branch = code.code >> bit & 1;
+                if (nodes[node].children[branch] < 0) {
+                    nodes[node].children[branch] =
+                        static_cast<int16_t>(nodes.size());
+                    Node child{{-1, -1}, -1, -1};
+                    if (bit == 0) {
+                        child.symbol = symbol;
+                    } else {
+                        child.state = states;
+                        nodeOfState[states++] = nodes.size();
+                    }
+                    nodes.push_back(child);
+                }
+                node = nodes[node].children[branch];
+            }
+        }
+
+        for (size_t state = 0; state < 256; ++state) {
+            accepting[state] = false;
+            for (size_t nibble = 0; nibble < 16; ++nibble) {
+                Transition &transition = transitions[state][nibble];
+                transition = Transition{0, 0, 0};
+                size_t node = nodeOfState[state];
+                for (int bit = 3; bit >= 0; --bit) {
+                    node = nodes[node].children[nibble >> bit & 1];
+                    if (nodes[node].symbol >= 0) {
+                        if (nodes[node].symbol == 256)
+                            transition.flags |= kFail;
+                        transition.symbol =
+                            static_cast<uint8_t>(nodes[node].symbol);
+                        transition.flags |= kEmit;
+                        node = 0;
+                    }
+                }
+                transition.next = static_cast<uint8_t>(nodes[node].state);
+            }
+        }
+        size_t node = 0;
+        for (int depth = 0; depth < 8; ++depth) {
+            accepting[nodes[node].state] = true;
+            node = nodes[node].children[1];
+        }
+    }
+};
+
+const HuffmanDecoder huffmanDecoder;
+
+/**
+ * @description:
+ *     Get the length of a string in Huffman code.
+ */
+size_t getHuffmanLength(msg::StringView s) {
+    size_t bits = 0;
+    for (char ch : s) {
+        bits += huffmanCodes[static_cast<unsigned char>(ch)].length;
+    }
+    return (bits + 7) / 8;
+}
+
+/**
+ * @description:
+ *     Append a string in Huffman code, padded by the most significant bits
+ *     of EOS.
+ */
+void encodeHuffman(msg::StringView s, std::string &dest) {
+    uint64_t bits = 0;
+    size_t count = 0;
+    for (char ch : s) {
+        const HuffmanCode &code = huffmanCodes[static_cast<unsigned char>(ch)];
+        bits = bits << code.length | code.code;
+        count += code.length;
+        while (count >= 8) {
+            count -= 8;
+            dest.append(1, static_cast<char>(bits >> count));
+        }
+    }
+    if (count)
+        dest.append(1, static_cast<char>(bits << (8 - count) |
+                                         (0xFF >> count)));
+}
+
+/**
+ * @description:
+ *     Decode a string in Huffman code.
+ * @return:
+ *     An indicator of whether or not the code had no EOS and its padding
+ *     was valid.
+ */
+bool decodeHuffman(const char *s, size_t length, std::string &dest) {
+    dest.clear();
+    uint8_t state = 0;
+    bool accepting = true;
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char byte = static_cast<unsigned char>(s[i]);
+        for (int shift = 4; shift >= 0; shift -= 4) {
+            const HuffmanDecoder::Transition &transition =
+                huffmanDecoder.transitions[state][byte >> shift & 0x0F];
+            if (transition.flags & HuffmanDecoder::kFail)
+                return false;
+            if (transition.flags & HuffmanDecoder::kEmit)
+                dest.append(1, static_cast<char>(transition.symbol));
+            state = transition.next;
+        }
+        accepting = huffmanDecoder.accepting[state];
+    }
+    return accepting;
+}
+
+/**
+ * @description:
+ *     Append an integer with a prefix of some bits, the other bits of the
+ *     first byte are flags.
+ */
+void encodeInteger(size_t value, int prefixBits, uint8_t flags,
+                   std::string &dest) {
+    size_t limit = (size_t(1) << prefixBits) - 1;
+    if (value < limit) {
+        dest.append(1, static_cast<char>(flags | value));
+        return;
+    }
+    dest.append(1, static_cast<char>(flags | limit));
+    value -= limit;
+    while (value >= 0x80) {
+        dest.append(1, static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    dest.append(1, static_cast<char>(value));
+}
+
+/**
+ * @description:
+ *     Append a string literal, in Huffman code if it's shorter.
+ */
+void encodeString(msg::StringView s, std::string &dest) {
+    size_t huffmanLength = getHuffmanLength(s);
+    if (huffmanLength < s.size()) {
+        encodeInteger(huffmanLength, 7, 0x80, dest);
+        encodeHuffman(s, dest);
+    } else {
+        encodeInteger(s.size(), 7, 0, dest);
+        dest.append(s.data(), s.size());
+    }
+}
+
+/**
+ * @description:
+ *     A cursor over a header block, every read is checked against the end.
+ */
+class BlockReader {
+public:
+    BlockReader(const char *data, size_t length)
+        : pos_(reinterpret_cast<const uint8_t *>(data)), end_(pos_ + length) {
+    }
+
+    bool atEnd() const { return pos_ == end_; }
+    uint8_t peek() const { return *pos_; }
+
+    // An integer up to 2^32, larger ones are only used by attacks.
+    bool readInteger(int prefixBits, size_t &value) {
+        if (pos_ == end_)
+            return false;
+        size_t limit = (size_t(1) << prefixBits) - 1;
+        value = *pos_++ & limit;
+        if (value < limit)
+            return true;
+        for (int shift = 0; shift <= 28; shift += 7) {
+            if (pos_ == end_)
+                return false;
+            uint8_t byte = *pos_++;
+            value += static_cast<size_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return value <= UINT32_MAX;
+        }
+        return false;
+    }
+
+    // A literal as it is in the block, or decoded into a buffer.
+    bool readString(msg::StringView &s, std::string &buffer) {
+        if (pos_ == end_)
+            return false;
+        bool huffman = *pos_ & 0x80;
+        size_t length;
+        if (!readInteger(7, length) ||
+            length > static_cast<size_t>(end_ - pos_))
+            return false;
+        const char *data = reinterpret_cast<const char *>(pos_);
+        pos_ += length;
+        if (!huffman) {
+            s = msg::StringView(data, length);
+            return true;
+        }
+        if (!decodeHuffman(data, length, buffer))
+            return false;
+        s = buffer;
+        return true;
+    }
+
+private:
+    const uint8_t *pos_;
+    const uint8_t *end_;
+};
+
+} // namespace
+
+namespace msg {
+const size_t HpackTable::npos;
+const size_t HpackTable::entryOverhead;
+
+// Public methods
+/**
+ * @description:
+ *     Get the number of entries.
+ */
+size_t HpackTable::getCount() const { return count_; }
+
+/**
+ * @description:
+ *     Get the size of all entries, each counts its name, value and the
+ *     overhead.
+ */
+size_t HpackTable::getSize() const { return size_; }
+
+/**
+ * @description:
+ *     Get the limit of the size.
+ */
+size_t HpackTable::getMaxSize() const { return maxSize_; }
+
+/**
+ * @description:
+ *     Set the limit of the size, the oldest entries are evicted until the
+ *     table fits.
+ * @param[in] maxSize
+ *     The limit of the size.
+ */
+void HpackTable::setMaxSize(size_t maxSize) {
+    maxSize_ = maxSize;
+    evict(maxSize);
+}
+
+/**
+ * @description:
+ *     Add an entry as the newest one. Entries are evicted to make room,
+ *     an entry larger than the limit empties the table and isn't added.
+ * @param[in] name
+ *     The name of the entry, it may refer to an entry to be evicted.
+ * @param[in] value
+ *     The value of the entry.
+ */
+void HpackTable::insert(StringView name, StringView value) {
+    size_t entrySize = name.size() + value.size() + entryOverhead;
+    if (entrySize > maxSize_) {
+        evict(0);
+        return;
+    }
+    evict(maxSize_ - entrySize);
+
+    if (count_ == entries_.size()) { // Unroll the ring into a larger one.
+        std::vector<Entry> entries(std::max<size_t>(16, entries_.size() * 2));
+        for (size_t i = 0; i < count_; ++i) {
+            entries[i] = std::move(entries_[(first_ + i) % entries_.size()]);
+        }
+        entries_.swap(entries);
+        first_ = 0;
+    }
+    // An evicted entry keeps its strings, so the name is still valid.
+    Entry &entry = entries_[(first_ + count_) % entries_.size()];
+    entry.nameHash = hashString(name);
+    entry.name.assign(name.data(), name.size());
+    entry.value.assign(value.data(), value.size());
+    ++count_;
+    size_ += entrySize;
+}
+
+/**
+ * @description:
+ *     Get the name of an entry.
+ * @param[in] index
+ *     The index of the entry, zero is the newest one.
+ */
+StringView HpackTable::getName(size_t index) const {
+    return entries_[slot(index)].name;
+}
+
+/**
+ * @description:
+ *     Get the value of an entry.
+ * @param[in] index
+ *     The index of the entry, zero is the newest one.
+ */
+StringView HpackTable::getValue(size_t index) const {
+    return entries_[slot(index)].value;
+}
+
+/**
+ * @description:
+ *     Find the newest entry of a field, or of its name only.
+ * @param[in] name
+ *     The name of the field, compared case-sensitively.
+ * @param[in] value
+ *     The value of the field.
+ * @param[out] matched
+ *     Whether or not the value matched too.
+ * @return:
+ *     The index of the entry, npos if no entry has the name.
+ */
+size_t HpackTable::find(StringView name, StringView value,
+                        bool &matched) const {
+    uint32_t nameHash = hashString(name);
+    size_t found = npos;
+    matched = false;
+    for (size_t index = 0; index < count_; ++index) {
+        const Entry &entry = entries_[slot(index)];
+        if (entry.nameHash != nameHash || StringView(entry.name) != name)
+            continue;
+        if (StringView(entry.value) == value) {
+            matched = true;
+            return index;
+        }
+        if (found == npos)
+            found = index;
+    }
+    return found;
+}
+
+// Private methods
+/**
+ * @description:
+ *     Get the slot of an entry in the ring.
+ */
+size_t HpackTable::slot(size_t index) const {
+    return (first_ + count_ - 1 - index) % entries_.size();
+}
+
+/**
+ * @description:
+ *     Evict the oldest entries until the size is within a limit.
+ */
+void HpackTable::evict(size_t maxSize) {
+    while (size_ > maxSize) {
+        const Entry &entry = entries_[first_];
+        size_ -= entry.name.size() + entry.value.size() + entryOverhead;
+        first_ = (first_ + 1) % entries_.size();
+        --count_;
+    }
+}
+
+// Public methods
+/**
+ * @description:
+ *     Set the size of the dynamic table, it must not exceed the setting
+ *     of the peer. The change is sent at the start of the next block.
+ * @param[in] maxSize
+ *     The size of the dynamic table.
+ */
+void HpackEncoder::setMaxTableSize(size_t maxSize) {
+    minSize_ = sizeChanged_ ? std::min(minSize_, maxSize) : maxSize;
+    sizeChanged_ = true;
+    table_.setMaxSize(maxSize);
+}
+
+/**
+ * @description:
+ *     Start a header block, pending changes of the table size are sent.
+ * @param[in|out] targetBlock
+ *     A buffer the block is appended to.
+ */
+void HpackEncoder::startBlock(std::string &targetBlock) {
+    if (!sizeChanged_)
+        return;
+    if (minSize_ < table_.getMaxSize())
+        encodeInteger(minSize_, 5, 0x20, targetBlock);
+    encodeInteger(table_.getMaxSize(), 5, 0x20, targetBlock);
+    sizeChanged_ = false;
+}
+
+/**
+ * @description:
+ *     Encode a header field. A field in a table is indexed, otherwise it's
+ *     added to the dynamic table unless it's sensitive or too large.
+ * @param[in] name
+ *     The name of the field, it's lowercased.
+ * @param[in] value
+ *     The value of the field.
+ * @param[in|out] targetBlock
+ *     A buffer the field is appended to.
+ * @param[in] sensitive
+ *     A sensitive field is never indexed, by this or any intermediary.
+ */
+void HpackEncoder::encodeField(StringView name, StringView value,
+                               std::string &targetBlock, bool sensitive) {
+    name_.resize(name.size());
+    for (size_t i = 0; i < name.size(); ++i) {
+        name_[i] = syntax::toLower(name[i]);
+    }
+    StringView lowerName = name_;
+
+    size_t nameIndex = staticIndex.lookup(lowerName);
+    if (nameIndex && !sensitive) {
+        for (size_t index = nameIndex;
+             index <= staticCount && staticTable[index][0] == lowerName;
+             ++index) {
+            if (staticTable[index][1] == value) {
+                encodeInteger(index, 7, 0x80, targetBlock);
+                return;
+            }
+        }
+    }
+    bool matched = false;
+    size_t found = table_.find(lowerName, value, matched);
+    if (found != HpackTable::npos) {
+        if (matched && !sensitive) {
+            encodeInteger(staticCount + 1 + found, 7, 0x80, targetBlock);
+            return;
+        }
+        if (!nameIndex)
+            nameIndex = staticCount + 1 + found;
+    }
+
+    size_t entrySize = name.size() + value.size() + HpackTable::entryOverhead;
+    if (sensitive) {
+        encodeInteger(nameIndex, 4, 0x10, targetBlock);
+    } else if (entrySize * 4 > table_.getMaxSize() * 3) {
+        // A field taking most of the table would evict everything else.
+        encodeInteger(nameIndex, 4, 0, targetBlock);
+    } else {
+        encodeInteger(nameIndex, 6, 0x40, targetBlock);
+        table_.insert(lowerName, value);
+    }
+    if (!nameIndex)
+        encodeString(lowerName, targetBlock);
+    encodeString(value, targetBlock);
+}
+
+/**
+ * @description:
+ *     Get the dynamic table.
+ */
+const HpackTable &HpackEncoder::getTable() const { return table_; }
+
+/**
+ * @description:
+ *     Set the setting of the table size sent to the peer, it bounds the
+ *     size updates of the peer.
+ * @param[in] maxSize
+ *     The size of the dynamic table.
+ */
+void HpackDecoder::setMaxTableSize(size_t maxSize) {
+    maxTableSize_ = maxSize;
+    if (table_.getMaxSize() > maxSize)
+        table_.setMaxSize(maxSize);
+}
+
+/**
+ * @description:
+ *     Decode a header block, the fields of HEADERS and CONTINUATION frames
+ *     concatenated.
+ * @param[in] data
+ *     A pointer to the block.
+ * @param[in] length
+ *     The length of the block.
+ * @param[in] onField
+ *     A handler called with each field in order.
+ * @return:
+ *     An indicator of whether or not the block was well formed, a
+ *     malformed one is a connection error since the table is broken.
+ */
+bool HpackDecoder::decode(const char *data, size_t length,
+                          const FieldHandler &onField) {
+    BlockReader reader(data, length);
+    bool fieldSeen = false;
+    while (!reader.atEnd()) {
+        uint8_t first = reader.peek();
+        size_t index;
+        if (first & 0x80) { // Indexed field.
+            if (!reader.readInteger(7, index) || index == 0)
+                return false;
+            if (index <= staticCount) {
+                onField(staticTable[index][0], staticTable[index][1]);
+            } else if (index - staticCount - 1 < table_.getCount()) {
+                index -= staticCount + 1;
+                onField(table_.getName(index), table_.getValue(index));
+            } else {
+                return false;
+            }
+            fieldSeen = true;
+            continue;
+        }
+
+        if ((first & 0xE0) == 0x20) { // Table size update.
+            if (fieldSeen || !reader.readInteger(5, index) ||
+                index > maxTableSize_)
+                return false;
+            table_.setMaxSize(index);
+            continue;
+        }
+
+        // Literal fields, with incremental indexing or not.
+        bool indexing = first & 0x40;
+        if (!reader.readInteger(indexing ? 6 : 4, index))
+            return false;
+        StringView name;
+        StringView value;
+        if (index == 0) {
+            if (!reader.readString(name, name_))
+                return false;
+        } else if (index <= staticCount) {
+            name = staticTable[index][0];
+        } else if (index - staticCount - 1 < table_.getCount()) {
+            // The entry may be evicted by the insertion.
+            StringView entryName = table_.getName(index - staticCount - 1);
+            name_.assign(entryName.data(), entryName.size());
+            name = name_;
+        } else {
+            return false;
+        }
+        if (!reader.readString(value, value_))
+            return false;
+        if (indexing)
+            table_.insert(name, value);
+        onField(name, value);
+        fieldSeen = true;
+    }
+    return true;
+}
+
+/**
+ * @description:
+ *     Get the dynamic table.
+ */
+const HpackTable &HpackDecoder::getTable() const { return table_; }
+
+} // namespace msg
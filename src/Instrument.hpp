@@ -0,0 +1,183 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 09:48:27
+ * @LastEditTime: 2019-09-05 09:48:27
+ * @Description: Counting and timing points of parsing and producing, they
+ *     compile to nothing without MESSAGE_ENABLE_STATS.
+ */
+#ifndef MESSAGE_INSTRUMENT_HPP
+#define MESSAGE_INSTRUMENT_HPP
+
+#include <message/Stats.hpp>
+
+#if defined(MESSAGE_ENABLE_STATS)
+#include <atomic>
+#include <chrono>
+#endif
+
+namespace msg {
+namespace stats {
+
+#if defined(MESSAGE_ENABLE_STATS)
+/**
+ * @description:
+ *     The counters of a thread. Only the owning thread writes them, so a
+ *     relaxed load and store replace a read-modify-write, and a snapshot
+ *     reads them at any time.
+ */
+struct ThreadStats {
+    std::atomic<uint64_t> counters[static_cast<size_t>(Counter::Count)];
+    std::atomic<uint64_t> rejects[static_cast<size_t>(ParseError::Count)];
+    std::atomic<uint64_t> phases[static_cast<size_t>(Phase::Count)]
+                                [LatencyHistogram::bucketCount];
+    // Messages left until the next one is timed.
+    uint32_t countdown = 0;
+
+    ThreadStats();
+};
+
+extern thread_local ThreadStats *current;
+extern std::atomic<uint32_t> sampleInterval;
+
+ThreadStats *attach();
+
+/**
+ * @description:
+ *     Get the counters of the calling thread, registered on first use.
+ */
+inline ThreadStats &local() {
+    ThreadStats *stats = current;
+    return stats ? *stats : *attach();
+}
+
+/**
+ * @description:
+ *     Add to a counter owned by the calling thread.
+ */
+inline void add(std::atomic<uint64_t> &counter, uint64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+}
+
+/**
+ * @description:
+ *     Count events of the calling thread.
+ */
+inline void count(Counter counter, uint64_t n = 1) {
+    add(local().counters[static_cast<size_t>(counter)], n);
+}
+
+/**
+ * @description:
+ *     Count a rejected message of the calling thread.
+ */
+inline void reject(ParseError error) {
+    add(local().rejects[static_cast<size_t>(error)], 1);
+}
+
+/**
+ * @description:
+ *     A clock times a call and its phases if the call is sampled. The
+ *     time between two calls of enter() is added to the phase entered
+ *     first, the latencies are recorded when the clock is destroyed.
+ *     Events of the call are counted through the clock, which finds the
+ *     counters of the thread once.
+ */
+class PhaseClock {
+public:
+    explicit PhaseClock(Phase whole) : stats_(local()), whole_(whole) {
+        if (stats_.countdown > 1) {
+            --stats_.countdown;
+            return;
+        }
+        uint32_t interval = sampleInterval.load(std::memory_order_relaxed);
+        stats_.countdown = interval;
+        if (!interval)
+            return;
+        sampled_ = true;
+        start_ = last_ = now();
+    }
+    ~PhaseClock() {
+        if (!sampled_)
+            return;
+        uint64_t end = now();
+        enter(Phase::Count, end);
+        for (size_t phase = 0; phase < phaseCount; ++phase) {
+            if (entered_ >> phase & 1)
+                record(phase, elapsed_[phase]);
+        }
+        record(static_cast<size_t>(whole_), end - start_);
+    }
+    PhaseClock(const PhaseClock &) = delete;
+    PhaseClock &operator=(const PhaseClock &) = delete;
+
+public:
+    void enter(Phase phase) {
+        if (sampled_)
+            enter(phase, now());
+    }
+
+    void count(Counter counter, uint64_t n = 1) {
+        add(stats_.counters[static_cast<size_t>(counter)], n);
+    }
+
+    void reject(ParseError error) {
+        add(stats_.rejects[static_cast<size_t>(error)], 1);
+    }
+
+private:
+    static const size_t phaseCount = static_cast<size_t>(Phase::Count);
+
+    ThreadStats &stats_;
+    Phase whole_;
+    Phase phase_ = Phase::Count;
+    bool sampled_ = false;
+    uint32_t entered_ = 0;
+    uint64_t start_ = 0;
+    uint64_t last_ = 0;
+    uint64_t elapsed_[phaseCount] = {};
+
+private:
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void enter(Phase phase, uint64_t time) {
+        if (phase_ != Phase::Count)
+            elapsed_[static_cast<size_t>(phase_)] += time - last_;
+        if (phase != Phase::Count)
+            entered_ |= 1u << static_cast<size_t>(phase);
+        phase_ = phase;
+        last_ = time;
+    }
+
+    void record(size_t phase, uint64_t latency) {
+        add(stats_.phases[phase][LatencyHistogram::getBucket(latency)], 1);
+    }
+};
+
+#else
+inline void count(Counter, uint64_t = 1) {}
+inline void reject(ParseError) {}
+
+class PhaseClock {
+public:
+    explicit PhaseClock(Phase) {}
+    PhaseClock(const PhaseClock &) = delete;
+    PhaseClock &operator=(const PhaseClock &) = delete;
+
+public:
+    void enter(Phase) {}
+    void count(Counter, uint64_t = 1) {}
+    void reject(ParseError) {}
+};
+#endif
+
+} // namespace stats
+} // namespace msg
+
+#endif // MESSAGE_INSTRUMENT_HPP
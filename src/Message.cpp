@@ -3,66 +3,185 @@
  * @Author: shaqsnake
  * @Email: shaqsnake@gmail.com
  * @Date: 2019-07-25 09:28:37
- * @LastEditTime: 2019-08-15 17:10:28
+ * @LastEditTime: 2019-09-06 12:30:52
  * @Description: An implementation of class msg::Message.
  */
+#include "DialectRules.hpp"
+#include "Folding.hpp"
+#include "Instrument.hpp"
+#include "Syntax.hpp"
 #include <algorithm>
 #include <iostream>
+#include <message/Hpack.hpp>
 #include <message/Message.hpp>
-#include <regex>
+#include <message/MessageTemplate.hpp>
+#include <message/MessageView.hpp>
+#include <message/SharedMessage.hpp>
+#include <message/SnapshotView.hpp>
+#include <sys/uio.h>
+#include <utility>
 #include <vector>
 
 namespace {
+using msg::syntax::headerSeparator;
+using msg::syntax::lineTerminator;
+const size_t npos = static_cast<size_t>(-1);
+const std::string emptyString;
+// Bounds on the spare headers of a thread, a string of more capacity
+// isn't kept.
+const size_t maxSpareHeaders = 128;
+const size_t maxSpareCapacity = 4096;
+
 /**
  * @description:
- *     Remove the whitespace charaters
- *     at the left of an input string.
- * @param[in] s
- *     An input string.
+ *     Get the view parseFromMessage() parses with on this thread, it is
+ *     reused for the capacity of its buffers.
  */
-static inline void ltrim(std::string &s) {
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(),
-                                    [](int ch) { return !std::isspace(ch); }));
+msg::MessageView &getParseView() {
+    static thread_local msg::MessageView view;
+    return view;
 }
 
 /**
  * @description:
- *     Remove the whitespace characters
- *     at the right of an input string.
- * @param[in] s
- *     An input string.
+ *     Get the view parseFromSnapshot() decodes with on this thread, it is
+ *     reused for the capacity of its tables.
  */
-static inline void rtrim(std::string &s) {
-    s.erase(std::find_if(s.rbegin(), s.rend(),
-                         [](int ch) { return !std::isspace(ch); })
-                .base(),
-            s.end());
+msg::SnapshotView &getSnapshotView() {
+    static thread_local msg::SnapshotView view;
+    return view;
 }
 
 /**
  * @description:
- *     Remove the whitspace characters
- *     at the both sides of an input string.
- * @param[in] s
- *     An input string.
+ *     Get the headers removed from messages on this thread, kept for the
+ *     capacity of their strings.
  */
-void trim(std::string &s) {
-    ltrim(s);
-    rtrim(s);
+msg::Message::Headers &getSpareHeaders() {
+    static thread_local msg::Message::Headers spare;
+    return spare;
 }
 
 /**
  * @description:
- *     Check a string matches the pattern.
- * @param[in] s
- *     A string to be checked.
- * @param[in] pattern
- *     A pattern to check.
+ *     Keep a removed header for its strings, unless enough are kept or
+ *     the strings are too large to be kept.
+ */
+void keepSpareHeader(msg::Message::Header &&header) {
+    msg::Message::Headers &spare = getSpareHeaders();
+    if (spare.size() < maxSpareHeaders &&
+        header.first.capacity() <= maxSpareCapacity &&
+        header.second.capacity() <= maxSpareCapacity)
+        spare.push_back(std::move(header));
+}
+
+/**
+ * @description:
+ *     Make a buffer descriptor of a range of characters.
+ */
+inline iovec makeIovec(const char *data, size_t length) {
+    iovec vec;
+    vec.iov_base = const_cast<char *>(data);
+    vec.iov_len = length;
+    return vec;
+}
+
+/**
+ * @description:
+ *     Get the number of bytes in a list of buffers.
+ */
+inline size_t getIovecLength(const iovec *vecs, size_t count) {
+    size_t length = 0;
+    for (size_t i = 0; i < count; ++i)
+        length += vecs[i].iov_len;
+    return length;
+}
+
+/**
+ * @description:
+ *     Append a number in LEB128, 7 bits a byte from the lowest.
+ */
+inline void appendNumber(std::string &dest, uint64_t value) {
+    char bytes[10];
+    size_t count = 0;
+    do {
+        unsigned char byte = value & 0x7F;
+        value >>= 7;
+        bytes[count++] = static_cast<char>(value ? byte | 0x80 : byte);
+    } while (value);
+    dest.append(bytes, count);
+}
+
+/**
+ * @description:
+ *     Append a string prefixed by its length.
+ */
+inline void appendString(std::string &dest, msg::StringView s) {
+    appendNumber(dest, s.size());
+    dest.append(s.data(), s.size());
+}
+
+/**
+ * @description:
+ *     Write a little-endian number of some bytes.
+ */
+inline void writeLittleEndian(char *dest, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        dest[i] = static_cast<char>(value >> (i * 8));
+    }
+}
+
+/**
+ * @description:
+ *     Check if a header is specific to an HTTP/1 connection, such headers
+ *     aren't allowed in HTTP/2 except TE: trailers.
+ */
+bool isConnectionSpecific(msg::HeaderId headerId, msg::StringView headerName,
+                          msg::StringView headerValue) {
+    switch (headerId) {
+    case msg::HeaderId::Connection:
+    case msg::HeaderId::KeepAlive:
+    case msg::HeaderId::TransferEncoding:
+    case msg::HeaderId::Upgrade:
+        return true;
+    case msg::HeaderId::Te:
+        return !msg::syntax::equalsName(headerValue.data(), headerValue.size(),
+                                        "trailers", 8);
+    case msg::HeaderId::Unknown:
+        return msg::syntax::equalsName(headerName.data(), headerName.size(),
+                                       "proxy-connection", 16);
+    default:
+        return false;
+    }
+}
+
+/**
+ * @description:
+ *     Split a request target in absolute-form, see RFC 7230 5.3.2, into
+ *     its scheme, authority, and path and query.
  * @return:
- *     An indicator whether or not was valid is return.
+ *     An indicator of whether or not the target was in absolute-form.
  */
-bool isValid(const std::string &s, std::string pattern) {
-    return std::regex_match(s, std::regex(pattern));
+bool splitAbsoluteTarget(msg::StringView target, msg::StringView &scheme,
+                         msg::StringView &authority, msg::StringView &path) {
+    size_t colon = target.find(':');
+    if (colon == 0 || colon == msg::StringView::npos ||
+        target.substr(colon, 3) != "://")
+        return false;
+    for (size_t i = 0; i < colon; ++i) {
+        char ch = msg::syntax::toLower(target[i]);
+        bool alpha = ch >= 'a' && ch <= 'z';
+        if (!alpha && (i == 0 || !((ch >= '0' && ch <= '9') || ch == '+' ||
+                                   ch == '-' || ch == '.')))
+            return false;
+    }
+    size_t end = colon + 3;
+    while (end < target.size() && target[end] != '/' && target[end] != '?')
+        ++end;
+    scheme = target.substr(0, colon);
+    authority = target.substr(colon + 3, end - colon - 3);
+    path = target.substr(end);
+    return true;
 }
 
 } // namespace
@@ -80,66 +199,85 @@ namespace msg {
  *     was successful is returned.
  */
 bool Message::parseFromMessage(const std::string &rawMessage) {
-    std::string lineTerminator = "\r\n";
-    std::vector<std::string> lines; // Store the splited parts of message.
-    std::string::size_type start = 0;
-    std::string::size_type offset = rawMessage.find(lineTerminator);
-    // Splite message by lines.
-    while (start != rawMessage.length()) {
-        lines.push_back(rawMessage.substr(start, offset - start));
-        start = offset + lineTerminator.size();
-        offset = rawMessage.find(lineTerminator, start);
-
-        // Line length exceed the limitation.
-        if (offset != std::string::npos && maxLineLength_ &&
-            offset - start + 2 > maxLineLength_)
-            return false;
-    }
+    return parseFromMessage(rawMessage.data(), rawMessage.size());
+}
 
-    // Handle each line and assign it to header or body.
-    bool doneWithHeaders = false;
-    for (auto &line : lines) {
-        if (line == "") {
-            doneWithHeaders = true;
-            continue;
-        }
+/**
+ * @description:
+ *     Parse a raw message in a buffer into an object.
+ * @param[in] data
+ *     A pointer to the raw message, it is not referenced after the call.
+ * @param[in] length
+ *     The length of the raw message.
+ * @return:
+ *     An identicator of whether or not the parse process
+ *     was successful is returned, getParseError() tells why it failed.
+ */
+bool Message::parseFromMessage(const char *data, size_t length) {
+    return parseFromMessage<GenericDialect>(data, length);
+}
 
-        if (!doneWithHeaders) { // Extract the name and value filed of headers.
-            std::string headerFieldDelimeter = ":";
-
-            auto pos = line.find(headerFieldDelimeter);
-            if (pos == std::string::npos) {
-                ltrim(line);
-                line.insert(0, " ");
-                headers_.back().second += line;
-            } else { // Set headers.
-
-                auto headerName = line.substr(0, pos);
-                // Printable US-ASCII characters except colon
-                if (!isValid(headerName, "[\x21-\x39\x3B-\x7E]*"))
-                    return false;
-
-                auto headerValue = line.substr(pos + 1);
-                // Printable US-ASCII characters and WSP characters
-                if (!isValid(headerValue, "[\x9\x20-\x7E]*"))
-                    return false;
-                setHeader(headerName, headerValue);
-            }
-        } else { // Concat rest message to body.
-            body_ += line;
+/**
+ * @description:
+ *     Parse a raw message in a buffer by the rules of a protocol. The
+ *     dialect also decides whether single letter names are compact forms
+ *     and, but for the generic one, how repeated fields are produced.
+ * @param[in] data
+ *     A pointer to the raw message, it is not referenced after the call.
+ * @param[in] length
+ *     The length of the raw message.
+ * @return:
+ *     An identicator of whether or not the parse process
+ *     was successful is returned, getParseError() tells why it failed.
+ */
+template <typename Dialect>
+bool Message::parseFromMessage(const char *data, size_t length) {
+    typedef DialectRules<Dialect> Rules;
+    MessageView &view = getParseView();
+    view.setLineLength(maxLineLength_);
+    view.setLimits(limits_);
+    bool parsed = view.parse<Dialect>(data, length);
+    parseError_ = view.getError();
+    if (!Rules::keepsFieldForm)
+        fieldForm_ = Rules::repeatsFields ? FieldForm::Repeated
+                                          : FieldForm::Joined;
+    if (compactForms_ != Rules::compactForms) {
+        // Headers set before are keyed on the other rule.
+        compactForms_ = Rules::compactForms;
+        for (size_t i = 0; i < headers_.size(); ++i)
+            headerIds_[i] = identify(headers_[i].first);
+        if (!index_.empty())
+            rebuildIndex(index_.size());
+    }
+    if (parsed) {
+        if (view.getStartLine().getType() != StartLine::Type::None)
+            startLine_ = view.getStartLine();
+        // Copy each field once, repeated headers are combined into one value.
+        for (size_t i = 0; i < view.getHeaderCount(); ++i) {
+            auto field = view.getHeader(i);
+            addHeader(field.name, field.value);
         }
+        auto body = view.getBody();
+        body_.append(body.data(), body.size());
     }
+    // Drop references to the raw message but keep the capacity.
+    view.clear();
+    return parsed;
+}
 
-    // Trim whitespace characters of all headers and body field.
-    for (auto &header : headers_) {
-        trim(header.first);
-        trim(header.second);
-    }
-    if (body_.length())
-        trim(body_);
+template bool Message::parseFromMessage<GenericDialect>(const char *, size_t);
+template bool Message::parseFromMessage<HttpDialect>(const char *, size_t);
+template bool Message::parseFromMessage<SipDialect>(const char *, size_t);
+template bool Message::parseFromMessage<MailDialect>(const char *, size_t);
 
-    return true;
-}
+/**
+ * @description:
+ *     Get the reason the last parse from a message, snapshot or header
+ *     block failed.
+ * @return:
+ *     The reason, None if the last parse was successful.
+ */
+ParseError Message::getParseError() const { return parseError_; }
 
 /**
  * @description:
@@ -149,32 +287,544 @@ bool Message::parseFromMessage(const std::string &rawMessage) {
  */
 std::string Message::produceToMessage() const {
     std::string targetMessage;
-    std::vector<std::string> lines;
+    produceToMessage(targetMessage);
+    return targetMessage;
+}
 
-    dumpToVec(lines);
+/**
+ * @description:
+ *     Produce message components to the end of a buffer. The buffer
+ *     grows once by the exact length of the message, a buffer reused
+ *     with enough capacity doesn't allocate at all.
+ *
+ *     A nonempty body is ended by a line terminator like the lines before
+ *     it, the body parseFromMessage() trimmed is framed again so. A
+ *     Content-Length of that body counts the terminator, one of a body
+ *     kept as it was framed leaves an empty line before the next message.
+ *     MessageParser ignores it, as RFC 7230 3.5 and RFC 3261 7.5 ask.
+ * @param[in|out] targetMessage
+ *     A buffer the message text is appended to.
+ */
+void Message::produceToMessage(std::string &targetMessage) const {
+    stats::PhaseClock clock(Phase::Produce);
+    size_t messageLength = getMessageLength();
+    targetMessage.reserve(targetMessage.size() + messageLength);
+    clock.count(Counter::Produced);
+    clock.count(Counter::ProducedBytes, messageLength);
 
     // Fold message if set max line length
     if (maxLineLength_) {
-        foldMessageLines(lines, maxLineLength_);
+        clock.enter(Phase::Fold);
+        syntax::StringSink sink{targetMessage};
+        clock.count(Counter::Folds, foldMessage(sink));
+        return;
     }
 
-    for (const auto &line : lines) {
-        targetMessage += line + "\r\n";
+    if (startLine_.getType() != StartLine::Type::None) {
+        auto text = startLine_.getText();
+        targetMessage.append(text.data(), text.size())
+            .append(lineTerminator, 2);
     }
-    return targetMessage;
+    forEachHeaderLine([&targetMessage](StringView name, StringView value) {
+        targetMessage.append(name.data(), name.size())
+            .append(headerSeparator, 2)
+            .append(value.data(), value.size())
+            .append(lineTerminator, 2);
+    });
+    targetMessage.append(lineTerminator, 2);
+    if (!body_.empty()) {
+        targetMessage.append(body_).append(lineTerminator, 2);
+    }
+}
+
+/**
+ * @description:
+ *     Produce message components to a list of buffers for writev() or
+ *     sendmsg(). The buffers refer to the names, values and body of the
+ *     message, so it must stay unchanged until they were written. Folded
+ *     lines don't exist in the message, they are produced into a buffer
+ *     supplied by the caller.
+ * @param[out] dest
+ *     A vector the buffers are appended to.
+ * @param[in|out] foldBuffer
+ *     A buffer holds the folded message if a line length was set, it must
+ *     live as long as the buffers.
+ */
+void Message::produceToIovec(std::vector<iovec> &dest,
+                             std::string &foldBuffer) const {
+    if (maxLineLength_) {
+        foldBuffer.clear();
+        produceToMessage(foldBuffer);
+        dest.push_back(makeIovec(foldBuffer.data(), foldBuffer.size()));
+        return;
+    }
+
+    stats::PhaseClock clock(Phase::Produce);
+    size_t first = dest.size();
+    dest.reserve(dest.size() + (headers_.size() + repeats_.size()) * 4 + 5);
+    if (startLine_.getType() != StartLine::Type::None) {
+        auto text = startLine_.getText();
+        dest.push_back(makeIovec(text.data(), text.size()));
+        dest.push_back(makeIovec(lineTerminator, 2));
+    }
+    forEachHeaderLine([&dest](StringView name, StringView value) {
+        dest.push_back(makeIovec(name.data(), name.size()));
+        dest.push_back(makeIovec(headerSeparator, 2));
+        dest.push_back(makeIovec(value.data(), value.size()));
+        dest.push_back(makeIovec(lineTerminator, 2));
+    });
+    dest.push_back(makeIovec(lineTerminator, 2));
+    if (!body_.empty()) {
+        dest.push_back(makeIovec(body_.data(), body_.size()));
+        dest.push_back(makeIovec(lineTerminator, 2));
+    }
+    clock.count(Counter::Produced);
+    clock.count(Counter::ProducedBytes,
+                 getIovecLength(dest.data() + first, dest.size() - first));
 }
 
+/**
+ * @description:
+ *     Get the exact length of the message produceToMessage() produces.
+ * @return:
+ *     The number of bytes of the message text.
+ */
+size_t Message::getMessageLength() const {
+    if (maxLineLength_) {
+        syntax::LengthSink sink;
+        foldMessage(sink);
+        return sink.length;
+    }
+
+    size_t length = 2;
+    if (startLine_.getType() != StartLine::Type::None) {
+        length += startLine_.getText().size() + 2;
+    }
+    forEachHeaderLine([&length](StringView name, StringView value) {
+        length += name.size() + value.size() + 4;
+    });
+    if (!body_.empty()) {
+        length += body_.size() + 2;
+    }
+    return length;
+}
+
+/**
+ * @description:
+ *     Restore a message from a binary snapshot. Nothing is validated or
+ *     unfolded again, and the strings of a reset message are reused.
+ * @param[in] data
+ *     A pointer to the snapshot, it is not referenced after the call.
+ * @param[in] length
+ *     The length of the buffer, it may hold more after the snapshot.
+ * @return:
+ *     An identicator of whether or not the snapshot was intact. The
+ *     message is reset first, the line length limit and field form are
+ *     kept.
+ */
+bool Message::parseFromSnapshot(const char *data, size_t length) {
+    reset();
+    SnapshotView &snapshot = getSnapshotView();
+    bool parsed = snapshot.parse(data, length);
+    if (parsed) {
+        if (snapshot.getStartLine().getType() != StartLine::Type::None)
+            startLine_ = snapshot.getStartLine();
+        for (size_t i = 0; i < snapshot.getHeaderCount(); ++i) {
+            auto field = snapshot.getHeader(i);
+            appendHeader(field.id, field.name, field.value);
+            const char *value = field.value.data();
+            StringView previous = snapshot.getHeaderField(i, 0);
+            for (size_t k = 1; k < snapshot.getHeaderFieldCount(i); ++k) {
+                StringView next = snapshot.getHeaderField(i, k);
+                repeats_.push_back(
+                    Repeat{i,
+                           static_cast<size_t>(previous.data() +
+                                               previous.size() - value),
+                           static_cast<size_t>(next.data() - value)});
+                previous = next;
+            }
+        }
+        auto body = snapshot.getBody();
+        body_.assign(body.data(), body.size());
+    }
+    size_t snapshotLength = parsed ? snapshot.getLength() : length;
+    // Drop references to the snapshot but keep the capacity.
+    snapshot.clear();
+    return finishDecode(parsed, snapshotLength);
+}
+
+/**
+ * @description:
+ *     Produce the message to the end of a buffer as a binary snapshot, it
+ *     keeps the fields of repeated headers apart. See SnapshotView for
+ *     the format.
+ * @param[in|out] targetSnapshot
+ *     A buffer the snapshot is appended to.
+ */
+void Message::produceToSnapshot(std::string &targetSnapshot) const {
+    size_t start = targetSnapshot.size();
+    size_t estimate = SnapshotView::headerLength +
+                      SnapshotView::trailerLength + headers_.size() * 8 +
+                      repeats_.size() * 4 + startLine_.getText().size() +
+                      body_.size() + 16;
+    for (const auto &header : headers_) {
+        estimate += header.first.size() + header.second.size();
+    }
+    targetSnapshot.reserve(start + estimate);
+
+    targetSnapshot.append(SnapshotView::magic, sizeof(SnapshotView::magic));
+    targetSnapshot.append(1, static_cast<char>(SnapshotView::version));
+    // Reserved bytes, then the length written at last.
+    targetSnapshot.append(SnapshotView::headerLength - 5, '\0');
+
+    appendString(targetSnapshot, startLine_.getText());
+    appendNumber(targetSnapshot, headers_.size());
+    for (size_t position = 0; position < headers_.size(); ++position) {
+        targetSnapshot.append(1, static_cast<char>(headerIds_[position]));
+        appendString(targetSnapshot, headers_[position].first);
+        appendString(targetSnapshot, headers_[position].second);
+        size_t count = 0;
+        for (const auto &repeat : repeats_) {
+            count += repeat.position == position;
+        }
+        appendNumber(targetSnapshot, count);
+        for (size_t i = 0; count && i < repeats_.size(); ++i) {
+            if (repeats_[i].position == position) {
+                appendNumber(targetSnapshot, repeats_[i].end);
+                appendNumber(targetSnapshot, repeats_[i].begin);
+            }
+        }
+    }
+    appendString(targetSnapshot, body_);
+
+    size_t length = targetSnapshot.size() - start + SnapshotView::trailerLength;
+    writeLittleEndian(&targetSnapshot[start + 8], length, 8);
+    uint32_t crc = syntax::crc32c(targetSnapshot.data() + start,
+                                  targetSnapshot.size() - start);
+    char trailer[SnapshotView::trailerLength];
+    writeLittleEndian(trailer, crc, sizeof(trailer));
+    targetSnapshot.append(trailer, sizeof(trailer));
+}
+
+/**
+ * @description:
+ *     Parse an HTTP/2 header block into an object as RFC 7540 8.1.2.3
+ *     translates it to HTTP/1.1. :method and :path, or :status, make the
+ *     start line with the version HTTP/2, :authority makes Host and
+ *     :scheme is left to the connection. A request needs all but
+ *     :status, CONNECT only :method and :authority, which is the target
+ *     then. Other pseudo-headers are kept as headers. Cookie crumbs are
+ *     combined with a semicolon and a space.
+ * @param[in] data
+ *     A pointer to the header block, it is not referenced after the call.
+ * @param[in] length
+ *     The length of the header block.
+ * @param[in] decoder
+ *     The decoder of the connection the block was received on.
+ * @return:
+ *     An identicator of whether or not the block was decoded into a well
+ *     formed message. The message is reset first, a malformed message
+ *     still updates the dynamic table.
+ */
+bool Message::parseFromHpack(const char *data, size_t length,
+                             HpackDecoder &decoder) {
+    reset();
+    struct {
+        std::string method;
+        std::string path;
+        std::string status;
+        std::string scheme;
+        std::string authority;
+        bool regularSeen = false;
+        bool wellFormed = true;
+    } block;
+    // Two captures keep the handler within the small buffer of
+    // std::function.
+    auto onField = [this, &block](StringView name, StringView value) {
+        if (!name.empty() && name[0] == ':') {
+            // Pseudo-headers precede regular headers and aren't repeated.
+            std::string *part = name == ":method"      ? &block.method
+                                : name == ":path"      ? &block.path
+                                : name == ":status"    ? &block.status
+                                : name == ":scheme"    ? &block.scheme
+                                : name == ":authority" ? &block.authority
+                                                       : nullptr;
+            if (block.regularSeen || (part && !part->empty()) ||
+                (part && value.empty())) {
+                block.wellFormed = false;
+            } else if (part) {
+                part->assign(value.data(), value.size());
+                if (part == &block.authority)
+                    appendHeader(HeaderId::Host,
+                                 getHeaderName(HeaderId::Host), value);
+            } else {
+                addHeader(name, value);
+            }
+            return;
+        }
+
+        block.regularSeen = true;
+        HeaderId headerId = identify(name);
+        // Host repeats :authority if both are sent.
+        if (headerId == HeaderId::Host && !block.authority.empty()) {
+            block.wellFormed = block.wellFormed && value == block.authority;
+            return;
+        }
+        size_t position = findHeader(headerId, name);
+        if (position == npos) {
+            appendHeader(headerId, name, value);
+            return;
+        }
+        auto &header = headers_[position];
+        size_t end = header.second.size();
+        header.second.append(headerId == HeaderId::Cookie ? "; " : ", ");
+        header.second.append(value.data(), value.size());
+        repeats_.push_back(Repeat{position, end, end + 2});
+    };
+    if (!decoder.decode(data, length, onField) || !block.wellFormed)
+        return finishDecode(false, length);
+
+    if (!block.method.empty() || !block.path.empty() ||
+        !block.scheme.empty()) {
+        bool connect = block.method == "CONNECT";
+        // CONNECT has no :path and :scheme, its target is :authority.
+        if (connect && block.path.empty() && block.scheme.empty())
+            block.path = block.authority;
+        return finishDecode(
+            block.status.empty() && !block.method.empty() &&
+                !block.path.empty() && (connect || !block.scheme.empty()) &&
+                startLine_.setRequest(block.method, block.path, "HTTP/2"),
+            length);
+    }
+    if (!block.authority.empty())
+        return finishDecode(false, length);
+    if (!block.status.empty()) {
+        unsigned code = 0;
+        for (char digit : block.status) {
+            if (digit < '0' || digit > '9')
+                return finishDecode(false, length);
+            code = code * 10 + (digit - '0');
+        }
+        return finishDecode(block.status.size() == 3 &&
+                                startLine_.setStatus("HTTP/2", code, ""),
+                            length);
+    }
+    return finishDecode(true, length); // A trailer has no start line.
+}
+
+/**
+ * @description:
+ *     Produce the message to the end of a buffer as an HTTP/2 header
+ *     block, translated from HTTP/1.1 as RFC 7540 8.1.2.3 asks. The start
+ *     line makes the pseudo-headers, a request gets :scheme and
+ *     :authority from a target in absolute-form, or else from the scheme
+ *     given and Host, which is left out then. CONNECT sends its target as
+ *     :authority only. Headers specific to HTTP/1 connections are left
+ *     out, Cookie is split into crumbs and Authorization is never indexed.
+ *     The body is left to DATA frames.
+ * @param[in|out] targetBlock
+ *     A buffer the header block is appended to.
+ * @param[in] encoder
+ *     The encoder of the connection the block is sent on.
+ * @param[in] scheme
+ *     The scheme of a request whose target has none.
+ */
+void Message::produceToHpack(std::string &targetBlock, HpackEncoder &encoder,
+                             StringView scheme) const {
+    encoder.startBlock(targetBlock);
+    bool request = startLine_.getType() == StartLine::Type::Request;
+    if (request) {
+        encoder.encodeField(":method", startLine_.getMethodName(),
+                            targetBlock);
+        StringView target = startLine_.getTarget();
+        StringView authority = getHeaderValue(HeaderId::Host);
+        StringView path = target;
+        if (startLine_.getMethod() == Method::Connect) {
+            encoder.encodeField(":authority", target, targetBlock);
+        } else {
+            splitAbsoluteTarget(target, scheme, authority, path);
+            encoder.encodeField(":scheme", scheme, targetBlock);
+            if (!authority.empty())
+                encoder.encodeField(":authority", authority, targetBlock);
+            if (path.empty() || path[0] == '?') { // The path is never empty.
+                encoder.encodeField(":path", "/" + path.toString(),
+                                    targetBlock);
+            } else {
+                encoder.encodeField(":path", path, targetBlock);
+            }
+        }
+    } else if (startLine_.getType() == StartLine::Type::Status) {
+        unsigned code = startLine_.getStatusCode();
+        char digits[3] = {static_cast<char>('0' + code / 100 % 10),
+                          static_cast<char>('0' + code / 10 % 10),
+                          static_cast<char>('0' + code % 10)};
+        encoder.encodeField(":status", StringView(digits, 3), targetBlock);
+    }
+
+    forEachHeaderLine([&](StringView name, StringView value) {
+        if (!name.empty() && name[0] == ':')
+            encoder.encodeField(name, value, targetBlock);
+    });
+    forEachHeaderLine([&](StringView name, StringView value) {
+        if (!name.empty() && name[0] == ':')
+            return;
+        HeaderId headerId = identify(name);
+        if (isConnectionSpecific(headerId, name, value) ||
+            (request && headerId == HeaderId::Host))
+            return;
+        if (headerId == HeaderId::Cookie) { // Crumbs are indexed apart.
+            size_t begin = 0;
+            while (begin < value.size()) {
+                size_t end = begin;
+                while (end < value.size() && value[end] != ';')
+                    ++end;
+                encoder.encodeField(name, value.substr(begin, end - begin),
+                                    targetBlock);
+                begin = end + 1;
+                while (begin < value.size() && syntax::isSpace(value[begin]))
+                    ++begin;
+            }
+            return;
+        }
+        encoder.encodeField(name, value, targetBlock,
+                            headerId == HeaderId::Authorization ||
+                                headerId == HeaderId::ProxyAuthorization);
+    });
+}
+
+/**
+ * @description:
+ *     Compile the message into a template. The lines of headers with slots
+ *     and a body with a slot are left open, the rest is produced once as
+ *     produceToMessage() does, folding included.
+ * @param[in|out] targetTemplate
+ *     A template whose slots were added, it is compiled anew.
+ */
+void Message::produceToTemplate(MessageTemplate &targetTemplate) const {
+    std::string &text = targetTemplate.text_;
+    text.clear();
+    targetTemplate.pieces_.clear();
+    targetTemplate.maxLineLength_ = maxLineLength_;
+    syntax::StringSink sink{text};
+
+    if (startLine_.getType() != StartLine::Type::None) {
+        auto line = startLine_.getText();
+        text.append(line.data(), line.size()).append(lineTerminator, 2);
+    }
+    // A header with a slot makes one line, at its first line.
+    std::vector<bool> placed(targetTemplate.slots_.size(), false);
+    forEachHeaderLine([&](StringView name, StringView value) {
+        size_t slot = targetTemplate.findSlot(lookupHeaderId(name), name);
+        if (slot != npos) {
+            if (!placed[slot])
+                targetTemplate.appendSlot(slot, name);
+            placed[slot] = true;
+        } else if (maxLineLength_) {
+            syntax::foldLine(syntax::Line(name, value), maxLineLength_, sink);
+        } else {
+            text.append(name.data(), name.size())
+                .append(headerSeparator, 2)
+                .append(value.data(), value.size())
+                .append(lineTerminator, 2);
+        }
+    });
+    size_t bodySlot = npos;
+    for (size_t slot = 0; slot < placed.size(); ++slot) {
+        if (targetTemplate.isBody(slot)) {
+            bodySlot = bodySlot == npos ? slot : bodySlot;
+        } else if (!placed[slot]) {
+            targetTemplate.appendSlot(slot, targetTemplate.slots_[slot].name);
+        }
+    }
+    text.append(lineTerminator, 2);
+
+    if (bodySlot != npos) {
+        targetTemplate.appendSlot(bodySlot, StringView());
+    } else if (!body_.empty() && maxLineLength_) {
+        syntax::foldLine(syntax::Line(body_.data(), body_.size()),
+                         maxLineLength_, sink);
+    } else if (!body_.empty()) {
+        text.append(body_).append(lineTerminator, 2);
+    }
+    targetTemplate.compiled_ = true;
+}
+
+/**
+ * @description:
+ *     Freeze the message into a shared message made in one allocation,
+ *     the message may be changed or reset afterwards.
+ * @param[in|out] targetMessage
+ *     A handle that refers to the new message, its former one is dropped.
+ */
+void Message::produceToShared(SharedMessage &targetMessage) const {
+    size_t textLength = startLine_.getText().size() + body_.size();
+    for (const auto &header : headers_) {
+        textLength += header.first.size() + header.second.size();
+    }
+    SharedMessage::Block *block = SharedMessage::allocate(
+        headers_.size(), repeats_.size(), textLength, nullptr);
+    char *text =
+        SharedMessage::writeStartLine(block, startLine_, block->text());
+    block->compactForms = compactForms_;
+    block->repeatsFields = fieldForm_ == FieldForm::Repeated;
+
+    SharedMessage::Entry *entries = block->entries();
+    SharedMessage::Boundary *boundaries = block->boundaries();
+    uint32_t boundaryIndex = 0;
+    for (size_t position = 0; position < headers_.size(); ++position) {
+        const Header &header = headers_[position];
+        SharedMessage::Entry &entry = entries[position];
+        entry.id = headerIds_[position];
+        entry.name = text;
+        entry.nameLength = static_cast<uint32_t>(header.first.size());
+        text = std::copy(header.first.begin(), header.first.end(), text);
+        entry.value = text;
+        entry.valueLength = static_cast<uint32_t>(header.second.size());
+        text = std::copy(header.second.begin(), header.second.end(), text);
+        entry.boundaryIndex = boundaryIndex;
+        for (const auto &repeat : repeats_) {
+            if (repeat.position == position) {
+                boundaries[boundaryIndex++] = SharedMessage::Boundary{
+                    static_cast<uint32_t>(repeat.end),
+                    static_cast<uint32_t>(repeat.begin)};
+            }
+        }
+        entry.boundaryCount = boundaryIndex - entry.boundaryIndex;
+    }
+    block->body = text;
+    block->bodyLength = body_.size();
+    std::copy(body_.begin(), body_.end(), text);
+    targetMessage = SharedMessage(block);
+}
+
+/**
+ * @description:
+ *     Get the request or status line.
+ * @return:
+ *     The start line, its type is None if the message has none.
+ */
+const StartLine &Message::getStartLine() const { return startLine_; }
+
+/**
+ * @description:
+ *     Get the request or status line to be changed.
+ * @return:
+ *     The start line, its type is None if the message has none.
+ */
+StartLine &Message::getStartLine() { return startLine_; }
+
 /**
  * @description:
  *     Get the all headers.
  * @return:
- *     Headers parsed from a raw message.
+ *     Headers parsed from a raw message, valid until the message changes.
  */
-Message::Headers Message::getHeaders() const { return headers_; }
+const Message::Headers &Message::getHeaders() const { return headers_; }
 
 /**
  * @description:
- *     Check the name of a header is exist or not.
+ *     Check the name of a header is exist or not, names are compared
+ *     case-insensitively and a SIP compact form matches its full name.
  * @param[in] headerName
  *     the name filed of a header to be checked
  * @return:
@@ -182,16 +832,26 @@ Message::Headers Message::getHeaders() const { return headers_; }
  *     is returned.
  */
 bool Message::hasHeader(const std::string &headerName) const {
-    for (const auto &header : headers_) {
-        if (header.first == headerName)
-            return true;
-    }
-    return false;
+    return findHeader(identify(headerName), headerName) != npos;
 }
 
 /**
  * @description:
- *     Set message header by its name and value.
+ *     Check a well-known header is exist or not.
+ * @param[in] headerId
+ *     the identifier of a header to be checked
+ * @return:
+ *     An indicator of whether or not the header was exist is returned.
+ */
+bool Message::hasHeader(HeaderId headerId) const {
+    return findHeader(headerId, StringView()) != npos;
+}
+
+/**
+ * @description:
+ *     Set message header by its name and value. Unless it's replaced, a
+ *     repeated header is appended with a bare comma as it always was, not
+ *     with the comma and space addHeader() uses.
  * @param[in] headerName
  *     A header's name to identity header.
  * @param[in] headerValue
@@ -200,18 +860,79 @@ bool Message::hasHeader(const std::string &headerName) const {
  */
 void Message::setHeader(const std::string &headerName,
                         const std::string &headerValue, bool replace) {
-    for (auto &header : headers_) {
-        if (header.first == headerName) {
-            if (replace)
-                header.second = headerValue;
-            else
-                header.second += "," + headerValue;
-            return;
-        }
+    storeHeader(identify(headerName), headerName, headerValue, replace);
+}
+
+/**
+ * @description:
+ *     Set message header by its name and a value moved into the message.
+ * @param[in] headerName
+ *     A header's name to identity header.
+ * @param[in] headerValue
+ *     A heaser's value to be set according to its name.
+ * @return:
+ */
+void Message::setHeader(const std::string &headerName,
+                        std::string &&headerValue, bool replace) {
+    storeHeader(identify(headerName), headerName, std::move(headerValue),
+                replace);
+}
+
+/**
+ * @description:
+ *     Set a well-known header by its identifier and value, a new header
+ *     gets the canonical name.
+ * @param[in] headerId
+ *     The identifier of a header.
+ * @param[in] headerValue
+ *     A heaser's value to be set according to its identifier.
+ * @return:
+ */
+void Message::setHeader(HeaderId headerId, const std::string &headerValue,
+                        bool replace) {
+    storeHeader(headerId, getHeaderName(headerId), headerValue, replace);
+}
+
+/**
+ * @description:
+ *     Set a well-known header by its identifier and a value moved into
+ *     the message.
+ * @param[in] headerId
+ *     The identifier of a header.
+ * @param[in] headerValue
+ *     A heaser's value to be set according to its identifier.
+ * @return:
+ */
+void Message::setHeader(HeaderId headerId, std::string &&headerValue,
+                        bool replace) {
+    storeHeader(headerId, getHeaderName(headerId), std::move(headerValue),
+                replace);
+}
+
+/**
+ * @description:
+ *     Add a header field as it was received. A repeated name is combined
+ *     into the existing value with a comma and a space, as a parsed
+ *     message has always combined values that kept the space after their
+ *     colon. setHeader() appends with a bare comma.
+ * @param[in] headerName
+ *     A header's name to identity header.
+ * @param[in] headerValue
+ *     A header's value of the field.
+ */
+void Message::addHeader(StringView headerName, StringView headerValue) {
+    HeaderId headerId = identify(headerName);
+    size_t position = findHeader(headerId, headerName);
+    if (position == npos) {
+        appendHeader(headerId, headerName, headerValue);
+        return;
     }
 
-    headers_.emplace_back(headerName, headerValue);
-    return;
+    auto &header = headers_[position];
+    size_t end = header.second.size();
+    header.second.append(", ");
+    header.second.append(headerValue.data(), headerValue.size());
+    repeats_.push_back(Repeat{position, end, end + 2});
 }
 
 /**
@@ -221,11 +942,17 @@ void Message::setHeader(const std::string &headerName,
  *     A header's name to specified which header should be remvoed.
  */
 void Message::removeHeader(const std::string &headerName) {
-    headers_.erase(std::remove_if(headers_.begin(), headers_.end(),
-                                  [&headerName](Message::Header header) {
-                                      return header.first == headerName;
-                                  }),
-                   headers_.end());
+    eraseHeader(findHeader(identify(headerName), headerName));
+}
+
+/**
+ * @description:
+ *     Remove a well-known header by its identifier.
+ * @param[in] headerId;
+ *     The identifier of the header should be removed.
+ */
+void Message::removeHeader(HeaderId headerId) {
+    eraseHeader(findHeader(headerId, StringView()));
 }
 
 /**
@@ -234,14 +961,106 @@ void Message::removeHeader(const std::string &headerName) {
  * @param[in] headerName
  *     A header's name as an index.
  * @return:
- *     The header's value which indexed by its name.
+ *     The header's value which indexed by its name, an empty string if
+ *     there is none. It's valid until the message changes.
  */
-std::string Message::getHeaderValue(const std::string &headerName) const {
-    for (const auto &header : headers_) {
-        if (header.first == headerName)
-            return header.second;
-    }
-    return "";
+const std::string &
+Message::getHeaderValue(const std::string &headerName) const {
+    size_t position = findHeader(identify(headerName), headerName);
+    if (position == npos)
+        return emptyString;
+    return headers_[position].second;
+}
+
+/**
+ * @description:
+ *     Get a well-known header's value by its identifier.
+ * @param[in] headerId
+ *     The identifier of a header.
+ * @return:
+ *     The header's value which indexed by its identifier, an empty string
+ *     if there is none. It's valid until the message changes.
+ */
+const std::string &Message::getHeaderValue(HeaderId headerId) const {
+    size_t position = findHeader(headerId, StringView());
+    if (position == npos)
+        return emptyString;
+    return headers_[position].second;
+}
+
+/**
+ * @description:
+ *     Count the fields of a header, a header set or added repeatedly
+ *     keeps its fields apart in the combined value.
+ * @param[in] headerName
+ *     A header's name as an index.
+ * @return:
+ *     The number of fields, zero if there is no such header.
+ */
+size_t Message::getHeaderFieldCount(const std::string &headerName) const {
+    size_t position = findHeader(identify(headerName), headerName);
+    if (position == npos)
+        return 0;
+    return 1 + std::count_if(repeats_.begin(), repeats_.end(),
+                             [position](const Repeat &repeat) {
+                                 return repeat.position == position;
+                             });
+}
+
+/**
+ * @description:
+ *     Count the fields of a well-known header.
+ * @param[in] headerId
+ *     The identifier of a header.
+ * @return:
+ *     The number of fields, zero if there is no such header.
+ */
+size_t Message::getHeaderFieldCount(HeaderId headerId) const {
+    size_t position = findHeader(headerId, StringView());
+    if (position == npos)
+        return 0;
+    return 1 + std::count_if(repeats_.begin(), repeats_.end(),
+                             [position](const Repeat &repeat) {
+                                 return repeat.position == position;
+                             });
+}
+
+/**
+ * @description:
+ *     Get a field of a header as it was set or added, without the comma
+ *     combining it with the others.
+ * @param[in] headerName
+ *     A header's name as an index.
+ * @param[in] index
+ *     The index of the field, in the order the fields were added.
+ * @return:
+ *     A view of the field, valid until the message changes. It's empty if
+ *     there is no such field.
+ */
+StringView Message::getHeaderField(const std::string &headerName,
+                                   size_t index) const {
+    size_t position = findHeader(identify(headerName), headerName);
+    if (position == npos)
+        return StringView();
+    return getField(position, index);
+}
+
+/**
+ * @description:
+ *     Get a field of a well-known header.
+ * @param[in] headerId
+ *     The identifier of a header.
+ * @param[in] index
+ *     The index of the field, in the order the fields were added.
+ * @return:
+ *     A view of the field, valid until the message changes. It's empty if
+ *     there is no such field.
+ */
+StringView Message::getHeaderField(HeaderId headerId, size_t index) const {
+    size_t position = findHeader(headerId, StringView());
+    if (position == npos)
+        return StringView();
+    return getField(position, index);
 }
 
 /**
@@ -250,7 +1069,19 @@ std::string Message::getHeaderValue(const std::string &headerName) const {
  * @return:
  *     A text of message body.
  */
-std::string Message::getBody() const { return body_; }
+const std::string &Message::getBody() const { return body_; }
+
+/**
+ * @description:
+ *     Move message body out of the message, the body becomes empty.
+ * @return:
+ *     A text of message body.
+ */
+std::string Message::takeBody() {
+    std::string bodyText = std::move(body_);
+    body_.clear();
+    return bodyText;
+}
 
 /**
  * @description:
@@ -261,6 +1092,15 @@ std::string Message::getBody() const { return body_; }
  */
 void Message::setBody(const std::string &bodyText) { body_ = bodyText; }
 
+/**
+ * @description:
+ *    Set message body by a text moved into the message.
+ * @param[in] bodyText
+ *    A text should be set to message body compoent.
+ * @return:
+ */
+void Message::setBody(std::string &&bodyText) { body_ = std::move(bodyText); }
+
 /**
  * @description:
  *     Set line length limit number.
@@ -269,77 +1109,331 @@ void Message::setBody(const std::string &bodyText) { body_ = bodyText; }
  */
 void Message::setLineLength(size_t maxLength) { maxLineLength_ = maxLength; }
 
+/**
+ * @description:
+ *     Set the bounds on the resources a raw message may take, a parse
+ *     over any of them fails at once with the error of that bound. The
+ *     bounds are kept by reset().
+ * @param[in] limits
+ *     The bounds, 0 for none.
+ */
+void Message::setLimits(const ParseLimits &limits) { limits_ = limits; }
+
+/**
+ * @description:
+ *     Set how repeated fields of a header are produced.
+ * @param[in] form
+ *     Joined into one line, or one line per field.
+ */
+void Message::setFieldForm(FieldForm form) { fieldForm_ = form; }
+
+/**
+ * @description:
+ *     Remove the start line, all headers and the body so the message can
+ *     be reused. The memory of headers, index and body is kept, the
+ *     strings of headers by the thread for the next header added on it.
+ *     A message reused for messages of similar size on one thread doesn't
+ *     allocate at all. The line length limit and the field form are kept
+ *     too.
+ */
+void Message::reset() {
+    startLine_.clear();
+    for (auto &header : headers_) {
+        keepSpareHeader(std::move(header));
+    }
+    headers_.clear();
+    headerIds_.clear();
+    repeats_.clear();
+    std::fill(index_.begin(), index_.end(), 0);
+    body_.clear();
+}
+
 // Private methods
 /**
  * @description:
- *     Dump massge headers and body to a container.
- * @param[out] vec
- *     A vector container to store message headers and body.
+ *     Look up the identifier of a header name by the compact form rule of
+ *     the dialect the message was last parsed as.
  */
-void Message::dumpToVec(std::vector<std::string> &vec) const {
-    for (const auto &header : headers_) {
-        vec.push_back(header.first + ": " + header.second);
+HeaderId Message::identify(StringView headerName) const {
+    return lookupHeaderId(headerName, compactForms_);
+}
+
+/**
+ * @description:
+ *     Get the slot a header starts probing from. Well-known headers are
+ *     keyed on their identifier so their names are never hashed.
+ * @param[in] headerId
+ *     The identifier of a header.
+ * @param[in] headerName
+ *     A header's name, only used for unknown headers.
+ * @return:
+ *     The hash of the header.
+ */
+size_t Message::hashHeader(HeaderId headerId, StringView headerName) {
+    if (headerId != HeaderId::Unknown)
+        return static_cast<size_t>(headerId) * 2654435761u;
+    return syntax::hashName(headerName.data(), headerName.size());
+}
+
+/**
+ * @description:
+ *     Find a header in the index, well-known headers are compared by
+ *     identifiers and the others by names case-insensitively.
+ * @param[in] headerId
+ *     The identifier of a header.
+ * @param[in] headerName
+ *     A header's name, only used for unknown headers.
+ * @return:
+ *     The position of the header in headers_, npos if there is none.
+ */
+size_t Message::findHeader(HeaderId headerId, StringView headerName) const {
+    if (index_.empty())
+        return npos;
+
+    size_t mask = index_.size() - 1;
+    size_t slot = hashHeader(headerId, headerName) & mask;
+    while (index_[slot]) {
+        size_t position = index_[slot] - 1;
+        if (headerIds_[position] == headerId) {
+            if (headerId != HeaderId::Unknown)
+                return position;
+            const auto &name = headers_[position].first;
+            if (syntax::equalsName(name.data(), name.size(), headerName.data(),
+                                   headerName.size()))
+                return position;
+        }
+        slot = (slot + 1) & mask;
     }
-    vec.push_back("");
-    if (!body_.empty()) {
-        vec.push_back(body_);
+    return npos;
+}
+
+/**
+ * @description:
+ *     Set a header, a repeated header is combined into the existing value
+ *     with a bare comma unless it's replaced. addHeader() and a parsed
+ *     message use a comma and a space.
+ * @param[in] headerId
+ *     The identifier of a header.
+ * @param[in] headerName
+ *     A header's name used when the header is new.
+ * @param[in] headerValue
+ *     A header's value.
+ * @param[in] replace
+ *     Whether or not to replace the existing value.
+ */
+template <typename Value>
+void Message::storeHeader(HeaderId headerId, StringView headerName,
+                          Value &&headerValue, bool replace) {
+    size_t position = findHeader(headerId, headerName);
+    if (position == npos) {
+        appendHeader(headerId, headerName, StringView("", 0));
+        headers_.back().second = std::forward<Value>(headerValue);
+        return;
+    }
+
+    auto &header = headers_[position];
+    if (replace) {
+        header.second = std::forward<Value>(headerValue);
+        dropRepeats(position);
+        return;
     }
+    size_t end = header.second.size();
+    header.second.append(1, ',').append(headerValue);
+    repeats_.push_back(Repeat{position, end, end + 1});
 }
 
 /**
  * @description:
- *     Fold message lines by lenght limitation, always break line into segments
- *     at whitespace charater if any.
- * @param[in|out] lines
- *     The lines should be folded.
- * @param[in] maxLength
- *     The max characters limitation per line.
+ *     Append a new header and index it, the index is kept at most half
+ *     full so probe sequences stay short.
+ * @param[in] headerId
+ *     The identifier of a header.
+ * @param[in] headerName
+ *     A header's name, no header of the name exists yet.
+ * @param[in] headerValue
+ *     A header's value.
+ */
+void Message::appendHeader(HeaderId headerId, StringView headerName,
+                           StringView headerValue) {
+    Headers &spare = getSpareHeaders();
+    if (spare.empty()) {
+        headers_.emplace_back(headerName.toString(), headerValue.toString());
+    } else { // Reuse the strings of a header removed on this thread.
+        headers_.push_back(std::move(spare.back()));
+        spare.pop_back();
+        headers_.back().first.assign(headerName.data(), headerName.size());
+        headers_.back().second.assign(headerValue.data(), headerValue.size());
+    }
+    headerIds_.push_back(headerId);
+    if (headers_.size() * 2 > index_.size()) {
+        rebuildIndex(index_.empty() ? 16 : index_.size() * 2);
+        return;
+    }
+
+    size_t mask = index_.size() - 1;
+    size_t slot = hashHeader(headerId, headerName) & mask;
+    while (index_[slot])
+        slot = (slot + 1) & mask;
+    index_[slot] = static_cast<uint32_t>(headers_.size());
+}
+
+/**
+ * @description:
+ *     Record the result of restoring a message from a snapshot or header
+ *     block, which fail only as a whole.
+ * @param[in] parsed
+ *     An indicator of whether or not the message was restored.
+ * @param[in] length
+ *     The number of bytes decoded.
+ * @return:
+ *     The indicator given.
+ */
+bool Message::finishDecode(bool parsed, size_t length) {
+    if (!parsed) {
+        parseError_ = ParseError::InvalidEncoding;
+        stats::reject(parseError_);
+        return false;
+    }
+    parseError_ = ParseError::None;
+    stats::count(Counter::Messages);
+    stats::count(Counter::Bytes, length);
+    stats::count(Counter::Headers, headers_.size());
+    return true;
+}
+
+/**
+ * @description:
+ *     Erase a header, positions after it shift so the index is rebuilt.
+ * @param[in] position
+ *     The position of the header in headers_, npos erases nothing.
+ */
+void Message::eraseHeader(size_t position) {
+    if (position == npos)
+        return;
+
+    keepSpareHeader(std::move(headers_[position]));
+    headers_.erase(headers_.begin() + position);
+    headerIds_.erase(headerIds_.begin() + position);
+    dropRepeats(position);
+    for (auto &repeat : repeats_) {
+        if (repeat.position > position)
+            --repeat.position;
+    }
+    rebuildIndex(index_.size());
+}
+
+/**
+ * @description:
+ *     Rebuild the index of all headers.
+ * @param[in] capacity
+ *     The number of slots, a power of two.
+ */
+void Message::rebuildIndex(size_t capacity) {
+    index_.assign(capacity, 0);
+    size_t mask = capacity - 1;
+    for (size_t position = 0; position < headers_.size(); ++position) {
+        size_t slot =
+            hashHeader(headerIds_[position], headers_[position].first) & mask;
+        while (index_[slot])
+            slot = (slot + 1) & mask;
+        index_[slot] = static_cast<uint32_t>(position + 1);
+    }
+}
+
+/**
+ * @description:
+ *     Forget the fields of a header whose value was replaced or erased.
+ * @param[in] position
+ *     The position of the header in headers_.
  */
-void Message::foldMessageLines(std::vector<std::string> &dest,
-                               size_t maxLength) const {
-    std::vector<std::string> orig = std::move(dest);
-    dest.clear();
+void Message::dropRepeats(size_t position) {
+    repeats_.erase(std::remove_if(repeats_.begin(), repeats_.end(),
+                                  [position](const Repeat &repeat) {
+                                      return repeat.position == position;
+                                  }),
+                   repeats_.end());
+}
 
-    std::string whitespaces = " \t\f\v";
-    for (auto &line : orig) {
-        if (line == "") { // Keep the blank line.
-            dest.push_back(line);
+/**
+ * @description:
+ *     Get a field of a header.
+ * @param[in] position
+ *     The position of the header in headers_.
+ * @param[in] index
+ *     The index of the field.
+ * @return:
+ *     A view of the field, empty if there is no such field.
+ */
+StringView Message::getField(size_t position, size_t index) const {
+    StringView value = headers_[position].second;
+    size_t begin = 0;
+    for (const auto &repeat : repeats_) {
+        if (repeat.position != position)
             continue;
-        }
+        if (index == 0)
+            return value.substr(begin, repeat.end - begin);
+        --index;
+        begin = repeat.begin;
+    }
+    return index == 0 ? value.substr(begin) : StringView();
+}
 
-        std::string buffer;
-        while (line.size()) {
-            auto splitPos = line.find_first_of(whitespaces);
-            if (splitPos != std::string::npos) { // Splite string by WSP and
-                                                 // concat to buffer.
-                auto offset = line.find_first_not_of(whitespaces, splitPos);
-                buffer += line.substr(0, offset);
-                line.erase(0, offset);
-            } else { // No any WSP in the line.
-                buffer += line.substr();
-                line.erase();
-            }
+/**
+ * @description:
+ *     Call a function with the name and value of each header line to be
+ *     produced, a header in repeated form makes a line per field.
+ * @param[in] function
+ *     The function called with the name and the value.
+ */
+template <typename Function>
+void Message::forEachHeaderLine(Function &&function) const {
+    for (size_t position = 0; position < headers_.size(); ++position) {
+        const auto &header = headers_[position];
+        if (repeats_.empty() || (fieldForm_ == FieldForm::Joined &&
+                                 headerIds_[position] != HeaderId::SetCookie)) {
+            function(header.first, header.second);
+            continue;
+        }
 
-            // Push every line in limit length.
-            if (buffer.length() + 2 > maxLength) {
-                auto lastWSP = buffer.find_last_of(whitespaces);
-                if (lastWSP != 0) {
-                    // Break line at WSP.
-                    std::string newLine = buffer.substr(0, lastWSP);
-                    rtrim(newLine);
-                    dest.push_back(newLine);
-                    buffer.erase(0, lastWSP);
-                }
+        StringView value = header.second;
+        size_t begin = 0;
+        for (const auto &repeat : repeats_) {
+            if (repeat.position == position) {
+                function(header.first, value.substr(begin, repeat.end - begin));
+                begin = repeat.begin;
             }
         }
+        function(header.first, value.substr(begin));
+    }
+}
 
-        if (buffer.size()) {
-            // Keep only one space at the head of a line.
-            ltrim(buffer);
-            buffer.insert(0, " ");
-            dest.push_back(buffer);
-        }
+/**
+ * @description:
+ *     Write the folded message to a sink.
+ * @param[out] sink
+ *     The sink the message is written to.
+ * @return:
+ *     The number of times lines were broken.
+ */
+template <typename Sink> size_t Message::foldMessage(Sink &sink) const {
+    size_t breaks = 0;
+    // A start line is never folded.
+    if (startLine_.getType() != StartLine::Type::None) {
+        auto text = startLine_.getText();
+        sink(text.data(), text.size());
+        sink(lineTerminator, 2);
+    }
+    forEachHeaderLine(
+        [this, &sink, &breaks](StringView name, StringView value) {
+            breaks += syntax::foldLine(syntax::Line(name, value),
+                                       maxLineLength_, sink);
+        });
+    sink(lineTerminator, 2);
+    if (!body_.empty()) {
+        breaks += syntax::foldLine(syntax::Line(body_.data(), body_.size()),
+                                   maxLineLength_, sink);
     }
+    return breaks;
 }
 
 } // namespace msg
@@ -0,0 +1,815 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-18 14:03:26
+ * @LastEditTime: 2019-09-06 12:07:44
+ * @Description: An implementation of class msg::MessageParser.
+ */
+#include "Instrument.hpp"
+#include "Syntax.hpp"
+#include <cstring>
+#include <message/MessageParser.hpp>
+#include <utility>
+
+namespace {
+// Bytes of a chunk size line without a field limit, only chunk extensions
+// make it long.
+const size_t maxChunkLineBytes = 4096;
+
+/**
+ * @description:
+ *     Remove the whitspace characters
+ *     at the both sides of an input string.
+ * @param[in] s
+ *     An input string.
+ */
+void trim(std::string &s) {
+    size_t end = s.size();
+    while (end && msg::syntax::isSpace(s[end - 1]))
+        --end;
+    size_t start = 0;
+    while (start < end && msg::syntax::isSpace(s[start]))
+        ++start;
+    s.erase(end);
+    s.erase(0, start);
+}
+
+/**
+ * @description:
+ *     Concatenate the lines of a body as Message::parseFromMessage does,
+ *     line terminators are dropped and the result is trimmed.
+ * @param[in|out] body
+ *     The raw body to be normalized.
+ */
+void normalizeBody(std::string &body) {
+    size_t dest = 0;
+    for (size_t src = 0; src < body.size(); ++src) {
+        if (body[src] == '\r' && src + 1 < body.size() &&
+            body[src + 1] == '\n') {
+            ++src;
+            continue;
+        }
+        body[dest++] = body[src];
+    }
+    body.resize(dest);
+    trim(body);
+}
+
+/**
+ * @description:
+ *     Get the value of a hexadecimal digit.
+ * @return:
+ *     The value of the digit, -1 if it isn't one.
+ */
+int hexValue(char ch) {
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    return -1;
+}
+
+/**
+ * @description:
+ *     Parse the value of Content-Length. Repeated fields were combined
+ *     into a list, it's valid only if all members are the same.
+ * @param[in] value
+ *     The value of the header.
+ * @param[out] length
+ *     The length of the body.
+ * @return:
+ *     An indicator of whether or not the value was valid.
+ */
+bool parseContentLength(const std::string &value, uint64_t &length) {
+    bool found = false;
+    size_t pos = 0;
+    while (pos <= value.size()) {
+        size_t end = value.find(',', pos);
+        if (end == std::string::npos)
+            end = value.size();
+        size_t start = pos;
+        size_t stop = end;
+        while (start < stop && msg::syntax::isSpace(value[start]))
+            ++start;
+        while (stop > start && msg::syntax::isSpace(value[stop - 1]))
+            --stop;
+        if (start == stop)
+            return false;
+
+        uint64_t number = 0;
+        for (size_t i = start; i < stop; ++i) {
+            if (value[i] < '0' || value[i] > '9' ||
+                number > (UINT64_MAX - 9) / 10)
+                return false;
+            number = number * 10 + (value[i] - '0');
+        }
+        if (found && number != length)
+            return false;
+        length = number;
+        found = true;
+        pos = end + 1;
+    }
+    return found;
+}
+
+/**
+ * @description:
+ *     Check the final transfer coding of a Transfer-Encoding value is
+ *     chunked.
+ */
+bool isChunked(const std::string &value) {
+    size_t start = value.rfind(',');
+    start = start == std::string::npos ? 0 : start + 1;
+    size_t stop = value.size();
+    while (start < stop && msg::syntax::isSpace(value[start]))
+        ++start;
+    while (stop > start && msg::syntax::isSpace(value[stop - 1]))
+        --stop;
+    return msg::syntax::equalsName(value.data() + start, stop - start,
+                                   "chunked", 7);
+}
+
+} // namespace
+
+namespace msg {
+/**
+ * @description:
+ *     Construct a parser fills the message.
+ * @param[in] message
+ *     The message to be filled, it must outlive the parser.
+ */
+MessageParser::MessageParser(Message &message) : message_(&message) {}
+
+// Public methods
+/**
+ * @description:
+ *     Feed a chunk of a raw message. Parsing stops after the blank line
+ *     of headers, so the caller can look at headers and set a body sink
+ *     before the body. A framed body completes by itself, the other is
+ *     collected until finish() is called.
+ * @param[in] data
+ *     A pointer to the chunk, it is not referenced after the call.
+ * @param[in] length
+ *     The length of the chunk.
+ * @return:
+ *     The status of the message, getConsumed() tells how many bytes
+ *     of the chunk were used. Bytes after a complete message are left
+ *     for the next one.
+ */
+MessageParser::Status MessageParser::feed(const char *data, size_t length) {
+    consumed_ = 0;
+    if (state_ == State::Failed)
+        return Status::Error;
+    if (state_ == State::Done)
+        return Status::Complete;
+
+    stats::PhaseClock clock(Phase::Parse);
+    size_t pos = 0;
+    while (pos < length) {
+        if (state_ == State::Body) {
+            clock.enter(Phase::Trim);
+            bodyBytes_ += length - pos;
+            if (limits_.maxBodyBytes && bodyBytes_ > limits_.maxBodyBytes)
+                return fail(ParseError::BodyTooLarge);
+            if (maxLineLength_ && !checkBodyLines(data + pos, length - pos))
+                return fail(ParseError::LineTooLong);
+            deliver(data + pos, length - pos);
+            pos = length;
+            break;
+        }
+        if (state_ == State::Content || state_ == State::ChunkData) {
+            clock.enter(Phase::Trim);
+            size_t take = length - pos;
+            if (remaining_ < take)
+                take = static_cast<size_t>(remaining_);
+            deliver(data + pos, take);
+            pos += take;
+            remaining_ -= take;
+            if (remaining_)
+                break;
+            if (state_ == State::ChunkData) {
+                state_ = State::ChunkEnd;
+                continue;
+            }
+            consumed_ = pos;
+            Status status = completeBody();
+            messageLength_ += pos;
+            return status;
+        }
+
+        const char *line;
+        size_t lineLength;
+        clock.enter(Phase::SplitLines);
+        if (!readLine(data, length, pos, line, lineLength)) {
+            if (state_ == State::Failed)
+                return Status::Error;
+            break;
+        }
+        // The line may complete the message.
+        consumed_ = pos;
+        clock.enter(Phase::Validate);
+        Status status = onLine(line, lineLength);
+        line_.clear();
+        if (status != Status::NeedMore) {
+            if (status != Status::Error)
+                messageLength_ += pos;
+            return status;
+        }
+    }
+
+    consumed_ = pos;
+    messageLength_ += pos;
+    return Status::NeedMore;
+}
+
+/**
+ * @description:
+ *     Feed a buffer holding any number of back-to-back messages, each
+ *     completed message is handed to a handler. A message cut short by
+ *     the end of the buffer is resumed with the next call. Messages are
+ *     told apart by the framing of startBody(), such as requests without
+ *     a body, only a body lasting until finish() takes the rest of the
+ *     data. A message completed by feed() before is reset first.
+ * @param[in] data
+ *     A pointer to the buffer, it is not referenced after the call.
+ * @param[in] length
+ *     The length of the buffer.
+ * @param[in] onMessage
+ *     A handler called for each completed message.
+ * @return:
+ *     NeedMore when the buffer was consumed, otherwise Error and
+ *     getConsumed() tells where the malformed message started.
+ */
+MessageParser::Status
+MessageParser::feedMessages(const char *data, size_t length,
+                            const MessageHandler &onMessage) {
+    if (state_ == State::Done) {
+        message_->reset();
+        reset();
+    }
+
+    size_t pos = 0;
+    while (pos < length) {
+        Status status = feed(data + pos, length - pos);
+        if (status == Status::Error) {
+            // The message may have started in a previous buffer.
+            consumed_ = messageLength_ <= pos ? pos - messageLength_ : 0;
+            return status;
+        }
+        pos += consumed_;
+        if (status == Status::Complete) {
+            onMessage(*message_, messageLength_);
+            message_->reset();
+            reset();
+        }
+    }
+
+    consumed_ = pos;
+    return Status::NeedMore;
+}
+
+/**
+ * @description:
+ *     Tell the parser no more data will come, the collected body is
+ *     set to the message. The body of a message with a start line is kept
+ *     as it is, only that of a message without one is normalized.
+ * @return:
+ *     Complete if the headers were completed and a framed body wasn't
+ *     cut short, otherwise Error.
+ */
+MessageParser::Status MessageParser::finish() {
+    consumed_ = 0;
+    if (state_ == State::Done)
+        return Status::Complete;
+    if (state_ == State::Failed)
+        return Status::Error;
+    if (state_ != State::Body)
+        return fail(ParseError::InvalidFraming);
+
+    stats::PhaseClock clock(Phase::Parse);
+    clock.enter(Phase::Trim);
+    if (!bodySink_) {
+        if (message_->getStartLine().getType() == StartLine::Type::None)
+            normalizeBody(body_);
+        message_->setBody(std::move(body_));
+        body_.clear();
+    }
+    countMessage();
+    state_ = State::Done;
+    afterMessage_ = true;
+    return Status::Complete;
+}
+
+/**
+ * @description:
+ *     Get the number of bytes used by the last call of feed().
+ * @return:
+ *     The number of bytes used.
+ */
+size_t MessageParser::getConsumed() const { return consumed_; }
+
+/**
+ * @description:
+ *     Get the reason the message was rejected.
+ * @return:
+ *     The reason, None unless the last status was Error.
+ */
+ParseError MessageParser::getError() const { return error_; }
+
+/**
+ * @description:
+ *     Prepare the parser for a new message into the same target.
+ */
+void MessageParser::reset() {
+    state_ = State::Headers;
+    firstLine_ = true;
+    line_.clear();
+    pendingCR_ = false;
+    name_.clear();
+    value_.clear();
+    pendingHeader_ = false;
+    body_.clear();
+    bodyLineLength_ = 0;
+    lastBodyChar_ = '\0';
+    remaining_ = 0;
+    messageLength_ = 0;
+    consumed_ = 0;
+    headerBytes_ = 0;
+    headerCount_ = 0;
+    fieldBytes_ = 0;
+    continuations_ = 0;
+    unfolds_ = 0;
+    bodyBytes_ = 0;
+    error_ = ParseError::None;
+}
+
+/**
+ * @description:
+ *     Prepare the parser for a new message into another target.
+ * @param[in] message
+ *     The message to be filled, it must outlive the parser.
+ */
+void MessageParser::reset(Message &message) {
+    reset();
+    message_ = &message;
+}
+
+/**
+ * @description:
+ *     Set line length limit number.
+ * @param[in] maxLength
+ *     A number to limit message each line length.
+ */
+void MessageParser::setLineLength(size_t maxLength) {
+    maxLineLength_ = maxLength;
+}
+
+/**
+ * @description:
+ *     Set the bounds on the resources a message may take, it fails as
+ *     soon as any of them is passed. Header lines split across chunks are
+ *     never kept past the bounds. They are kept by reset().
+ * @param[in] limits
+ *     The bounds, 0 for none.
+ */
+void MessageParser::setLimits(const ParseLimits &limits) { limits_ = limits; }
+
+/**
+ * @description:
+ *     Set a sink receives body bytes as they arrive, the body isn't
+ *     collected into the message then. It's kept by reset().
+ * @param[in] bodySink
+ *     A callable receives body bytes, an empty one collects the body
+ *     into the message again.
+ */
+void MessageParser::setBodySink(BodySink bodySink) {
+    bodySink_ = std::move(bodySink);
+}
+
+// Private methods
+/**
+ * @description:
+ *     Mark the message as malformed and count the reason.
+ * @param[in] error
+ *     The reason.
+ * @return:
+ *     Error status.
+ */
+MessageParser::Status MessageParser::fail(ParseError error) {
+    state_ = State::Failed;
+    error_ = error;
+    stats::reject(error);
+    return Status::Error;
+}
+
+/**
+ * @description:
+ *     Take a complete line from a chunk. A line not ended in the chunk is
+ *     kept and resumed with the next chunk.
+ * @param[in] data
+ *     A pointer to the chunk.
+ * @param[in] length
+ *     The length of the chunk.
+ * @param[in|out] pos
+ *     The position the line starts at, moved past the line terminator.
+ * @param[out] line
+ *     A pointer to the line without the line terminator.
+ * @param[out] lineLength
+ *     The length of the line.
+ * @return:
+ *     False when the chunk ended before the line or the line was
+ *     malformed, the state tells which.
+ */
+bool MessageParser::readLine(const char *data, size_t length, size_t &pos,
+                             const char *&line, size_t &lineLength) {
+    // A CR ended the previous chunk, the line ends if LF follows.
+    if (pendingCR_) {
+        pendingCR_ = false;
+        if (data[pos] != '\n') {
+            fail(ParseError::BareCarriageReturn);
+            return false;
+        }
+        ++pos;
+        line = line_.data();
+        lineLength = line_.size();
+        return true;
+    }
+
+    const char *cr =
+        static_cast<const char *>(std::memchr(data + pos, '\r', length - pos));
+    size_t end = cr ? cr - data : length;
+
+    // Line length exceed the limitation.
+    if (maxLineLength_ && line_.size() + end - pos + 2 > maxLineLength_) {
+        fail(ParseError::LineTooLong);
+        return false;
+    }
+    if (!checkLine(line_.size() + end - pos))
+        return false;
+
+    if (!cr || end + 1 == length) { // Resume the line with next chunk.
+        line_.append(data + pos, end - pos);
+        pendingCR_ = cr != nullptr;
+        pos = length;
+        return false;
+    }
+    // Lines never contain a bare CR.
+    if (data[end + 1] != '\n') {
+        fail(ParseError::BareCarriageReturn);
+        return false;
+    }
+
+    if (line_.empty()) {
+        line = data + pos;
+        lineLength = end - pos;
+    } else {
+        line_.append(data + pos, end - pos);
+        line = line_.data();
+        lineLength = line_.size();
+    }
+    pos = end + 2;
+    return true;
+}
+
+/**
+ * @description:
+ *     Handle a complete line of headers, chunk framing or trailers.
+ * @param[in] line
+ *     A pointer to the line without the line terminator.
+ * @param[in] length
+ *     The length of the line.
+ * @return:
+ *     NeedMore to go on, otherwise the status to stop with.
+ */
+MessageParser::Status MessageParser::onLine(const char *line,
+                                            size_t length) {
+    switch (state_) {
+    case State::Headers:
+        // Empty lines between messages are ignored, such as the line
+        // terminator produced after a body its framing doesn't count.
+        if (firstLine_ && !length && afterMessage_)
+            return Status::NeedMore;
+        headerBytes_ += length ? length + 2 : 0;
+        if (limits_.maxHeaderBytes && headerBytes_ > limits_.maxHeaderBytes)
+            return fail(ParseError::HeaderSectionTooLarge);
+        if (firstLine_) {
+            firstLine_ = false;
+            if (length && !syntax::isSpace(line[0]) &&
+                message_->getStartLine().parse(line, length))
+                return Status::NeedMore;
+        }
+        if (onHeaderLine(line, length))
+            return Status::NeedMore;
+        return state_ == State::Failed ? Status::Error : startBody();
+    case State::ChunkSize:
+        if (onChunkSize(line, length))
+            return Status::NeedMore;
+        return state_ == State::Failed ? Status::Error
+                                       : fail(ParseError::InvalidFraming);
+    case State::ChunkEnd: // Chunk data is followed by CRLF only.
+        if (length)
+            return fail(ParseError::InvalidFraming);
+        state_ = State::ChunkSize;
+        return Status::NeedMore;
+    case State::Trailers: // Trailer fields are added as headers.
+        headerBytes_ += length ? length + 2 : 0;
+        if (limits_.maxHeaderBytes && headerBytes_ > limits_.maxHeaderBytes)
+            return fail(ParseError::HeaderSectionTooLarge);
+        if (onHeaderLine(line, length))
+            return Status::NeedMore;
+        return state_ == State::Failed ? Status::Error : completeBody();
+    default:
+        return fail(ParseError::InvalidFraming);
+    }
+}
+
+/**
+ * @description:
+ *     Handle a complete line of the header section. A header is kept
+ *     pending until the next line shows it isn't folded any more.
+ * @param[in] line
+ *     A pointer to the line without the line terminator.
+ * @param[in] length
+ *     The length of the line.
+ * @return:
+ *     False when the line was the blank line ending headers or was
+ *     malformed, the state tells which.
+ */
+bool MessageParser::onHeaderLine(const char *line, size_t length) {
+    if (length == 0) {
+        commitHeader();
+        return false;
+    }
+
+    // A line never holds a CR here, colon and invalid characters are found
+    // in one pass.
+    syntax::LineScan scan = syntax::scanLine(line, length);
+    if (scan.colon == syntax::npos ||
+        syntax::isSpace(line[0])) { // Unfold the header.
+        if (!pendingHeader_) {
+            fail(ParseError::OrphanContinuation);
+            return false;
+        }
+        if (!scan.clean) {
+            fail(ParseError::InvalidCharacter);
+            return false;
+        }
+        fieldBytes_ += length + 2;
+        if (limits_.maxContinuations &&
+            ++continuations_ > limits_.maxContinuations) {
+            fail(ParseError::TooManyContinuations);
+            return false;
+        }
+        if (limits_.maxFieldBytes && fieldBytes_ > limits_.maxFieldBytes) {
+            fail(ParseError::FieldTooLarge);
+            return false;
+        }
+        ++unfolds_;
+        size_t skip = 0;
+        while (skip < length && syntax::isSpace(line[skip]))
+            ++skip;
+        value_ += ' ';
+        value_.append(line + skip, length - skip);
+        return true;
+    }
+
+    size_t pos = scan.colon;
+    // Printable US-ASCII characters except colon, then printable US-ASCII
+    // characters and WSP characters
+    if (!syntax::isValidName(line, pos)) {
+        fail(ParseError::InvalidName);
+        return false;
+    }
+    if (!scan.clean) {
+        fail(ParseError::InvalidCharacter);
+        return false;
+    }
+    if (limits_.maxHeaderCount && headerCount_ == limits_.maxHeaderCount) {
+        fail(ParseError::TooManyHeaders);
+        return false;
+    }
+    if (limits_.maxFieldBytes && length > limits_.maxFieldBytes) {
+        fail(ParseError::FieldTooLarge);
+        return false;
+    }
+    ++headerCount_;
+    fieldBytes_ = length;
+    continuations_ = 0;
+
+    commitHeader();
+    name_.assign(line, pos);
+    value_.assign(line + pos + 1, length - pos - 1);
+    pendingHeader_ = true;
+    return true;
+}
+
+/**
+ * @description:
+ *     Choose the framing of the body after headers were completed as RFC
+ *     7230 3.3.3 does, a chunked transfer coding takes precedence over
+ *     Content-Length. Without both a request has no body, and neither
+ *     has a SIP message since it carries Content-Length over streams.
+ *     Only the body of an HTTP response or a message without start line
+ *     lasts until finish().
+ * @return:
+ *     HeadersComplete, Complete if there is no body or Error.
+ */
+MessageParser::Status MessageParser::startBody() {
+    const StartLine &startLine = message_->getStartLine();
+    bool isRequest = startLine.getType() == StartLine::Type::Request;
+    bool isStatus = startLine.getType() == StartLine::Type::Status;
+    // Informational, 204 and 304 responses never have a body.
+    unsigned statusCode = startLine.getStatusCode();
+    if (isStatus &&
+        (statusCode < 200 || statusCode == 204 || statusCode == 304))
+        return completeBody();
+
+    const auto &transferEncoding =
+        message_->getHeaderValue(HeaderId::TransferEncoding);
+    if (!transferEncoding.empty() && isChunked(transferEncoding)) {
+        state_ = State::ChunkSize;
+        return Status::HeadersComplete;
+    }
+    if (transferEncoding.empty() &&
+        message_->hasHeader(HeaderId::ContentLength)) {
+        if (!parseContentLength(
+                message_->getHeaderValue(HeaderId::ContentLength), remaining_))
+            return fail(ParseError::InvalidFraming);
+        // Refused before any of it is read.
+        if (limits_.maxBodyBytes && remaining_ > limits_.maxBodyBytes)
+            return fail(ParseError::BodyTooLarge);
+        if (remaining_ == 0)
+            return completeBody();
+        state_ = State::Content;
+        return Status::HeadersComplete;
+    }
+
+    if (isRequest) {
+        // Only chunked coding frames a request of unknown length.
+        if (!transferEncoding.empty())
+            return fail(ParseError::InvalidFraming);
+        return completeBody();
+    }
+    if (isStatus &&
+        startLine.getVersion().substr(0, 4) == StringView("SIP/", 4))
+        return completeBody();
+    state_ = State::Body;
+    return Status::HeadersComplete;
+}
+
+/**
+ * @description:
+ *     Handle the size line of a chunk, chunk extensions are ignored.
+ * @param[in] line
+ *     A pointer to the line without the line terminator.
+ * @param[in] length
+ *     The length of the line.
+ * @return:
+ *     An indicator of whether or not the line was valid.
+ */
+bool MessageParser::onChunkSize(const char *line, size_t length) {
+    uint64_t size = 0;
+    size_t pos = 0;
+    for (; pos < length && hexValue(line[pos]) >= 0; ++pos) {
+        if (size >> 60)
+            return false;
+        size = size << 4 | static_cast<uint64_t>(hexValue(line[pos]));
+    }
+    if (pos == 0)
+        return false;
+    while (pos < length && syntax::isSpace(line[pos]))
+        ++pos;
+    if (pos < length && line[pos] != ';')
+        return false;
+    bodyBytes_ += size;
+    if (limits_.maxBodyBytes && bodyBytes_ > limits_.maxBodyBytes) {
+        fail(ParseError::BodyTooLarge);
+        return false;
+    }
+
+    remaining_ = size;
+    state_ = size ? State::ChunkData : State::Trailers;
+    return true;
+}
+
+/**
+ * @description:
+ *     Check the bytes of a line read so far against the bounds, before
+ *     they are kept. Header and trailer lines count for the header section
+ *     and a field, a start line for the section only. A line of chunk
+ *     framing is bounded as a field is, or by a fixed size without a
+ *     field limit.
+ * @param[in] lineBytes
+ *     The bytes of the line without its terminator.
+ * @return:
+ *     An indicator of whether or not the line was in bounds.
+ */
+bool MessageParser::checkLine(size_t lineBytes) {
+    if (state_ == State::ChunkSize || state_ == State::ChunkEnd) {
+        size_t maxBytes =
+            limits_.maxFieldBytes ? limits_.maxFieldBytes : maxChunkLineBytes;
+        if (lineBytes > maxBytes) {
+            fail(ParseError::InvalidFraming);
+            return false;
+        }
+        return true;
+    }
+    if (limits_.maxHeaderBytes &&
+        headerBytes_ + lineBytes > limits_.maxHeaderBytes) {
+        fail(ParseError::HeaderSectionTooLarge);
+        return false;
+    }
+    bool field = state_ == State::Trailers || !firstLine_;
+    if (field && limits_.maxFieldBytes && lineBytes > limits_.maxFieldBytes) {
+        fail(ParseError::FieldTooLarge);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @description:
+ *     Pass body bytes to the sink, or collect them if there is none.
+ */
+void MessageParser::deliver(const char *data, size_t length) {
+    if (!length)
+        return;
+    if (bodySink_)
+        bodySink_(data, length);
+    else
+        body_.append(data, length);
+}
+
+/**
+ * @description:
+ *     Complete a framed body, the collected bytes are set to the message
+ *     as they are.
+ * @return:
+ *     Complete status.
+ */
+MessageParser::Status MessageParser::completeBody() {
+    if (!bodySink_) {
+        message_->setBody(std::move(body_));
+        body_.clear();
+    }
+    countMessage();
+    state_ = State::Done;
+    afterMessage_ = true;
+    return Status::Complete;
+}
+
+/**
+ * @description:
+ *     Count a completed message as MessageView::parse() does, with the
+ *     bytes it used so far and the trailers among its headers.
+ */
+void MessageParser::countMessage() const {
+    stats::count(Counter::Messages);
+    stats::count(Counter::Bytes, messageLength_ + consumed_);
+    stats::count(Counter::Headers, headerCount_);
+    stats::count(Counter::Unfolds, unfolds_);
+}
+
+/**
+ * @description:
+ *     Check the lines of a body chunk against the line length limit.
+ * @param[in] data
+ *     A pointer to the body chunk.
+ * @param[in] length
+ *     The length of the chunk.
+ * @return:
+ *     An indicator of whether or not every completed line was in limit.
+ */
+bool MessageParser::checkBodyLines(const char *data, size_t length) {
+    char prev = lastBodyChar_;
+    for (size_t i = 0; i < length; ++i) {
+        if (data[i] == '\n' && prev == '\r') {
+            // The CR was counted, the line terminator adds two bytes.
+            if (bodyLineLength_ + 1 > maxLineLength_)
+                return false;
+            bodyLineLength_ = 0;
+        } else {
+            ++bodyLineLength_;
+        }
+        prev = data[i];
+    }
+    lastBodyChar_ = prev;
+    return true;
+}
+
+/**
+ * @description:
+ *     Add the pending header to the message.
+ */
+void MessageParser::commitHeader() {
+    if (!pendingHeader_)
+        return;
+    trim(value_);
+    message_->addHeader(name_, value_);
+    pendingHeader_ = false;
+}
+
+} // namespace msg
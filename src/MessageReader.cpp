@@ -0,0 +1,236 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 15:20:18
+ * @LastEditTime: 2019-09-06 09:52:18
+ * @Description: An implementation of class msg::MessageReader.
+ */
+#include <cerrno>
+#include <message/MessageReader.hpp>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+// Reads in a row before other descriptors get their turn.
+const int maxReads = 8;
+
+} // namespace
+
+namespace msg {
+MessageReader::MessageReader(EventLoop &loop, int fd)
+    : loop_(loop), fd_(fd), parser_(message_) {}
+
+MessageReader::~MessageReader() { stop(); }
+
+// Public methods
+/**
+ * @description:
+ *     Start reading messages.
+ * @param[in] onMessage
+ *     A handler called for each completed message.
+ * @param[in] onClose
+ *     A handler called once when the peer closed or a message was
+ *     malformed, the reader is stopped then.
+ * @return:
+ *     An indicator of whether or not the descriptor was watched, a reader
+ *     already reading isn't started again.
+ */
+bool MessageReader::start(MessageHandler onMessage, CloseHandler onClose) {
+    if (started_)
+        return false;
+    onMessage_ = std::move(onMessage);
+    onClose_ = std::move(onClose);
+    message_.reset();
+    parser_.reset();
+    buffer_.resize(bufferSize_);
+    begin_ = end_ = 0;
+    partial_ = false;
+    paused_ = false;
+    started_ = loop_.setReadHandler(fd_, [this]() { onReadable(); });
+    return started_;
+}
+
+/**
+ * @description:
+ *     Stop handing out messages until resume(), data left in the buffer
+ *     is kept and nothing more is read.
+ */
+void MessageReader::pause() {
+    if (!started_ || paused_)
+        return;
+    paused_ = true;
+    loop_.setReadHandler(fd_, EventLoop::Handler());
+}
+
+/**
+ * @description:
+ *     Hand out the messages left in the buffer and read again.
+ */
+void MessageReader::resume() {
+    if (!started_ || !paused_)
+        return;
+    paused_ = false;
+    // From a message handler, the running dispatch() goes on.
+    if (!dispatching_ && begin_ != end_ && !dispatch())
+        return;
+    if (started_ && !paused_)
+        loop_.setReadHandler(fd_, [this]() { onReadable(); });
+}
+
+/**
+ * @description:
+ *     Stop reading, the close handler isn't called. A message being read
+ *     is dropped by the next start().
+ */
+void MessageReader::stop() {
+    if (!started_)
+        return;
+    started_ = false;
+    loop_.setReadHandler(fd_, EventLoop::Handler());
+}
+
+/**
+ * @description:
+ *     Check if the reader was started and not stopped or closed since.
+ */
+bool MessageReader::isReading() const { return started_; }
+
+/**
+ * @description:
+ *     Set line length limit number.
+ * @param[in] maxLength
+ *     A number to limit message each line length.
+ */
+void MessageReader::setLineLength(size_t maxLength) {
+    parser_.setLineLength(maxLength);
+}
+
+/**
+ * @description:
+ *     Set the bounds on the resources a message may take, a peer passing
+ *     any of them is closed as soon as it does.
+ * @param[in] limits
+ *     The bounds, 0 for none.
+ */
+void MessageReader::setLimits(const ParseLimits &limits) {
+    parser_.setLimits(limits);
+}
+
+/**
+ * @description:
+ *     Set the size of the read buffer, it takes effect on the next
+ *     start().
+ * @param[in] size
+ *     The number of bytes read at most at once.
+ */
+void MessageReader::setBufferSize(size_t size) {
+    bufferSize_ = size ? size : 1;
+}
+
+/**
+ * @description:
+ *     Get the number of messages handed out since the reader was made.
+ */
+uint64_t MessageReader::getMessageCount() const { return messageCount_; }
+
+/**
+ * @description:
+ *     Get the reason the last message was rejected, for a close handler
+ *     told of a failure.
+ * @return:
+ *     The reason, None if no message was rejected since start().
+ */
+ParseError MessageReader::getParseError() const { return parser_.getError(); }
+
+// Private methods
+/**
+ * @description:
+ *     Read the descriptor until it would block, or a few times in a row
+ *     while the buffer gets filled.
+ */
+void MessageReader::onReadable() {
+    for (int reads = 0; reads < maxReads; ++reads) {
+        ssize_t n = ::read(fd_, &buffer_[0], buffer_.size());
+        if (n > 0) {
+            begin_ = 0;
+            end_ = static_cast<size_t>(n);
+            if (!dispatch() || paused_ ||
+                static_cast<size_t>(n) < buffer_.size())
+                return;
+            continue;
+        }
+        if (n == 0) {
+            if (!partial_) {
+                close(false);
+                return;
+            }
+            // A body may last until the peer closes.
+            if (parser_.finish() != MessageParser::Status::Complete) {
+                close(true);
+                return;
+            }
+            deliver();
+            if (started_)
+                close(false);
+            return;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            close(true);
+        return;
+    }
+}
+
+/**
+ * @description:
+ *     Parse the data in the buffer until it is used up or the reader is
+ *     paused or stopped.
+ * @return:
+ *     An indicator of whether or not the reader is still reading.
+ */
+bool MessageReader::dispatch() {
+    dispatching_ = true;
+    while (begin_ != end_ && started_ && !paused_) {
+        MessageParser::Status status =
+            parser_.feed(buffer_.data() + begin_, end_ - begin_);
+        if (status == MessageParser::Status::Error) {
+            dispatching_ = false;
+            close(true);
+            return false;
+        }
+        begin_ += parser_.getConsumed();
+        partial_ = true;
+        if (status == MessageParser::Status::Complete)
+            deliver();
+    }
+    dispatching_ = false;
+    return started_;
+}
+
+/**
+ * @description:
+ *     Hand out the completed message and prepare for the next.
+ */
+void MessageReader::deliver() {
+    partial_ = false;
+    ++messageCount_;
+    onMessage_(message_);
+    message_.reset();
+    parser_.reset();
+}
+
+/**
+ * @description:
+ *     Stop reading and tell the close handler.
+ * @param[in] failed
+ *     An indicator of whether or not reading ended by an error.
+ */
+void MessageReader::close(bool failed) {
+    stop();
+    if (onClose_)
+        onClose_(failed);
+}
+
+} // namespace msg
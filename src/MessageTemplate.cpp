@@ -0,0 +1,296 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-04 10:40:13
+ * @LastEditTime: 2019-09-06 12:07:44
+ * @Description: An implementation of class msg::MessageTemplate.
+ */
+#include "Folding.hpp"
+#include "Instrument.hpp"
+#include "Syntax.hpp"
+#include <message/MessageTemplate.hpp>
+#include <sys/uio.h>
+
+namespace {
+const size_t npos = static_cast<size_t>(-1);
+
+/**
+ * @description:
+ *     Make a buffer descriptor of a range of characters.
+ */
+inline iovec makeIovec(const char *data, size_t length) {
+    iovec vec;
+    vec.iov_base = const_cast<char *>(data);
+    vec.iov_len = length;
+    return vec;
+}
+
+} // namespace
+
+namespace msg {
+// Public methods
+/**
+ * @description:
+ *     Add a slot for a header, the template must be compiled again.
+ * @param[in] headerId
+ *     The identifier of the header, its canonical name is used if the
+ *     message has no such header.
+ * @return:
+ *     The index of the slot.
+ */
+size_t MessageTemplate::addSlot(HeaderId headerId) {
+    slots_.push_back(Slot{headerId, getHeaderName(headerId).toString()});
+    compiled_ = false;
+    return slots_.size() - 1;
+}
+
+/**
+ * @description:
+ *     Add a slot for a header, the template must be compiled again.
+ * @param[in] headerName
+ *     The name of the header, compared case-insensitively.
+ * @return:
+ *     The index of the slot.
+ */
+size_t MessageTemplate::addSlot(StringView headerName) {
+    slots_.push_back(Slot{lookupHeaderId(headerName), headerName.toString()});
+    compiled_ = false;
+    return slots_.size() - 1;
+}
+
+/**
+ * @description:
+ *     Add a slot for the body, the template must be compiled again.
+ * @return:
+ *     The index of the slot.
+ */
+size_t MessageTemplate::addBodySlot() {
+    slots_.push_back(Slot{HeaderId::Unknown, std::string()});
+    compiled_ = false;
+    return slots_.size() - 1;
+}
+
+/**
+ * @description:
+ *     Get the number of slots, the number of values a message needs.
+ */
+size_t MessageTemplate::getSlotCount() const { return slots_.size(); }
+
+/**
+ * @description:
+ *     Check if the template was compiled since the last slot was added.
+ */
+bool MessageTemplate::isCompiled() const { return compiled_; }
+
+/**
+ * @description:
+ *     Remove the slots and the compiled message.
+ */
+void MessageTemplate::clear() {
+    slots_.clear();
+    text_.clear();
+    pieces_.clear();
+    maxLineLength_ = 0;
+    compiled_ = false;
+}
+
+/**
+ * @description:
+ *     Produce a message to the end of a buffer. The buffer grows once by
+ *     the exact length of the message unless a slot line is folded.
+ * @param[in|out] targetMessage
+ *     A buffer the message text is appended to.
+ * @param[in] values
+ *     The values of the slots in order.
+ * @param[in] count
+ *     The number of values.
+ * @return:
+ *     An indicator of whether or not the template was compiled and a value
+ *     was given for each slot.
+ */
+bool MessageTemplate::produceToMessage(std::string &targetMessage,
+                                       const StringView *values,
+                                       size_t count) const {
+    if (!compiled_ || count != slots_.size())
+        return false;
+
+    stats::PhaseClock clock(Phase::Produce);
+    size_t start = targetMessage.size();
+    size_t length = text_.size();
+    for (const auto &piece : pieces_) {
+        size_t valueLength = values[piece.slot].size();
+        if (valueLength || !isBody(piece.slot))
+            length += valueLength + 2;
+    }
+    targetMessage.reserve(targetMessage.size() + length);
+
+    size_t begin = 0;
+    for (const auto &piece : pieces_) {
+        StringView value = values[piece.slot];
+        if (isFolded(piece, value)) {
+            targetMessage.append(text_, begin, piece.textEnd - begin);
+            syntax::StringSink sink{targetMessage};
+            size_t breaks;
+            if (isBody(piece.slot)) {
+                breaks = syntax::foldLine(
+                    syntax::Line(value.data(), value.size()), maxLineLength_,
+                    sink);
+            } else {
+                StringView name(text_.data() + piece.textEnd,
+                                piece.prefixEnd - piece.textEnd - 2);
+                breaks = syntax::foldLine(syntax::Line(name, value),
+                                          maxLineLength_, sink);
+            }
+            clock.count(Counter::Folds, breaks);
+        } else {
+            targetMessage.append(text_, begin, piece.prefixEnd - begin);
+            // An empty body has no line terminator.
+            if (!isBody(piece.slot) || !value.empty()) {
+                targetMessage.append(value.data(), value.size())
+                    .append(syntax::lineTerminator, 2);
+            }
+        }
+        begin = piece.prefixEnd;
+    }
+    targetMessage.append(text_, begin, npos);
+    clock.count(Counter::Produced);
+    clock.count(Counter::ProducedBytes, targetMessage.size() - start);
+    return true;
+}
+
+/**
+ * @description:
+ *     Produce a message to the end of a buffer.
+ * @param[in|out] targetMessage
+ *     A buffer the message text is appended to.
+ * @param[in] values
+ *     The values of the slots in order.
+ * @return:
+ *     An indicator of whether or not the template was compiled and a value
+ *     was given for each slot.
+ */
+bool MessageTemplate::produceToMessage(
+    std::string &targetMessage,
+    std::initializer_list<StringView> values) const {
+    return produceToMessage(targetMessage, values.begin(), values.size());
+}
+
+/**
+ * @description:
+ *     Produce a message to a list of buffers for writev() or sendmsg().
+ *     The buffers refer to the template and the values, a template with a
+ *     line length produces the message into a buffer supplied by the
+ *     caller.
+ * @param[out] dest
+ *     A vector the buffers are appended to.
+ * @param[in] values
+ *     The values of the slots in order.
+ * @param[in] count
+ *     The number of values.
+ * @param[in|out] foldBuffer
+ *     A buffer holds the folded message if a line length was set, it must
+ *     live as long as the buffers.
+ * @return:
+ *     An indicator of whether or not the template was compiled and a value
+ *     was given for each slot.
+ */
+bool MessageTemplate::produceToIovec(std::vector<iovec> &dest,
+                                     const StringView *values, size_t count,
+                                     std::string &foldBuffer) const {
+    if (!compiled_ || count != slots_.size())
+        return false;
+    if (maxLineLength_) {
+        foldBuffer.clear();
+        produceToMessage(foldBuffer, values, count);
+        dest.push_back(makeIovec(foldBuffer.data(), foldBuffer.size()));
+        return true;
+    }
+
+    stats::PhaseClock clock(Phase::Produce);
+    size_t length = text_.size();
+    dest.reserve(dest.size() + pieces_.size() * 3 + 1);
+    size_t begin = 0;
+    for (const auto &piece : pieces_) {
+        StringView value = values[piece.slot];
+        dest.push_back(
+            makeIovec(text_.data() + begin, piece.prefixEnd - begin));
+        if (!isBody(piece.slot) || !value.empty()) {
+            dest.push_back(makeIovec(value.data(), value.size()));
+            dest.push_back(makeIovec(syntax::lineTerminator, 2));
+            length += value.size() + 2;
+        }
+        begin = piece.prefixEnd;
+    }
+    if (begin < text_.size())
+        dest.push_back(makeIovec(text_.data() + begin, text_.size() - begin));
+    clock.count(Counter::Produced);
+    clock.count(Counter::ProducedBytes, length);
+    return true;
+}
+
+// Private methods
+/**
+ * @description:
+ *     Find the slot of a header.
+ * @param[in] headerId
+ *     The identifier of the header.
+ * @param[in] headerName
+ *     The name of the header, compared if the header isn't well known.
+ * @return:
+ *     The index of the slot, npos if the header has none.
+ */
+size_t MessageTemplate::findSlot(HeaderId headerId,
+                                 StringView headerName) const {
+    for (size_t slot = 0; slot < slots_.size(); ++slot) {
+        const Slot &candidate = slots_[slot];
+        if (isBody(slot) || candidate.id != headerId)
+            continue;
+        if (headerId != HeaderId::Unknown ||
+            syntax::equalsName(candidate.name.data(), candidate.name.size(),
+                               headerName.data(), headerName.size()))
+            return slot;
+    }
+    return npos;
+}
+
+/**
+ * @description:
+ *     Append a slot to the compiled message.
+ * @param[in] slot
+ *     The index of the slot.
+ * @param[in] headerName
+ *     The name the line of a header slot starts with.
+ */
+void MessageTemplate::appendSlot(size_t slot, StringView headerName) {
+    size_t textEnd = text_.size();
+    if (!isBody(slot)) {
+        text_.append(headerName.data(), headerName.size())
+            .append(syntax::headerSeparator, 2);
+    }
+    pieces_.push_back(Piece{textEnd, text_.size(), slot});
+}
+
+/**
+ * @description:
+ *     Check if a slot stands for the body.
+ */
+bool MessageTemplate::isBody(size_t slot) const {
+    return slots_[slot].name.empty();
+}
+
+/**
+ * @description:
+ *     Check if the value of a slot must be folded, which the message would
+ *     do to a nonempty body or a header line over the line length.
+ */
+bool MessageTemplate::isFolded(const Piece &piece, StringView value) const {
+    if (!maxLineLength_)
+        return false;
+    if (isBody(piece.slot))
+        return !value.empty();
+    return piece.prefixEnd - piece.textEnd + value.size() + 2 >
+           maxLineLength_;
+}
+
+} // namespace msg
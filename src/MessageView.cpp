@@ -0,0 +1,728 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-17 09:36:02
+ * @LastEditTime: 2019-09-06 10:17:26
+ * @Description: An implementation of class msg::MessageView.
+ */
+#include "DialectRules.hpp"
+#include "Instrument.hpp"
+#include "Syntax.hpp"
+#include <algorithm>
+#include <cstring>
+#include <message/MessageView.hpp>
+
+namespace {
+/**
+ * @description:
+ *     Compare two header names ignoring ASCII case.
+ */
+inline bool equalsName(msg::StringView lhs, msg::StringView rhs) {
+    return msg::syntax::equalsName(lhs.data(), lhs.size(), rhs.data(),
+                                   rhs.size());
+}
+
+/**
+ * @description:
+ *     Check a scanned line has only value characters of a dialect, lines
+ *     the scan found clean need no second look.
+ */
+template <typename Rules>
+inline bool isCleanLine(const msg::syntax::LineScan &scan, const char *line,
+                        size_t length) {
+    return scan.clean || (Rules::valueClass != msg::syntax::kFieldValue &&
+                          msg::syntax::matchClass(line, length,
+                                                  Rules::valueClass));
+}
+
+/**
+ * @description:
+ *     Find the end of a body line, only CRLF ends a line.
+ * @param[in] start
+ *     A pointer to the line.
+ * @param[in] end
+ *     A pointer to the end of the raw message.
+ * @param[out] next
+ *     A pointer to the next line, end for the last line.
+ * @return:
+ *     A pointer to the CR ending the line, end for the last line.
+ */
+inline const char *findLineEnd(const char *start, const char *end,
+                               const char *&next) {
+    next = end;
+    const char *lineEnd = start;
+    while (lineEnd != end) {
+        lineEnd = static_cast<const char *>(
+            std::memchr(lineEnd, '\r', end - lineEnd));
+        if (!lineEnd)
+            return end;
+        if (lineEnd + 1 != end && lineEnd[1] == '\n') {
+            next = lineEnd + 2;
+            return lineEnd;
+        }
+        ++lineEnd;
+    }
+    return end;
+}
+
+/**
+ * @description:
+ *     Check a line with its terminator is too long for a limit, a limit
+ *     of 0 means none. The last line counts as if it was terminated.
+ */
+inline bool exceedsLimit(const char *start, const char *lineEnd,
+                         size_t maxLength) {
+    return maxLength && static_cast<size_t>(lineEnd - start) + 2 > maxLength;
+}
+
+} // namespace
+
+namespace msg {
+// Public methods
+/**
+ * @description:
+ *     Parse a raw message in place. Each line is terminated by CRLF,
+ *     the first line may be a request or status line, a line without
+ *     colon continues the previous header, and the lines after the first
+ *     blank line are concatenated to the body.
+ * @param[in] data
+ *     A pointer to the raw message, it must outlive the view.
+ * @param[in] length
+ *     The length of the raw message.
+ * @return:
+ *     An identicator of whether or not the parse process
+ *     was successful is returned, getError() tells why it failed.
+ */
+bool MessageView::parse(const char *data, size_t length) {
+    return parse<GenericDialect>(data, length);
+}
+
+/**
+ * @description:
+ *     Parse a raw message in place. Each line is terminated by CRLF,
+ *     the start line, header names and values, continuation lines, line
+ *     lengths and the body follow the rules of a dialect.
+ * @param[in] data
+ *     A pointer to the raw message, it must outlive the view.
+ * @param[in] length
+ *     The length of the raw message.
+ * @return:
+ *     An identicator of whether or not the parse process
+ *     was successful is returned, getError() tells why it failed.
+ */
+template <typename Dialect>
+bool MessageView::parse(const char *data, size_t length) {
+    typedef DialectRules<Dialect> Rules;
+    stats::PhaseClock clock(Phase::Parse);
+    clear();
+    data_ = data;
+    length_ = length;
+    compactForms_ = Rules::compactForms;
+    size_t maxLength = Rules::maxLineLength;
+    if (!maxLength)
+        maxLength = maxLineLength_;
+
+    const char *end = data + length;
+    // Lines are never scanned past the header section limit, the blank
+    // line may end right at it.
+    const char *headerEnd = end;
+    if (limits_.maxHeaderBytes && length > limits_.maxHeaderBytes + 2)
+        headerEnd = data + limits_.maxHeaderBytes + 2;
+    size_t continuations = 0; // Of the last field.
+    const char *start = data;
+    while (start != end) {
+        clock.enter(Phase::SplitLines);
+        // CR, colon and invalid characters are found in one pass.
+        syntax::LineScan scan = syntax::scanLine(start, headerEnd - start);
+        const char *lineEnd = start + scan.end;
+        if (lineEnd == headerEnd && headerEnd != end)
+            return fail(ParseError::HeaderSectionTooLarge);
+        const char *next = end;
+        if (lineEnd != end) {
+            // Header fields never contain a bare CR.
+            if (lineEnd + 1 == end || lineEnd[1] != '\n')
+                return fail(ParseError::BareCarriageReturn);
+            next = lineEnd + 2;
+        }
+
+        // Line length exceed the limitation.
+        if (exceedsLimit(start, lineEnd, maxLength))
+            return fail(ParseError::LineTooLong);
+
+        size_t lineOffset = start - data;
+        size_t lineLength = lineEnd - start;
+        start = next;
+
+        if (lineLength == 0) {
+            if (Rules::startRule == StartRule::Required && lineOffset == 0)
+                return fail(ParseError::InvalidStartLine);
+            clock.enter(Phase::Trim);
+            return parseBody(start, end, maxLength, Rules::rawBody);
+        }
+
+        if (limits_.maxHeaderBytes &&
+            static_cast<size_t>(next - data) > limits_.maxHeaderBytes)
+            return fail(ParseError::HeaderSectionTooLarge);
+        const char *line = data + lineOffset;
+        clock.enter(Phase::Validate);
+        if (Rules::startRule == StartRule::Required && lineOffset == 0) {
+            StringView protocol = Rules::protocol();
+            if (!startLine_.parse(line, lineLength) ||
+                startLine_.getVersion().substr(0, protocol.size()) !=
+                    protocol)
+                return fail(ParseError::InvalidStartLine);
+            continue;
+        }
+        // A start line has a space before any colon, a header never has.
+        if (Rules::startRule == StartRule::Optional && lineOffset == 0 &&
+            !syntax::isSpace(line[0]) &&
+            std::memchr(line, ' ', std::min(scan.colon, lineLength)) &&
+            startLine_.parse(line, lineLength))
+            continue;
+
+        // Only lines starting with whitespace continue a value in the
+        // dialects of a protocol.
+        if (Rules::lenient ? scan.colon == syntax::npos ||
+                                 syntax::isSpace(line[0])
+                           : line[0] == ' ' || line[0] == '\t') {
+            clock.enter(Phase::Unfold);
+            if (fields_.empty())
+                return fail(ParseError::OrphanContinuation);
+            if (!Rules::folding)
+                return fail(ParseError::ObsoleteFolding);
+            if (!isCleanLine<Rules>(scan, line, lineLength))
+                return fail(ParseError::InvalidCharacter);
+            if (limits_.maxContinuations &&
+                ++continuations > limits_.maxContinuations)
+                return fail(ParseError::TooManyContinuations);
+            ++unfolds_;
+            Entry &entry = fields_.back();
+            if (limits_.maxFieldBytes &&
+                lineOffset + lineLength - entry.name.offset >
+                    limits_.maxFieldBytes)
+                return fail(ParseError::FieldTooLarge);
+            if (entry.lazy) { // Extend the raw value over the line.
+                entry.value.length = lineOffset + lineLength -
+                                     entry.value.offset;
+                entry.folded = true;
+                continue;
+            }
+            size_t skip = 0;
+            while (skip < lineLength && syntax::isSpace(line[skip]))
+                ++skip;
+            Span &value = entry.value;
+            own(value);
+            buffer_ += ' ';
+            value.length += 1;
+            append(value, lineOffset + skip, lineLength - skip);
+            continue;
+        }
+
+        // A line that neither continues a value nor has a colon.
+        if (!Rules::lenient && scan.colon == syntax::npos)
+            return fail(ParseError::InvalidName);
+        size_t pos = scan.colon;
+        size_t nameLength = pos;
+        while (Rules::spaceBeforeColon && nameLength &&
+               (line[nameLength - 1] == ' ' || line[nameLength - 1] == '\t'))
+            --nameLength;
+        // Characters of the dialect's names, then value characters.
+        if ((!Rules::lenient && nameLength == 0) ||
+            !syntax::matchClass(line, nameLength, Rules::nameClass))
+            return fail(ParseError::InvalidName);
+        if (!isCleanLine<Rules>(scan, line, lineLength))
+            return fail(ParseError::InvalidCharacter);
+        if (limits_.maxHeaderCount &&
+            fields_.size() == limits_.maxHeaderCount)
+            return fail(ParseError::TooManyHeaders);
+        if (limits_.maxFieldBytes && lineLength > limits_.maxFieldBytes)
+            return fail(ParseError::FieldTooLarge);
+        continuations = 0;
+
+        Entry entry;
+        entry.name.offset = lineOffset;
+        entry.name.length = nameLength;
+        entry.value.offset = lineOffset + pos + 1;
+        entry.value.length = lineLength - pos - 1;
+        entry.lazy = selectedLengths_ &&
+                     !isSelected(StringView(line, nameLength),
+                                 Rules::compactForms, entry.id);
+        fields_.push_back(entry);
+    }
+
+    if (Rules::startRule == StartRule::Required &&
+        startLine_.getType() == StartLine::Type::None)
+        return fail(ParseError::InvalidStartLine);
+    clock.enter(Phase::Trim);
+    return parseBody(end, end, maxLength, Rules::rawBody);
+}
+
+template bool MessageView::parse<GenericDialect>(const char *, size_t);
+template bool MessageView::parse<HttpDialect>(const char *, size_t);
+template bool MessageView::parse<SipDialect>(const char *, size_t);
+template bool MessageView::parse<MailDialect>(const char *, size_t);
+
+/**
+ * @description:
+ *     Parse a raw message in place.
+ * @param[in] rawMessage
+ *     A raw string in message format, it must outlive the view.
+ * @return:
+ *     An identicator of whether or not the parse process
+ *     was successful is returned.
+ */
+bool MessageView::parse(const std::string &rawMessage) {
+    return parse(rawMessage.data(), rawMessage.size());
+}
+
+/**
+ * @description:
+ *     Drop all parsed components, the internal buffer keeps its capacity.
+ */
+void MessageView::clear() {
+    data_ = nullptr;
+    length_ = 0;
+    compactForms_ = true;
+    startLine_.clear();
+    fields_.clear();
+    body_ = Span();
+    lazyBody_ = false;
+    buffer_.clear();
+    error_ = ParseError::None;
+    unfolds_ = 0;
+}
+
+/**
+ * @description:
+ *     Get the reason the last parse failed.
+ * @return:
+ *     The reason, None if the last parse was successful.
+ */
+ParseError MessageView::getError() const { return error_; }
+
+/**
+ * @description:
+ *     Get the request or status line of the message.
+ * @return:
+ *     The start line, its type is None if the message has none.
+ */
+const StartLine &MessageView::getStartLine() const { return startLine_; }
+
+/**
+ * @description:
+ *     Get the number of header fields in wire order.
+ * @return:
+ *     The number of header fields, repeated names are counted separately.
+ */
+size_t MessageView::getHeaderCount() const { return fields_.size(); }
+
+/**
+ * @description:
+ *     Get a header field by its position.
+ * @param[in] index
+ *     The position of the field in wire order.
+ * @return:
+ *     Views of the trimmed name and value of the field.
+ */
+MessageView::Field MessageView::getHeader(size_t index) const {
+    // A lazy value is unfolded once, reading from two threads isn't safe
+    // until then.
+    materialize(fields_[index]);
+    Field field;
+    field.name = resolve(fields_[index].name);
+    field.value = resolve(fields_[index].value);
+    return field;
+}
+
+/**
+ * @description:
+ *     Check the name of a header is exist or not, names are compared
+ *     case-insensitively.
+ * @param[in] headerName
+ *     the name filed of a header to be checked
+ * @return:
+ *     An indicator of whether or not the header's name was exist
+ *     is returned.
+ */
+bool MessageView::hasHeader(StringView headerName) const {
+    for (const auto &entry : fields_) {
+        if (equalsName(resolve(entry.name), headerName))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @description:
+ *     Get the value of the first header with a name.
+ * @param[in] headerName
+ *     A header's name as an index.
+ * @return:
+ *     A view of the header's value, an empty view if there is no such header.
+ */
+StringView MessageView::getHeaderValue(StringView headerName) const {
+    for (size_t i = 0; i < fields_.size(); ++i) {
+        if (equalsName(resolve(fields_[i].name), headerName))
+            return getHeader(i).value;
+    }
+    return StringView();
+}
+
+/**
+ * @description:
+ *     Get the value of the first header with an identifier, a SIP compact
+ *     form matches its full name.
+ * @param[in] headerId
+ *     The identifier of a well-known header.
+ * @return:
+ *     A view of the header's value, an empty view if there is no such header.
+ */
+StringView MessageView::getHeaderValue(HeaderId headerId) const {
+    // Selected headers got their identifiers while parsing.
+    bool selected = headerId != HeaderId::Unknown &&
+                    headerId != HeaderId::Count &&
+                    selectedIds_.test(static_cast<size_t>(headerId));
+    for (size_t i = 0; i < fields_.size(); ++i) {
+        if (selected ? fields_[i].id == headerId
+                     : lookupHeaderId(resolve(fields_[i].name),
+                                      compactForms_) == headerId)
+            return getHeader(i).value;
+    }
+    return StringView();
+}
+
+/**
+ * @description:
+ *     Get message body text.
+ * @return:
+ *     A view of the message body.
+ */
+StringView MessageView::getBody() const {
+    materializeBody();
+    return resolve(body_);
+}
+
+/**
+ * @description:
+ *     Set line length limit number.
+ * @param[in] maxLength
+ *     A number to limit message each line length.
+ */
+void MessageView::setLineLength(size_t maxLength) {
+    maxLineLength_ = maxLength;
+}
+
+/**
+ * @description:
+ *     Set the bounds on the resources a message may take, a parse over
+ *     any of them fails at once with the error of that bound.
+ * @param[in] limits
+ *     The bounds, 0 for none.
+ */
+void MessageView::setLimits(const ParseLimits &limits) { limits_ = limits; }
+
+/**
+ * @description:
+ *     Select a header to be unfolded while parsing, the selection is kept
+ *     until it is cleared.
+ * @param[in] headerId
+ *     The identifier of a well-known header, its compact form is selected
+ *     too.
+ */
+void MessageView::selectHeader(HeaderId headerId) {
+    if (headerId == HeaderId::Unknown || headerId == HeaderId::Count)
+        return;
+    if (selectedIds_.test(static_cast<size_t>(headerId)))
+        return;
+    selectedIds_.set(static_cast<size_t>(headerId));
+    StringView name = getHeaderName(headerId);
+    selection_.push_back(Selection{std::string(name.data(), name.size()),
+                                   headerId});
+    selectedLengths_ |= uint64_t(1) << std::min<size_t>(name.size(), 63);
+    // A compact form may stand for it.
+    selectedLengths_ |= uint64_t(1) << 1;
+}
+
+/**
+ * @description:
+ *     Select a header to be unfolded while parsing, the selection is kept
+ *     until it is cleared.
+ * @param[in] headerName
+ *     A header's name, compared case-insensitively.
+ */
+void MessageView::selectHeader(StringView headerName) {
+    HeaderId headerId = lookupHeaderId(headerName);
+    if (headerId != HeaderId::Unknown) {
+        selectHeader(headerId);
+        return;
+    }
+    if (headerName.empty())
+        return;
+    selection_.push_back(Selection{
+        std::string(headerName.data(), headerName.size()), HeaderId::Unknown});
+    selectedLengths_ |= uint64_t(1)
+                        << std::min<size_t>(headerName.size(), 63);
+}
+
+/**
+ * @description:
+ *     Drop the selection, all headers are unfolded while parsing again.
+ */
+void MessageView::clearSelection() {
+    selectedLengths_ = 0;
+    selectedIds_.reset();
+    selection_.clear();
+}
+
+// Private methods
+/**
+ * @description:
+ *     Take the lines after the blank line as the body, then trim
+ *     whitespace characters of all unfolded headers and the body. With a
+ *     selection and no line limit the body is kept raw until it is read.
+ * @param[in] start
+ *     A pointer to the first line of the body.
+ * @param[in] end
+ *     A pointer to the end of the raw message.
+ * @param[in] maxLength
+ *     The line length limit, 0 for none.
+ * @param[in] raw
+ *     An indicator of whether or not the body is kept as it is, its lines
+ *     are checked against the limit only.
+ * @return:
+ *     An identicator of whether or not all lines were in limit.
+ */
+bool MessageView::parseBody(const char *start, const char *end,
+                            size_t maxLength, bool raw) {
+    if (limits_.maxBodyBytes &&
+        static_cast<size_t>(end - start) > limits_.maxBodyBytes)
+        return fail(ParseError::BodyTooLarge);
+    if (raw) {
+        for (const char *line = start; maxLength && line != end;) {
+            const char *next;
+            if (exceedsLimit(line, findLineEnd(line, end, next), maxLength))
+                return fail(ParseError::LineTooLong);
+            line = next;
+        }
+        body_.offset = start - data_;
+        body_.length = end - start;
+    } else if (selectedLengths_ && !maxLength) {
+        body_.offset = start - data_;
+        body_.length = end - start;
+        lazyBody_ = true;
+    } else {
+        if (!joinBody(start, end, maxLength))
+            return fail(ParseError::LineTooLong);
+        trim(body_);
+    }
+
+    for (auto &entry : fields_) {
+        if (!entry.lazy)
+            trim(entry.value);
+    }
+    stats::count(Counter::Messages);
+    stats::count(Counter::Bytes, end - data_);
+    stats::count(Counter::Headers, fields_.size());
+    stats::count(Counter::Unfolds, unfolds_);
+    return true;
+}
+
+/**
+ * @description:
+ *     Concatenate the lines of a raw body to the body.
+ * @param[in] start
+ *     A pointer to the first line of the body.
+ * @param[in] end
+ *     A pointer to the end of the raw message.
+ * @param[in] maxLength
+ *     The line length limit, 0 for none.
+ * @return:
+ *     An identicator of whether or not all lines were in limit.
+ */
+bool MessageView::joinBody(const char *start, const char *end,
+                           size_t maxLength) const {
+    while (start != end) {
+        const char *next;
+        const char *lineEnd = findLineEnd(start, end, next);
+
+        // Line length exceed the limitation.
+        if (exceedsLimit(start, lineEnd, maxLength))
+            return false;
+
+        if (lineEnd != start)
+            append(body_, start - data_, lineEnd - start);
+        start = next;
+    }
+    return true;
+}
+
+/**
+ * @description:
+ *     Record the reason a parse failed.
+ * @param[in] error
+ *     The reason.
+ * @return:
+ *     false, for a parse to return.
+ */
+bool MessageView::fail(ParseError error) {
+    error_ = error;
+    stats::reject(error);
+    return false;
+}
+
+/**
+ * @description:
+ *     Check a header is selected. Names of a length nothing was selected
+ *     with are rejected before any compare.
+ * @param[in] headerName
+ *     A header's name.
+ * @param[in] compactForms
+ *     An indicator of whether or not a single letter is a compact form.
+ * @param[out] headerId
+ *     The identifier of a selected well-known header.
+ * @return:
+ *     An indicator of whether or not the header was selected.
+ */
+bool MessageView::isSelected(StringView headerName, bool compactForms,
+                             HeaderId &headerId) const {
+    size_t length = headerName.size();
+    if (!(selectedLengths_ >> std::min<size_t>(length, 63) & 1))
+        return false;
+    if (length == 1) {
+        headerId = lookupHeaderId(headerName, compactForms);
+        return headerId != HeaderId::Unknown &&
+               selectedIds_.test(static_cast<size_t>(headerId));
+    }
+    for (const auto &selection : selection_) {
+        if (equalsName(selection.name, headerName)) {
+            headerId = selection.id;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @description:
+ *     Unfold and trim a value skipped while parsing, the continuation
+ *     lines were validated then.
+ * @param[in|out] entry
+ *     The field to be unfolded.
+ */
+void MessageView::materialize(Entry &entry) const {
+    if (!entry.lazy)
+        return;
+    entry.lazy = false;
+    if (entry.folded) {
+        const char *start = data_ + entry.value.offset;
+        const char *end = start + entry.value.length;
+        Span value;
+        bool first = true;
+        while (start < end) {
+            const char *lineEnd = static_cast<const char *>(
+                std::memchr(start, '\r', end - start));
+            if (!lineEnd)
+                lineEnd = end;
+            if (!first) {
+                while (start != lineEnd && syntax::isSpace(*start))
+                    ++start;
+                own(value);
+                buffer_ += ' ';
+                value.length += 1;
+            }
+            append(value, start - data_, lineEnd - start);
+            first = false;
+            start = lineEnd == end ? end : lineEnd + 2;
+        }
+        entry.value = value;
+        entry.folded = false;
+    }
+    trim(entry.value);
+}
+
+/**
+ * @description:
+ *     Concatenate and trim a body kept raw while parsing.
+ */
+void MessageView::materializeBody() const {
+    if (!lazyBody_)
+        return;
+    lazyBody_ = false;
+    const char *start = data_ + body_.offset;
+    const char *end = start + body_.length;
+    body_ = Span();
+    joinBody(start, end, 0);
+    trim(body_);
+}
+
+/**
+ * @description:
+ *     Turn a span into a view of the raw message or the internal buffer.
+ */
+StringView MessageView::resolve(const Span &span) const {
+    const char *base = span.owned ? buffer_.data() : data_;
+    return StringView(base + span.offset, span.length);
+}
+
+/**
+ * @description:
+ *     Move a span into the internal buffer so it can be extended. Only
+ *     the last span of the buffer is ever extended, so the owned spans
+ *     stay contiguous. Each raw byte is copied once at most and joined
+ *     lines lose their terminators, so the buffer reserved for the raw
+ *     message is never reallocated.
+ * @param[in|out] span
+ *     The span to be copied.
+ */
+void MessageView::own(Span &span) const {
+    if (span.owned)
+        return;
+    if (buffer_.empty())
+        buffer_.reserve(length_);
+    size_t offset = buffer_.size();
+    buffer_.append(data_ + span.offset, span.length);
+    span.offset = offset;
+    span.owned = true;
+}
+
+/**
+ * @description:
+ *     Append a range of the raw message to a span. An empty span only
+ *     references the raw message, a non-empty one is copied first.
+ * @param[in|out] span
+ *     The span to be extended.
+ * @param[in] offset
+ *     The offset of the range in the raw message.
+ * @param[in] length
+ *     The length of the range.
+ */
+void MessageView::append(Span &span, size_t offset,
+                         size_t length) const {
+    if (!span.owned && span.length == 0) {
+        span.offset = offset;
+        span.length = length;
+        return;
+    }
+    own(span);
+    buffer_.append(data_ + offset, length);
+    span.length += length;
+}
+
+/**
+ * @description:
+ *     Remove the whitspace characters at the both sides of a span.
+ */
+void MessageView::trim(Span &span) const {
+    const char *base = span.owned ? buffer_.data() : data_;
+    while (span.length && syntax::isSpace(base[span.offset])) {
+        ++span.offset;
+        --span.length;
+    }
+    while (span.length &&
+           syntax::isSpace(base[span.offset + span.length - 1])) {
+        --span.length;
+    }
+}
+
+} // namespace msg
@@ -0,0 +1,258 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 16:05:31
+ * @LastEditTime: 2019-09-06 12:07:44
+ * @Description: An implementation of class msg::MessageWriter.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <message/MessageWriter.hpp>
+#include <sys/socket.h>
+#include <utility>
+
+namespace {
+#if defined(IOV_MAX)
+const size_t maxVectors = IOV_MAX;
+#else
+const size_t maxVectors = 1024;
+#endif
+
+} // namespace
+
+namespace msg {
+MessageWriter::MessageWriter(EventLoop &loop, int fd) : loop_(loop), fd_(fd) {}
+
+MessageWriter::~MessageWriter() {
+    if (getPendingLength())
+        loop_.setWriteHandler(fd_, EventLoop::Handler());
+}
+
+// Public methods
+/**
+ * @description:
+ *     Send a message as produceToIovec() produces it.
+ * @param[in] message
+ *     The message, it isn't referenced after the call.
+ * @return:
+ *     An indicator of whether or not the message was written or kept to
+ *     be written, false once writing failed.
+ */
+bool MessageWriter::send(const Message &message) {
+    if (error_)
+        return false;
+    if (getPendingLength()) {
+        message.produceToMessage(pending_);
+        return true;
+    }
+    iov_.clear();
+    message.produceToIovec(iov_, foldBuffer_);
+    return write();
+}
+
+/**
+ * @description:
+ *     Send a message produced from a template.
+ * @param[in] messageTemplate
+ *     A compiled template.
+ * @param[in] values
+ *     The values of the slots in order, they aren't referenced after the
+ *     call.
+ * @param[in] count
+ *     The number of values.
+ * @return:
+ *     An indicator of whether or not the message was written or kept to
+ *     be written, false if the values didn't fit the template or once
+ *     writing failed.
+ */
+bool MessageWriter::send(const MessageTemplate &messageTemplate,
+                         const StringView *values, size_t count) {
+    if (error_)
+        return false;
+    if (getPendingLength())
+        return messageTemplate.produceToMessage(pending_, values, count);
+    iov_.clear();
+    if (!messageTemplate.produceToIovec(iov_, values, count, foldBuffer_))
+        return false;
+    return write();
+}
+
+/**
+ * @description:
+ *     Send bytes as they are, such as a body streamed after its headers.
+ * @param[in] data
+ *     The bytes, they aren't referenced after the call.
+ * @return:
+ *     An indicator of whether or not the bytes were written or kept to be
+ *     written, false once writing failed.
+ */
+bool MessageWriter::sendRaw(StringView data) {
+    if (error_)
+        return false;
+    if (getPendingLength()) {
+        pending_.append(data.data(), data.size());
+        return true;
+    }
+    iov_.clear();
+    iovec vec;
+    vec.iov_base = const_cast<char *>(data.data());
+    vec.iov_len = data.size();
+    iov_.push_back(vec);
+    return write();
+}
+
+/**
+ * @description:
+ *     Get the number of bytes waiting for the descriptor.
+ */
+size_t MessageWriter::getPendingLength() const {
+    return pending_.size() - pendingOffset_;
+}
+
+/**
+ * @description:
+ *     Get the error writing failed with.
+ * @return:
+ *     The errno value, 0 if writing didn't fail.
+ */
+int MessageWriter::getError() const { return error_; }
+
+/**
+ * @description:
+ *     Set a handler called when the pending bytes were written or writing
+ *     them failed, a sender may wait for it before sending more.
+ */
+void MessageWriter::setDrainHandler(DrainHandler onDrain) {
+    onDrain_ = std::move(onDrain);
+}
+
+// Private methods
+/**
+ * @description:
+ *     Write the buffers of a message, the part the descriptor doesn't
+ *     take is kept.
+ * @return:
+ *     An indicator of whether or not writing didn't fail.
+ */
+bool MessageWriter::write() {
+    size_t index = 0;
+    while (index < iov_.size()) {
+        size_t count = std::min(iov_.size() - index, maxVectors);
+        size_t length = 0;
+        for (size_t i = index; i < index + count; ++i)
+            length += iov_[i].iov_len;
+        ssize_t n = writeVectors(&iov_[index], count);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fail(errno);
+                return false;
+            }
+            keep(index);
+            return true;
+        }
+
+        size_t written = static_cast<size_t>(n);
+        while (index < iov_.size() && written >= iov_[index].iov_len) {
+            written -= iov_[index].iov_len;
+            ++index;
+        }
+        if (written) {
+            iov_[index].iov_base = static_cast<char *>(iov_[index].iov_base) +
+                                   written;
+            iov_[index].iov_len -= written;
+        }
+        // A short write means the descriptor is full.
+        if (static_cast<size_t>(n) < length) {
+            keep(index);
+            return true;
+        }
+    }
+    return true;
+}
+
+/**
+ * @description:
+ *     Write buffers to the descriptor. Sockets are written by sendmsg()
+ *     so a closed peer fails with EPIPE instead of raising SIGPIPE.
+ * @return:
+ *     The number of bytes written, -1 with errno set on failure.
+ */
+ssize_t MessageWriter::writeVectors(const iovec *vecs, size_t count) {
+    if (socket_) {
+        msghdr header = msghdr();
+        header.msg_iov = const_cast<iovec *>(vecs);
+        header.msg_iovlen = count;
+        ssize_t n = ::sendmsg(fd_, &header, MSG_NOSIGNAL);
+        if (n >= 0 || errno != ENOTSOCK)
+            return n;
+        socket_ = false;
+    }
+    return ::writev(fd_, vecs, static_cast<int>(count));
+}
+
+/**
+ * @description:
+ *     Copy the buffers from an index on to the pending buffer and wait
+ *     for the descriptor to become writable.
+ * @param[in] index
+ *     The first buffer not written completely.
+ */
+void MessageWriter::keep(size_t index) {
+    for (size_t i = index; i < iov_.size(); ++i) {
+        pending_.append(static_cast<const char *>(iov_[i].iov_base),
+                        iov_[i].iov_len);
+    }
+    if (getPendingLength())
+        loop_.setWriteHandler(fd_, [this]() { onWritable(); });
+}
+
+/**
+ * @description:
+ *     Write the pending buffer until the descriptor is full again.
+ */
+void MessageWriter::onWritable() {
+    while (getPendingLength()) {
+        iovec vec;
+        vec.iov_base = &pending_[pendingOffset_];
+        vec.iov_len = getPendingLength();
+        ssize_t n = writeVectors(&vec, 1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Drop the written half so the buffer doesn't grow while
+                // messages keep coming.
+                if (pendingOffset_ > pending_.size() / 2) {
+                    pending_.erase(0, pendingOffset_);
+                    pendingOffset_ = 0;
+                }
+                return;
+            }
+            fail(errno);
+            break;
+        }
+        pendingOffset_ += static_cast<size_t>(n);
+    }
+
+    pending_.clear();
+    pendingOffset_ = 0;
+    loop_.setWriteHandler(fd_, EventLoop::Handler());
+    if (onDrain_)
+        onDrain_();
+}
+
+/**
+ * @description:
+ *     Record the error writing failed with and drop the pending bytes.
+ */
+void MessageWriter::fail(int error) {
+    error_ = error;
+    pending_.clear();
+    pendingOffset_ = 0;
+}
+
+} // namespace msg
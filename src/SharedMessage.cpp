@@ -0,0 +1,685 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 20:06:14
+ * @LastEditTime: 2019-09-06 10:04:51
+ * @Description: An implementation of class msg::SharedMessage.
+ */
+#include "DialectRules.hpp"
+#include "Syntax.hpp"
+#include <cstring>
+#include <message/SharedMessage.hpp>
+#include <new>
+#include <utility>
+
+namespace {
+const size_t npos = static_cast<size_t>(-1);
+const char lineTerminator[] = "\r\n";
+const char headerSeparator[] = ": ";
+const char fieldSeparator[] = ", ";
+
+/**
+ * @description:
+ *     Copy a string to the text of a block.
+ * @param[in|out] text
+ *     The position the string is copied to, moved past it.
+ * @return:
+ *     A pointer to the copy.
+ */
+inline const char *copyText(char *&text, msg::StringView s) {
+    char *copy = text;
+    if (!s.empty())
+        std::memcpy(text, s.data(), s.size());
+    text += s.size();
+    return copy;
+}
+
+} // namespace
+
+namespace msg {
+SharedMessage::~SharedMessage() { release(block_); }
+
+SharedMessage::SharedMessage(const SharedMessage &other)
+    : block_(other.block_) {
+    if (block_)
+        block_->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+SharedMessage::SharedMessage(SharedMessage &&other) noexcept
+    : block_(other.block_) {
+    other.block_ = nullptr;
+}
+
+SharedMessage &SharedMessage::operator=(const SharedMessage &other) {
+    if (other.block_)
+        other.block_->references.fetch_add(1, std::memory_order_relaxed);
+    release(block_);
+    block_ = other.block_;
+    return *this;
+}
+
+SharedMessage &SharedMessage::operator=(SharedMessage &&other) noexcept {
+    if (this != &other) {
+        release(block_);
+        block_ = other.block_;
+        other.block_ = nullptr;
+    }
+    return *this;
+}
+
+// Public methods
+/**
+ * @description:
+ *     Check the handle refers to no message.
+ */
+bool SharedMessage::empty() const { return block_ == nullptr; }
+
+/**
+ * @description:
+ *     Get the number of handles of the message, mutations committed from
+ *     it hold one each. The number may change at once in other threads.
+ */
+size_t SharedMessage::getUseCount() const {
+    return block_ ? block_->references.load(std::memory_order_relaxed) : 0;
+}
+
+/**
+ * @description:
+ *     Get the text of the request or status line.
+ * @return:
+ *     A view of the line, empty if the message has none.
+ */
+StringView SharedMessage::getStartLine() const {
+    return block_ ? StringView(block_->line, block_->lineLength)
+                  : StringView();
+}
+
+/**
+ * @description:
+ *     Get the method of a request.
+ * @return:
+ *     The method, Unknown for a status or an extension method.
+ */
+Method SharedMessage::getMethod() const {
+    return block_ ? block_->method : Method::Unknown;
+}
+
+/**
+ * @description:
+ *     Get the target of a request.
+ * @return:
+ *     A view of the target, empty for a status.
+ */
+StringView SharedMessage::getTarget() const {
+    return block_ ? StringView(block_->line + block_->targetOffset,
+                               block_->targetLength)
+                  : StringView();
+}
+
+/**
+ * @description:
+ *     Get the code of a status.
+ * @return:
+ *     The code, 0 for a request.
+ */
+unsigned SharedMessage::getStatusCode() const {
+    return block_ ? block_->statusCode : 0;
+}
+
+/**
+ * @description:
+ *     Get the number of headers, repeated fields of a name are one header.
+ */
+size_t SharedMessage::getHeaderCount() const {
+    return block_ ? block_->entryCount : 0;
+}
+
+/**
+ * @description:
+ *     Get a header by its position.
+ * @param[in] index
+ *     The position of the header.
+ * @return:
+ *     The identifier, name and combined value of the header.
+ */
+SharedMessage::Field SharedMessage::getHeader(size_t index) const {
+    const Entry &entry = block_->entries()[index];
+    return Field{entry.id, StringView(entry.name, entry.nameLength),
+                 StringView(entry.value, entry.valueLength)};
+}
+
+/**
+ * @description:
+ *     Check a well-known header exists.
+ */
+bool SharedMessage::hasHeader(HeaderId headerId) const {
+    return headerId != HeaderId::Unknown &&
+           findHeader(headerId, StringView()) != npos;
+}
+
+/**
+ * @description:
+ *     Check a header exists, names are compared case-insensitively.
+ */
+bool SharedMessage::hasHeader(StringView headerName) const {
+    return block_ &&
+           findHeader(lookupHeaderId(headerName, block_->compactForms),
+                      headerName) != npos;
+}
+
+/**
+ * @description:
+ *     Get the value of a well-known header.
+ * @return:
+ *     A view of the value, repeated fields are separated by commas.
+ *     Empty if there is no such header.
+ */
+StringView SharedMessage::getHeaderValue(HeaderId headerId) const {
+    size_t position = headerId == HeaderId::Unknown
+                          ? npos
+                          : findHeader(headerId, StringView());
+    return position == npos ? StringView() : getHeader(position).value;
+}
+
+/**
+ * @description:
+ *     Get the value of a header by its name.
+ * @return:
+ *     A view of the value, repeated fields are separated by commas.
+ *     Empty if there is no such header.
+ */
+StringView SharedMessage::getHeaderValue(StringView headerName) const {
+    if (!block_)
+        return StringView();
+    size_t position = findHeader(
+        lookupHeaderId(headerName, block_->compactForms), headerName);
+    return position == npos ? StringView() : getHeader(position).value;
+}
+
+/**
+ * @description:
+ *     Get the number of fields of a well-known header.
+ * @return:
+ *     The number of fields, 0 if there is no such header.
+ */
+size_t SharedMessage::getHeaderFieldCount(HeaderId headerId) const {
+    size_t position = headerId == HeaderId::Unknown
+                          ? npos
+                          : findHeader(headerId, StringView());
+    return position == npos ? 0
+                            : block_->entries()[position].boundaryCount + 1;
+}
+
+/**
+ * @description:
+ *     Get a field of a well-known header, such as the topmost Via.
+ * @param[in] headerId
+ *     The identifier of the header.
+ * @param[in] index
+ *     The position of the field in the order the fields were added.
+ * @return:
+ *     A view of the field, empty if there is no such field.
+ */
+StringView SharedMessage::getHeaderField(HeaderId headerId,
+                                         size_t index) const {
+    size_t position = headerId == HeaderId::Unknown
+                          ? npos
+                          : findHeader(headerId, StringView());
+    if (position == npos)
+        return StringView();
+    const Entry &entry = block_->entries()[position];
+    if (index > entry.boundaryCount)
+        return StringView();
+    const Boundary *boundaries = block_->boundaries() + entry.boundaryIndex;
+    size_t begin = index ? boundaries[index - 1].begin : 0;
+    size_t end =
+        index < entry.boundaryCount ? boundaries[index].end : entry.valueLength;
+    return StringView(entry.value + begin, end - begin);
+}
+
+/**
+ * @description:
+ *     Get message body text.
+ */
+StringView SharedMessage::getBody() const {
+    return block_ ? StringView(block_->body, block_->bodyLength)
+                  : StringView();
+}
+
+/**
+ * @description:
+ *     Produce the message to the end of a buffer as Message does without
+ *     a line length limit, for a consumer such as a logger.
+ * @param[in|out] targetMessage
+ *     A buffer the message text is appended to.
+ */
+void SharedMessage::produceToMessage(std::string &targetMessage) const {
+    if (!block_)
+        return;
+    if (block_->lineLength) {
+        targetMessage.append(block_->line, block_->lineLength)
+            .append(lineTerminator, 2);
+    }
+    for (size_t i = 0; i < block_->entryCount; ++i) {
+        const Entry &entry = block_->entries()[i];
+        if (!entry.boundaryCount ||
+            (!block_->repeatsFields && entry.id != HeaderId::SetCookie)) {
+            targetMessage.append(entry.name, entry.nameLength)
+                .append(headerSeparator, 2)
+                .append(entry.value, entry.valueLength)
+                .append(lineTerminator, 2);
+            continue;
+        }
+        const Boundary *boundaries = block_->boundaries() + entry.boundaryIndex;
+        for (size_t field = 0; field <= entry.boundaryCount; ++field) {
+            size_t begin = field ? boundaries[field - 1].begin : 0;
+            size_t end = field < entry.boundaryCount ? boundaries[field].end
+                                                     : entry.valueLength;
+            targetMessage.append(entry.name, entry.nameLength)
+                .append(headerSeparator, 2)
+                .append(entry.value + begin, end - begin)
+                .append(lineTerminator, 2);
+        }
+    }
+    targetMessage.append(lineTerminator, 2);
+    if (block_->bodyLength) {
+        targetMessage.append(block_->body, block_->bodyLength)
+            .append(lineTerminator, 2);
+    }
+}
+
+/**
+ * @description:
+ *     Start changing a copy of the message.
+ */
+SharedMessage::Mutation SharedMessage::mutate() const {
+    return Mutation(*this);
+}
+
+// Private methods
+SharedMessage::SharedMessage(Block *block) : block_(block) {}
+
+/**
+ * @description:
+ *     Allocate a block with room for its entries, boundaries and text,
+ *     the caller fills them in. A block starts with one reference.
+ * @param[in] parent
+ *     The block strings may refer to, it gets a reference.
+ */
+SharedMessage::Block *SharedMessage::allocate(size_t entryCount,
+                                              size_t boundaryCount,
+                                              size_t textLength,
+                                              Block *parent) {
+    size_t entryOffset =
+        (sizeof(Block) + alignof(Entry) - 1) / alignof(Entry) * alignof(Entry);
+    size_t size = entryOffset + entryCount * sizeof(Entry) +
+                  boundaryCount * sizeof(Boundary) + textLength;
+    Block *block = new (::operator new(size)) Block();
+    block->references.store(1, std::memory_order_relaxed);
+    if (parent)
+        parent->references.fetch_add(1, std::memory_order_relaxed);
+    block->parent = parent;
+    block->compactForms = true;
+    block->textLength = textLength;
+    block->entryCount = static_cast<uint32_t>(entryCount);
+    block->boundaryCount = static_cast<uint32_t>(boundaryCount);
+    return block;
+}
+
+/**
+ * @description:
+ *     Drop a reference to a block, the last one frees it and drops its
+ *     reference to the parent.
+ */
+void SharedMessage::release(Block *block) {
+    // Writes of other threads happen before the block is freed.
+    while (block &&
+           block->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        Block *parent = block->parent;
+        block->~Block();
+        ::operator delete(block);
+        block = parent;
+    }
+}
+
+/**
+ * @description:
+ *     Copy a start line to the text of a block and record its parts.
+ * @param[in] text
+ *     The position the line is copied to.
+ * @return:
+ *     The position after the line.
+ */
+char *SharedMessage::writeStartLine(Block *block, const StartLine &startLine,
+                                    char *text) {
+    StringView line = startLine.getText();
+    block->line = copyText(text, line);
+    block->lineLength = static_cast<uint32_t>(line.size());
+    block->method = startLine.getMethod();
+    block->statusCode = startLine.getStatusCode();
+    StringView target = startLine.getTarget();
+    block->targetOffset =
+        target.empty() ? 0 : static_cast<uint32_t>(target.data() - line.data());
+    block->targetLength = static_cast<uint32_t>(target.size());
+    return text;
+}
+
+/**
+ * @description:
+ *     Find a header, well-known headers are compared by identifier only.
+ * @return:
+ *     The position of the header, npos if there is no such header.
+ */
+size_t SharedMessage::findHeader(HeaderId headerId,
+                                 StringView headerName) const {
+    if (!block_)
+        return npos;
+    const Entry *entries = block_->entries();
+    for (size_t i = 0; i < block_->entryCount; ++i) {
+        if (entries[i].id != headerId)
+            continue;
+        if (headerId != HeaderId::Unknown ||
+            syntax::equalsName(entries[i].name, entries[i].nameLength,
+                               headerName.data(), headerName.size()))
+            return i;
+    }
+    return npos;
+}
+
+SharedMessage::Entry *SharedMessage::Block::entries() {
+    size_t offset =
+        (sizeof(Block) + alignof(Entry) - 1) / alignof(Entry) * alignof(Entry);
+    return reinterpret_cast<Entry *>(reinterpret_cast<char *>(this) + offset);
+}
+
+SharedMessage::Boundary *SharedMessage::Block::boundaries() {
+    return reinterpret_cast<Boundary *>(entries() + entryCount);
+}
+
+char *SharedMessage::Block::text() {
+    return reinterpret_cast<char *>(boundaries() + boundaryCount);
+}
+
+SharedMessage::Mutation::Mutation(const SharedMessage &source)
+    : source_(source) {
+    size_t count = source_.getHeaderCount();
+    slots_.reserve(count + 1);
+    for (size_t i = 0; i < count; ++i) {
+        slots_.push_back(Slot{i, npos});
+    }
+}
+
+// Public methods
+/**
+ * @description:
+ *     Replace the start line.
+ */
+void SharedMessage::Mutation::setStartLine(const StartLine &startLine) {
+    startLine_ = startLine;
+    startLineSet_ = true;
+}
+
+/**
+ * @description:
+ *     Set the value of a header, the fields it had are replaced.
+ * @param[in] headerName
+ *     A header's name, a new header is added at the end.
+ * @param[in] headerValue
+ *     A header's value.
+ */
+void SharedMessage::Mutation::setHeader(StringView headerName,
+                                        StringView headerValue) {
+    size_t position = findSlot(headerName);
+    if (position == npos) {
+        addField(headerName, headerValue, false);
+        return;
+    }
+    Change &header = change(position);
+    header.value.assign(headerValue.data(), headerValue.size());
+    header.boundaries.clear();
+}
+
+/**
+ * @description:
+ *     Add a field after the fields of a header, as Message::addHeader()
+ *     does.
+ */
+void SharedMessage::Mutation::addHeader(StringView headerName,
+                                        StringView headerValue) {
+    addField(headerName, headerValue, false);
+}
+
+/**
+ * @description:
+ *     Add a field before the fields of a header, as a SIP proxy adds its
+ *     Via on top.
+ */
+void SharedMessage::Mutation::prependHeader(StringView headerName,
+                                            StringView headerValue) {
+    addField(headerName, headerValue, true);
+}
+
+/**
+ * @description:
+ *     Remove a header with all its fields.
+ */
+void SharedMessage::Mutation::removeHeader(StringView headerName) {
+    size_t position = findSlot(headerName);
+    if (position != npos)
+        slots_.erase(slots_.begin() + position);
+}
+
+/**
+ * @description:
+ *     Replace the body.
+ */
+void SharedMessage::Mutation::setBody(StringView bodyText) {
+    body_.assign(bodyText.data(), bodyText.size());
+    bodySet_ = true;
+}
+
+/**
+ * @description:
+ *     Make a shared message of the source with the changes, the mutation
+ *     may be committed again or changed further.
+ * @return:
+ *     The new message in one allocation. It shares the strings of the
+ *     unchanged headers and the body with a source that has no parent and
+ *     whose text is kept for at least a quarter, it copies them otherwise.
+ */
+SharedMessage SharedMessage::Mutation::commit() const {
+    Block *source = source_.block_;
+    size_t boundaryCount = 0;
+    size_t textLength = 0;
+    // The strings of the source kept by the result.
+    size_t inheritedLength = 0;
+    if (source && !startLineSet_)
+        inheritedLength += source->lineLength;
+    if (source && !bodySet_)
+        inheritedLength += source->bodyLength;
+    for (const auto &slot : slots_) {
+        if (slot.change == npos) {
+            const Entry &entry = source->entries()[slot.entry];
+            boundaryCount += entry.boundaryCount;
+            inheritedLength += entry.nameLength + entry.valueLength;
+            continue;
+        }
+        const Change &header = changes_[slot.change];
+        boundaryCount += header.boundaries.size();
+        textLength += header.name.size() + header.value.size();
+    }
+    if (startLineSet_)
+        textLength += startLine_.getText().size();
+    if (bodySet_)
+        textLength += body_.size();
+    // Sharing a source that shares its own would chain every version, and
+    // a little kept of a large source would keep all of it.
+    bool shares = inheritedLength && !source->parent &&
+                  inheritedLength * 4 >= source->textLength;
+    if (!shares)
+        textLength += inheritedLength;
+
+    Block *block = allocate(slots_.size(), boundaryCount, textLength,
+                            shares ? source : nullptr);
+    char *text = block->text();
+    if (startLineSet_) {
+        text = writeStartLine(block, startLine_, text);
+    } else if (source) {
+        block->line = shares ? source->line
+                             : copyText(text, StringView(source->line,
+                                                         source->lineLength));
+        block->lineLength = source->lineLength;
+        block->method = source->method;
+        block->statusCode = source->statusCode;
+        block->targetOffset = source->targetOffset;
+        block->targetLength = source->targetLength;
+    }
+    if (source) {
+        block->compactForms = source->compactForms;
+        block->repeatsFields = source->repeatsFields;
+    }
+
+    Entry *entries = block->entries();
+    Boundary *boundaries = block->boundaries();
+    uint32_t boundaryIndex = 0;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        const Slot &slot = slots_[i];
+        Entry &entry = entries[i];
+        if (slot.change == npos) {
+            entry = source->entries()[slot.entry];
+            if (!shares) {
+                entry.name =
+                    copyText(text, StringView(entry.name, entry.nameLength));
+                entry.value =
+                    copyText(text, StringView(entry.value, entry.valueLength));
+            }
+            std::memcpy(boundaries + boundaryIndex,
+                        source->boundaries() + entry.boundaryIndex,
+                        entry.boundaryCount * sizeof(Boundary));
+        } else {
+            const Change &header = changes_[slot.change];
+            entry.id = header.id;
+            entry.name = copyText(text, header.name);
+            entry.nameLength = static_cast<uint32_t>(header.name.size());
+            entry.value = copyText(text, header.value);
+            entry.valueLength = static_cast<uint32_t>(header.value.size());
+            entry.boundaryCount =
+                static_cast<uint32_t>(header.boundaries.size());
+            if (!header.boundaries.empty()) {
+                std::memcpy(boundaries + boundaryIndex,
+                            header.boundaries.data(),
+                            header.boundaries.size() * sizeof(Boundary));
+            }
+        }
+        entry.boundaryIndex = boundaryIndex;
+        boundaryIndex += entry.boundaryCount;
+    }
+
+    if (bodySet_) {
+        block->body = copyText(text, body_);
+        block->bodyLength = body_.size();
+    } else if (source) {
+        block->body = shares ? source->body
+                             : copyText(text, StringView(source->body,
+                                                         source->bodyLength));
+        block->bodyLength = source->bodyLength;
+    }
+    return SharedMessage(block);
+}
+
+// Private methods
+/**
+ * @description:
+ *     Find a header of the result by its name.
+ * @return:
+ *     The position in slots_, npos if there is no such header.
+ */
+size_t SharedMessage::Mutation::findSlot(StringView headerName) const {
+    const Block *source = source_.block_;
+    HeaderId headerId =
+        lookupHeaderId(headerName, source ? source->compactForms : true);
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        HeaderId id;
+        StringView name;
+        if (slots_[i].change == npos) {
+            const Entry &entry = source_.block_->entries()[slots_[i].entry];
+            id = entry.id;
+            name = StringView(entry.name, entry.nameLength);
+        } else {
+            id = changes_[slots_[i].change].id;
+            name = changes_[slots_[i].change].name;
+        }
+        if (id == headerId &&
+            (headerId != HeaderId::Unknown ||
+             syntax::equalsName(name.data(), name.size(), headerName.data(),
+                                headerName.size())))
+            return i;
+    }
+    return npos;
+}
+
+/**
+ * @description:
+ *     Get the copy of a header to be changed, a header of the source is
+ *     copied on its first change.
+ * @param[in] position
+ *     The position in slots_.
+ */
+SharedMessage::Mutation::Change &
+SharedMessage::Mutation::change(size_t position) {
+    Slot &slot = slots_[position];
+    if (slot.change == npos) {
+        Block *source = source_.block_;
+        const Entry &entry = source->entries()[slot.entry];
+        const Boundary *boundaries = source->boundaries() + entry.boundaryIndex;
+        changes_.push_back(
+            Change{entry.id, std::string(entry.name, entry.nameLength),
+                   std::string(entry.value, entry.valueLength),
+                   std::vector<Boundary>(boundaries,
+                                         boundaries + entry.boundaryCount)});
+        slot.change = changes_.size() - 1;
+        slot.entry = npos;
+    }
+    return changes_[slot.change];
+}
+
+/**
+ * @description:
+ *     Add a field to a header, a new header is added at the end.
+ * @param[in] first
+ *     An indicator of whether or not the field goes before the others.
+ */
+void SharedMessage::Mutation::addField(StringView headerName,
+                                       StringView headerValue, bool first) {
+    size_t position = findSlot(headerName);
+    if (position == npos) {
+        const Block *source = source_.block_;
+        changes_.push_back(Change{
+            lookupHeaderId(headerName, source ? source->compactForms : true),
+            headerName.toString(), headerValue.toString(),
+            std::vector<Boundary>()});
+        slots_.push_back(Slot{npos, changes_.size() - 1});
+        return;
+    }
+
+    Change &header = change(position);
+    uint32_t length = static_cast<uint32_t>(headerValue.size());
+    if (first) {
+        for (auto &boundary : header.boundaries) {
+            boundary.end += length + 2;
+            boundary.begin += length + 2;
+        }
+        header.boundaries.insert(header.boundaries.begin(),
+                                 Boundary{length, length + 2});
+        header.value.insert(0, fieldSeparator, 2)
+            .insert(0, headerValue.data(), headerValue.size());
+    } else {
+        uint32_t end = static_cast<uint32_t>(header.value.size());
+        header.boundaries.push_back(Boundary{end, end + 2});
+        header.value.append(fieldSeparator, 2)
+            .append(headerValue.data(), headerValue.size());
+    }
+}
+
+} // namespace msg
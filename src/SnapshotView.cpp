@@ -0,0 +1,285 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-02 10:48:12
+ * @LastEditTime: 2019-09-02 10:48:12
+ * @Description: An implementation of class msg::SnapshotView.
+ */
+#include "Syntax.hpp"
+#include <cstring>
+#include <message/SnapshotView.hpp>
+
+namespace {
+/**
+ * @description:
+ *     Read a little-endian number of some bytes.
+ */
+inline uint64_t readLittleEndian(const char *s, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = bytes; i > 0; --i) {
+        value = value << 8 | static_cast<unsigned char>(s[i - 1]);
+    }
+    return value;
+}
+
+/**
+ * @description:
+ *     Decode a LEB128 number already checked to be well formed.
+ */
+inline size_t decodeNumber(const char *&s) {
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        unsigned char byte = static_cast<unsigned char>(*s++);
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+}
+
+/**
+ * @description:
+ *     A cursor over the body of a snapshot, every read is checked against
+ *     the end.
+ */
+class Reader {
+public:
+    Reader(const char *data, const char *end) : pos_(data), end_(end) {}
+
+    const char *position() const { return pos_; }
+    bool atEnd() const { return pos_ == end_; }
+    size_t remaining() const { return end_ - pos_; }
+
+    bool readByte(uint8_t &byte) {
+        if (pos_ == end_)
+            return false;
+        byte = static_cast<uint8_t>(*pos_++);
+        return true;
+    }
+
+    // A number of up to 64 bits, an overlong encoding is malformed.
+    bool readNumber(size_t &value) {
+        uint64_t result = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte;
+            if (!readByte(byte))
+                return false;
+            result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                if (result > static_cast<size_t>(-1))
+                    return false;
+                value = static_cast<size_t>(result);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readString(msg::StringView &s) {
+        size_t length;
+        if (!readNumber(length) || length > remaining())
+            return false;
+        s = msg::StringView(pos_, length);
+        pos_ += length;
+        return true;
+    }
+
+private:
+    const char *pos_;
+    const char *end_;
+};
+
+} // namespace
+
+namespace msg {
+const char SnapshotView::magic[4] = {'M', 'S', 'G', 'S'};
+const uint8_t SnapshotView::version;
+const size_t SnapshotView::headerLength;
+const size_t SnapshotView::trailerLength;
+
+// Public methods
+/**
+ * @description:
+ *     Decode a snapshot in place after its length, version and checksum
+ *     were checked. Header identifiers are trusted, they were interned by
+ *     the writer of the same format version.
+ * @param[in] data
+ *     A pointer to the snapshot, it must outlive the view.
+ * @param[in] length
+ *     The length of the buffer, it may hold more after the snapshot.
+ * @return:
+ *     An identicator of whether or not the snapshot was intact, the view
+ *     is cleared otherwise.
+ */
+bool SnapshotView::parse(const char *data, size_t length) {
+    clear();
+    if (decode(data, length))
+        return true;
+    clear();
+    return false;
+}
+
+/**
+ * @description:
+ *     Drop all decoded components, the memory of the table is kept.
+ */
+void SnapshotView::clear() {
+    length_ = 0;
+    startLine_.clear();
+    fields_.clear();
+    body_ = StringView();
+}
+
+/**
+ * @description:
+ *     Get the length of the snapshot, so snapshots written one after
+ *     another are read in turn.
+ * @return:
+ *     The number of bytes of the snapshot, zero if none was decoded.
+ */
+size_t SnapshotView::getLength() const { return length_; }
+
+/**
+ * @description:
+ *     Get the request or status line of the message.
+ * @return:
+ *     The start line, its type is None if the message has none.
+ */
+const StartLine &SnapshotView::getStartLine() const { return startLine_; }
+
+/**
+ * @description:
+ *     Get the number of headers.
+ * @return:
+ *     The number of headers, each repeated header is counted once.
+ */
+size_t SnapshotView::getHeaderCount() const { return fields_.size(); }
+
+/**
+ * @description:
+ *     Get a header by its position.
+ * @param[in] index
+ *     The position of the header.
+ * @return:
+ *     The identifier, the name and the combined value of the header.
+ */
+SnapshotView::Field SnapshotView::getHeader(size_t index) const {
+    const Entry &entry = fields_[index];
+    return Field{entry.id, entry.name, entry.value};
+}
+
+/**
+ * @description:
+ *     Count the fields of a header.
+ * @param[in] index
+ *     The position of the header.
+ * @return:
+ *     The number of fields combined into the value.
+ */
+size_t SnapshotView::getHeaderFieldCount(size_t index) const {
+    return fields_[index].boundaryCount + 1;
+}
+
+/**
+ * @description:
+ *     Get a field of a header without the separator combining it with the
+ *     others.
+ * @param[in] index
+ *     The position of the header.
+ * @param[in] field
+ *     The index of the field.
+ * @return:
+ *     A view of the field, empty if there is no such field.
+ */
+StringView SnapshotView::getHeaderField(size_t index, size_t field) const {
+    const Entry &entry = fields_[index];
+    if (field > entry.boundaryCount)
+        return StringView();
+    const char *boundary = entry.boundaries;
+    size_t begin = 0;
+    for (size_t i = 0; i < entry.boundaryCount; ++i) {
+        size_t end = decodeNumber(boundary);
+        if (i == field)
+            return entry.value.substr(begin, end - begin);
+        begin = decodeNumber(boundary);
+    }
+    return entry.value.substr(begin);
+}
+
+/**
+ * @description:
+ *     Get message body text.
+ * @return:
+ *     A view of the message body.
+ */
+StringView SnapshotView::getBody() const { return body_; }
+
+// Private methods
+/**
+ * @description:
+ *     Check the frame of a snapshot and decode its components.
+ * @param[in] data
+ *     A pointer to the snapshot.
+ * @param[in] length
+ *     The length of the buffer.
+ * @return:
+ *     An identicator of whether or not the snapshot was intact.
+ */
+bool SnapshotView::decode(const char *data, size_t length) {
+    if (length < headerLength + trailerLength ||
+        std::memcmp(data, magic, sizeof(magic)) != 0 ||
+        static_cast<uint8_t>(data[4]) != version || data[5] || data[6] ||
+        data[7])
+        return false;
+    uint64_t size = readLittleEndian(data + 8, 8);
+    if (size < headerLength + trailerLength || size > length)
+        return false;
+    const char *end = data + size - trailerLength;
+    if (readLittleEndian(end, trailerLength) !=
+        syntax::crc32c(data, size - trailerLength))
+        return false;
+
+    Reader reader(data + headerLength, end);
+    StringView text;
+    if (!reader.readString(text))
+        return false;
+    if (!text.empty() && !startLine_.parse(text.data(), text.size()))
+        return false;
+
+    size_t count;
+    // A header takes four bytes at least.
+    if (!reader.readNumber(count) || count > reader.remaining() / 4)
+        return false;
+    fields_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Entry entry;
+        uint8_t id;
+        if (!reader.readByte(id) ||
+            id >= static_cast<uint8_t>(HeaderId::Count) ||
+            !reader.readString(entry.name) || entry.name.empty() ||
+            !reader.readString(entry.value) ||
+            !reader.readNumber(entry.boundaryCount))
+            return false;
+        entry.id = static_cast<HeaderId>(id);
+        entry.boundaries = reader.position();
+
+        // Fields are in order and within the value.
+        size_t previous = 0;
+        for (size_t k = 0; k < entry.boundaryCount; ++k) {
+            size_t fieldEnd, fieldBegin;
+            if (!reader.readNumber(fieldEnd) ||
+                !reader.readNumber(fieldBegin) || fieldEnd < previous ||
+                fieldBegin < fieldEnd || fieldBegin > entry.value.size())
+                return false;
+            previous = fieldBegin;
+        }
+        fields_.push_back(entry);
+    }
+
+    if (!reader.readString(body_) || !reader.atEnd())
+        return false;
+    length_ = static_cast<size_t>(size);
+    return true;
+}
+
+} // namespace msg
@@ -0,0 +1,357 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-30 09:21:02
+ * @LastEditTime: 2019-08-30 09:21:02
+ * @Description: An implementation of class msg::StartLine.
+ */
+#include "Syntax.hpp"
+#include <cstring>
+#include <message/StartLine.hpp>
+
+namespace {
+const size_t methodCount = static_cast<size_t>(msg::Method::Count);
+
+// Names indexed by msg::Method.
+const char *const methodNames[methodCount] = {
+    "",        "ACK",     "BYE",   "CANCEL",   "CONNECT",   "DELETE",
+    "GET",     "HEAD",    "INFO",  "INVITE",   "MESSAGE",   "NOTIFY",
+    "OPTIONS", "PATCH",   "POST",  "PRACK",    "PUBLISH",   "PUT",
+    "REFER",   "REGISTER", "SUBSCRIBE", "TRACE", "UPDATE",
+};
+
+/**
+ * @description:
+ *     Check a token is a protocol version, which tells a start line from
+ *     a header field.
+ */
+bool isVersion(const char *s, size_t length) {
+    return (length > 5 && std::memcmp(s, "HTTP/", 5) == 0) ||
+           (length > 4 && std::memcmp(s, "SIP/", 4) == 0);
+}
+
+} // namespace
+
+namespace msg {
+/**
+ * @description:
+ *     Get the identifier of a method name by its length and first
+ *     character, then one compare.
+ * @param[in] methodName
+ *     A method name, compared case-sensitively.
+ * @return:
+ *     The identifier, Unknown if the method isn't well known.
+ */
+Method lookupMethod(StringView methodName) {
+    const char *s = methodName.data();
+    switch (methodName.size()) {
+    case 3:
+        switch (s[0]) {
+        case 'A':
+            return std::memcmp(s, "ACK", 3) ? Method::Unknown : Method::Ack;
+        case 'B':
+            return std::memcmp(s, "BYE", 3) ? Method::Unknown : Method::Bye;
+        case 'G':
+            return std::memcmp(s, "GET", 3) ? Method::Unknown : Method::Get;
+        case 'P':
+            return std::memcmp(s, "PUT", 3) ? Method::Unknown : Method::Put;
+        }
+        break;
+    case 4:
+        switch (s[0]) {
+        case 'H':
+            return std::memcmp(s, "HEAD", 4) ? Method::Unknown : Method::Head;
+        case 'I':
+            return std::memcmp(s, "INFO", 4) ? Method::Unknown : Method::Info;
+        case 'P':
+            return std::memcmp(s, "POST", 4) ? Method::Unknown : Method::Post;
+        }
+        break;
+    case 5:
+        switch (s[0]) {
+        case 'P':
+            if (std::memcmp(s, "PATCH", 5) == 0)
+                return Method::Patch;
+            return std::memcmp(s, "PRACK", 5) ? Method::Unknown
+                                               : Method::Prack;
+        case 'R':
+            return std::memcmp(s, "REFER", 5) ? Method::Unknown
+                                               : Method::Refer;
+        case 'T':
+            return std::memcmp(s, "TRACE", 5) ? Method::Unknown
+                                               : Method::Trace;
+        }
+        break;
+    case 6:
+        switch (s[0]) {
+        case 'C':
+            return std::memcmp(s, "CANCEL", 6) ? Method::Unknown
+                                                : Method::Cancel;
+        case 'D':
+            return std::memcmp(s, "DELETE", 6) ? Method::Unknown
+                                                : Method::Delete;
+        case 'I':
+            return std::memcmp(s, "INVITE", 6) ? Method::Unknown
+                                                : Method::Invite;
+        case 'N':
+            return std::memcmp(s, "NOTIFY", 6) ? Method::Unknown
+                                                : Method::Notify;
+        case 'U':
+            return std::memcmp(s, "UPDATE", 6) ? Method::Unknown
+                                                : Method::Update;
+        }
+        break;
+    case 7:
+        switch (s[0]) {
+        case 'C':
+            return std::memcmp(s, "CONNECT", 7) ? Method::Unknown
+                                                 : Method::Connect;
+        case 'M':
+            return std::memcmp(s, "MESSAGE", 7) ? Method::Unknown
+                                                 : Method::Message;
+        case 'O':
+            return std::memcmp(s, "OPTIONS", 7) ? Method::Unknown
+                                                 : Method::Options;
+        case 'P':
+            return std::memcmp(s, "PUBLISH", 7) ? Method::Unknown
+                                                 : Method::Publish;
+        }
+        break;
+    case 8:
+        return std::memcmp(s, "REGISTER", 8) ? Method::Unknown
+                                              : Method::Register;
+    case 9:
+        return std::memcmp(s, "SUBSCRIBE", 9) ? Method::Unknown
+                                               : Method::Subscribe;
+    }
+    return Method::Unknown;
+}
+
+/**
+ * @description:
+ *     Get the name of a method.
+ * @param[in] method
+ *     The identifier of a method.
+ * @return:
+ *     The name, empty for Unknown.
+ */
+StringView getMethodName(Method method) {
+    size_t id = static_cast<size_t>(method);
+    if (id >= methodCount)
+        return StringView();
+    return methodNames[id];
+}
+
+// Public methods
+/**
+ * @description:
+ *     Parse a request line or a status line. A line parsed as neither
+ *     leaves the start line cleared.
+ * @param[in] line
+ *     A pointer to the line without the line terminator.
+ * @param[in] length
+ *     The length of the line.
+ * @return:
+ *     An indicator of whether or not the line was a start line.
+ */
+bool StartLine::parse(const char *line, size_t length) {
+    clear();
+    if (length > UINT32_MAX)
+        return false;
+    syntax::LineScan scan = syntax::scanLine(line, length);
+    if (scan.end != length || !scan.clean)
+        return false;
+
+    const char *end = line + length;
+    const char *firstEnd =
+        static_cast<const char *>(std::memchr(line, ' ', length));
+    if (!firstEnd || firstEnd == line)
+        return false;
+    const char *second = firstEnd + 1;
+    const char *secondEnd = static_cast<const char *>(
+        std::memchr(second, ' ', end - second));
+
+    if (isVersion(line, firstEnd - line)) { // VERSION code [reason]
+        const char *codeEnd = secondEnd ? secondEnd : end;
+        if (codeEnd - second != 3)
+            return false;
+        unsigned code = 0;
+        for (const char *digit = second; digit != codeEnd; ++digit) {
+            if (*digit < '0' || *digit > '9')
+                return false;
+            code = code * 10 + (*digit - '0');
+        }
+        if (code < 100)
+            return false;
+        type_ = Type::Status;
+        statusCode_ = code;
+    } else { // METHOD target VERSION
+        if (!secondEnd || secondEnd == second ||
+            !syntax::isValidName(line, firstEnd - line) ||
+            !isVersion(secondEnd + 1, end - secondEnd - 1) ||
+            std::memchr(secondEnd + 1, ' ', end - secondEnd - 1))
+            return false;
+        type_ = Type::Request;
+        method_ = lookupMethod(StringView(line, firstEnd - line));
+    }
+
+    text_.assign(line, length);
+    const char *thirdStart = secondEnd ? secondEnd + 1 : end;
+    const char *bounds[3][2] = {{line, firstEnd},
+                                {second, secondEnd ? secondEnd : end},
+                                {thirdStart, end}};
+    for (size_t i = 0; i < 3; ++i) {
+        parts_[i].offset = static_cast<uint32_t>(bounds[i][0] - line);
+        parts_[i].length = static_cast<uint32_t>(bounds[i][1] - bounds[i][0]);
+    }
+    return true;
+}
+
+/**
+ * @description:
+ *     Remove the start line, the memory of the text is kept.
+ */
+void StartLine::clear() {
+    text_.clear();
+    type_ = Type::None;
+    method_ = Method::Unknown;
+    statusCode_ = 0;
+    for (auto &part : parts_) {
+        part = Span();
+    }
+}
+
+/**
+ * @description:
+ *     Get the type of the start line.
+ * @return:
+ *     Request, Status or None if there is no start line.
+ */
+StartLine::Type StartLine::getType() const { return type_; }
+
+/**
+ * @description:
+ *     Get the method of a request.
+ * @return:
+ *     The identifier of the method, Unknown for an extension method or a
+ *     status line.
+ */
+Method StartLine::getMethod() const { return method_; }
+
+/**
+ * @description:
+ *     Get the method name of a request as it was received.
+ * @return:
+ *     The method name, empty for a status line.
+ */
+StringView StartLine::getMethodName() const {
+    return type_ == Type::Request ? resolve(parts_[0]) : StringView();
+}
+
+/**
+ * @description:
+ *     Get the request-target of a request, a Request-URI of SIP.
+ * @return:
+ *     The request-target, empty for a status line.
+ */
+StringView StartLine::getTarget() const {
+    return type_ == Type::Request ? resolve(parts_[1]) : StringView();
+}
+
+/**
+ * @description:
+ *     Get the protocol version, such as "HTTP/1.1" or "SIP/2.0".
+ * @return:
+ *     The protocol version, empty if there is no start line.
+ */
+StringView StartLine::getVersion() const {
+    return resolve(parts_[type_ == Type::Request ? 2 : 0]);
+}
+
+/**
+ * @description:
+ *     Get the status code of a status line.
+ * @return:
+ *     The status code, zero for a request line.
+ */
+unsigned StartLine::getStatusCode() const { return statusCode_; }
+
+/**
+ * @description:
+ *     Get the reason phrase of a status line.
+ * @return:
+ *     The reason phrase, empty for a request line.
+ */
+StringView StartLine::getReason() const {
+    return type_ == Type::Status ? resolve(parts_[2]) : StringView();
+}
+
+/**
+ * @description:
+ *     Get the whole start line without the line terminator.
+ * @return:
+ *     The text of the line, valid until the start line changes.
+ */
+StringView StartLine::getText() const { return text_; }
+
+/**
+ * @description:
+ *     Set a request line.
+ * @param[in] methodName
+ *     The method name.
+ * @param[in] target
+ *     The request-target.
+ * @param[in] version
+ *     The protocol version.
+ * @return:
+ *     An indicator of whether or not the parts made a valid request line,
+ *     the start line is cleared otherwise.
+ */
+bool StartLine::setRequest(StringView methodName, StringView target,
+                           StringView version) {
+    std::string line;
+    line.reserve(methodName.size() + target.size() + version.size() + 2);
+    line.append(methodName.data(), methodName.size())
+        .append(1, ' ')
+        .append(target.data(), target.size())
+        .append(1, ' ')
+        .append(version.data(), version.size());
+    return parse(line.data(), line.size());
+}
+
+/**
+ * @description:
+ *     Set a status line.
+ * @param[in] version
+ *     The protocol version.
+ * @param[in] statusCode
+ *     The status code of three digits.
+ * @param[in] reason
+ *     The reason phrase.
+ * @return:
+ *     An indicator of whether or not the parts made a valid status line,
+ *     the start line is cleared otherwise.
+ */
+bool StartLine::setStatus(StringView version, unsigned statusCode,
+                          StringView reason) {
+    std::string line;
+    line.reserve(version.size() + reason.size() + 5);
+    line.append(version.data(), version.size())
+        .append(1, ' ')
+        .append(std::to_string(statusCode))
+        .append(1, ' ')
+        .append(reason.data(), reason.size());
+    return parse(line.data(), line.size());
+}
+
+// Private methods
+/**
+ * @description:
+ *     Turn a span into a view of the text.
+ */
+StringView StartLine::resolve(const Span &span) const {
+    return StringView(text_.data() + span.offset, span.length);
+}
+
+} // namespace msg
@@ -0,0 +1,411 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 10:12:51
+ * @LastEditTime: 2019-09-05 21:04:37
+ * @Description: An implementation of parse error names, latency histograms
+ *     and snapshots of the instrumentation.
+ */
+#include "Instrument.hpp"
+#include <algorithm>
+#include <message/Stats.hpp>
+
+#if defined(MESSAGE_ENABLE_STATS)
+#include <mutex>
+#include <vector>
+#endif
+
+namespace {
+const char *const parseErrorNames[] = {
+    "none",
+    "bare_carriage_return",
+    "line_too_long",
+    "orphan_continuation",
+    "invalid_name",
+    "invalid_character",
+    "invalid_encoding",
+    "invalid_start_line",
+    "obsolete_folding",
+    "invalid_framing",
+    "too_many_headers",
+    "header_section_too_large",
+    "field_too_large",
+    "too_many_continuations",
+    "body_too_large",
+};
+const char *const counterNames[] = {
+    "messages", "bytes",          "headers", "unfolds",
+    "produced", "produced_bytes", "folds",
+};
+const char *const phaseNames[] = {
+    "parse", "split_lines", "validate", "unfold", "trim", "produce", "fold",
+};
+
+/**
+ * @description:
+ *     Get the name of an enumerator from a table of names, an enumerator
+ *     out of range has an empty name.
+ */
+template <typename Enum, size_t Size>
+msg::StringView getName(const char *const (&names)[Size], Enum value) {
+    static_assert(Size == static_cast<size_t>(Enum::Count),
+                  "Each enumerator needs a name.");
+    size_t index = static_cast<size_t>(value);
+    return index < Size ? msg::StringView(names[index]) : msg::StringView();
+}
+
+/**
+ * @description:
+ *     Get the position of the most significant set bit of a nonzero value.
+ */
+inline size_t getMostSignificantBit(uint64_t value) {
+    return 63 - __builtin_clzll(value);
+}
+
+#if defined(MESSAGE_ENABLE_STATS)
+using msg::stats::ThreadStats;
+
+/**
+ * @description:
+ *     The counters of all living threads and the totals of the exited.
+ *     The mutex is taken when a thread comes or goes and by snapshots,
+ *     never while counting.
+ */
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadStats *> threads;
+    uint64_t counters[static_cast<size_t>(msg::Counter::Count)] = {};
+    uint64_t rejects[static_cast<size_t>(msg::ParseError::Count)] = {};
+    msg::LatencyHistogram phases[static_cast<size_t>(msg::Phase::Count)];
+};
+
+Registry &getRegistry() {
+    // Leaked, threads may exit after static destruction began.
+    static Registry *registry = new Registry;
+    return *registry;
+}
+
+/**
+ * @description:
+ *     Add the counters of a thread to a snapshot.
+ */
+void collect(const ThreadStats &stats, uint64_t *counters, uint64_t *rejects,
+             msg::LatencyHistogram *phases) {
+    for (size_t i = 0; i < static_cast<size_t>(msg::Counter::Count); ++i)
+        counters[i] += stats.counters[i].load(std::memory_order_relaxed);
+    for (size_t i = 0; i < static_cast<size_t>(msg::ParseError::Count); ++i)
+        rejects[i] += stats.rejects[i].load(std::memory_order_relaxed);
+    for (size_t phase = 0; phase < static_cast<size_t>(msg::Phase::Count);
+         ++phase) {
+        for (size_t bucket = 0; bucket < msg::LatencyHistogram::bucketCount;
+             ++bucket) {
+            uint64_t count =
+                stats.phases[phase][bucket].load(std::memory_order_relaxed);
+            if (count) {
+                phases[phase].record(
+                    msg::LatencyHistogram::getBucketLimit(bucket), count);
+            }
+        }
+    }
+}
+
+/**
+ * @description:
+ *     Owns the counters of a thread, they are registered when it counts
+ *     first and folded into the retired totals when it exits.
+ */
+struct Holder {
+    ThreadStats stats;
+
+    Holder() {
+        Registry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.threads.push_back(&stats);
+    }
+    ~Holder();
+};
+
+// Counts of threads whose counters are gone, they are dropped.
+ThreadStats discarded;
+
+Holder::~Holder() {
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threads.erase(std::find(registry.threads.begin(),
+                                     registry.threads.end(), &stats));
+    collect(stats, registry.counters, registry.rejects, registry.phases);
+    msg::stats::current = &discarded;
+}
+#endif
+
+} // namespace
+
+namespace msg {
+#if defined(MESSAGE_ENABLE_STATS)
+namespace stats {
+thread_local ThreadStats *current = nullptr;
+std::atomic<uint32_t> sampleInterval(64);
+
+ThreadStats::ThreadStats() {
+    for (auto &counter : counters)
+        counter.store(0, std::memory_order_relaxed);
+    for (auto &counter : rejects)
+        counter.store(0, std::memory_order_relaxed);
+    for (auto &phase : phases) {
+        for (auto &bucket : phase)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @description:
+ *     Register the counters of the calling thread.
+ */
+ThreadStats *attach() {
+    thread_local Holder holder;
+    current = &holder.stats;
+    return current;
+}
+
+} // namespace stats
+#endif
+
+/**
+ * @description:
+ *     Get the name of a parse error as a metric label.
+ */
+StringView getParseErrorName(ParseError error) {
+    return getName(parseErrorNames, error);
+}
+
+/**
+ * @description:
+ *     Get the name of a counter as a metric label.
+ */
+StringView getCounterName(Counter counter) {
+    return getName(counterNames, counter);
+}
+
+/**
+ * @description:
+ *     Get the name of a phase as a metric label.
+ */
+StringView getPhaseName(Phase phase) { return getName(phaseNames, phase); }
+
+// Public methods
+/**
+ * @description:
+ *     Get the bucket of a value. Values below 16 have a bucket each, then
+ *     each power of two has 16 buckets.
+ * @param[in] value
+ *     A latency in nanoseconds.
+ * @return:
+ *     The index of the bucket.
+ */
+size_t LatencyHistogram::getBucket(uint64_t value) {
+    if (value < subBucketCount)
+        return static_cast<size_t>(value);
+    size_t shift = getMostSignificantBit(value) - 4;
+    size_t bucket = subBucketCount + shift * subBucketCount +
+                    static_cast<size_t>((value >> shift) - subBucketCount);
+    return std::min(bucket, bucketCount - 1);
+}
+
+/**
+ * @description:
+ *     Get the largest value of a bucket.
+ * @param[in] bucket
+ *     The index of the bucket.
+ * @return:
+ *     The largest value counted in the bucket.
+ */
+uint64_t LatencyHistogram::getBucketLimit(size_t bucket) {
+    if (bucket < subBucketCount)
+        return bucket;
+    if (bucket == bucketCount - 1)
+        return UINT64_MAX;
+    size_t shift = bucket / subBucketCount - 1;
+    uint64_t base = subBucketCount + bucket % subBucketCount;
+    return ((base + 1) << shift) - 1;
+}
+
+/**
+ * @description:
+ *     Count a value.
+ * @param[in] value
+ *     A latency in nanoseconds.
+ * @param[in] count
+ *     The number of times the value is counted.
+ */
+void LatencyHistogram::record(uint64_t value, uint64_t count) {
+    buckets_[getBucket(value)] += count;
+    count_ += count;
+}
+
+/**
+ * @description:
+ *     Add the counts of another histogram.
+ */
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+        buckets_[bucket] += other.buckets_[bucket];
+    count_ += other.count_;
+}
+
+/**
+ * @description:
+ *     Drop all counts.
+ */
+void LatencyHistogram::clear() {
+    std::fill(buckets_, buckets_ + bucketCount, 0);
+    count_ = 0;
+}
+
+/**
+ * @description:
+ *     Get the number of values counted.
+ */
+uint64_t LatencyHistogram::getCount() const { return count_; }
+
+/**
+ * @description:
+ *     Get the number of values counted in a bucket.
+ */
+uint64_t LatencyHistogram::getBucketCount(size_t bucket) const {
+    return bucket < bucketCount ? buckets_[bucket] : 0;
+}
+
+/**
+ * @description:
+ *     Get a percentile of the values counted.
+ * @param[in] percentile
+ *     The percentile from 0 to 100.
+ * @return:
+ *     The largest value of the bucket the percentile falls in, 0 if
+ *     nothing was counted.
+ */
+uint64_t LatencyHistogram::getPercentile(double percentile) const {
+    if (!count_)
+        return 0;
+    double rank = percentile / 100 * count_;
+    uint64_t target = rank < 1 ? 1 : static_cast<uint64_t>(rank + 0.5);
+    target = std::min(target, count_);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+        seen += buckets_[bucket];
+        if (seen >= target)
+            return getBucketLimit(bucket);
+    }
+    return getBucketLimit(bucketCount - 1);
+}
+
+/**
+ * @description:
+ *     Get the total of a counter.
+ */
+uint64_t StatsSnapshot::getCounter(Counter counter) const {
+    size_t index = static_cast<size_t>(counter);
+    return index < static_cast<size_t>(Counter::Count) ? counters_[index] : 0;
+}
+
+/**
+ * @description:
+ *     Get the number of messages rejected for a reason.
+ */
+uint64_t StatsSnapshot::getRejects(ParseError error) const {
+    size_t index = static_cast<size_t>(error);
+    return index < static_cast<size_t>(ParseError::Count) ? rejects_[index]
+                                                          : 0;
+}
+
+/**
+ * @description:
+ *     Get the latencies of a phase in nanoseconds.
+ */
+const LatencyHistogram &StatsSnapshot::getPhase(Phase phase) const {
+    size_t index = static_cast<size_t>(phase);
+    return phases_[index < static_cast<size_t>(Phase::Count) ? index : 0];
+}
+
+/**
+ * @description:
+ *     Drop all totals.
+ */
+void StatsSnapshot::clear() {
+    std::fill(counters_, counters_ + static_cast<size_t>(Counter::Count), 0);
+    std::fill(rejects_, rejects_ + static_cast<size_t>(ParseError::Count), 0);
+    for (auto &phase : phases_)
+        phase.clear();
+}
+
+/**
+ * @description:
+ *     Check if the instrumentation was compiled in.
+ */
+bool Stats::isEnabled() {
+#if defined(MESSAGE_ENABLE_STATS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @description:
+ *     Set how often phases are timed, it takes effect after the next
+ *     message timed by each thread.
+ * @param[in] interval
+ *     One of every interval messages is timed, none if it is 0.
+ */
+void Stats::setSampleInterval(uint32_t interval) {
+#if defined(MESSAGE_ENABLE_STATS)
+    stats::sampleInterval.store(interval, std::memory_order_relaxed);
+#else
+    (void)interval;
+#endif
+}
+
+/**
+ * @description:
+ *     Get how often phases are timed, one of every interval messages.
+ */
+uint32_t Stats::getSampleInterval() {
+#if defined(MESSAGE_ENABLE_STATS)
+    return stats::sampleInterval.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @description:
+ *     Merge the counters of all threads, the living ones keep counting
+ *     while they are read.
+ * @param[out] snapshot
+ *     The snapshot the totals are written to, it is empty if the
+ *     instrumentation wasn't compiled in.
+ */
+void Stats::takeSnapshot(StatsSnapshot &snapshot) {
+#if defined(MESSAGE_ENABLE_STATS)
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::copy(registry.counters,
+              registry.counters + static_cast<size_t>(Counter::Count),
+              snapshot.counters_);
+    std::copy(registry.rejects,
+              registry.rejects + static_cast<size_t>(ParseError::Count),
+              snapshot.rejects_);
+    std::copy(registry.phases,
+              registry.phases + static_cast<size_t>(Phase::Count),
+              snapshot.phases_);
+    for (const ThreadStats *stats : registry.threads) {
+        collect(*stats, snapshot.counters_, snapshot.rejects_,
+                snapshot.phases_);
+    }
+#else
+    snapshot.clear();
+#endif
+}
+
+} // namespace msg
@@ -0,0 +1,414 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-17 09:40:12
+ * @LastEditTime: 2019-09-05 18:10:37
+ * @Description: Character classes and field checks shared by the parsers.
+ */
+#include "Syntax.hpp"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MESSAGE_HAVE_AVX2 1
+#define MESSAGE_HAVE_SSE42 1
+#include <immintrin.h>
+#endif
+
+namespace msg {
+namespace syntax {
+
+CharTable::CharTable() {
+    for (int ch = 0; ch < 256; ++ch) {
+        unsigned char cls = 0;
+        if (ch >= 0x21 && ch <= 0x7E && ch != ':')
+            cls |= kFieldName;
+        if ((ch >= 0x20 && ch <= 0x7E) || ch == '\t')
+            cls |= kFieldValue;
+        if (ch == ' ' || (ch >= '\t' && ch <= '\r'))
+            cls |= kSpace;
+        bool alnum = (ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'Z') ||
+                     (ch >= 'a' && ch <= 'z');
+        if (alnum || (ch && std::strchr("!#$%&'*+-.^_`|~", ch)))
+            cls |= kToken;
+        if (alnum || (ch && std::strchr("-.!%*_+`'~", ch)))
+            cls |= kSipToken;
+        if ((cls & kFieldValue) || ch >= 0x80)
+            cls |= kFieldText;
+        classes[ch] = static_cast<unsigned char>(cls);
+        lower[ch] = static_cast<unsigned char>(
+            ch >= 'A' && ch <= 'Z' ? ch - 'A' + 'a' : ch);
+    }
+}
+
+const CharTable charTable;
+
+namespace {
+/**
+ * @description:
+ *     Scan the rest of a line byte by byte, continuing a scan of blocks.
+ * @param[in] s
+ *     A pointer to the line.
+ * @param[in] pos
+ *     The position the scan continues from.
+ * @param[in] length
+ *     The length of the line.
+ * @param[in] result
+ *     The colon and cleanness found before pos.
+ * @return:
+ *     The result of the whole line.
+ */
+inline LineScan scanTail(const char *s, size_t pos, size_t length,
+                         LineScan result) {
+    for (; pos < length; ++pos) {
+        char ch = s[pos];
+        if (ch == '\r')
+            break;
+        if (ch == ':' && result.colon == npos)
+            result.colon = pos;
+        if (!hasClass(ch, kFieldValue))
+            result.clean = false;
+    }
+    result.end = pos;
+    return result;
+}
+
+/**
+ * @description:
+ *     Fold the masks of a block into a scan result, bit i of a mask
+ *     stands for byte i of the block.
+ * @param[in] pos
+ *     The position of the block in the line.
+ * @param[in] crMask
+ *     CR characters of the block.
+ * @param[in] colonMask
+ *     Colon characters of the block.
+ * @param[in] badMask
+ *     Characters of the block which aren't field value characters.
+ * @param[in|out] result
+ *     The result of the line so far.
+ * @return:
+ *     An indicator of whether or not the block holds the end of the line.
+ */
+inline bool foldMasks(size_t pos, uint32_t crMask, uint32_t colonMask,
+                      uint32_t badMask, LineScan &result) {
+    if (crMask) {
+        // Only bytes before the CR belong to the line.
+        uint32_t before = (crMask & (0u - crMask)) - 1;
+        colonMask &= before;
+        badMask &= before;
+        result.end = pos + __builtin_ctz(crMask);
+    }
+    if (colonMask && result.colon == npos)
+        result.colon = pos + __builtin_ctz(colonMask);
+    if (badMask)
+        result.clean = false;
+    return crMask != 0;
+}
+
+/**
+ * @description:
+ *     Select the kernel of scanLine() by features of the CPU.
+ */
+LineScanner selectLineScanner() {
+    if (hasAvx2())
+        return scanLineAvx2;
+    if (hasSse2())
+        return scanLineSse2;
+    return scanLineScalar;
+}
+
+/**
+ * @description:
+ *     A lookup table of CRC-32C for one byte at a time, of the reflected
+ *     polynomial 0x82F63B78.
+ */
+struct Crc32cTable {
+    uint32_t values[256];
+
+    Crc32cTable() {
+        for (uint32_t byte = 0; byte < 256; ++byte) {
+            uint32_t crc = byte;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (crc & 1 ? 0x82F63B78u : 0);
+            }
+            values[byte] = crc;
+        }
+    }
+};
+
+const Crc32cTable crc32cTable;
+
+/**
+ * @description:
+ *     Select the kernel of crc32c() by features of the CPU.
+ */
+ChecksumKernel selectChecksumKernel() {
+    if (hasSse42())
+        return crc32cSse42;
+    return crc32cScalar;
+}
+
+} // namespace
+
+const LineScanner lineScanner = selectLineScanner();
+const ChecksumKernel checksumKernel = selectChecksumKernel();
+
+/**
+ * @description:
+ *     Scan a line byte by byte, the reference of the other kernels.
+ * @param[in] s
+ *     A pointer to the line.
+ * @param[in] length
+ *     The length of the buffer the line starts.
+ * @return:
+ *     The end, the first colon and the cleanness of the line.
+ */
+LineScan scanLineScalar(const char *s, size_t length) {
+    return scanTail(s, 0, length, LineScan{0, npos, true});
+}
+
+/**
+ * @description:
+ *     Scan a line 16 bytes at a time, CR, colon and invalid characters are
+ *     found by the same loads.
+ * @param[in] s
+ *     A pointer to the line.
+ * @param[in] length
+ *     The length of the buffer the line starts.
+ * @return:
+ *     The end, the first colon and the cleanness of the line.
+ */
+LineScan scanLineSse2(const char *s, size_t length) {
+    LineScan result{0, npos, true};
+    size_t pos = 0;
+#if defined(__SSE2__)
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i low = _mm_set1_epi8(0x1F);
+    const __m128i high = _mm_set1_epi8(0x7F);
+    const __m128i tab = _mm_set1_epi8('\t');
+    for (; pos + 16 <= length; pos += 16) {
+        __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + pos));
+        __m128i ok = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi8(block, low),
+                                                _mm_cmplt_epi8(block, high)),
+                                  _mm_cmpeq_epi8(block, tab));
+        uint32_t crMask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, cr));
+        uint32_t colonMask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, colon));
+        uint32_t badMask = ~_mm_movemask_epi8(ok) & 0xFFFFu;
+        if (foldMasks(pos, crMask, colonMask, badMask, result))
+            return result;
+    }
+#endif
+    return scanTail(s, pos, length, result);
+}
+
+/**
+ * @description:
+ *     Scan a line 32 bytes at a time, it's only called if the CPU
+ *     supports AVX2.
+ * @param[in] s
+ *     A pointer to the line.
+ * @param[in] length
+ *     The length of the buffer the line starts.
+ * @return:
+ *     The end, the first colon and the cleanness of the line.
+ */
+#if defined(MESSAGE_HAVE_AVX2)
+__attribute__((target("avx2")))
+#endif
+LineScan scanLineAvx2(const char *s, size_t length) {
+    LineScan result{0, npos, true};
+    size_t pos = 0;
+#if defined(MESSAGE_HAVE_AVX2)
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i low = _mm256_set1_epi8(0x1F);
+    const __m256i high = _mm256_set1_epi8(0x7F);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    for (; pos + 32 <= length; pos += 32) {
+        __m256i block =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + pos));
+        // Bytes above 0x7F are negative as signed, so they fail the first
+        // compare.
+        __m256i ok = _mm256_or_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi8(block, low),
+                             _mm256_cmpgt_epi8(high, block)),
+            _mm256_cmpeq_epi8(block, tab));
+        uint32_t crMask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, cr));
+        uint32_t colonMask =
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, colon));
+        uint32_t badMask = ~static_cast<uint32_t>(_mm256_movemask_epi8(ok));
+        if (foldMasks(pos, crMask, colonMask, badMask, result))
+            return result;
+    }
+#endif
+    return scanTail(s, pos, length, result);
+}
+
+/**
+ * @description:
+ *     Check the SSE2 kernel is built in, SSE2 is part of x86-64.
+ */
+bool hasSse2() {
+#if defined(__SSE2__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @description:
+ *     Check the CPU supports AVX2 at run time.
+ */
+bool hasAvx2() {
+#if defined(MESSAGE_HAVE_AVX2)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+/**
+ * @description:
+ *     Compute CRC-32C byte by byte, the reference of the other kernel.
+ * @param[in] crc
+ *     The checksum of the preceding buffers, zero for the first one.
+ * @param[in] s
+ *     A pointer to the buffer.
+ * @param[in] length
+ *     The length of the buffer.
+ * @return:
+ *     The checksum including the buffer.
+ */
+uint32_t crc32cScalar(uint32_t crc, const char *s, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) {
+        crc = crc32cTable.values[(crc ^ static_cast<unsigned char>(s[i])) &
+                                 0xFF] ^
+              (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * @description:
+ *     Compute CRC-32C 8 bytes at a time by the CRC32 instruction, it's
+ *     only called if the CPU supports SSE4.2.
+ * @param[in] crc
+ *     The checksum of the preceding buffers, zero for the first one.
+ * @param[in] s
+ *     A pointer to the buffer.
+ * @param[in] length
+ *     The length of the buffer.
+ * @return:
+ *     The checksum including the buffer.
+ */
+#if defined(MESSAGE_HAVE_SSE42)
+__attribute__((target("sse4.2")))
+#endif
+uint32_t crc32cSse42(uint32_t crc, const char *s, size_t length) {
+#if defined(MESSAGE_HAVE_SSE42)
+    crc = ~crc;
+    size_t pos = 0;
+#if defined(__x86_64__)
+    uint64_t wide = crc;
+    for (; pos + 8 <= length; pos += 8) {
+        uint64_t block;
+        std::memcpy(&block, s + pos, 8);
+        wide = _mm_crc32_u64(wide, block);
+    }
+    crc = static_cast<uint32_t>(wide);
+#endif
+    for (; pos < length; ++pos) {
+        crc = _mm_crc32_u8(crc, static_cast<unsigned char>(s[pos]));
+    }
+    return ~crc;
+#else
+    return crc32cScalar(crc, s, length);
+#endif
+}
+
+/**
+ * @description:
+ *     Check the CPU supports SSE4.2 at run time.
+ */
+bool hasSse42() {
+#if defined(MESSAGE_HAVE_SSE42)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return false;
+#endif
+}
+
+/**
+ * @description:
+ *     Check a string is a valid header name, which consists of
+ *     printable US-ASCII characters except colon.
+ * @param[in] s
+ *     A pointer to the string to be checked.
+ * @param[in] length
+ *     The length of the string.
+ * @return:
+ *     An indicator whether or not was valid is return.
+ */
+bool isValidName(const char *s, size_t length) {
+    return matchClass(s, length, kFieldName);
+}
+
+/**
+ * @description:
+ *     Compare two header names ignoring ASCII case, as field names of
+ *     HTTP, SIP and Internet Message Format are case-insensitive.
+ * @param[in] lhs
+ *     A pointer to the first name.
+ * @param[in] lhsLength
+ *     The length of the first name.
+ * @param[in] rhs
+ *     A pointer to the second name.
+ * @param[in] rhsLength
+ *     The length of the second name.
+ * @return:
+ *     An indicator whether or not the names are equal.
+ */
+bool equalsName(const char *lhs, size_t lhsLength, const char *rhs,
+                size_t rhsLength) {
+    if (lhsLength != rhsLength)
+        return false;
+    for (size_t i = 0; i < lhsLength; ++i) {
+        if (lhs[i] != rhs[i] && toLower(lhs[i]) != toLower(rhs[i]))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @description:
+ *     Hash a header name with FNV-1a over its case folded characters,
+ *     names equal by equalsName() have the same hash.
+ * @param[in] s
+ *     A pointer to the name.
+ * @param[in] length
+ *     The length of the name.
+ * @return:
+ *     The hash of the name.
+ */
+size_t hashName(const char *s, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(toLower(s[i]));
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+} // namespace syntax
+} // namespace msg
@@ -0,0 +1,147 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-17 09:40:12
+ * @LastEditTime: 2019-09-05 18:10:37
+ * @Description: Character classes and field checks shared by the parsers.
+ */
+#ifndef MESSAGE_SYNTAX_HPP
+#define MESSAGE_SYNTAX_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace msg {
+namespace syntax {
+
+/**
+ * @description:
+ *     Character classes of header fields, a byte may belong to several
+ *     classes at the same time.
+ */
+enum CharClass : unsigned char {
+    kFieldName = 0x01,  // Printable US-ASCII characters except colon.
+    kFieldValue = 0x02, // Printable US-ASCII characters and WSP characters.
+    kSpace = 0x04,      // Whitespace characters as std::isspace in C locale.
+    kToken = 0x08,      // Characters of an HTTP token, tchar of RFC 7230.
+    kSipToken = 0x10,   // Characters of a SIP token of RFC 3261.
+    kFieldText = 0x20,  // Field value characters and non-ASCII bytes.
+};
+
+/**
+ * @description:
+ *     A lookup table maps every byte to its character classes, so a field
+ *     can be validated by one load and one test per byte.
+ */
+struct CharTable {
+    unsigned char classes[256];
+    unsigned char lower[256]; // ASCII case folding.
+
+    CharTable();
+};
+
+extern const CharTable charTable;
+
+/**
+ * @description:
+ *     Check a character belongs to a character class.
+ */
+inline bool hasClass(char ch, CharClass cls) {
+    return (charTable.classes[static_cast<unsigned char>(ch)] & cls) != 0;
+}
+
+/**
+ * @description:
+ *     Check all characters of a string belong to a character class.
+ * @param[in] s
+ *     A pointer to the characters to be checked.
+ * @param[in] length
+ *     The number of characters to be checked.
+ * @param[in] cls
+ *     The character class every character should belong to.
+ * @return:
+ *     An indicator whether or not was valid is return.
+ */
+inline bool matchClass(const char *s, size_t length, CharClass cls) {
+    for (size_t i = 0; i < length; ++i) {
+        if (!hasClass(s[i], cls))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @description:
+ *     Check a character is a whitespace character.
+ */
+inline bool isSpace(char ch) { return hasClass(ch, kSpace); }
+
+/**
+ * @description:
+ *     Fold an ASCII character to lower case.
+ */
+inline char toLower(char ch) {
+    return static_cast<char>(charTable.lower[static_cast<unsigned char>(ch)]);
+}
+
+/**
+ * @description:
+ *     The result of scanning a line for its structure in one pass.
+ */
+struct LineScan {
+    size_t end;   // The position of the first CR, or the length.
+    size_t colon; // The position of the first colon before end, or npos.
+    bool clean;   // All characters before end are field value characters.
+};
+
+const size_t npos = static_cast<size_t>(-1);
+
+typedef LineScan (*LineScanner)(const char *s, size_t length);
+
+// Kernels of scanLine(), exposed to be compared with each other.
+LineScan scanLineScalar(const char *s, size_t length);
+LineScan scanLineSse2(const char *s, size_t length);
+LineScan scanLineAvx2(const char *s, size_t length);
+bool hasSse2();
+bool hasAvx2();
+
+extern const LineScanner lineScanner;
+
+/**
+ * @description:
+ *     Scan a line for its CR, colon and invalid characters by the widest
+ *     kernel the CPU supports.
+ */
+inline LineScan scanLine(const char *s, size_t length) {
+    return lineScanner(s, length);
+}
+
+typedef uint32_t (*ChecksumKernel)(uint32_t crc, const char *s,
+                                   size_t length);
+
+// Kernels of crc32c(), exposed to be compared with each other.
+uint32_t crc32cScalar(uint32_t crc, const char *s, size_t length);
+uint32_t crc32cSse42(uint32_t crc, const char *s, size_t length);
+bool hasSse42();
+
+extern const ChecksumKernel checksumKernel;
+
+/**
+ * @description:
+ *     Compute the CRC-32C (Castagnoli) of a buffer by the fastest kernel
+ *     the CPU supports, a running checksum continues over several buffers.
+ */
+inline uint32_t crc32c(const char *s, size_t length, uint32_t crc = 0) {
+    return checksumKernel(crc, s, length);
+}
+
+bool isValidName(const char *s, size_t length);
+bool equalsName(const char *lhs, size_t lhsLength, const char *rhs,
+                size_t rhsLength);
+size_t hashName(const char *s, size_t length);
+
+} // namespace syntax
+} // namespace msg
+
+#endif // MESSAGE_SYNTAX_HPP
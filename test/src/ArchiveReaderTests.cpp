@@ -0,0 +1,172 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-28 14:21:50
+ * @LastEditTime: 2019-09-06 11:09:52
+ * @Description: Unittests of class msg::ArchiveReader.
+ */
+#include <atomic>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <message/ArchiveReader.hpp>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+/**
+ * @description:
+ *     A temporary file removed when it goes out of scope.
+ */
+class TempFile {
+public:
+    explicit TempFile(const std::string &content) {
+        char path[] = "/tmp/ArchiveReaderTestsXXXXXX";
+        int fd = mkstemp(path);
+        if (fd >= 0) {
+            ssize_t written = write(fd, content.data(), content.size());
+            (void)written;
+            close(fd);
+        }
+        path_ = path;
+    }
+    ~TempFile() { std::remove(path_.c_str()); }
+
+    const std::string &path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+} // namespace
+
+TEST(ArchiveReaderTests, ReadMbox) {
+    TempFile archive("From alice@example.com Mon Jan  1 00:00:00 2019\n"
+                     "From: Alice <alice@example.com>\n"
+                     "Subject: One\n"
+                     "\n"
+                     "Hello\n"
+                     ">From the body\n"
+                     "\n"
+                     "From bob@example.com Mon Jan  1 00:00:01 2019\n"
+                     "From: Bob <bob@example.com>\n"
+                     "Subject: Two\r\n"
+                     "\n"
+                     "Hi\n");
+
+    msg::ArchiveReader reader;
+    ASSERT_TRUE(reader.open(archive.path(), msg::ArchiveReader::Format::Mbox));
+    ASSERT_EQ(2u, reader.getMessageCount());
+    ASSERT_EQ("From: Alice <alice@example.com>\n"
+              "Subject: One\n"
+              "\n"
+              "Hello\n"
+              ">From the body\n",
+              reader.getRawMessage(0));
+
+    auto messages = reader.parseAll(4);
+    ASSERT_EQ(2u, messages.size());
+    ASSERT_EQ("One", messages[0].getHeaderValue("Subject"));
+    ASSERT_EQ("Hello\r\nFrom the body\r\n", messages[0].getBody());
+    ASSERT_EQ("Bob <bob@example.com>", messages[1].getHeaderValue("From"));
+    ASSERT_EQ("Two", messages[1].getHeaderValue("Subject"));
+    ASSERT_EQ("Hi\r\n", messages[1].getBody());
+}
+
+TEST(ArchiveReaderTests, KeepTheLinesOfMboxBodies) {
+    const std::string body = "Dear Bob,\r\n"
+                             "\r\n"
+                             "  The minutes are attached.\r\n"
+                             "From now on we meet on Mondays.\r\n"
+                             "\r\n"
+                             "Alice\r\n";
+    TempFile archive("From alice@example.com Mon Jan  1 00:00:00 2019\n"
+                     "From: Alice <alice@example.com>\n"
+                     "Subject: Minutes\n"
+                     "\n"
+                     "Dear Bob,\n"
+                     "\n"
+                     "  The minutes are attached.\n"
+                     ">From now on we meet on Mondays.\n"
+                     "\n"
+                     "Alice\n");
+
+    msg::ArchiveReader reader;
+    ASSERT_TRUE(reader.open(archive.path(), msg::ArchiveReader::Format::Mbox));
+    auto messages = reader.parseAll(1);
+    ASSERT_EQ(1u, messages.size());
+    ASSERT_EQ(body, messages[0].getBody());
+
+    // Produced and parsed again, the body is the same. The line terminator
+    // produced after the body isn't part of it.
+    std::string produced = messages[0].produceToMessage();
+    msg::Message again;
+    ASSERT_TRUE(again.parseFromMessage<msg::MailDialect>(
+        produced.data(), produced.size() - 2));
+    ASSERT_EQ("Minutes", again.getHeaderValue("Subject"));
+    ASSERT_EQ(body, again.getBody());
+}
+
+TEST(ArchiveReaderTests, ParseLengthPrefixedInParallel) {
+    std::string content;
+    for (int i = 0; i < 1000; ++i) {
+        std::string message = i % 100 == 99 ? "Ho st: x\r\n\r\n"
+                                            : "Call-ID: " + std::to_string(i) +
+                                                  "\r\n\r\nbody\r\n";
+        content += std::to_string(message.size()) + "\n" + message;
+    }
+    TempFile archive(content);
+
+    msg::ArchiveReader reader;
+    ASSERT_TRUE(reader.open(archive.path(),
+                            msg::ArchiveReader::Format::LengthPrefixed));
+    ASSERT_EQ(1000u, reader.getMessageCount());
+
+    for (size_t threadCount = 1; threadCount <= 8; ++threadCount) {
+        std::vector<std::atomic<int>> seen(1000);
+        size_t malformed = reader.parse(
+            [&seen](size_t index, msg::Message &message) {
+                if (message.getHeaderValue("Call-ID") == std::to_string(index))
+                    ++seen[index];
+            },
+            threadCount);
+        ASSERT_EQ(10u, malformed)
+            << ">>> Test is failed at " << threadCount << ". <<<";
+        for (size_t idx = 0; idx < seen.size(); ++idx) {
+            ASSERT_EQ(idx % 100 == 99 ? 0 : 1, seen[idx].load())
+                << ">>> Test is failed at " << threadCount << ", " << idx
+                << ". <<<";
+        }
+    }
+}
+
+TEST(ArchiveReaderTests, OpenInvalidArchive) {
+    struct TestCase {
+        std::string content;
+        msg::ArchiveReader::Format format;
+    };
+
+    std::vector<TestCase> testCases{
+        {"Subject: no From line\n\n", msg::ArchiveReader::Format::Mbox},
+        {"5\nabc", msg::ArchiveReader::Format::LengthPrefixed},
+        {"x\nabc", msg::ArchiveReader::Format::LengthPrefixed},
+        {"3abc", msg::ArchiveReader::Format::LengthPrefixed},
+        {"99999999999999999999999\n", msg::ArchiveReader::Format::LengthPrefixed},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        TempFile archive(testCase.content);
+        msg::ArchiveReader reader;
+        ASSERT_FALSE(reader.open(archive.path(), testCase.format))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(0u, reader.getMessageCount())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+
+    msg::ArchiveReader reader;
+    ASSERT_FALSE(reader.open("/nonexistent/archive",
+                             msg::ArchiveReader::Format::Mbox));
+}
@@ -0,0 +1,155 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 19:05:18
+ * @LastEditTime: 2019-09-05 19:05:18
+ * @Description: Conformance tests of the protocol dialects.
+ */
+#include <gtest/gtest.h>
+#include <message/Dialect.hpp>
+#include <message/Message.hpp>
+#include <message/MessageView.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+struct TestCase {
+    std::string rawMessage;
+    msg::ParseError expectedError;
+};
+
+/**
+ * @description:
+ *     Parse each case by a dialect into a view and a message, both must
+ *     agree with the expected error.
+ */
+template <typename Dialect>
+void checkConformance(const std::vector<TestCase> &testCases) {
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        const std::string &raw = testCase.rawMessage;
+        bool expected = testCase.expectedError == msg::ParseError::None;
+        msg::MessageView view;
+        ASSERT_EQ(expected, view.parse<Dialect>(raw.data(), raw.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.expectedError, view.getError())
+            << ">>> Test is failed at " << idx << ". <<<";
+
+        msg::Message msg;
+        ASSERT_EQ(expected,
+                  msg.parseFromMessage<Dialect>(raw.data(), raw.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.expectedError, msg.getParseError())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+} // namespace
+
+TEST(DialectTests, ConformToHttp) {
+    checkConformance<msg::HttpDialect>({
+        {"GET / HTTP/1.1\r\nHost: a\r\n\r\n", msg::ParseError::None},
+        {"HTTP/1.0 200 OK\r\nX-Id!#$%&'*+.^_`|~: a\r\n\r\n",
+         msg::ParseError::None},
+        // obs-text is allowed in values.
+        {"HTTP/1.1 200 OK\r\nTitle: caf\xc3\xa9\r\n\r\n",
+         msg::ParseError::None},
+        {"Host: a\r\n\r\n", msg::ParseError::InvalidStartLine},
+        {"\r\nbody", msg::ParseError::InvalidStartLine},
+        {"", msg::ParseError::InvalidStartLine},
+        {"INVITE sip:bob@b.com SIP/2.0\r\n\r\n",
+         msg::ParseError::InvalidStartLine},
+        {"GET / HTTP/1.1\r\nSubject: a\r\n b\r\n\r\n",
+         msg::ParseError::ObsoleteFolding},
+        {"GET / HTTP/1.1\r\nHost : a\r\n\r\n", msg::ParseError::InvalidName},
+        {"GET / HTTP/1.1\r\nHost\r\n\r\n", msg::ParseError::InvalidName},
+        {"GET / HTTP/1.1\r\n: a\r\n\r\n", msg::ParseError::InvalidName},
+        {"GET / HTTP/1.1\r\nA/B: a\r\n\r\n", msg::ParseError::InvalidName},
+        {"GET / HTTP/1.1\r\nHost: a\x01\r\n\r\n",
+         msg::ParseError::InvalidCharacter},
+    });
+}
+
+TEST(DialectTests, ConformToSip) {
+    checkConformance<msg::SipDialect>({
+        {"INVITE sip:bob@b.com SIP/2.0\r\nf: a\r\n\r\n",
+         msg::ParseError::None},
+        {"SIP/2.0 180 Ringing\r\nSubject : a\r\n\tb\r\n\r\n",
+         msg::ParseError::None},
+        {"SIP/2.0 200 OK\r\nSubject: caf\xc3\xa9\r\n\r\n",
+         msg::ParseError::None},
+        {"GET / HTTP/1.1\r\n\r\n", msg::ParseError::InvalidStartLine},
+        {"f: a\r\n\r\n", msg::ParseError::InvalidStartLine},
+        {"SIP/2.0 200 OK\r\nA#B: a\r\n\r\n", msg::ParseError::InvalidName},
+        {"SIP/2.0 200 OK\r\nHost\r\n\r\n", msg::ParseError::InvalidName},
+        {"SIP/2.0 200 OK\r\nHost: a\x7f\r\n\r\n",
+         msg::ParseError::InvalidCharacter},
+    });
+}
+
+TEST(DialectTests, ConformToMail) {
+    std::string longest(998 - 9, 'x');
+    checkConformance<msg::MailDialect>({
+        {"From: a@b.com\r\nSubject: a\r\n b\r\n\r\nHi\r\n",
+         msg::ParseError::None},
+        {"Subject : a\r\n\r\n", msg::ParseError::None},
+        {"Subject: " + longest + "\r\n\r\n", msg::ParseError::None},
+        {"Subject: " + longest + "x\r\n\r\n", msg::ParseError::LineTooLong},
+        {"Subject: a\r\n\r\n" + longest + longest + "\r\n",
+         msg::ParseError::LineTooLong},
+        // A start line is a header with an invalid name.
+        {"GET / HTTP/1.1\r\n\r\n", msg::ParseError::InvalidName},
+        {" a\r\n\r\n", msg::ParseError::OrphanContinuation},
+        {"Subject: caf\xc3\xa9\r\n\r\n", msg::ParseError::InvalidCharacter},
+    });
+}
+
+TEST(DialectTests, KeepTheSemanticsOfEachProtocol) {
+    const std::string rawHttp = "HTTP/1.1 200 OK\r\n"
+                                "f: not a compact form\r\n"
+                                "Vary: a\r\n"
+                                "Vary: b\r\n"
+                                "\r\n"
+                                " line one\r\n"
+                                "line two\r\n";
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage<msg::HttpDialect>(rawHttp.data(),
+                                                       rawHttp.size()));
+    ASSERT_FALSE(msg.hasHeader(msg::HeaderId::From));
+    ASSERT_EQ("not a compact form", msg.getHeaderValue("f"));
+    ASSERT_EQ(" line one\r\nline two\r\n", msg.getBody());
+    ASSERT_EQ(std::string::npos, msg.produceToMessage().find("Vary: b"));
+
+    // Generic parses join the body and take compact forms as before.
+    msg::Message generic;
+    ASSERT_TRUE(generic.parseFromMessage(rawHttp));
+    ASSERT_EQ("not a compact form",
+              generic.getHeaderValue(msg::HeaderId::From));
+    ASSERT_EQ("line oneline two", generic.getBody());
+
+    const std::string rawSip = "INVITE sip:bob@b.com SIP/2.0\r\n"
+                               "f: Alice <sip:a@a.com>\r\n"
+                               "\r\n";
+    msg.reset();
+    ASSERT_TRUE(
+        msg.parseFromMessage<msg::SipDialect>(rawSip.data(), rawSip.size()));
+    ASSERT_EQ("Alice <sip:a@a.com>", msg.getHeaderValue(msg::HeaderId::From));
+    msg::MessageView view;
+    ASSERT_TRUE(view.parse<msg::SipDialect>(rawSip.data(), rawSip.size()));
+    ASSERT_EQ("Alice <sip:a@a.com>", view.getHeaderValue(msg::HeaderId::From));
+    ASSERT_TRUE(view.parse<msg::MailDialect>(rawSip.data() + 30,
+                                             rawSip.size() - 30));
+    ASSERT_TRUE(view.getHeaderValue(msg::HeaderId::From).empty());
+
+    // Repeated mail fields aren't lists, they are produced apart.
+    const std::string rawMail = "Received: from a\r\n"
+                                "Received: from b\r\n"
+                                "\r\n";
+    msg.reset();
+    ASSERT_TRUE(msg.parseFromMessage<msg::MailDialect>(rawMail.data(),
+                                                       rawMail.size()));
+    ASSERT_EQ(2u, msg.getHeaderFieldCount(msg::HeaderId::Received));
+    ASSERT_EQ(rawMail, msg.produceToMessage());
+}
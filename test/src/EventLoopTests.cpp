@@ -0,0 +1,126 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 16:40:26
+ * @LastEditTime: 2019-09-06 09:41:12
+ * @Description: Unittests of class msg::EventLoop.
+ */
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <message/EventLoop.hpp>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+TEST(EventLoopTests, DispatchReadAndWriteHandlers) {
+    msg::EventLoop loop;
+    ASSERT_TRUE(loop.isOpen());
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+
+    int reads = 0;
+    int writes = 0;
+    ASSERT_TRUE(loop.setReadHandler(fds[0], [&reads]() { ++reads; }));
+    ASSERT_TRUE(loop.setWriteHandler(fds[0], [&loop, &writes, &fds]() {
+        ++writes;
+        loop.setWriteHandler(fds[0], msg::EventLoop::Handler());
+    }));
+    ASSERT_EQ(1u, loop.getWatchCount());
+    ASSERT_EQ(1u, loop.runOnce(0));
+    ASSERT_EQ(0, reads);
+    ASSERT_EQ(1, writes);
+    ASSERT_EQ(0u, loop.runOnce(0));
+
+    ASSERT_EQ(1, write(fds[1], "x", 1));
+    ASSERT_EQ(1u, loop.runOnce(0));
+    ASSERT_EQ(1, reads);
+    ASSERT_EQ(1, writes);
+
+    ASSERT_TRUE(loop.setReadHandler(fds[0], msg::EventLoop::Handler()));
+    ASSERT_EQ(0u, loop.getWatchCount());
+    ASSERT_EQ(0u, loop.runOnce(0));
+    loop.run(); // Returns as nothing is watched.
+    ASSERT_FALSE(loop.setReadHandler(-1, [] {}));
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(EventLoopTests, DropEventsOfRemovedDescriptors) {
+    msg::EventLoop loop;
+    int first[2];
+    int second[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, first));
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, second));
+    ASSERT_EQ(1, write(first[1], "x", 1));
+    ASSERT_EQ(1, write(second[1], "x", 1));
+
+    // Whichever handler runs first removes the other, which must not run
+    // in the same round though its event is ready.
+    int calls = 0;
+    auto removeOther = [&](int other) {
+        return [&, other]() {
+            ++calls;
+            loop.setReadHandler(other, msg::EventLoop::Handler());
+        };
+    };
+    loop.setReadHandler(first[0], removeOther(second[0]));
+    loop.setReadHandler(second[0], removeOther(first[0]));
+    ASSERT_EQ(2u, loop.runOnce(0));
+    ASSERT_EQ(1, calls);
+    ASSERT_EQ(1u, loop.getWatchCount());
+
+    // stop() ends run() after the round at hand.
+    loop.setReadHandler(first[0], msg::EventLoop::Handler());
+    loop.setReadHandler(second[0], msg::EventLoop::Handler());
+    loop.setReadHandler(first[0], [&loop, &calls]() {
+        ++calls;
+        loop.stop();
+    });
+    loop.run();
+    ASSERT_EQ(2, calls);
+    for (int fd : {first[0], first[1], second[0], second[1]})
+        close(fd);
+}
+
+TEST(EventLoopTests, RegisterDescriptorsFromHandlers) {
+    msg::EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+    ASSERT_EQ(1, write(fds[1], "x", 1));
+
+    // The handler registers descriptors far above its own, then uses its
+    // capture, which must still be there. One pointer is small enough to
+    // be kept inside the handler rather than beside it.
+    struct State {
+        msg::EventLoop *loop;
+        int fd;
+        std::vector<int> added;
+        int calls;
+    } state{&loop, fds[0], {}, 0};
+    State *captured = &state;
+    ASSERT_TRUE(loop.setReadHandler(fds[0], [captured]() {
+        for (int i = 0; i < 4; ++i) {
+            int fd = fcntl(captured->fd, F_DUPFD, 256 + 256 * i);
+            ASSERT_LE(0, fd);
+            captured->added.push_back(fd);
+            ASSERT_TRUE(captured->loop->setWriteHandler(
+                fd, [captured]() { ++captured->calls; }));
+        }
+        ++captured->calls;
+        captured->loop->setReadHandler(captured->fd,
+                                       msg::EventLoop::Handler());
+    }));
+    ASSERT_EQ(1u, loop.runOnce(0));
+    ASSERT_EQ(1, state.calls);
+    ASSERT_EQ(4u, loop.getWatchCount());
+    ASSERT_EQ(4u, loop.runOnce(0));
+    ASSERT_EQ(5, state.calls);
+
+    for (int fd : state.added) {
+        loop.setWriteHandler(fd, msg::EventLoop::Handler());
+        close(fd);
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-01 11:20:43
+ * @LastEditTime: 2019-09-01 11:20:43
+ * @Description: Unittests of class msg::HeaderList.
+ */
+#include <gtest/gtest.h>
+#include <message/HeaderList.hpp>
+#include <string>
+#include <vector>
+
+TEST(HeaderListTests, SplitListElements) {
+    struct TestCase {
+        std::string headerValue;
+        std::vector<std::string> expectedElements;
+    };
+    std::vector<TestCase> testCases{
+        {"", {}},
+        {" , ,", {}},
+        {"gzip", {"gzip"}},
+        {"SIP/2.0/UDP a.example.com;branch=z9hG4bK1, SIP/2.0/TCP b.example.com",
+         {"SIP/2.0/UDP a.example.com;branch=z9hG4bK1",
+          "SIP/2.0/TCP b.example.com"}},
+        {"a,,b ,\t c", {"a", "b", "c"}},
+        {"\"Bob, Jr.\" <sip:bob@biloxi.com>, <sip:carol@chicago.com>",
+         {"\"Bob, Jr.\" <sip:bob@biloxi.com>", "<sip:carol@chicago.com>"}},
+        {"\"a \\\", b\", c", {"\"a \\\", b\"", "c"}},
+        {"Mozilla/5.0 (X11; Linux, x86_64), curl (a (b, c) d)",
+         {"Mozilla/5.0 (X11; Linux, x86_64)", "curl (a (b, c) d)"}},
+        {"x (\\), y) z, w", {"x (\\), y) z", "w"}},
+        {"\"a\" (b) \"c, d\", e", {"\"a\" (b) \"c, d\"", "e"}},
+        {"\"a\" (b) \"c, d\", e", {"\"a\" (b) \"c, d\"", "e"}},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::HeaderList list(testCase.headerValue);
+        std::vector<std::string> elements;
+        for (msg::StringView element : list) {
+            elements.push_back(element.toString());
+        }
+        ASSERT_EQ(testCase.expectedElements, elements)
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.expectedElements.size(), list.size())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(HeaderListTests, ElementsReferenceValue) {
+    std::string headerValue = "a, b";
+    msg::HeaderList list(headerValue);
+    auto it = list.begin();
+    ASSERT_EQ(headerValue.data(), it->data());
+    ASSERT_EQ(headerValue.data() + 3, (++it)->data());
+    ASSERT_TRUE(++it == list.end());
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-21 11:40:26
+ * @LastEditTime: 2019-08-21 11:40:26
+ * @Description: Unittests of well-known header names.
+ */
+#include <gtest/gtest.h>
+#include <message/HeaderNames.hpp>
+#include <string>
+#include <vector>
+
+TEST(HeaderNamesTests, LookupCanonicalNames) {
+    for (size_t id = 1; id < static_cast<size_t>(msg::HeaderId::Count); ++id) {
+        auto headerId = static_cast<msg::HeaderId>(id);
+        auto name = msg::getHeaderName(headerId);
+        ASSERT_FALSE(name.empty()) << ">>> Test is failed at " << id << ". <<<";
+        ASSERT_EQ(headerId, msg::lookupHeaderId(name))
+            << ">>> Test is failed at " << id << ". <<<";
+    }
+}
+
+TEST(HeaderNamesTests, LookupNamesCaseInsensitively) {
+    struct TestCase {
+        std::string name;
+        msg::HeaderId expectedId;
+    };
+
+    std::vector<TestCase> testCases{
+        {"content-length", msg::HeaderId::ContentLength},
+        {"CALL-ID", msg::HeaderId::CallId},
+        {"cseq", msg::HeaderId::CSeq},
+        {"Www-Authenticate", msg::HeaderId::WwwAuthenticate},
+        {"X-Data", msg::HeaderId::Unknown},
+        {"Content-Lengths", msg::HeaderId::Unknown},
+        {"", msg::HeaderId::Unknown},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        ASSERT_EQ(testCase.expectedId, msg::lookupHeaderId(testCase.name))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(HeaderNamesTests, LookupSipCompactForms) {
+    struct TestCase {
+        std::string name;
+        msg::HeaderId expectedId;
+    };
+
+    std::vector<TestCase> testCases{
+        {"v", msg::HeaderId::Via},           {"i", msg::HeaderId::CallId},
+        {"l", msg::HeaderId::ContentLength}, {"f", msg::HeaderId::From},
+        {"T", msg::HeaderId::To},            {"m", msg::HeaderId::Contact},
+        {"c", msg::HeaderId::ContentType},   {"k", msg::HeaderId::Supported},
+        {"z", msg::HeaderId::Unknown},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        ASSERT_EQ(testCase.expectedId, msg::lookupHeaderId(testCase.name))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
@@ -0,0 +1,275 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-03 15:10:44
+ * @LastEditTime: 2019-09-03 15:10:44
+ * @Description: Unittests of HPACK header compression.
+ */
+#include <gtest/gtest.h>
+#include <message/Hpack.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+typedef std::vector<std::pair<std::string, std::string>> Fields;
+
+std::string fromHex(const std::string &hex) {
+    std::string bytes;
+    for (size_t i = 0; i + 1 < hex.size();) {
+        if (hex[i] == ' ') {
+            ++i;
+            continue;
+        }
+        bytes.append(1, static_cast<char>(std::stoi(hex.substr(i, 2), 0, 16)));
+        i += 2;
+    }
+    return bytes;
+}
+
+bool decode(msg::HpackDecoder &decoder, const std::string &block,
+            Fields &fields) {
+    fields.clear();
+    return decoder.decode(block.data(), block.size(),
+                          [&fields](msg::StringView name,
+                                    msg::StringView value) {
+                              fields.emplace_back(name.toString(),
+                                                  value.toString());
+                          });
+}
+
+} // namespace
+
+TEST(HpackTests, DecodeRequestExamples) {
+    struct TestCase {
+        std::string block;
+        Fields expectedFields;
+        size_t expectedTableSize;
+    };
+    // RFC 7541 C.3 without and C.4 with Huffman coding.
+    std::vector<std::vector<TestCase>> connections{
+        {{"8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d",
+          {{":method", "GET"},
+           {":scheme", "http"},
+           {":path", "/"},
+           {":authority", "www.example.com"}},
+          57},
+         {"8286 84be 5808 6e6f 2d63 6163 6865",
+          {{":method", "GET"},
+           {":scheme", "http"},
+           {":path", "/"},
+           {":authority", "www.example.com"},
+           {"cache-control", "no-cache"}},
+          110},
+         {"8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661 "
+          "6c75 65",
+          {{":method", "GET"},
+           {":scheme", "https"},
+           {":path", "/index.html"},
+           {":authority", "www.example.com"},
+           {"custom-key", "custom-value"}},
+          164}},
+        {{"8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff",
+          {{":method", "GET"},
+           {":scheme", "http"},
+           {":path", "/"},
+           {":authority", "www.example.com"}},
+          57},
+         {"8286 84be 5886 a8eb 1064 9cbf",
+          {{":method", "GET"},
+           {":scheme", "http"},
+           {":path", "/"},
+           {":authority", "www.example.com"},
+           {"cache-control", "no-cache"}},
+          110},
+         {"8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf",
+          {{":method", "GET"},
+           {":scheme", "https"},
+           {":path", "/index.html"},
+           {":authority", "www.example.com"},
+           {"custom-key", "custom-value"}},
+          164}},
+    };
+
+    size_t idx = 0;
+    for (const auto &connection : connections) {
+        msg::HpackDecoder decoder;
+        for (const auto &testCase : connection) {
+            Fields fields;
+            ASSERT_TRUE(decode(decoder, fromHex(testCase.block), fields))
+                << ">>> Test is failed at " << idx << ". <<<";
+            ASSERT_EQ(testCase.expectedFields, fields)
+                << ">>> Test is failed at " << idx << ". <<<";
+            ASSERT_EQ(testCase.expectedTableSize, decoder.getTable().getSize())
+                << ">>> Test is failed at " << idx << ". <<<";
+            ++idx;
+        }
+    }
+}
+
+TEST(HpackTests, DecodeResponseExamplesWithEviction) {
+    // RFC 7541 C.6, the table holds 256 bytes.
+    std::vector<std::string> blocks{
+        "4882 6402 5885 aec3 771a 4b61 96d0 7abe 9410 54d4 44a8 2005 9504 "
+        "0b81 66e0 82a6 2d1b ff6e 919d 29ad 1718 63c7 8f0b 97c8 e9ae 82ae "
+        "43d3",
+        "4883 640e ffc1 c0bf",
+        "88c1 6196 d07a be94 1054 d444 a820 0595 040b 8166 e084 a62d 1bff "
+        "c05a 839b d9ab 77ad 94e7 821d d7f2 e6c7 b335 dfdf cd5b 3960 d5af "
+        "2708 7f36 72c1 ab27 0fb5 291f 9587 3160 65c0 03ed 4ee5 b106 3d50 07",
+    };
+    std::vector<Fields> expectedFields{
+        {{":status", "302"},
+         {"cache-control", "private"},
+         {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+         {"location", "https://www.example.com"}},
+        {{":status", "307"},
+         {"cache-control", "private"},
+         {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+         {"location", "https://www.example.com"}},
+        {{":status", "200"},
+         {"cache-control", "private"},
+         {"date", "Mon, 21 Oct 2013 20:13:22 GMT"},
+         {"location", "https://www.example.com"},
+         {"content-encoding", "gzip"},
+         {"set-cookie",
+          "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"}},
+    };
+    std::vector<std::string> expectedBlocks{"3fe1 01" + blocks[0],
+                                            "4803 3330 37c1 c0bf", blocks[2]};
+    std::vector<size_t> expectedCounts{4, 4, 3};
+    std::vector<size_t> expectedSizes{222, 222, 215};
+
+    msg::HpackDecoder decoder;
+    decoder.setMaxTableSize(256);
+    msg::HpackEncoder encoder;
+    encoder.setMaxTableSize(256);
+    for (size_t idx = 0; idx < blocks.size(); ++idx) {
+        Fields fields;
+        ASSERT_TRUE(decode(decoder, fromHex(blocks[idx]), fields))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(expectedFields[idx], fields)
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(expectedCounts[idx], decoder.getTable().getCount())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(expectedSizes[idx], decoder.getTable().getSize())
+            << ">>> Test is failed at " << idx << ". <<<";
+
+        // The encoder makes the same choices after announcing the size,
+        // but keeps "307" raw as Huffman coding saves nothing.
+        std::string block;
+        encoder.startBlock(block);
+        for (const auto &field : fields) {
+            encoder.encodeField(field.first, field.second, block);
+        }
+        ASSERT_EQ(fromHex(expectedBlocks[idx]), block)
+            << ">>> Test is failed at " << idx << ". <<<";
+    }
+}
+
+TEST(HpackTests, EncodeRequestExamples) {
+    std::vector<Fields> requests{
+        {{":method", "GET"},
+         {":scheme", "http"},
+         {":path", "/"},
+         {":authority", "www.example.com"}},
+        {{":method", "GET"},
+         {":scheme", "http"},
+         {":path", "/"},
+         {":authority", "www.example.com"},
+         {"Cache-Control", "no-cache"}},
+        {{":method", "GET"},
+         {":scheme", "https"},
+         {":path", "/index.html"},
+         {":authority", "www.example.com"},
+         {"custom-key", "custom-value"}},
+    };
+    // RFC 7541 C.4, names are lowercased.
+    std::vector<std::string> expectedBlocks{
+        "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff",
+        "8286 84be 5886 a8eb 1064 9cbf",
+        "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf",
+    };
+
+    msg::HpackEncoder encoder;
+    for (size_t idx = 0; idx < requests.size(); ++idx) {
+        std::string block;
+        encoder.startBlock(block);
+        for (const auto &field : requests[idx]) {
+            encoder.encodeField(field.first, field.second, block);
+        }
+        ASSERT_EQ(fromHex(expectedBlocks[idx]), block)
+            << ">>> Test is failed at " << idx << ". <<<";
+    }
+    ASSERT_EQ(164u, encoder.getTable().getSize());
+}
+
+TEST(HpackTests, RoundTripAllOctets) {
+    msg::HpackEncoder encoder;
+    msg::HpackDecoder decoder;
+    // Long runs of a short code make every value Huffman coded.
+    for (int idx = 0; idx < 256; ++idx) {
+        std::string value(16, 'a');
+        value.append(1, static_cast<char>(idx)).append(16, 'e');
+        std::string block;
+        encoder.encodeField("x-octet", value, block, true);
+        size_t valuePos = 2 + (block[1] & 0x7F);
+        ASSERT_TRUE(static_cast<unsigned char>(block[valuePos]) & 0x80)
+            << ">>> Test is failed at " << idx << ". <<<";
+        Fields fields;
+        ASSERT_TRUE(decode(decoder, block, fields))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(Fields({{"x-octet", value}}), fields)
+            << ">>> Test is failed at " << idx << ". <<<";
+    }
+    ASSERT_EQ(0u, decoder.getTable().getCount());
+}
+
+TEST(HpackTests, KeepSensitiveAndLargeFieldsOutOfTable) {
+    msg::HpackEncoder encoder;
+    encoder.setMaxTableSize(128);
+    std::string block;
+    encoder.startBlock(block);
+    ASSERT_EQ(fromHex("3f61"), block);
+
+    block.clear();
+    encoder.encodeField("authorization", "secret", block, true);
+    ASSERT_EQ(0x1F, block[0]); // Never indexed, name 23.
+    block.clear();
+    encoder.encodeField("x-large", std::string(80, 'x'), block);
+    ASSERT_EQ(0x00, block[0]); // Without indexing, literal name.
+    ASSERT_EQ(0u, encoder.getTable().getCount());
+
+    // A shrink and regrowth is announced as the smallest size, then the
+    // final one.
+    encoder.setMaxTableSize(0);
+    encoder.setMaxTableSize(64);
+    block.clear();
+    encoder.startBlock(block);
+    ASSERT_EQ(fromHex("203f 21"), block);
+}
+
+TEST(HpackTests, RejectMalformedBlocks) {
+    std::vector<std::string> blocks{
+        "80",                      // Index zero.
+        "be",                      // Beyond the dynamic table.
+        "0481 00",                 // Padding of zeros.
+        "0482 ffff",               // Padding longer than seven bits.
+        "0484 ffff ffff",          // EOS.
+        "3fe2 01",                 // Size update above the setting.
+        "8220",                    // Size update after a field.
+        "0485 00",                 // Truncated string.
+        "41",                      // Missing value.
+        "ff",                      // Truncated integer.
+        "ffff ffff ffff ffff 7f",  // Integer overflow.
+    };
+
+    for (size_t idx = 0; idx < blocks.size(); ++idx) {
+        msg::HpackDecoder decoder;
+        decoder.setMaxTableSize(256);
+        Fields fields;
+        ASSERT_FALSE(decode(decoder, fromHex(blocks[idx]), fields))
+            << ">>> Test is failed at " << idx << ". <<<";
+    }
+}
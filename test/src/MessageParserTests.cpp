@@ -0,0 +1,439 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-18 15:02:17
+ * @LastEditTime: 2019-09-06 12:07:44
+ * @Description: Unittests of class msg::MessageParser.
+ */
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <message/Message.hpp>
+#include <message/MessageParser.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * @description:
+ *     Feed a raw message to a parser in chunks of a fixed size.
+ */
+msg::MessageParser::Status feedInChunks(msg::MessageParser &parser,
+                                        const std::string &rawMessage,
+                                        size_t chunkSize) {
+    auto status = msg::MessageParser::Status::NeedMore;
+    size_t pos = 0;
+    while (pos < rawMessage.size()) {
+        size_t length = std::min(chunkSize, rawMessage.size() - pos);
+        status = parser.feed(rawMessage.data() + pos, length);
+        if (status == msg::MessageParser::Status::Error ||
+            status == msg::MessageParser::Status::Complete)
+            return status;
+        pos += parser.getConsumed();
+    }
+    return parser.finish();
+}
+
+} // namespace
+
+TEST(MessageParserTests, ParseInChunksOfAnySize) {
+    std::string rawMessage =
+        "Via: SIP/2.0/UDP server10.biloxi.com\r\n"
+        "    ;branch=z9hG4bKnashds8;received=192.0.2.3\r\n"
+        "Via: SIP/2.0/UDP pc33.atlanta.com\r\n"
+        "To: Bob <sip:bob@biloxi.com>;tag=a6c85cf\r\n"
+        "Content-Length: 51\r\n"
+        "\r\n"
+        "Hello World! My payload includes a trailing CRLF.\r\n";
+
+    msg::Message expected;
+    ASSERT_TRUE(expected.parseFromMessage(rawMessage));
+    // The body framed by Content-Length is kept as it is.
+    expected.setBody("Hello World! My payload includes a trailing CRLF.\r\n");
+
+    for (size_t chunkSize = 1; chunkSize <= rawMessage.size(); ++chunkSize) {
+        msg::Message msg;
+        msg::MessageParser parser(msg);
+        ASSERT_EQ(msg::MessageParser::Status::Complete,
+                  feedInChunks(parser, rawMessage, chunkSize))
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+        ASSERT_EQ(expected.getHeaders(), msg.getHeaders())
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+        ASSERT_EQ(expected.getBody(), msg.getBody())
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+    }
+}
+
+TEST(MessageParserTests, StopAfterHeaders) {
+    std::string rawMessage = "Host: www.example.com\r\n\r\nbody";
+
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    ASSERT_EQ(msg::MessageParser::Status::HeadersComplete,
+              parser.feed(rawMessage.data(), rawMessage.size()));
+    ASSERT_EQ(rawMessage.size() - 4, parser.getConsumed());
+    ASSERT_EQ("www.example.com", msg.getHeaderValue("Host"));
+    ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+              parser.feed(rawMessage.data() + rawMessage.size() - 4, 4));
+    ASSERT_EQ(msg::MessageParser::Status::Complete, parser.finish());
+    ASSERT_EQ("body", msg.getBody());
+}
+
+TEST(MessageParserTests, ParseWithInvalidLengthBeforeLineEnds) {
+    std::string longStr(999, 'x');
+
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    parser.setLineLength(1000);
+    std::string head = "X-data: " + longStr.substr(8);
+    ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+              parser.feed(head.data(), head.size() - 1));
+    ASSERT_EQ(msg::MessageParser::Status::Error,
+              parser.feed(head.data() + head.size() - 1, 1));
+}
+
+TEST(MessageParserTests, ParseFromMessageWithInvaildFormat) {
+    std::vector<std::string> testCases{
+        "Ho st: www.example.com\r\n\r\n",    "Ho\rst: www.example.com\r\n\r\n",
+        "Host: www.ex\nample.com\r\n\r\n",   " folded\r\nHost: a\r\n\r\n",
+        "Host: www.example.com\r\n",
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::Message msg;
+        msg::MessageParser parser(msg);
+        ASSERT_EQ(msg::MessageParser::Status::Error,
+                  feedInChunks(parser, testCase, 3))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(MessageParserTests, ParseChunkedBodyInChunksOfAnySize) {
+    std::string binary("binary\0\r\rbody\nis kept as is", 27);
+    std::string rawMessage = "Transfer-Encoding: gzip, chunked\r\n"
+                             "\r\n"
+                             "7;name=value\r\n"
+                             "Hello, \r\n"
+                             "1b\r\n" +
+                             binary +
+                             "\r\n"
+                             "0\r\n"
+                             "Expires: never\r\n"
+                             "\r\n"
+                             "NEXT";
+
+    for (size_t chunkSize = 1; chunkSize <= rawMessage.size(); ++chunkSize) {
+        msg::Message msg;
+        msg::MessageParser parser(msg);
+        ASSERT_EQ(msg::MessageParser::Status::Complete,
+                  feedInChunks(parser, rawMessage, chunkSize))
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+        ASSERT_EQ("Hello, " + binary, msg.getBody())
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+        ASSERT_EQ("never", msg.getHeaderValue("Expires"))
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+    }
+
+    // The next message is left unconsumed.
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    ASSERT_EQ(msg::MessageParser::Status::HeadersComplete,
+              parser.feed(rawMessage.data(), rawMessage.size()));
+    size_t pos = parser.getConsumed();
+    ASSERT_EQ(msg::MessageParser::Status::Complete,
+              parser.feed(rawMessage.data() + pos, rawMessage.size() - pos));
+    ASSERT_EQ("NEXT", rawMessage.substr(pos + parser.getConsumed()));
+}
+
+TEST(MessageParserTests, StreamBodyToSink) {
+    std::string payload(100000, 'x');
+    std::string rawMessage =
+        "l: " + std::to_string(payload.size()) + "\r\n\r\n" + payload;
+
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    std::string received;
+    size_t calls = 0;
+    parser.setBodySink([&](const char *data, size_t length) {
+        received.append(data, length);
+        ++calls;
+    });
+    ASSERT_EQ(msg::MessageParser::Status::Complete,
+              feedInChunks(parser, rawMessage, 4096));
+    ASSERT_EQ(payload, received);
+    ASSERT_EQ(25u, calls);
+    ASSERT_EQ("", msg.getBody());
+}
+
+TEST(MessageParserTests, KeepBodyUntilCloseAsItIs) {
+    std::string binary(" \r\n\0binary\r\n\r\nbody\t\r\n", 21);
+    std::string rawMessage = "HTTP/1.1 200 OK\r\n"
+                             "Content-Type: application/octet-stream\r\n"
+                             "\r\n" +
+                             binary;
+
+    for (size_t chunkSize = 1; chunkSize <= rawMessage.size(); ++chunkSize) {
+        msg::Message msg;
+        msg::MessageParser parser(msg);
+        ASSERT_EQ(msg::MessageParser::Status::Complete,
+                  feedInChunks(parser, rawMessage, chunkSize))
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+        ASSERT_EQ(binary, msg.getBody())
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+    }
+
+    // Without start line the body is still joined as parseFromMessage()
+    // joins it.
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    ASSERT_EQ(msg::MessageParser::Status::Complete,
+              feedInChunks(parser, "Host: a\r\n\r\n" + binary, 5));
+    msg::Message expected;
+    ASSERT_TRUE(expected.parseFromMessage("Host: a\r\n\r\n" + binary));
+    ASSERT_EQ(expected.getBody(), msg.getBody());
+}
+
+TEST(MessageParserTests, CompleteWithoutBody) {
+    std::string rawMessage = "Content-Length: 0\r\n\r\n";
+
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    ASSERT_EQ(msg::MessageParser::Status::Complete,
+              parser.feed(rawMessage.data(), rawMessage.size()));
+    ASSERT_EQ(rawMessage.size(), parser.getConsumed());
+    ASSERT_EQ(msg::MessageParser::Status::Complete, parser.finish());
+}
+
+TEST(MessageParserTests, FrameByStartLineWithoutLength) {
+    struct TestCase {
+        std::string rawMessage;
+        msg::MessageParser::Status expectedStatus;
+    };
+    std::vector<TestCase> testCases{
+        {"GET / HTTP/1.1\r\nHost: a\r\n\r\n",
+         msg::MessageParser::Status::Complete},
+        {"OPTIONS sip:bob@b.com SIP/2.0\r\nCSeq: 1 OPTIONS\r\n\r\n",
+         msg::MessageParser::Status::Complete},
+        {"SIP/2.0 200 OK\r\nCSeq: 1 OPTIONS\r\n\r\n",
+         msg::MessageParser::Status::Complete},
+        {"HTTP/1.1 204 No Content\r\nContent-Length: 3\r\n\r\n",
+         msg::MessageParser::Status::Complete},
+        {"HTTP/1.1 100 Continue\r\n\r\n",
+         msg::MessageParser::Status::Complete},
+        // Only the end of the data ends these.
+        {"HTTP/1.1 200 OK\r\n\r\n",
+         msg::MessageParser::Status::HeadersComplete},
+        {"Host: a\r\n\r\n", msg::MessageParser::Status::HeadersComplete},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n",
+         msg::MessageParser::Status::Error},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        const std::string &raw = testCase.rawMessage;
+        msg::Message msg;
+        msg::MessageParser parser(msg);
+        ASSERT_EQ(testCase.expectedStatus, parser.feed(raw.data(), raw.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(raw.size(), parser.getConsumed())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ("", msg.getBody())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(MessageParserTests, ParseWithInvalidFraming) {
+    std::vector<std::string> testCases{
+        "Content-Length: 1x\r\n\r\nb",
+        "Content-Length: 2, 3\r\n\r\nabc",
+        "Content-Length: 99999999999999999999\r\n\r\n",
+        "Content-Length: 10\r\n\r\nshort",
+        "Transfer-Encoding: chunked\r\n\r\nz\r\n",
+        "Transfer-Encoding: chunked\r\n\r\n2\r\nabc\r\n0\r\n\r\n",
+        "Transfer-Encoding: chunked\r\n\r\n11111111111111111\r\n",
+        "Transfer-Encoding: chunked\r\n\r\n1\r\na\r\n",
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::Message msg;
+        msg::MessageParser parser(msg);
+        ASSERT_EQ(msg::MessageParser::Status::Error,
+                  feedInChunks(parser, testCase, 3))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(MessageParserTests, ParsePipelinedMessages) {
+    std::vector<std::string> messages = {
+        "Call-ID: 1\r\nContent-Length: 5\r\n\r\nfirst",
+        "Call-ID: 2\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "6\r\nsecond\r\n0\r\n\r\n",
+        "Call-ID: 3\r\nl: 0\r\n\r\n",
+    };
+    std::string tail = "Call-ID: 4\r\nContent-Le";
+    std::string buffer;
+    for (const auto &message : messages) {
+        buffer += message;
+    }
+    buffer += tail;
+
+    // Split the buffer into two reads at every position.
+    for (size_t split = 0; split <= buffer.size(); ++split) {
+        msg::Message msg;
+        msg::MessageParser parser(msg);
+        std::vector<std::pair<std::string, size_t>> received;
+        auto onMessage = [&](msg::Message &message, size_t length) {
+            received.emplace_back(message.getHeaderValue("Call-ID") + ":" +
+                                      message.getBody(),
+                                  length);
+        };
+        ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+                  parser.feedMessages(buffer.data(), split, onMessage))
+            << ">>> Test is failed at " << split << ". <<<";
+        ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+                  parser.feedMessages(buffer.data() + split,
+                                      buffer.size() - split, onMessage))
+            << ">>> Test is failed at " << split << ". <<<";
+        ASSERT_EQ(3u, received.size())
+            << ">>> Test is failed at " << split << ". <<<";
+        ASSERT_EQ(std::make_pair(std::string("1:first"), messages[0].size()),
+                  received[0])
+            << ">>> Test is failed at " << split << ". <<<";
+        ASSERT_EQ(std::make_pair(std::string("2:second"), messages[1].size()),
+                  received[1])
+            << ">>> Test is failed at " << split << ". <<<";
+        ASSERT_EQ(std::make_pair(std::string("3:"), messages[2].size()),
+                  received[2])
+            << ">>> Test is failed at " << split << ". <<<";
+        // The tail is resumed with the next read.
+        std::string rest = "ngth: 1\r\n\r\n!";
+        ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+                  parser.feedMessages(rest.data(), rest.size(), onMessage))
+            << ">>> Test is failed at " << split << ". <<<";
+        ASSERT_EQ(std::make_pair(std::string("4:!"), tail.size() + rest.size()),
+                  received.back())
+            << ">>> Test is failed at " << split << ". <<<";
+    }
+
+    // A malformed message stops the batch where it starts.
+    std::string malformed = messages[0] + "Ho st: a\r\n\r\n";
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    size_t count = 0;
+    ASSERT_EQ(msg::MessageParser::Status::Error,
+              parser.feedMessages(malformed.data(), malformed.size(),
+                                  [&](msg::Message &, size_t) { ++count; }));
+    ASSERT_EQ(1u, count);
+    ASSERT_EQ(messages[0].size(), parser.getConsumed());
+}
+
+TEST(MessageParserTests, ParsePipelinedRequestsWithoutBody) {
+    std::vector<std::string> requests = {
+        "GET /a HTTP/1.1\r\nHost: x\r\n\r\n",
+        "GET /b HTTP/1.1\r\nHost: x\r\n\r\n",
+        "OPTIONS sip:bob@b.com SIP/2.0\r\nCSeq: 1 OPTIONS\r\n\r\n",
+        "POST /c HTTP/1.1\r\nContent-Length: 2\r\n\r\nok",
+        "HEAD /d HTTP/1.1\r\nHost: x\r\n\r\n",
+    };
+    std::string buffer;
+    for (const auto &request : requests) {
+        buffer += request;
+    }
+
+    // Split the buffer into two reads at every position.
+    for (size_t split = 0; split <= buffer.size(); ++split) {
+        msg::Message msg;
+        msg::MessageParser parser(msg);
+        std::vector<std::pair<std::string, size_t>> received;
+        auto onMessage = [&](msg::Message &message, size_t length) {
+            const msg::StartLine &line = message.getStartLine();
+            received.emplace_back(
+                line.getTarget().toString() + ":" + message.getBody(), length);
+        };
+        ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+                  parser.feedMessages(buffer.data(), split, onMessage))
+            << ">>> Test is failed at " << split << ". <<<";
+        ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+                  parser.feedMessages(buffer.data() + split,
+                                      buffer.size() - split, onMessage))
+            << ">>> Test is failed at " << split << ". <<<";
+        std::vector<std::pair<std::string, size_t>> expected{
+            {"/a:", requests[0].size()},
+            {"/b:", requests[1].size()},
+            {"sip:bob@b.com:", requests[2].size()},
+            {"/c:ok", requests[3].size()},
+            {"/d:", requests[4].size()},
+        };
+        ASSERT_EQ(expected, received)
+            << ">>> Test is failed at " << split << ". <<<";
+    }
+}
+
+TEST(MessageParserTests, IgnoreEmptyLinesBetweenMessages) {
+    const std::string buffer = "SIP/2.0 200 OK\r\n"
+                               "Content-Length: 3\r\n"
+                               "\r\n"
+                               "v=0\r\n"
+                               "\r\n"
+                               "OPTIONS sip:bob@b.com SIP/2.0\r\n"
+                               "Content-Length: 0\r\n"
+                               "\r\n";
+
+    for (size_t split = 0; split <= buffer.size(); ++split) {
+        msg::Message msg;
+        msg::MessageParser parser(msg);
+        std::vector<std::string> received;
+        auto onMessage = [&](msg::Message &message, size_t) {
+            received.push_back(message.getStartLine().getText().toString() +
+                               ":" + message.getBody());
+        };
+        ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+                  parser.feedMessages(buffer.data(), split, onMessage))
+            << ">>> Test is failed at " << split << ". <<<";
+        ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+                  parser.feedMessages(buffer.data() + split,
+                                      buffer.size() - split, onMessage))
+            << ">>> Test is failed at " << split << ". <<<";
+        ASSERT_EQ(std::vector<std::string>(
+                      {"SIP/2.0 200 OK:v=0",
+                       "OPTIONS sip:bob@b.com SIP/2.0:"}),
+                  received)
+            << ">>> Test is failed at " << split << ". <<<";
+    }
+
+    // The first message may start with the blank line of no headers.
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    ASSERT_EQ(msg::MessageParser::Status::HeadersComplete,
+              parser.feed("\r\nbody", 6));
+    ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+              parser.feed("body", 4));
+    ASSERT_EQ(msg::MessageParser::Status::Complete, parser.finish());
+    ASSERT_EQ("body", msg.getBody());
+}
+
+TEST(MessageParserTests, ParseStartLineInChunks) {
+    std::string rawMessage = "HTTP/1.1 200 OK\r\n"
+                             "Content-Length: 2\r\n"
+                             "\r\n"
+                             "OK";
+
+    for (size_t chunkSize = 1; chunkSize <= rawMessage.size(); ++chunkSize) {
+        msg::Message msg;
+        msg::MessageParser parser(msg);
+        ASSERT_EQ(msg::MessageParser::Status::Complete,
+                  feedInChunks(parser, rawMessage, chunkSize))
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+        ASSERT_EQ(200u, msg.getStartLine().getStatusCode())
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+        ASSERT_EQ("2", msg.getHeaderValue(msg::HeaderId::ContentLength))
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+        ASSERT_EQ("OK", msg.getBody())
+            << ">>> Test is failed at " << chunkSize << ". <<<";
+    }
+}
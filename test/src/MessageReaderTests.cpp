@@ -0,0 +1,178 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 16:58:14
+ * @LastEditTime: 2019-09-06 11:40:27
+ * @Description: Unittests of class msg::MessageReader.
+ */
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <message/MessageReader.hpp>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+/**
+ * @description:
+ *     A connected pair of non-blocking sockets closed at the end of scope.
+ */
+struct SocketPair {
+    int fds[2] = {-1, -1};
+
+    SocketPair() { socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds); }
+    ~SocketPair() {
+        for (int fd : fds) {
+            if (fd >= 0)
+                close(fd);
+        }
+    }
+    void closePeer() {
+        close(fds[1]);
+        fds[1] = -1;
+    }
+};
+
+} // namespace
+
+TEST(MessageReaderTests, ReadMessagesInPiecesOfAnySize) {
+    const std::string stream = "SIP/2.0 200 OK\r\n"
+                               "Content-Length: 4\r\n"
+                               "\r\n"
+                               "v=0\n"
+                               "HTTP/1.1 200 OK\r\n"
+                               "Transfer-Encoding: chunked\r\n"
+                               "\r\n"
+                               "3\r\nabc\r\n0\r\n\r\n"
+                               "HTTP/1.1 200 OK\r\n"
+                               "\r\n"
+                               "until close\r\n";
+    std::vector<std::string> expectedBodies{"v=0\n", "abc",
+                                            "until close\r\n"};
+
+    for (size_t piece : {1, 7, 64, 4096}) {
+        msg::EventLoop loop;
+        SocketPair pair;
+        msg::MessageReader reader(loop, pair.fds[0]);
+        reader.setBufferSize(piece);
+        std::vector<std::string> bodies;
+        int closes = 0;
+        bool failed = true;
+        ASSERT_TRUE(reader.start(
+            [&bodies](msg::Message &message) {
+                bodies.push_back(message.getBody());
+            },
+            [&closes, &failed](bool closeFailed) {
+                ++closes;
+                failed = closeFailed;
+            }));
+        ASSERT_FALSE(reader.start(nullptr, nullptr));
+
+        for (size_t pos = 0; pos < stream.size(); pos += piece) {
+            size_t length = std::min(piece, stream.size() - pos);
+            ASSERT_EQ(static_cast<ssize_t>(length),
+                      write(pair.fds[1], stream.data() + pos, length))
+                << ">>> Test is failed at " << piece << ". <<<";
+            loop.runOnce(0);
+        }
+        pair.closePeer();
+        loop.run();
+        ASSERT_EQ(expectedBodies, bodies)
+            << ">>> Test is failed at " << piece << ". <<<";
+        ASSERT_EQ(1, closes) << ">>> Test is failed at " << piece << ". <<<";
+        ASSERT_FALSE(failed) << ">>> Test is failed at " << piece << ". <<<";
+        ASSERT_FALSE(reader.isReading());
+        ASSERT_EQ(3u, reader.getMessageCount());
+    }
+}
+
+TEST(MessageReaderTests, DeliverRequestsWithoutBodyOnAnOpenConnection) {
+    msg::EventLoop loop;
+    SocketPair pair;
+    msg::MessageReader reader(loop, pair.fds[0]);
+    std::vector<std::string> targets;
+    int closes = 0;
+    reader.start(
+        [&targets](msg::Message &message) {
+            targets.push_back(message.getStartLine().getTarget().toString());
+        },
+        [&closes](bool) { ++closes; });
+
+    // Each request is handed out as it arrives, the peer stays open.
+    for (const std::string target : {"/a", "/b", "/c"}) {
+        const std::string request = "GET " + target +
+                                    " HTTP/1.1\r\n"
+                                    "Host: example.com\r\n"
+                                    "\r\n";
+        write(pair.fds[1], request.data(), request.size());
+        loop.runOnce(0);
+        ASSERT_FALSE(targets.empty()) << ">>> Test is failed at " << target
+                                      << ". <<<";
+        ASSERT_EQ(target, targets.back());
+    }
+    ASSERT_EQ(std::vector<std::string>({"/a", "/b", "/c"}), targets);
+    ASSERT_EQ(0, closes);
+    ASSERT_TRUE(reader.isReading());
+    reader.stop();
+}
+
+TEST(MessageReaderTests, CloseOnMalformedOrTruncatedMessages) {
+    std::vector<std::string> streams{
+        "HTTP/1.1 200 OK\r\nContent-Length: x\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nshort",
+        "HTTP/1.1 200 OK\r\nHost",
+    };
+
+    size_t idx = 0;
+    for (const auto &stream : streams) {
+        msg::EventLoop loop;
+        SocketPair pair;
+        msg::MessageReader reader(loop, pair.fds[0]);
+        int messages = 0;
+        int failures = 0;
+        reader.start([&messages](msg::Message &) { ++messages; },
+                     [&failures](bool failed) { failures += failed; });
+        write(pair.fds[1], stream.data(), stream.size());
+        pair.closePeer();
+        loop.run();
+        ASSERT_EQ(0, messages) << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(1, failures) << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(MessageReaderTests, PauseBetweenMessages) {
+    msg::EventLoop loop;
+    SocketPair pair;
+    msg::MessageReader reader(loop, pair.fds[0]);
+    std::vector<std::string> bodies;
+    reader.start(
+        [&reader, &bodies](msg::Message &message) {
+            bodies.push_back(message.getBody());
+            reader.pause();
+        },
+        nullptr);
+
+    std::string stream;
+    for (char body : {'a', 'b', 'c'})
+        stream += "HTTP/1.1 200 OK\r\nContent-Length: 1\r\n\r\n" +
+                  std::string(1, body);
+    write(pair.fds[1], stream.data(), stream.size());
+    loop.runOnce(0);
+    ASSERT_EQ(std::vector<std::string>{"a"}, bodies);
+    ASSERT_EQ(0u, loop.getWatchCount());
+
+    // The rest is in the buffer already.
+    reader.resume();
+    ASSERT_EQ(std::vector<std::string>({"a", "b"}), bodies);
+    reader.resume();
+    ASSERT_EQ(std::vector<std::string>({"a", "b", "c"}), bodies);
+    ASSERT_EQ(0u, loop.getWatchCount());
+    // Reading goes on once the buffer is used up.
+    reader.resume();
+    ASSERT_EQ(1u, loop.getWatchCount());
+    reader.stop();
+    ASSERT_EQ(0u, loop.getWatchCount());
+}
@@ -0,0 +1,149 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-04 13:26:09
+ * @LastEditTime: 2019-09-04 13:26:09
+ * @Description: Unittests of class msg::MessageTemplate.
+ */
+#include <gtest/gtest.h>
+#include <message/Message.hpp>
+#include <message/MessageTemplate.hpp>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+TEST(MessageTemplateTests, ProduceAsMessageWould) {
+    struct TestCase {
+        std::string rawMessage;
+        size_t lineLength;
+        msg::Message::FieldForm form;
+        std::vector<std::string> slotNames; // An empty name is the body.
+        std::vector<std::string> values;
+    };
+    std::vector<TestCase> testCases{
+        {"HTTP/1.1 200 OK\r\n"
+         "Date: Mon, 27 Jul 2009 12:28:53 GMT\r\n"
+         "Server: Apache\r\n"
+         "Content-Length: 0\r\n"
+         "Content-Type: text/plain\r\n"
+         "\r\n",
+         0,
+         msg::Message::FieldForm::Joined,
+         {"Date", "Content-Length", ""},
+         {"Tue, 28 Jul 2009 08:00:00 GMT", "5", "hello"}},
+        {"SIP/2.0 100 Trying\r\n"
+         "Via: SIP/2.0/UDP a.example.com;branch=z9hG4bK1\r\n"
+         "Via: SIP/2.0/UDP b.example.com;branch=z9hG4bK2\r\n"
+         "From: Alice <sip:alice@atlanta.com>;tag=1928301774\r\n"
+         "i: a84b4c76e66710\r\n"
+         "CSeq: 314159 INVITE\r\n"
+         "Content-Length: 0\r\n"
+         "\r\n",
+         0,
+         msg::Message::FieldForm::Repeated,
+         {"Via", "Call-ID", "CSeq"},
+         {"SIP/2.0/UDP c.example.com;branch=z9hG4bK3", "f81d4fae7dec11d0",
+          "1 INVITE"}},
+        // Slots of absent headers follow the other headers, an empty body
+        // has no line.
+        {"HTTP/1.1 404 Not Found\r\n"
+         "Content-Length: 0\r\n"
+         "\r\n"
+         "gone\r\n",
+         0,
+         msg::Message::FieldForm::Joined,
+         {"X-Request-Id", "Date", ""},
+         {"42", "Tue, 28 Jul 2009 08:00:00 GMT", ""}},
+        // Fixed lines are folded once, slot lines when they are too long.
+        {"SIP/2.0 180 Ringing\r\n"
+         "Subject: A long subject that is folded at spaces\r\n"
+         "X-Short: a\r\n"
+         "X-Long: b\r\n"
+         "\r\n"
+         "v=0\r\n",
+         24,
+         msg::Message::FieldForm::Joined,
+         {"X-Short", "X-Long", ""},
+         {"short", "a value long enough to be folded", "o=alice 2890844526"}},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::Message msg;
+        ASSERT_TRUE(msg.parseFromMessage(testCase.rawMessage))
+            << ">>> Test is failed at " << idx << ". <<<";
+        msg.setLineLength(testCase.lineLength);
+        msg.setFieldForm(testCase.form);
+        msg::MessageTemplate tmpl;
+        for (const auto &name : testCase.slotNames) {
+            if (name.empty())
+                tmpl.addBodySlot();
+            else
+                tmpl.addSlot(name);
+        }
+        msg.produceToTemplate(tmpl);
+        ASSERT_TRUE(tmpl.isCompiled())
+            << ">>> Test is failed at " << idx << ". <<<";
+
+        std::vector<msg::StringView> values(testCase.values.begin(),
+                                            testCase.values.end());
+        std::string produced;
+        ASSERT_TRUE(
+            tmpl.produceToMessage(produced, values.data(), values.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+
+        for (size_t slot = 0; slot < values.size(); ++slot) {
+            if (testCase.slotNames[slot].empty())
+                msg.setBody(testCase.values[slot]);
+            else
+                msg.setHeader(testCase.slotNames[slot], testCase.values[slot],
+                              true);
+        }
+        ASSERT_EQ(msg.produceToMessage(), produced)
+            << ">>> Test is failed at " << idx << ". <<<";
+
+        std::vector<iovec> iov;
+        std::string foldBuffer;
+        ASSERT_TRUE(tmpl.produceToIovec(iov, values.data(), values.size(),
+                                        foldBuffer))
+            << ">>> Test is failed at " << idx << ". <<<";
+        std::string gathered;
+        for (const auto &vec : iov) {
+            gathered.append(static_cast<const char *>(vec.iov_base),
+                            vec.iov_len);
+        }
+        ASSERT_EQ(produced, gathered)
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(MessageTemplateTests, RequireCompiledTemplateAndAllValues) {
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage("HTTP/1.1 204 No Content\r\n"
+                                     "Date: Mon, 27 Jul 2009 12:28:53 GMT\r\n"
+                                     "\r\n"));
+    msg::MessageTemplate tmpl;
+    std::string produced;
+    ASSERT_FALSE(tmpl.produceToMessage(produced, {}));
+
+    ASSERT_EQ(0u, tmpl.addSlot(msg::HeaderId::Date));
+    msg.produceToTemplate(tmpl);
+    ASSERT_FALSE(tmpl.produceToMessage(produced, {}));
+    ASSERT_TRUE(tmpl.produceToMessage(produced, {"Tue"}));
+    ASSERT_EQ("HTTP/1.1 204 No Content\r\nDate: Tue\r\n\r\n", produced);
+
+    // A slot added later needs the template compiled again.
+    ASSERT_EQ(1u, tmpl.addSlot("Server"));
+    ASSERT_FALSE(tmpl.produceToMessage(produced, {"Tue", "x"}));
+    msg.produceToTemplate(tmpl);
+    produced.clear();
+    ASSERT_TRUE(tmpl.produceToMessage(produced, {"Tue", "x"}));
+    ASSERT_EQ("HTTP/1.1 204 No Content\r\nDate: Tue\r\nServer: x\r\n\r\n",
+              produced);
+
+    tmpl.clear();
+    ASSERT_EQ(0u, tmpl.getSlotCount());
+    ASSERT_FALSE(tmpl.isCompiled());
+}
@@ -3,12 +3,14 @@
  * @Author: shaqsnake
  * @Email: shaqsnake@gmail.com
  * @Date: 2019-07-25 09:29:37
- * @LastEditTime: 2019-08-15 17:11:42
+ * @LastEditTime: 2019-09-06 12:30:52
  * @Description: Unittests of class msg::msg.
  */
 #include <gtest/gtest.h>
+#include <message/Hpack.hpp>
 #include <message/Message.hpp>
 #include <string>
+#include <sys/uio.h>
 #include <unordered_map>
 #include <vector>
 
@@ -163,6 +165,8 @@ TEST(MessageTests, ParseFromMessageWithInvaildFormat) {
         "Ho st: www.example.com\r\n\r\n",    "Ho\rst: www.example.com\r\n\r\n",
         "Host: www.ex\rample.com\r\n\r\n",   "Host: www.ex\nample.com\r\n\r\n",
         "Host: www.example.com\x7F\r\n\r\n",
+        "X-Data: " + std::string(40, 'x') + "\x7F" + std::string(40, 'x') + "\r\n\r\n",
+        "X-Data: " + std::string(40, 'x') + "\x80" + std::string(40, 'x') + "\r\n\r\n",
     };
 
     size_t idx = 0;
@@ -179,6 +183,7 @@ TEST(MessageTests, ParseFromMessageWithBarelyVaildFormat) {
         "Host: www.ex ample.com\r\n\r\n",
         "Host: www.ex\tample.com\r\n\r\n",
         "Host: www.example.com~\r\n\r\n",
+        "X-Data: " + std::string(40, 'x') + "\t~ " + std::string(40, 'x') + "\r\n\r\n",
     };
 
     size_t idx = 0;
@@ -261,6 +266,43 @@ TEST(MessageTests, ProduceToMessageByFolding) {
     }
 }
 
+TEST(MessageTests, ProduceToMessageByFoldingOnlyLongLines) {
+    std::string rawMessage = "Host: www.example.com\r\n"
+                             "Subject: This is a test\r\n"
+                             "\r\n"
+                             "I'm body!\r\n";
+
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage(rawMessage));
+    msg.setLineLength(24);
+    ASSERT_EQ("Host: www.example.com\r\n"
+              "Subject: This is a\r\n"
+              " test\r\n"
+              "\r\n"
+              "I'm body!\r\n",
+              msg.produceToMessage());
+}
+
+TEST(MessageTests, ProduceToMessageByFoldingLongValue) {
+    std::string word = "xxxxxxx ";
+    std::string value;
+    while (value.size() < 64 * 1024)
+        value += word;
+
+    msg::Message msg;
+    msg.setHeader("X-Data", value);
+    msg.setLineLength(78);
+    auto message = msg.produceToMessage();
+    ASSERT_EQ(message.size(), msg.getMessageLength());
+
+    ASSERT_LT(64u * 1024, message.size());
+
+    msg::Message unfolded;
+    ASSERT_TRUE(unfolded.parseFromMessage(message));
+    ASSERT_EQ(value.substr(0, value.size() - 1),
+              unfolded.getHeaderValue("X-Data"));
+}
+
 TEST(MessageTests, GetMultiValuesByHeaderName) {
     std::string rawMessage =
         "Via: SIP/2.0/UDP server10.biloxi.com\r\n"
@@ -303,4 +345,524 @@ TEST(MessageTests, RemoveHeaderByName) {
     ASSERT_TRUE(msg.hasHeader("Date"));
     msg.removeHeader("Date");
     ASSERT_FALSE(msg.hasHeader("Date"));
-}
\ No newline at end of file
+}
+TEST(MessageTests, LookupHeadersCaseInsensitively) {
+    std::string rawMessage = "Content-Length: 51\r\n"
+                             "Via: SIP/2.0/UDP a.example.com\r\n"
+                             "via: SIP/2.0/UDP b.example.com\r\n"
+                             "\r\n";
+
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage(rawMessage));
+    ASSERT_EQ(2u, msg.getHeaders().size());
+    ASSERT_TRUE(msg.hasHeader("content-length"));
+    ASSERT_EQ("51", msg.getHeaderValue("CONTENT-LENGTH"));
+    ASSERT_EQ("SIP/2.0/UDP a.example.com, SIP/2.0/UDP b.example.com",
+              msg.getHeaderValue("VIA"));
+
+    msg.setHeader("content-length", "0", true);
+    ASSERT_EQ("Content-Length", msg.getHeaders()[0].first);
+    ASSERT_EQ("0", msg.getHeaderValue("Content-Length"));
+
+    msg.removeHeader("CONTENT-length");
+    ASSERT_FALSE(msg.hasHeader("Content-Length"));
+    ASSERT_TRUE(msg.hasHeader("Via"));
+}
+
+TEST(MessageTests, SetAndRemoveManyHeaders) {
+    msg::Message msg;
+    for (int i = 0; i < 100; ++i) {
+        msg.setHeader("X-Header-" + std::to_string(i), std::to_string(i));
+    }
+    for (int i = 0; i < 100; i += 2) {
+        msg.removeHeader("x-header-" + std::to_string(i));
+    }
+
+    ASSERT_EQ(50u, msg.getHeaders().size());
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(i % 2 == 1, msg.hasHeader("X-HEADER-" + std::to_string(i)))
+            << ">>> Test is failed at " << i << ". <<<";
+    }
+    ASSERT_EQ("99", msg.getHeaderValue("X-Header-99"));
+}
+
+TEST(MessageTests, LookupHeadersByIdAndCompactForm) {
+    std::string rawMessage = "v: SIP/2.0/UDP a.example.com\r\n"
+                             "Via: SIP/2.0/UDP b.example.com\r\n"
+                             "i: a84b4c76e66710@pc33.atlanta.com\r\n"
+                             "X-Data: XXX\r\n"
+                             "\r\n";
+
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage(rawMessage));
+    ASSERT_EQ(3u, msg.getHeaders().size());
+    ASSERT_EQ("SIP/2.0/UDP a.example.com, SIP/2.0/UDP b.example.com",
+              msg.getHeaderValue(msg::HeaderId::Via));
+    ASSERT_EQ("a84b4c76e66710@pc33.atlanta.com", msg.getHeaderValue("Call-ID"));
+    ASSERT_FALSE(msg.hasHeader(msg::HeaderId::ContentLength));
+
+    msg.setHeader(msg::HeaderId::ContentLength, "0");
+    ASSERT_EQ("0", msg.getHeaderValue("l"));
+    msg.removeHeader(msg::HeaderId::CallId);
+    ASSERT_FALSE(msg.hasHeader("i"));
+    ASSERT_EQ("XXX", msg.getHeaderValue("x-data"));
+    ASSERT_EQ("v: SIP/2.0/UDP a.example.com, SIP/2.0/UDP b.example.com\r\n"
+              "X-Data: XXX\r\n"
+              "Content-Length: 0\r\n"
+              "\r\n",
+              msg.produceToMessage());
+}
+
+TEST(MessageTests, ProduceToBufferAndIovec) {
+    struct TestCase {
+        std::string rawMessage;
+        size_t maxLength;
+    };
+
+    std::vector<TestCase> testCases{
+        {"Host: www.example.com\r\nAccept-Language: en, mi\r\n\r\n", 0},
+        {"Subject: This is a test\r\n\r\nI'm body!\r\n", 0},
+        {"Subject: This is a test\r\nX-Data: xxxxxx xxx\r\n\r\nI'm\tbody!!!\r\n", 5},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::Message msg;
+        ASSERT_TRUE(msg.parseFromMessage(testCase.rawMessage))
+            << ">>> Test is failed at " << idx << ". <<<";
+        msg.setLineLength(testCase.maxLength);
+        auto expectedMessage = msg.produceToMessage();
+        ASSERT_EQ(expectedMessage.size(), msg.getMessageLength())
+            << ">>> Test is failed at " << idx << ". <<<";
+
+        std::string buffer = "prefix";
+        msg.produceToMessage(buffer);
+        ASSERT_EQ("prefix" + expectedMessage, buffer)
+            << ">>> Test is failed at " << idx << ". <<<";
+
+        std::vector<iovec> iov;
+        std::string foldBuffer;
+        msg.produceToIovec(iov, foldBuffer);
+        std::string gathered;
+        for (const auto &vec : iov) {
+            gathered.append(static_cast<const char *>(vec.iov_base),
+                            vec.iov_len);
+        }
+        ASSERT_EQ(expectedMessage, gathered)
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(MessageTests, ProduceToIovecReferencesMessage) {
+    msg::Message msg;
+    msg.setHeader("Host", "www.example.com");
+    msg.setBody("I'm body!");
+
+    std::vector<iovec> iov;
+    std::string foldBuffer;
+    msg.produceToIovec(iov, foldBuffer);
+    ASSERT_TRUE(foldBuffer.empty());
+    ASSERT_EQ(7u, iov.size());
+    ASSERT_EQ("Host", std::string(static_cast<const char *>(iov[0].iov_base),
+                                  iov[0].iov_len));
+}
+
+TEST(MessageTests, ResetAndReuseMessage) {
+    std::vector<std::string> rawMessages = {
+        "Host: www.example.com\r\n"
+        "Accept: */*\r\n"
+        "X-Trace: 1\r\n"
+        "\r\n"
+        "first\r\n",
+        "Accept: text/html\r\n"
+        "Content-Length: 6\r\n"
+        "\r\n"
+        "second\r\n",
+        "Host: x\r\n"
+        "\r\n",
+    };
+
+    msg::Message msg;
+    msg.setLineLength(100);
+    for (size_t idx = 0; idx < rawMessages.size(); ++idx) {
+        msg.reset();
+        ASSERT_TRUE(msg.getHeaders().empty())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ("", msg.getBody())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_TRUE(msg.parseFromMessage(rawMessages[idx]))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(rawMessages[idx], msg.produceToMessage())
+            << ">>> Test is failed at " << idx << ". <<<";
+    }
+    ASSERT_FALSE(msg.hasHeader("X-Trace"));
+    ASSERT_FALSE(msg.hasHeader(msg::HeaderId::ContentLength));
+    ASSERT_EQ("x", msg.getHeaderValue(msg::HeaderId::Host));
+
+    // The line length limit survives a reset.
+    msg.reset();
+    ASSERT_FALSE(msg.parseFromMessage("X-Long: " + std::string(100, 'x') +
+                                      "\r\n\r\n"));
+}
+
+TEST(MessageTests, MoveMessageAndTakeBody) {
+    std::string rawMessage = "Host: www.example.com\r\n"
+                             "Accept: */*\r\n"
+                             "\r\n"
+                             "I'm a body long enough to be on the heap!\r\n";
+
+    msg::Message parsed;
+    ASSERT_TRUE(parsed.parseFromMessage(rawMessage));
+    const char *body = parsed.getBody().data();
+
+    std::vector<msg::Message> queue;
+    queue.push_back(std::move(parsed));
+    msg::Message msg = std::move(queue.back());
+    ASSERT_EQ(rawMessage, msg.produceToMessage());
+    ASSERT_EQ("www.example.com", msg.getHeaderValue(msg::HeaderId::Host));
+    ASSERT_EQ("", msg.getHeaderValue("Missing"));
+
+    // Accessors refer to the message, a body is moved out as it is.
+    ASSERT_EQ(&msg.getHeaders()[1].second, &msg.getHeaderValue("accept"));
+    std::string taken = msg.takeBody();
+    ASSERT_EQ("I'm a body long enough to be on the heap!", taken);
+    ASSERT_EQ(body, taken.data());
+    ASSERT_EQ("", msg.getBody());
+
+    std::string value(64, 'v');
+    const char *data = value.data();
+    msg.setHeader("X-Data", std::move(value));
+    ASSERT_EQ(data, msg.getHeaderValue("X-Data").data());
+    msg.setBody(std::move(taken));
+    ASSERT_EQ(body, msg.getBody().data());
+    msg.setHeader(msg::HeaderId::Accept, std::string("text/html"), true);
+    ASSERT_EQ("text/html", msg.getHeaderValue("Accept"));
+}
+
+TEST(MessageTests, ParseAndProduceStartLine) {
+    std::vector<std::string> testCases{
+        "GET /index.html HTTP/1.1\r\n"
+        "Host: www.example.com\r\n"
+        "\r\n",
+        "SIP/2.0 180 Ringing\r\n"
+        "Via: SIP/2.0/UDP pc33.atlanta.com;branch=z9hG4bK776asdhds\r\n"
+        "\r\n",
+        "INVITE sip:bob@biloxi.com SIP/2.0\r\n"
+        "\r\n"
+        "v=0\r\n",
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::Message msg;
+        ASSERT_TRUE(msg.parseFromMessage(testCase))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_NE(msg::StartLine::Type::None, msg.getStartLine().getType())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase, msg.produceToMessage())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.size(), msg.getMessageLength())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage(testCases[2]));
+    ASSERT_EQ(msg::Method::Invite, msg.getStartLine().getMethod());
+    ASSERT_EQ("sip:bob@biloxi.com", msg.getStartLine().getTarget());
+    ASSERT_TRUE(msg.getHeaders().empty());
+
+    // A start line is written first and never folded.
+    msg.getStartLine().setStatus("SIP/2.0", 200, "OK");
+    msg.setHeader(msg::HeaderId::To, "Bob <sip:bob@biloxi.com>");
+    msg.setLineLength(10);
+    ASSERT_EQ("SIP/2.0 200 OK\r\n"
+              "To: Bob\r\n"
+              " <sip:bob@biloxi.com>\r\n"
+              "\r\n"
+              "v=0\r\n",
+              msg.produceToMessage());
+
+    // A start line is only the first line, a later one is a folded line.
+    msg.reset();
+    msg.setLineLength(0);
+    ASSERT_TRUE(msg.parseFromMessage("Host: a\r\nGET / HTTP/1.1\r\n\r\n"));
+    ASSERT_EQ(msg::StartLine::Type::None, msg.getStartLine().getType());
+    ASSERT_EQ("a GET / HTTP/1.1", msg.getHeaderValue("Host"));
+}
+
+TEST(MessageTests, KeepRepeatedFieldsApart) {
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage(
+        "Via: SIP/2.0/UDP a.example.com\r\n"
+        "Set-Cookie: id=a; Expires=Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+        "Via: SIP/2.0/UDP b.example.com, SIP/2.0/UDP c.example.com\r\n"
+        "Set-Cookie: lang=en\r\n"
+        "\r\n"));
+    ASSERT_EQ("SIP/2.0/UDP a.example.com, SIP/2.0/UDP b.example.com, "
+              "SIP/2.0/UDP c.example.com",
+              msg.getHeaderValue(msg::HeaderId::Via));
+    ASSERT_EQ(2u, msg.getHeaderFieldCount(msg::HeaderId::Via));
+    ASSERT_EQ("SIP/2.0/UDP b.example.com, SIP/2.0/UDP c.example.com",
+              msg.getHeaderField("via", 1));
+    ASSERT_EQ("", msg.getHeaderField(msg::HeaderId::Via, 2));
+    ASSERT_EQ(2u, msg.getHeaderFieldCount("Set-Cookie"));
+    ASSERT_EQ("id=a; Expires=Wed, 21 Oct 2015 07:28:00 GMT",
+              msg.getHeaderField(msg::HeaderId::SetCookie, 0));
+    ASSERT_EQ(0u, msg.getHeaderFieldCount("To"));
+
+    // Set-Cookie is never joined.
+    std::string joined =
+        "Via: SIP/2.0/UDP a.example.com, SIP/2.0/UDP b.example.com, "
+        "SIP/2.0/UDP c.example.com\r\n"
+        "Set-Cookie: id=a; Expires=Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+        "Set-Cookie: lang=en\r\n"
+        "\r\n";
+    ASSERT_EQ(joined, msg.produceToMessage());
+    ASSERT_EQ(joined.size(), msg.getMessageLength());
+
+    msg.setFieldForm(msg::Message::FieldForm::Repeated);
+    std::string repeated =
+        "Via: SIP/2.0/UDP a.example.com\r\n"
+        "Via: SIP/2.0/UDP b.example.com, SIP/2.0/UDP c.example.com\r\n"
+        "Set-Cookie: id=a; Expires=Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+        "Set-Cookie: lang=en\r\n"
+        "\r\n";
+    ASSERT_EQ(repeated, msg.produceToMessage());
+    ASSERT_EQ(repeated.size(), msg.getMessageLength());
+    std::vector<iovec> iov;
+    std::string foldBuffer;
+    msg.produceToIovec(iov, foldBuffer);
+    std::string gathered;
+    for (const auto &vec : iov) {
+        gathered.append(static_cast<const char *>(vec.iov_base), vec.iov_len);
+    }
+    ASSERT_EQ(repeated, gathered);
+
+    // Fields follow replaced and removed headers.
+    msg.setHeader(msg::HeaderId::Via, "SIP/2.0/UDP d.example.com", true);
+    ASSERT_EQ(1u, msg.getHeaderFieldCount(msg::HeaderId::Via));
+    msg.setHeader(msg::HeaderId::Via, "SIP/2.0/UDP e.example.com");
+    ASSERT_EQ("SIP/2.0/UDP d.example.com,SIP/2.0/UDP e.example.com",
+              msg.getHeaderValue(msg::HeaderId::Via));
+    ASSERT_EQ("SIP/2.0/UDP e.example.com",
+              msg.getHeaderField(msg::HeaderId::Via, 1));
+    msg.removeHeader(msg::HeaderId::Via);
+    ASSERT_EQ(2u, msg.getHeaderFieldCount(msg::HeaderId::SetCookie));
+    ASSERT_EQ("lang=en", msg.getHeaderField(msg::HeaderId::SetCookie, 1));
+    msg.reset();
+    msg.setHeader("Set-Cookie", "a=1");
+    ASSERT_EQ(1u, msg.getHeaderFieldCount(msg::HeaderId::SetCookie));
+}
+
+TEST(MessageTests, RoundTripThroughSnapshot) {
+    std::vector<std::string> testCases{
+        "",
+        "Host: www.example.com\r\n\r\n",
+        "GET /index.html HTTP/1.1\r\n"
+        "Host: www.example.com\r\n"
+        "X-Long: " + std::string(300, 'x') + "\r\n"
+        "\r\n",
+        "SIP/2.0 180 Ringing\r\n"
+        "Via: SIP/2.0/UDP a.example.com\r\n"
+        "i: a84b4c76e66710\r\n"
+        "Via: SIP/2.0/UDP b.example.com, SIP/2.0/UDP c.example.com\r\n"
+        "Set-Cookie: id=a; Expires=Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+        "Set-Cookie: lang=en\r\n"
+        "\r\n"
+        "v=0\r\n",
+    };
+
+    size_t idx = 0;
+    msg::Message restored;
+    for (const auto &testCase : testCases) {
+        msg::Message msg;
+        ASSERT_TRUE(msg.parseFromMessage(testCase))
+            << ">>> Test is failed at " << idx << ". <<<";
+        std::string snapshot;
+        msg.produceToSnapshot(snapshot);
+        ASSERT_TRUE(restored.parseFromSnapshot(snapshot.data(), snapshot.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(msg.produceToMessage(), restored.produceToMessage())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(msg.getHeaders(), restored.getHeaders())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+
+    // Identifiers, fields and the index are restored.
+    ASSERT_EQ("a84b4c76e66710", restored.getHeaderValue(msg::HeaderId::CallId));
+    ASSERT_EQ(2u, restored.getHeaderFieldCount("via"));
+    ASSERT_EQ("SIP/2.0/UDP a.example.com",
+              restored.getHeaderField(msg::HeaderId::Via, 0));
+    restored.setFieldForm(msg::Message::FieldForm::Repeated);
+    ASSERT_EQ(msg::StartLine::Type::Status,
+              restored.getStartLine().getType());
+    ASSERT_EQ("SIP/2.0 180 Ringing\r\n"
+              "Via: SIP/2.0/UDP a.example.com\r\n"
+              "Via: SIP/2.0/UDP b.example.com, SIP/2.0/UDP c.example.com\r\n"
+              "i: a84b4c76e66710\r\n"
+              "Set-Cookie: id=a; Expires=Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+              "Set-Cookie: lang=en\r\n"
+              "\r\n"
+              "v=0\r\n",
+              restored.produceToMessage());
+
+    // A damaged snapshot leaves the message empty.
+    std::string snapshot;
+    restored.produceToSnapshot(snapshot);
+    snapshot[snapshot.size() / 2] ^= 1;
+    ASSERT_FALSE(restored.parseFromSnapshot(snapshot.data(), snapshot.size()));
+    ASSERT_TRUE(restored.getHeaders().empty());
+}
+
+TEST(MessageTests, TranslateThroughHpack) {
+    msg::HpackEncoder encoder;
+    msg::HpackDecoder decoder;
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage("GET /index.html HTTP/1.1\r\n"
+                                     "Host: www.example.com\r\n"
+                                     "Connection: keep-alive\r\n"
+                                     "Authorization: Basic YWxhZGRpbjpvcGVu\r\n"
+                                     "TE: trailers\r\n"
+                                     "\r\n"));
+    msg::Message restored;
+    std::vector<size_t> blockLengths;
+    for (int idx = 0; idx < 2; ++idx) {
+        std::string block;
+        msg.produceToHpack(block, encoder);
+        blockLengths.push_back(block.size());
+        ASSERT_TRUE(restored.parseFromHpack(block.data(), block.size(), decoder))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ("GET /index.html HTTP/2\r\n"
+                  "Host: www.example.com\r\n"
+                  "authorization: Basic YWxhZGRpbjpvcGVu\r\n"
+                  "te: trailers\r\n"
+                  "\r\n",
+                  restored.produceToMessage())
+            << ">>> Test is failed at " << idx << ". <<<";
+    }
+    // The second block refers to the table, except for Authorization.
+    ASSERT_LT(blockLengths[1], blockLengths[0]);
+
+    // Cookie crumbs are combined, Set-Cookie stays one field per line.
+    std::string block;
+    encoder.encodeField(":status", "200", block);
+    encoder.encodeField("cookie", "a=1", block);
+    encoder.encodeField("cookie", "b=2", block);
+    encoder.encodeField("set-cookie", "c=3; Path=/", block);
+    encoder.encodeField("set-cookie", "d=4", block);
+    ASSERT_TRUE(restored.parseFromHpack(block.data(), block.size(), decoder));
+    ASSERT_EQ(200u, restored.getStartLine().getStatusCode());
+    ASSERT_EQ("a=1; b=2", restored.getHeaderValue(msg::HeaderId::Cookie));
+    ASSERT_EQ(2u, restored.getHeaderFieldCount(msg::HeaderId::Cookie));
+    ASSERT_EQ("d=4", restored.getHeaderField(msg::HeaderId::SetCookie, 1));
+    block.clear();
+    restored.produceToHpack(block, encoder);
+    ASSERT_EQ(5u, block.size()); // Each field is indexed in one byte.
+
+    // Pseudo-headers after regular ones make a malformed message.
+    block.clear();
+    encoder.encodeField("x-a", "1", block);
+    encoder.encodeField(":method", "GET", block);
+    ASSERT_FALSE(restored.parseFromHpack(block.data(), block.size(), decoder));
+}
+
+TEST(MessageTests, TranslateRequestsBetweenHttp1AndHttp2) {
+    struct TestCase {
+        std::string rawMessage;
+        std::string scheme; // Of the connection.
+        std::vector<std::string> expectedFields;
+        std::string expectedMessage;
+    };
+    std::vector<TestCase> testCases{
+        {"POST /upload?id=1 HTTP/1.1\r\n"
+         "Host: www.example.com\r\n"
+         "Connection: keep-alive, Upgrade\r\n"
+         "Keep-Alive: timeout=5\r\n"
+         "Transfer-Encoding: chunked\r\n"
+         "Upgrade: websocket\r\n"
+         "Accept: */*\r\n"
+         "\r\n",
+         "https",
+         {":method: POST", ":scheme: https", ":authority: www.example.com",
+          ":path: /upload?id=1", "accept: */*"},
+         "POST /upload?id=1 HTTP/2\r\n"
+         "Host: www.example.com\r\n"
+         "accept: */*\r\n"
+         "\r\n"},
+        {"GET http://www.example.com:8080?q HTTP/1.1\r\n"
+         "Host: www.example.com:8080\r\n"
+         "\r\n",
+         "http",
+         {":method: GET", ":scheme: http", ":authority: www.example.com:8080",
+          ":path: /?q"},
+         "GET /?q HTTP/2\r\n"
+         "Host: www.example.com:8080\r\n"
+         "\r\n"},
+        {"CONNECT www.example.com:443 HTTP/1.1\r\n"
+         "Host: www.example.com:443\r\n"
+         "\r\n",
+         "https",
+         {":method: CONNECT", ":authority: www.example.com:443"},
+         "CONNECT www.example.com:443 HTTP/2\r\n"
+         "Host: www.example.com:443\r\n"
+         "\r\n"},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::HpackEncoder encoder;
+        msg::HpackDecoder decoder;
+        msg::HpackDecoder fieldDecoder;
+        msg::Message msg;
+        ASSERT_TRUE(msg.parseFromMessage(testCase.rawMessage))
+            << ">>> Test is failed at " << idx << ". <<<";
+        // HTTP/1.1 to HTTP/2 and back, then to HTTP/2 again. A target in
+        // origin-form takes the scheme of the connection.
+        for (int round = 0; round < 2; ++round) {
+            std::string block;
+            msg.produceToHpack(block, encoder, testCase.scheme);
+            std::vector<std::string> fields;
+            ASSERT_TRUE(fieldDecoder.decode(
+                block.data(), block.size(),
+                [&fields](msg::StringView name, msg::StringView value) {
+                    fields.push_back(name.toString() + ": " +
+                                     value.toString());
+                }));
+            ASSERT_EQ(testCase.expectedFields, fields)
+                << ">>> Test is failed at " << idx << ". <<<";
+            ASSERT_TRUE(msg.parseFromHpack(block.data(), block.size(),
+                                           decoder))
+                << ">>> Test is failed at " << idx << ". <<<";
+            ASSERT_EQ(testCase.expectedMessage, msg.produceToMessage())
+                << ">>> Test is failed at " << idx << ". <<<";
+        }
+        ++idx;
+    }
+
+    // A request lacks :scheme, or has a Host other than :authority.
+    std::vector<std::vector<std::pair<std::string, std::string>>> malformed{
+        {{":method", "GET"}, {":path", "/"}},
+        {{":method", "GET"},
+         {":scheme", "https"},
+         {":authority", "a.example.com"},
+         {":path", "/"},
+         {"host", "b.example.com"}},
+        {{":status", "200"}, {":authority", "a.example.com"}},
+    };
+    idx = 0;
+    for (const auto &fields : malformed) {
+        msg::HpackEncoder encoder;
+        msg::HpackDecoder decoder;
+        std::string block;
+        for (const auto &field : fields) {
+            encoder.encodeField(field.first, field.second, block);
+        }
+        msg::Message msg;
+        ASSERT_FALSE(msg.parseFromHpack(block.data(), block.size(), decoder))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
@@ -0,0 +1,181 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-17 10:15:48
+ * @LastEditTime: 2019-09-06 10:17:26
+ * @Description: Unittests of class msg::MessageView.
+ */
+#include <gtest/gtest.h>
+#include <message/MessageView.hpp>
+#include <string>
+#include <vector>
+
+TEST(MessageViewTests, ParseHttpResponseInPlace) {
+    std::string rawMessage =
+        "Date: Mon, 27 Jul 2009 12:28:53 GMT\r\n"
+        "Server:   Apache  \r\n"
+        "Content-Length: 51\r\n"
+        "\r\n"
+        "Hello World! My payload includes a trailing CRLF.\r\n";
+
+    msg::MessageView view;
+    ASSERT_TRUE(view.parse(rawMessage));
+    ASSERT_EQ(3u, view.getHeaderCount());
+    ASSERT_EQ("Server", view.getHeader(1).name);
+    ASSERT_EQ("Apache", view.getHeader(1).value);
+    ASSERT_TRUE(view.hasHeader("Content-Length"));
+    ASSERT_FALSE(view.hasHeader("spam"));
+    ASSERT_EQ("", view.getHeaderValue("spam"));
+    ASSERT_EQ("Hello World! My payload includes a trailing CRLF.",
+              view.getBody());
+
+    // Unchanged components are views of the raw message.
+    const char *begin = rawMessage.data();
+    const char *end = begin + rawMessage.size();
+    auto value = view.getHeaderValue("Date");
+    ASSERT_TRUE(value.data() >= begin && value.data() < end);
+    ASSERT_TRUE(view.getBody().data() >= begin && view.getBody().data() < end);
+}
+
+TEST(MessageViewTests, ParseFromFoldingMessage) {
+    struct TestCase {
+        std::string rawString;
+        std::vector<std::string> expectedValues;
+        std::string expectedBody;
+    };
+    std::vector<TestCase> testCases{
+        {"Subject: This\r\n is a test\r\n\r\n", {"This is a test"}, ""},
+        {"Subject: This\r\n is a test \r\nTo: Bob\r\n\r\n", {"This is a test", "Bob"}, ""},
+        {"Subject:\r\n\tThis is a test\r\n\r\n", {"This is a test"}, ""},
+        {"Host: www.example.com\r\n\r\nI'm \r\nbody.\r\n", {"www.example.com"}, "I'm body."},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::MessageView view;
+        ASSERT_TRUE(view.parse(testCase.rawString))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.expectedValues.size(), view.getHeaderCount())
+            << ">>> Test is failed at " << idx << ". <<<";
+        for (size_t i = 0; i < view.getHeaderCount(); ++i) {
+            ASSERT_EQ(testCase.expectedValues[i], view.getHeader(i).value)
+                << ">>> Test is failed at " << idx << ". <<<";
+        }
+        ASSERT_EQ(testCase.expectedBody, view.getBody())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(MessageViewTests, KeepRepeatedHeadersApart) {
+    std::string rawMessage = "Via: SIP/2.0/UDP a.example.com\r\n"
+                             "To: Bob <sip:bob@biloxi.com>\r\n"
+                             "Via: SIP/2.0/UDP b.example.com\r\n"
+                             "    ;branch=z9hG4bK776asdhds\r\n"
+                             "\r\n";
+
+    msg::MessageView view;
+    ASSERT_TRUE(view.parse(rawMessage));
+    ASSERT_EQ(3u, view.getHeaderCount());
+    ASSERT_EQ("SIP/2.0/UDP a.example.com", view.getHeaderValue("Via"));
+    ASSERT_EQ("SIP/2.0/UDP b.example.com ;branch=z9hG4bK776asdhds",
+              view.getHeader(2).value);
+}
+
+TEST(MessageViewTests, UnfoldSelectedHeadersOnly) {
+    std::string rawMessage = "INVITE sip:bob@biloxi.com SIP/2.0\r\n"
+                             "v: SIP/2.0/UDP a.example.com\r\n"
+                             "Subject:  lunch\r\n"
+                             "   tomorrow \r\n"
+                             "Call-ID: a84b4c76e66710\r\n"
+                             "X-Route:\r\n"
+                             " edge-1\r\n"
+                             "CSeq: 314159 INVITE\r\n"
+                             "\r\n"
+                             "v=0\r\n"
+                             "o=bob\r\n";
+
+    msg::MessageView view;
+    view.selectHeader(msg::HeaderId::Via);
+    view.selectHeader("call-id");
+    view.selectHeader(msg::HeaderId::CSeq);
+    view.selectHeader("X-Route");
+    ASSERT_TRUE(view.parse(rawMessage));
+    ASSERT_EQ(5u, view.getHeaderCount());
+    ASSERT_EQ("SIP/2.0/UDP a.example.com",
+              view.getHeaderValue(msg::HeaderId::Via));
+    ASSERT_EQ("a84b4c76e66710", view.getHeaderValue(msg::HeaderId::CallId));
+    ASSERT_EQ("314159 INVITE", view.getHeaderValue("CSeq"));
+    ASSERT_EQ("edge-1", view.getHeaderValue("X-Route"));
+
+    // The others are unfolded on first access, as a full parse does.
+    ASSERT_EQ("lunch tomorrow", view.getHeader(1).value);
+    ASSERT_EQ("lunch tomorrow", view.getHeaderValue("Subject"));
+    ASSERT_EQ("v=0o=bob", view.getBody());
+
+    view.clearSelection();
+    ASSERT_TRUE(view.parse(rawMessage));
+    ASSERT_EQ("lunch tomorrow", view.getHeaderValue(msg::HeaderId::Subject));
+    ASSERT_EQ("v=0o=bob", view.getBody());
+}
+
+TEST(MessageViewTests, ValidateSkippedHeaders) {
+    std::vector<std::string> testCases{
+        "Call-ID: a\r\nSub ject: lunch\r\n\r\n",
+        "Call-ID: a\r\nSubject: lun\x7F\r\n\r\n",
+        "Call-ID: a\r\nSubject: lunch\r\n to\x01morrow\r\n\r\n",
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::MessageView view;
+        view.selectHeader(msg::HeaderId::CallId);
+        ASSERT_FALSE(view.parse(testCase))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(MessageViewTests, KeepViewsValidWhileUnfolding) {
+    // Each value and the body is unfolded into the internal buffer on
+    // first access, after the views of the others were handed out.
+    std::string rawMessage = "MESSAGE sip:bob@biloxi.com SIP/2.0\r\n";
+    for (char name = 'A'; name <= 'Z'; ++name) {
+        rawMessage += std::string("X-") + name + ": first\r\n " +
+                      std::string(64, name) + "\r\n second\r\n";
+    }
+    rawMessage += "\r\nline one\r\nline two\r\n";
+    msg::MessageView view;
+    view.selectHeader(msg::HeaderId::CallId);
+    ASSERT_TRUE(view.parse(rawMessage));
+
+    std::vector<msg::StringView> values;
+    for (size_t i = 0; i < view.getHeaderCount(); ++i)
+        values.push_back(view.getHeader(i).value);
+    msg::StringView body = view.getBody();
+    for (size_t i = 0; i < view.getHeaderCount(); ++i) {
+        ASSERT_EQ(values[i].data(), view.getHeader(i).value.data())
+            << ">>> Test is failed at " << i << ". <<<";
+        ASSERT_EQ("first " + std::string(64, static_cast<char>('A' + i)) +
+                      " second",
+                  values[i].toString())
+            << ">>> Test is failed at " << i << ". <<<";
+    }
+    ASSERT_EQ("line oneline two", body.toString());
+}
+
+TEST(MessageViewTests, ParseFromMessageWithInvaildFormat) {
+    std::vector<std::string> testCases{
+        "Ho st: www.example.com\r\n\r\n",  "Host: www.ex\rample.com\r\n\r\n",
+        "Host: www.example.com\x7F\r\n\r\n", " folded\r\nHost: a\r\n\r\n",
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::MessageView view;
+        ASSERT_FALSE(view.parse(testCase))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
@@ -0,0 +1,211 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 17:21:47
+ * @LastEditTime: 2019-09-06 12:07:44
+ * @Description: Unittests of class msg::MessageWriter.
+ */
+#include <cerrno>
+#include <gtest/gtest.h>
+#include <memory>
+#include <message/MessageReader.hpp>
+#include <message/MessageTemplate.hpp>
+#include <message/MessageWriter.hpp>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+TEST(MessageWriterTests, KeepWhatTheSocketDoesNotTake) {
+    msg::EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+    msg::MessageWriter writer(loop, fds[0]);
+    msg::MessageReader reader(loop, fds[1]);
+    int drains = 0;
+    writer.setDrainHandler([&drains]() { ++drains; });
+    std::vector<std::string> bodies;
+    reader.start(
+        [&bodies](msg::Message &message) {
+            bodies.push_back(message.getBody());
+        },
+        nullptr);
+
+    // Far more than a socket buffer holds.
+    msg::Message msg;
+    msg.getStartLine().setStatus("HTTP/1.1", 200, "OK");
+    std::string body(4 << 20, 'x');
+    msg.setHeader("Content-Length", std::to_string(body.size()));
+    msg.setBody(body);
+    ASSERT_TRUE(writer.send(msg));
+    ASSERT_LT(0u, writer.getPendingLength());
+    // Sent later, written after the first.
+    msg.setBody("y");
+    msg.setHeader("Content-Length", "1", true);
+    ASSERT_TRUE(writer.send(msg));
+
+    while (bodies.size() < 2)
+        ASSERT_LT(0u, loop.runOnce(1000));
+    ASSERT_EQ(body, bodies[0]);
+    ASSERT_EQ("y", bodies[1]);
+    ASSERT_EQ(0u, writer.getPendingLength());
+    ASSERT_EQ(1, drains);
+    ASSERT_EQ(1u, loop.getWatchCount());
+
+    // A closed peer fails the writer without a signal.
+    reader.stop();
+    close(fds[1]);
+    ASSERT_FALSE(writer.send(msg));
+    ASSERT_EQ(EPIPE, writer.getError());
+    ASSERT_FALSE(writer.sendRaw("z"));
+    close(fds[0]);
+}
+
+TEST(MessageWriterTests, ExchangeOverThousandsOfConnections) {
+    const size_t connectionCount = 2000;
+    const size_t requestCount = 3;
+    struct Connection {
+        int fds[2];
+        std::unique_ptr<msg::MessageReader> serverReader;
+        std::unique_ptr<msg::MessageWriter> serverWriter;
+        std::unique_ptr<msg::MessageReader> clientReader;
+        std::unique_ptr<msg::MessageWriter> clientWriter;
+        std::vector<std::string> responses;
+    };
+
+    msg::EventLoop loop;
+    std::vector<Connection> connections(connectionCount);
+    size_t responseCount = 0;
+    msg::Message request;
+    request.getStartLine().setRequest("OPTIONS", "sip:bob@biloxi.com",
+                                      "SIP/2.0");
+    request.setHeader("Content-Length", "0");
+    for (auto &connection : connections) {
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0,
+                                connection.fds));
+        connection.serverReader.reset(
+            new msg::MessageReader(loop, connection.fds[0]));
+        connection.serverWriter.reset(
+            new msg::MessageWriter(loop, connection.fds[0]));
+        connection.clientReader.reset(
+            new msg::MessageReader(loop, connection.fds[1]));
+        connection.clientWriter.reset(
+            new msg::MessageWriter(loop, connection.fds[1]));
+
+        // The server answers each request on the same socket.
+        msg::MessageWriter &serverWriter = *connection.serverWriter;
+        connection.serverReader->start(
+            [&serverWriter](msg::Message &message) {
+                const std::string cseq = message.getHeaderValue("CSeq");
+                message.getStartLine().setStatus("SIP/2.0", 200, "OK");
+                message.setHeader("CSeq", cseq + " ACK", true);
+                serverWriter.send(message);
+            },
+            nullptr);
+        std::vector<std::string> &responses = connection.responses;
+        connection.clientReader->start(
+            [&responses, &responseCount](msg::Message &message) {
+                responses.push_back(message.getHeaderValue("CSeq"));
+                ++responseCount;
+            },
+            nullptr);
+        for (size_t i = 0; i < requestCount; ++i) {
+            request.setHeader("CSeq", std::to_string(i) + " OPTIONS", true);
+            ASSERT_TRUE(connection.clientWriter->send(request));
+        }
+    }
+
+    while (responseCount < connectionCount * requestCount)
+        ASSERT_LT(0u, loop.runOnce(1000));
+    for (auto &connection : connections) {
+        ASSERT_EQ(std::vector<std::string>(
+                      {"0 OPTIONS ACK", "1 OPTIONS ACK", "2 OPTIONS ACK"}),
+                  connection.responses);
+        connection.serverReader->stop();
+        connection.clientReader->stop();
+        close(connection.fds[0]);
+        close(connection.fds[1]);
+    }
+    ASSERT_EQ(0u, loop.getWatchCount());
+}
+
+TEST(MessageWriterTests, SendMessagesAsTheyAreProduced) {
+    msg::EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+    msg::MessageWriter writer(loop, fds[0]);
+
+    msg::Message msg;
+    msg.getStartLine().setStatus("SIP/2.0", 200, "OK");
+    msg.setHeader("Content-Length", "3");
+    msg.setBody("v=0");
+    msg::MessageTemplate bodyTemplate;
+    bodyTemplate.addBodySlot();
+    msg.produceToTemplate(bodyTemplate);
+    msg::MessageTemplate fixedTemplate;
+    msg.produceToTemplate(fixedTemplate);
+    const std::string expected = msg.produceToMessage();
+    ASSERT_EQ("SIP/2.0 200 OK\r\n"
+              "Content-Length: 3\r\n"
+              "\r\n"
+              "v=0\r\n",
+              expected);
+
+    // Written at once and from the pending buffer alike.
+    msg::StringView value("v=0");
+    for (bool pending : {false, true}) {
+        if (pending) {
+            ASSERT_TRUE(writer.sendRaw(std::string(4 << 20, 'x')));
+        }
+        ASSERT_EQ(pending, writer.getPendingLength() != 0);
+        ASSERT_TRUE(writer.send(msg));
+        ASSERT_TRUE(writer.send(bodyTemplate, &value, 1));
+        ASSERT_TRUE(writer.send(fixedTemplate, nullptr, 0));
+
+        std::string received;
+        char buffer[4096];
+        size_t total = (pending ? 4 << 20 : 0) + expected.size() * 3;
+        while (received.size() < total) {
+            loop.runOnce(0);
+            ssize_t n = read(fds[1], buffer, sizeof(buffer));
+            if (n > 0)
+                received.append(buffer, static_cast<size_t>(n));
+        }
+        if (pending) {
+            received.erase(0, 4 << 20);
+        }
+        ASSERT_EQ(expected + expected + expected, received)
+            << ">>> Test is failed at " << pending << ". <<<";
+        ASSERT_EQ(-1, read(fds[1], buffer, sizeof(buffer)));
+    }
+
+    // A length counting the line terminator after the body gets all of
+    // it, the empty line after a body of exact length is ignored.
+    msg::MessageReader reader(loop, fds[1]);
+    std::vector<std::string> bodies;
+    reader.start(
+        [&bodies](msg::Message &message) {
+            bodies.push_back(message.getBody());
+        },
+        nullptr);
+    msg::Message fixture;
+    ASSERT_TRUE(fixture.parseFromMessage(
+        "SIP/2.0 200 OK\r\n"
+        "Content-Length: 51\r\n"
+        "\r\n"
+        "Hello World! My payload includes a trailing CRLF.\r\n"));
+    ASSERT_TRUE(writer.send(fixture));
+    ASSERT_TRUE(writer.send(msg));
+    ASSERT_TRUE(writer.send(fixture));
+    while (bodies.size() < 3)
+        ASSERT_LT(0u, loop.runOnce(1000));
+    ASSERT_EQ(std::vector<std::string>(
+                  {"Hello World! My payload includes a trailing CRLF.\r\n",
+                   "v=0",
+                   "Hello World! My payload includes a trailing CRLF.\r\n"}),
+              bodies);
+    reader.stop();
+    close(fds[0]);
+    close(fds[1]);
+}
@@ -0,0 +1,268 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 21:44:19
+ * @LastEditTime: 2019-09-06 10:52:44
+ * @Description: Unittests of struct msg::ParseLimits.
+ */
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <message/Message.hpp>
+#include <message/MessageParser.hpp>
+#include <message/MessageView.hpp>
+#include <message/ParseLimits.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * @description:
+ *     Feed a raw message to a push parser in chunks of a size.
+ * @return:
+ *     The reason the message was rejected, None if it was completed.
+ */
+msg::ParseError feedParser(const std::string &raw,
+                           const msg::ParseLimits &limits, size_t chunkSize) {
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    parser.setLimits(limits);
+    msg::MessageParser::Status status = msg::MessageParser::Status::NeedMore;
+    for (size_t pos = 0; pos < raw.size();) {
+        status = parser.feed(raw.data() + pos,
+                             std::min(chunkSize, raw.size() - pos));
+        if (status == msg::MessageParser::Status::Error)
+            return parser.getError();
+        pos += parser.getConsumed();
+    }
+    if (status != msg::MessageParser::Status::Complete &&
+        parser.finish() != msg::MessageParser::Status::Complete)
+        return parser.getError();
+    return msg::ParseError::None;
+}
+
+/**
+ * @description:
+ *     Make limits with one bound set.
+ */
+msg::ParseLimits makeLimits(size_t msg::ParseLimits::*bound, size_t value) {
+    msg::ParseLimits limits;
+    limits.*bound = value;
+    return limits;
+}
+
+} // namespace
+
+TEST(ParseLimitsTests, RejectAtEachLimit) {
+    struct TestCase {
+        std::string rawMessage;
+        msg::ParseLimits limits;
+        msg::ParseError expectedError;
+    };
+    using msg::ParseLimits;
+    const std::string threeHeaders = "GET / HTTP/1.1\r\n"
+                                     "A: 1\r\n"
+                                     "B: 2\r\n"
+                                     "C: 3\r\n"
+                                     "\r\n";
+    const std::string foldedHeader = "GET / HTTP/1.1\r\n"
+                                     "Subject: abc\r\n"
+                                     " def\r\n"
+                                     " ghi\r\n"
+                                     "\r\n";
+    const std::string framedBody = "POST / HTTP/1.1\r\n"
+                                   "Content-Length: 5\r\n"
+                                   "\r\n"
+                                   "hello";
+    std::vector<TestCase> testCases{
+        {threeHeaders, ParseLimits(), msg::ParseError::None},
+        {threeHeaders, makeLimits(&ParseLimits::maxHeaderCount, 3),
+         msg::ParseError::None},
+        {threeHeaders, makeLimits(&ParseLimits::maxHeaderCount, 2),
+         msg::ParseError::TooManyHeaders},
+        // The start line and three header lines take 34 bytes.
+        {threeHeaders, makeLimits(&ParseLimits::maxHeaderBytes, 34),
+         msg::ParseError::None},
+        {threeHeaders, makeLimits(&ParseLimits::maxHeaderBytes, 33),
+         msg::ParseError::HeaderSectionTooLarge},
+        {threeHeaders, makeLimits(&ParseLimits::maxHeaderBytes, 10),
+         msg::ParseError::HeaderSectionTooLarge},
+        // The field takes 24 bytes over its three lines.
+        {foldedHeader, makeLimits(&ParseLimits::maxFieldBytes, 24),
+         msg::ParseError::None},
+        {foldedHeader, makeLimits(&ParseLimits::maxFieldBytes, 23),
+         msg::ParseError::FieldTooLarge},
+        {foldedHeader, makeLimits(&ParseLimits::maxFieldBytes, 11),
+         msg::ParseError::FieldTooLarge},
+        // The start line isn't a field.
+        {threeHeaders, makeLimits(&ParseLimits::maxFieldBytes, 4),
+         msg::ParseError::None},
+        {foldedHeader, makeLimits(&ParseLimits::maxContinuations, 2),
+         msg::ParseError::None},
+        {foldedHeader, makeLimits(&ParseLimits::maxContinuations, 1),
+         msg::ParseError::TooManyContinuations},
+        {framedBody, makeLimits(&ParseLimits::maxBodyBytes, 5),
+         msg::ParseError::None},
+        {framedBody, makeLimits(&ParseLimits::maxBodyBytes, 4),
+         msg::ParseError::BodyTooLarge},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        const std::string &raw = testCase.rawMessage;
+        bool expected = testCase.expectedError == msg::ParseError::None;
+        msg::MessageView view;
+        view.setLimits(testCase.limits);
+        ASSERT_EQ(expected, view.parse(raw))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.expectedError, view.getError())
+            << ">>> Test is failed at " << idx << ". <<<";
+
+        msg::Message msg;
+        msg.setLimits(testCase.limits);
+        ASSERT_EQ(expected, msg.parseFromMessage(raw))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.expectedError, msg.getParseError())
+            << ">>> Test is failed at " << idx << ". <<<";
+
+        // The same bounds whole or a byte at a time.
+        ASSERT_EQ(testCase.expectedError,
+                  feedParser(raw, testCase.limits, raw.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.expectedError, feedParser(raw, testCase.limits, 1))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(ParseLimitsTests, RefuseHostileInputEarly) {
+    msg::ParseLimits limits;
+    limits.maxHeaderBytes = 8192;
+    limits.maxBodyBytes = 1 << 20;
+
+    // A header line that never ends.
+    std::string flood = "GET / HTTP/1.1\r\nX-Flood: ";
+    flood.append(16 << 20, 'a');
+    msg::MessageView view;
+    view.setLimits(limits);
+    ASSERT_FALSE(view.parse(flood));
+    ASSERT_EQ(msg::ParseError::HeaderSectionTooLarge, view.getError());
+
+    // Fed as it arrives, the first chunk past the bound fails.
+    msg::Message msg;
+    msg::MessageParser parser(msg);
+    parser.setLimits(limits);
+    ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+              parser.feed(flood.data(), 4096));
+    ASSERT_EQ(msg::MessageParser::Status::Error,
+              parser.feed(flood.data() + 4096, 16384));
+    ASSERT_EQ(msg::ParseError::HeaderSectionTooLarge, parser.getError());
+    ASSERT_EQ(msg::MessageParser::Status::Error, parser.finish());
+    ASSERT_EQ(msg::ParseError::HeaderSectionTooLarge, parser.getError());
+
+    // A declared body over the bound is refused before it is read.
+    const std::string huge = "POST / HTTP/1.1\r\n"
+                             "Content-Length: 1000000000\r\n"
+                             "\r\n";
+    msg.reset();
+    parser.reset();
+    ASSERT_EQ(msg::MessageParser::Status::Error,
+              parser.feed(huge.data(), huge.size()));
+    ASSERT_EQ(msg::ParseError::BodyTooLarge, parser.getError());
+
+    // So is a chunk, and a body lasting until close once it grows past.
+    const std::string chunked = "POST / HTTP/1.1\r\n"
+                                "Transfer-Encoding: chunked\r\n"
+                                "\r\n"
+                                "200000\r\n";
+    msg.reset();
+    parser.reset();
+    ASSERT_EQ(msg::MessageParser::Status::HeadersComplete,
+              parser.feed(chunked.data(), chunked.size()));
+    size_t consumed = parser.getConsumed();
+    ASSERT_EQ(msg::MessageParser::Status::Error,
+              parser.feed(chunked.data() + consumed,
+                          chunked.size() - consumed));
+    ASSERT_EQ(msg::ParseError::BodyTooLarge, parser.getError());
+    const std::string unframed = "HTTP/1.0 200 OK\r\n\r\n";
+    msg.reset();
+    parser.reset();
+    ASSERT_EQ(msg::MessageParser::Status::HeadersComplete,
+              parser.feed(unframed.data(), unframed.size()));
+    std::string chunk(1 << 19, 'b');
+    ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+              parser.feed(chunk.data(), chunk.size()));
+    ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+              parser.feed(chunk.data(), chunk.size()));
+    ASSERT_EQ(msg::MessageParser::Status::Error,
+              parser.feed(chunk.data(), 1));
+    ASSERT_EQ(msg::ParseError::BodyTooLarge, parser.getError());
+
+    // Chunk size lines are bounded with or without a field limit.
+    std::string extensions = "POST / HTTP/1.1\r\n"
+                             "Transfer-Encoding: chunked\r\n"
+                             "\r\n"
+                             "5;";
+    extensions.append(1 << 20, 'e');
+    for (size_t maxFieldBytes : {0, 64}) {
+        msg.reset();
+        parser.reset();
+        parser.setLimits(makeLimits(&msg::ParseLimits::maxFieldBytes,
+                                    maxFieldBytes));
+        ASSERT_EQ(msg::MessageParser::Status::HeadersComplete,
+                  parser.feed(extensions.data(), extensions.size()));
+        consumed = parser.getConsumed();
+        ASSERT_EQ(msg::MessageParser::Status::NeedMore,
+                  parser.feed(extensions.data() + consumed, 60));
+        ASSERT_EQ(msg::MessageParser::Status::Error,
+                  parser.feed(extensions.data() + consumed + 60,
+                              extensions.size() - consumed - 60))
+            << ">>> Test is failed at " << maxFieldBytes << ". <<<";
+        ASSERT_EQ(msg::ParseError::InvalidFraming, parser.getError());
+    }
+
+    // Trailers count against the header section and the header count.
+    const std::string trailers = "POST / HTTP/1.1\r\n"
+                                 "Transfer-Encoding: chunked\r\n"
+                                 "\r\n"
+                                 "0\r\n"
+                                 "X-Checksum: 1234\r\n"
+                                 "X-Signature: 5678\r\n"
+                                 "\r\n";
+    struct TestCase {
+        msg::ParseLimits limits;
+        msg::ParseError expectedError;
+    };
+    // The start line and the header take 45 bytes, the trailers 37.
+    std::vector<TestCase> testCases{
+        {makeLimits(&msg::ParseLimits::maxHeaderBytes, 82),
+         msg::ParseError::None},
+        {makeLimits(&msg::ParseLimits::maxHeaderBytes, 81),
+         msg::ParseError::HeaderSectionTooLarge},
+        {makeLimits(&msg::ParseLimits::maxHeaderCount, 3),
+         msg::ParseError::None},
+        {makeLimits(&msg::ParseLimits::maxHeaderCount, 2),
+         msg::ParseError::TooManyHeaders},
+    };
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        ASSERT_EQ(testCase.expectedError,
+                  feedParser(trailers, testCase.limits, trailers.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.expectedError,
+                  feedParser(trailers, testCase.limits, 1))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+    parser.setLimits(limits);
+
+    // Other malformed framing has a reason too.
+    const std::string badLength = "POST / HTTP/1.1\r\n"
+                                  "Content-Length: x\r\n"
+                                  "\r\n";
+    msg.reset();
+    parser.reset();
+    ASSERT_EQ(msg::MessageParser::Status::Error,
+              parser.feed(badLength.data(), badLength.size()));
+    ASSERT_EQ(msg::ParseError::InvalidFraming, parser.getError());
+}
@@ -0,0 +1,225 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 20:38:12
+ * @LastEditTime: 2019-09-06 10:04:51
+ * @Description: Unittests of class msg::SharedMessage.
+ */
+#include <atomic>
+#include <gtest/gtest.h>
+#include <message/Message.hpp>
+#include <message/SharedMessage.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+const std::string rawInvite = "INVITE sip:bob@biloxi.com SIP/2.0\r\n"
+                              "Via: SIP/2.0/UDP pc33.atlanta.com\r\n"
+                              "Via: SIP/2.0/UDP bigbox3.site3.atlanta.com\r\n"
+                              "Max-Forwards: 70\r\n"
+                              "X-Trace: 1\r\n"
+                              "Set-Cookie: a=1\r\n"
+                              "Set-Cookie: b=2\r\n"
+                              "CSeq: 314159 INVITE\r\n"
+                              "\r\n"
+                              "v=0\r\n";
+
+} // namespace
+
+TEST(SharedMessageTests, ReadWhatTheMessageHolds) {
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage(rawInvite));
+    msg::SharedMessage shared;
+    ASSERT_TRUE(shared.empty());
+    ASSERT_EQ(0u, shared.getHeaderCount());
+    msg.produceToShared(shared);
+    msg.reset();
+
+    ASSERT_FALSE(shared.empty());
+    ASSERT_EQ("INVITE sip:bob@biloxi.com SIP/2.0", shared.getStartLine());
+    ASSERT_EQ(msg::Method::Invite, shared.getMethod());
+    ASSERT_EQ("sip:bob@biloxi.com", shared.getTarget());
+    ASSERT_EQ(5u, shared.getHeaderCount());
+    ASSERT_EQ(msg::HeaderId::Via, shared.getHeader(0).id);
+    ASSERT_EQ("X-Trace", shared.getHeader(2).name);
+    ASSERT_EQ("1", shared.getHeaderValue("x-trace"));
+    ASSERT_TRUE(shared.hasHeader(msg::HeaderId::CSeq));
+    ASSERT_TRUE(shared.hasHeader("v"));
+    ASSERT_FALSE(shared.hasHeader("X-Other"));
+    ASSERT_EQ(2u, shared.getHeaderFieldCount(msg::HeaderId::Via));
+    ASSERT_EQ("SIP/2.0/UDP bigbox3.site3.atlanta.com",
+              shared.getHeaderField(msg::HeaderId::Via, 1));
+    ASSERT_TRUE(shared.getHeaderField(msg::HeaderId::Via, 2).empty());
+    ASSERT_EQ("v=0", shared.getBody());
+
+    // The same text as the message produced.
+    ASSERT_TRUE(msg.parseFromMessage(rawInvite));
+    std::string produced;
+    shared.produceToMessage(produced);
+    ASSERT_EQ(msg.produceToMessage(), produced);
+}
+
+TEST(SharedMessageTests, ShareOneAllocationBetweenCopies) {
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage(rawInvite));
+    msg::SharedMessage shared;
+    msg.produceToShared(shared);
+    ASSERT_EQ(1u, shared.getUseCount());
+    {
+        msg::SharedMessage copy = shared;
+        ASSERT_EQ(2u, shared.getUseCount());
+        ASSERT_EQ(shared.getBody().data(), copy.getBody().data());
+        msg::SharedMessage moved = std::move(copy);
+        ASSERT_TRUE(copy.empty());
+        ASSERT_EQ(2u, moved.getUseCount());
+    }
+    ASSERT_EQ(1u, shared.getUseCount());
+}
+
+TEST(SharedMessageTests, CopyOnlyTheChangedHeaders) {
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage(rawInvite));
+    msg::SharedMessage original;
+    msg.produceToShared(original);
+    std::string originalText;
+    original.produceToMessage(originalText);
+
+    msg::SharedMessage forked;
+    {
+        msg::SharedMessage::Mutation mutation = original.mutate();
+        mutation.prependHeader("Via", "SIP/2.0/UDP proxy.biloxi.com");
+        mutation.setHeader("Max-Forwards", "69");
+        mutation.removeHeader("X-Trace");
+        mutation.addHeader("Record-Route", "<sip:proxy.biloxi.com;lr>");
+        forked = mutation.commit();
+    }
+    ASSERT_EQ(2u, original.getUseCount());
+
+    std::string forkedText;
+    forked.produceToMessage(forkedText);
+    ASSERT_EQ("INVITE sip:bob@biloxi.com SIP/2.0\r\n"
+              "Via: SIP/2.0/UDP proxy.biloxi.com, SIP/2.0/UDP "
+              "pc33.atlanta.com, SIP/2.0/UDP bigbox3.site3.atlanta.com\r\n"
+              "Max-Forwards: 69\r\n"
+              "Set-Cookie: a=1\r\n"
+              "Set-Cookie: b=2\r\n"
+              "CSeq: 314159 INVITE\r\n"
+              "Record-Route: <sip:proxy.biloxi.com;lr>\r\n"
+              "\r\n"
+              "v=0\r\n",
+              forkedText);
+    ASSERT_EQ(3u, forked.getHeaderFieldCount(msg::HeaderId::Via));
+    ASSERT_EQ("SIP/2.0/UDP pc33.atlanta.com",
+              forked.getHeaderField(msg::HeaderId::Via, 1));
+
+    // The original is unchanged and lends its strings.
+    std::string text;
+    original.produceToMessage(text);
+    ASSERT_EQ(originalText, text);
+    ASSERT_EQ(original.getHeaderValue(msg::HeaderId::CSeq).data(),
+              forked.getHeaderValue(msg::HeaderId::CSeq).data());
+    ASSERT_EQ(original.getStartLine().data(), forked.getStartLine().data());
+    ASSERT_EQ(original.getBody().data(), forked.getBody().data());
+
+    // The fork keeps the original alive.
+    original = msg::SharedMessage();
+    auto mutation = forked.mutate();
+    msg::StartLine line;
+    line.setStatus("SIP/2.0", 180, "Ringing");
+    mutation.setStartLine(line);
+    mutation.setBody("");
+    msg::SharedMessage response = mutation.commit();
+    forked = msg::SharedMessage();
+    ASSERT_EQ(180u, response.getStatusCode());
+    ASSERT_EQ("314159 INVITE", response.getHeaderValue("CSeq"));
+    ASSERT_TRUE(response.getBody().empty());
+}
+
+TEST(SharedMessageTests, ReadFromManyThreads) {
+    const size_t threadCount = 8;
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage(rawInvite));
+    msg::SharedMessage shared;
+    msg.produceToShared(shared);
+    std::string expected;
+    shared.produceToMessage(expected);
+
+    std::atomic<size_t> mismatches(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back([shared, &expected, &mismatches, i]() {
+            for (size_t round = 0; round < 1000; ++round) {
+                msg::SharedMessage copy = shared;
+                auto mutation = copy.mutate();
+                mutation.prependHeader("Via", "SIP/2.0/UDP branch" +
+                                                  std::to_string(i));
+                msg::SharedMessage forked = mutation.commit();
+                std::string text;
+                copy.produceToMessage(text);
+                if (text != expected ||
+                    forked.getHeaderField(msg::HeaderId::Via, 0) !=
+                        "SIP/2.0/UDP branch" + std::to_string(i))
+                    ++mismatches;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(0u, mismatches.load());
+    ASSERT_EQ(1u, shared.getUseCount());
+}
+
+TEST(SharedMessageTests, KeepNoOlderVersionsAlive) {
+    // Each version replaces the large body of the one before, which is
+    // freed with its last handle.
+    const std::string body(1 << 20, 'b');
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage(rawInvite));
+    msg.setBody(body);
+    msg::SharedMessage first;
+    msg.produceToShared(first);
+    msg::SharedMessage current = first;
+    for (size_t i = 0; i < 20; ++i) {
+        {
+            auto mutation = current.mutate();
+            mutation.setBody(body);
+            current = mutation.commit();
+        }
+        ASSERT_EQ(1u, first.getUseCount())
+            << ">>> Test is failed at " << i << ". <<<";
+        ASSERT_EQ(1u, current.getUseCount())
+            << ">>> Test is failed at " << i << ". <<<";
+    }
+
+    // A small change shares the version it was made of, but a change of
+    // that one doesn't keep both alive.
+    msg::SharedMessage second;
+    {
+        auto mutation = current.mutate();
+        mutation.setHeader("Max-Forwards", "69");
+        second = mutation.commit();
+    }
+    ASSERT_EQ(2u, current.getUseCount());
+    ASSERT_EQ(current.getBody().data(), second.getBody().data());
+    msg::SharedMessage third;
+    {
+        auto mutation = second.mutate();
+        mutation.setHeader("Max-Forwards", "68");
+        third = mutation.commit();
+    }
+    ASSERT_EQ(1u, third.getUseCount());
+    ASSERT_EQ(2u, current.getUseCount());
+    ASSERT_NE(current.getBody().data(), third.getBody().data());
+    current = second = msg::SharedMessage();
+
+    std::string text;
+    third.produceToMessage(text);
+    ASSERT_NE(std::string::npos, text.find("Max-Forwards: 68\r\n"));
+    ASSERT_EQ(body, third.getBody());
+    ASSERT_EQ("INVITE sip:bob@biloxi.com SIP/2.0", third.getStartLine());
+    ASSERT_EQ("sip:bob@biloxi.com", third.getTarget());
+    ASSERT_EQ(2u, third.getHeaderFieldCount(msg::HeaderId::Via));
+}
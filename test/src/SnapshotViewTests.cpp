@@ -0,0 +1,95 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-02 15:02:19
+ * @LastEditTime: 2019-09-02 15:02:19
+ * @Description: Unittests of class msg::SnapshotView.
+ */
+#include <gtest/gtest.h>
+#include <message/Message.hpp>
+#include <message/SnapshotView.hpp>
+#include <string>
+#include <vector>
+
+TEST(SnapshotViewTests, DecodeInPlace) {
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage("SIP/2.0 200 OK\r\n"
+                                     "Via: SIP/2.0/UDP a.example.com\r\n"
+                                     "v: SIP/2.0/UDP b.example.com\r\n"
+                                     "X-Trace: 1\r\n"
+                                     "\r\n"
+                                     "v=0\r\n"));
+    std::string snapshot;
+    msg.produceToSnapshot(snapshot);
+
+    msg::SnapshotView view;
+    ASSERT_TRUE(view.parse(snapshot.data(), snapshot.size()));
+    ASSERT_EQ(snapshot.size(), view.getLength());
+    ASSERT_EQ(200u, view.getStartLine().getStatusCode());
+    ASSERT_EQ(2u, view.getHeaderCount());
+    ASSERT_EQ(msg::HeaderId::Via, view.getHeader(0).id);
+    ASSERT_EQ("Via", view.getHeader(0).name);
+    ASSERT_EQ(2u, view.getHeaderFieldCount(0));
+    ASSERT_EQ("SIP/2.0/UDP b.example.com", view.getHeaderField(0, 1));
+    ASSERT_EQ("", view.getHeaderField(0, 2));
+    ASSERT_EQ(msg::HeaderId::Unknown, view.getHeader(1).id);
+    ASSERT_EQ("1", view.getHeaderField(1, 0));
+    ASSERT_EQ("v=0", view.getBody());
+
+    // Components are views of the snapshot.
+    const char *begin = snapshot.data();
+    const char *end = begin + snapshot.size();
+    ASSERT_TRUE(view.getHeader(0).value.data() > begin &&
+                view.getHeader(0).value.data() < end);
+    ASSERT_TRUE(view.getBody().data() > begin && view.getBody().data() < end);
+}
+
+TEST(SnapshotViewTests, ReadConsecutiveSnapshots) {
+    std::string spool;
+    msg::Message msg;
+    for (int i = 0; i < 3; ++i) {
+        msg.reset();
+        msg.setHeader(msg::HeaderId::CallId, std::to_string(i));
+        msg.produceToSnapshot(spool);
+    }
+
+    msg::SnapshotView view;
+    size_t offset = 0;
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(view.parse(spool.data() + offset, spool.size() - offset))
+            << ">>> Test is failed at " << i << ". <<<";
+        ASSERT_EQ(std::to_string(i), view.getHeader(0).value)
+            << ">>> Test is failed at " << i << ". <<<";
+        offset += view.getLength();
+    }
+    ASSERT_EQ(spool.size(), offset);
+}
+
+TEST(SnapshotViewTests, RejectDamagedSnapshots) {
+    msg::Message msg;
+    ASSERT_TRUE(msg.parseFromMessage("GET / HTTP/1.1\r\n"
+                                     "Host: www.example.com\r\n"
+                                     "Accept: a\r\n"
+                                     "Accept: b\r\n"
+                                     "\r\n"
+                                     "body\r\n"));
+    std::string snapshot;
+    msg.produceToSnapshot(snapshot);
+
+    msg::SnapshotView view;
+    // Every flipped bit is caught by the frame checks or the checksum.
+    for (size_t idx = 0; idx < snapshot.size() * 8; ++idx) {
+        std::string damaged = snapshot;
+        damaged[idx / 8] ^= static_cast<char>(1 << (idx % 8));
+        ASSERT_FALSE(view.parse(damaged.data(), damaged.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(0u, view.getHeaderCount())
+            << ">>> Test is failed at " << idx << ". <<<";
+    }
+    for (size_t length = 0; length < snapshot.size(); ++length) {
+        ASSERT_FALSE(view.parse(snapshot.data(), length))
+            << ">>> Test is failed at " << length << ". <<<";
+    }
+    ASSERT_TRUE(view.parse(snapshot.data(), snapshot.size()));
+}
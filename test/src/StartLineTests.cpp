@@ -0,0 +1,150 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-30 15:05:48
+ * @LastEditTime: 2019-08-30 15:05:48
+ * @Description: Unittests of class msg::StartLine.
+ */
+#include <gtest/gtest.h>
+#include <message/StartLine.hpp>
+#include <string>
+#include <vector>
+
+TEST(StartLineTests, ParseRequestLines) {
+    struct TestCase {
+        std::string line;
+        msg::Method method;
+        std::string methodName;
+        std::string target;
+        std::string version;
+    };
+
+    std::vector<TestCase> testCases{
+        {"GET /index.html HTTP/1.1", msg::Method::Get, "GET", "/index.html",
+         "HTTP/1.1"},
+        {"INVITE sip:bob@biloxi.com SIP/2.0", msg::Method::Invite, "INVITE",
+         "sip:bob@biloxi.com", "SIP/2.0"},
+        {"CONNECT www.example.com:443 HTTP/1.1", msg::Method::Connect,
+         "CONNECT", "www.example.com:443", "HTTP/1.1"},
+        {"SUBSCRIBE sip:alice@a.com SIP/2.0", msg::Method::Subscribe,
+         "SUBSCRIBE", "sip:alice@a.com", "SIP/2.0"},
+        {"PROPFIND /dav HTTP/1.1", msg::Method::Unknown, "PROPFIND", "/dav",
+         "HTTP/1.1"},
+        {"get / HTTP/1.0", msg::Method::Unknown, "get", "/", "HTTP/1.0"},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::StartLine startLine;
+        ASSERT_TRUE(startLine.parse(testCase.line.data(), testCase.line.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(msg::StartLine::Type::Request, startLine.getType())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.method, startLine.getMethod())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.methodName, startLine.getMethodName())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.target, startLine.getTarget())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.version, startLine.getVersion())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(0u, startLine.getStatusCode())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.line, startLine.getText())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(StartLineTests, ParseStatusLines) {
+    struct TestCase {
+        std::string line;
+        std::string version;
+        unsigned statusCode;
+        std::string reason;
+    };
+
+    std::vector<TestCase> testCases{
+        {"HTTP/1.1 200 OK", "HTTP/1.1", 200, "OK"},
+        {"SIP/2.0 180 Ringing", "SIP/2.0", 180, "Ringing"},
+        {"HTTP/1.1 404 Not Found", "HTTP/1.1", 404, "Not Found"},
+        {"HTTP/1.1 204 ", "HTTP/1.1", 204, ""},
+        {"HTTP/1.1 500", "HTTP/1.1", 500, ""},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::StartLine startLine;
+        ASSERT_TRUE(startLine.parse(testCase.line.data(), testCase.line.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(msg::StartLine::Type::Status, startLine.getType())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(msg::Method::Unknown, startLine.getMethod())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.version, startLine.getVersion())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.statusCode, startLine.getStatusCode())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.reason, startLine.getReason())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_TRUE(startLine.getTarget().empty())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(StartLineTests, ParseInvalidStartLines) {
+    std::vector<std::string> testCases{
+        "",
+        "Host: www.example.com",
+        "GET /index.html",
+        "GET  HTTP/1.1",
+        "GET / HTTP/1.1 extra",
+        "GET / FTP/1.0",
+        " GET / HTTP/1.1",
+        "GET / HTTP/1.1\r",
+        "HTTP/1.1 20 OK",
+        "HTTP/1.1 2000 OK",
+        "HTTP/1.1 2x0 OK",
+        "HTTP/1.1 099 Too Low",
+        "Subject: GET / HTTP/1.1",
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::StartLine startLine;
+        ASSERT_FALSE(startLine.parse(testCase.data(), testCase.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(msg::StartLine::Type::None, startLine.getType())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+}
+
+TEST(StartLineTests, SetStartLines) {
+    msg::StartLine startLine;
+    ASSERT_TRUE(startLine.setRequest(msg::getMethodName(msg::Method::Register),
+                                     "sip:registrar.biloxi.com", "SIP/2.0"));
+    ASSERT_EQ("REGISTER sip:registrar.biloxi.com SIP/2.0",
+              startLine.getText());
+    ASSERT_EQ(msg::Method::Register, startLine.getMethod());
+
+    ASSERT_TRUE(startLine.setStatus("SIP/2.0", 200, "OK"));
+    ASSERT_EQ("SIP/2.0 200 OK", startLine.getText());
+    ASSERT_EQ(200u, startLine.getStatusCode());
+
+    ASSERT_FALSE(startLine.setRequest("GET", "/a b", "HTTP/1.1"));
+    ASSERT_EQ(msg::StartLine::Type::None, startLine.getType());
+}
+
+TEST(StartLineTests, LookupMethods) {
+    for (size_t id = 1; id < static_cast<size_t>(msg::Method::Count); ++id) {
+        auto method = static_cast<msg::Method>(id);
+        ASSERT_EQ(method, msg::lookupMethod(msg::getMethodName(method)))
+            << ">>> Test is failed at " << id << ". <<<";
+    }
+    ASSERT_EQ(msg::Method::Unknown, msg::lookupMethod("Get"));
+    ASSERT_EQ(msg::Method::Unknown, msg::lookupMethod("GETS"));
+    ASSERT_EQ(msg::Method::Unknown, msg::lookupMethod(""));
+}
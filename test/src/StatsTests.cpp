@@ -0,0 +1,180 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-09-05 12:30:52
+ * @LastEditTime: 2019-09-06 11:52:09
+ * @Description: Unittests of parse errors and the instrumentation.
+ */
+#include <gtest/gtest.h>
+#include <message/Hpack.hpp>
+#include <message/Message.hpp>
+#include <message/MessageParser.hpp>
+#include <message/MessageView.hpp>
+#include <message/Stats.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(StatsTests, ReportParseErrors) {
+    struct TestCase {
+        std::string rawMessage;
+        size_t lineLength;
+        msg::ParseError expectedError;
+    };
+    std::vector<TestCase> testCases{
+        {"GET / HTTP/1.1\r\nHost: a\r\n\r\n", 0, msg::ParseError::None},
+        {"GET / HTTP/1.1\r\nHost: a\rb\r\n\r\n", 0,
+         msg::ParseError::BareCarriageReturn},
+        {"GET / HTTP/1.1\r\nHost: example.com\r\n\r\n", 16,
+         msg::ParseError::LineTooLong},
+        {"GET / HTTP/1.1\r\nHost: a\r\n\r\na body line\r\n", 12,
+         msg::ParseError::LineTooLong},
+        {" folded\r\nHost: a\r\n\r\n", 0,
+         msg::ParseError::OrphanContinuation},
+        {"GET / HTTP/1.1\r\nBad Name: a\r\n\r\n", 0,
+         msg::ParseError::InvalidName},
+        {"GET / HTTP/1.1\r\nHost: a\x01"
+         "b\r\n\r\n",
+         0, msg::ParseError::InvalidCharacter},
+        {"GET / HTTP/1.1\r\nSubject: a\r\n b\x7f\r\n\r\n", 0,
+         msg::ParseError::InvalidCharacter},
+    };
+
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        msg::Message msg;
+        msg.setLineLength(testCase.lineLength);
+        ASSERT_EQ(testCase.expectedError == msg::ParseError::None,
+                  msg.parseFromMessage(testCase.rawMessage))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(testCase.expectedError, msg.getParseError())
+            << ">>> Test is failed at " << idx << ". <<<";
+
+        msg::MessageView view;
+        view.setLineLength(testCase.lineLength);
+        view.parse(testCase.rawMessage);
+        ASSERT_EQ(testCase.expectedError, view.getError())
+            << ">>> Test is failed at " << idx << ". <<<";
+        ++idx;
+    }
+
+    msg::Message msg;
+    ASSERT_FALSE(msg.parseFromSnapshot("garbage", 7));
+    ASSERT_EQ(msg::ParseError::InvalidEncoding, msg.getParseError());
+    msg::HpackDecoder decoder;
+    ASSERT_FALSE(msg.parseFromHpack("\x80", 1, decoder));
+    ASSERT_EQ(msg::ParseError::InvalidEncoding, msg.getParseError());
+    ASSERT_TRUE(msg.parseFromMessage("Host: a\r\n\r\n"));
+    ASSERT_EQ(msg::ParseError::None, msg.getParseError());
+    ASSERT_EQ("line_too_long",
+              msg::getParseErrorName(msg::ParseError::LineTooLong));
+    ASSERT_TRUE(msg::getParseErrorName(msg::ParseError::Count).empty());
+}
+
+TEST(StatsTests, BucketLatencies) {
+    typedef msg::LatencyHistogram Histogram;
+    for (uint64_t value = 0; value < Histogram::subBucketCount; ++value) {
+        ASSERT_EQ(value, Histogram::getBucket(value));
+        ASSERT_EQ(value, Histogram::getBucketLimit(value));
+    }
+    size_t lastBucket = 0;
+    for (uint64_t value = 16; value < (uint64_t(1) << 40); value += value / 7) {
+        size_t bucket = Histogram::getBucket(value);
+        uint64_t limit = Histogram::getBucketLimit(bucket);
+        ASSERT_LE(lastBucket, bucket) << ">>> Test is failed at " << value;
+        ASSERT_LE(value, limit) << ">>> Test is failed at " << value;
+        // Within one sixteenth of the value.
+        ASSERT_LE(limit - value, value / 16) << ">>> Test is failed at "
+                                             << value;
+        ASSERT_EQ(bucket, Histogram::getBucket(limit))
+            << ">>> Test is failed at " << value;
+        lastBucket = bucket;
+    }
+    ASSERT_EQ(Histogram::bucketCount - 1, Histogram::getBucket(UINT64_MAX));
+
+    Histogram histogram;
+    ASSERT_EQ(0u, histogram.getPercentile(50));
+    for (uint64_t value = 1; value <= 100; ++value)
+        histogram.record(value * 1000);
+    Histogram other;
+    other.record(1000000, 100);
+    histogram.merge(other);
+    ASSERT_EQ(200u, histogram.getCount());
+    ASSERT_EQ(Histogram::getBucketLimit(Histogram::getBucket(1000)),
+              histogram.getPercentile(0));
+    ASSERT_EQ(Histogram::getBucketLimit(Histogram::getBucket(50000)),
+              histogram.getPercentile(25));
+    ASSERT_EQ(Histogram::getBucketLimit(Histogram::getBucket(1000000)),
+              histogram.getPercentile(99));
+    histogram.clear();
+    ASSERT_EQ(0u, histogram.getCount());
+}
+
+TEST(StatsTests, CountThreadsInSnapshots) {
+    const std::string rawMessage = "INVITE sip:bob@biloxi.com SIP/2.0\r\n"
+                                   "Subject: first\r\n"
+                                   "  second\r\n"
+                                   "Call-ID: a84b4c76e66710\r\n"
+                                   "\r\n";
+    auto work = [&rawMessage]() {
+        msg::Message msg;
+        for (int i = 0; i < 10; ++i)
+            msg.parseFromMessage(rawMessage);
+        msg.parseFromMessage("Host: a\r\nBad Name: a\r\n\r\n");
+        msg.setLineLength(20);
+        msg.produceToMessage();
+        // Messages fed as they arrive are counted the same.
+        const std::string badLength = "POST / HTTP/1.1\r\n"
+                                      "Content-Length: x\r\n"
+                                      "\r\n";
+        msg.reset();
+        msg::MessageParser parser(msg);
+        parser.feed(badLength.data(), badLength.size());
+        msg.reset();
+        parser.reset();
+        for (char ch : rawMessage)
+            parser.feed(&ch, 1);
+    };
+
+    msg::StatsSnapshot before;
+    msg::Stats::takeSnapshot(before);
+    uint32_t interval = msg::Stats::getSampleInterval();
+    msg::Stats::setSampleInterval(1);
+    work();
+    // Counts of an exited thread stay in the totals.
+    std::thread thread(work);
+    thread.join();
+    msg::Stats::setSampleInterval(interval);
+    msg::StatsSnapshot after;
+    msg::Stats::takeSnapshot(after);
+
+    if (!msg::Stats::isEnabled()) {
+        ASSERT_EQ(0u, after.getCounter(msg::Counter::Messages));
+        ASSERT_EQ(0u, after.getPhase(msg::Phase::Parse).getCount());
+        return;
+    }
+    auto delta = [&before, &after](msg::Counter counter) {
+        return after.getCounter(counter) - before.getCounter(counter);
+    };
+    ASSERT_EQ(22u, delta(msg::Counter::Messages));
+    ASSERT_EQ(22 * rawMessage.size(), delta(msg::Counter::Bytes));
+    ASSERT_EQ(44u, delta(msg::Counter::Headers));
+    ASSERT_EQ(22u, delta(msg::Counter::Unfolds));
+    ASSERT_EQ(2u, delta(msg::Counter::Produced));
+    ASSERT_LT(0u, delta(msg::Counter::ProducedBytes));
+    ASSERT_LT(0u, delta(msg::Counter::Folds));
+    ASSERT_EQ(2u, after.getRejects(msg::ParseError::InvalidName) -
+                      before.getRejects(msg::ParseError::InvalidName));
+    ASSERT_EQ(2u, after.getRejects(msg::ParseError::InvalidFraming) -
+                      before.getRejects(msg::ParseError::InvalidFraming));
+
+    // A new thread times each message at once.
+    uint64_t parses = after.getPhase(msg::Phase::Parse).getCount() -
+                      before.getPhase(msg::Phase::Parse).getCount();
+    ASSERT_LE(11u + rawMessage.size(), parses);
+    ASSERT_LT(before.getPhase(msg::Phase::Unfold).getCount(),
+              after.getPhase(msg::Phase::Unfold).getCount());
+    ASSERT_LT(before.getPhase(msg::Phase::Fold).getCount(),
+              after.getPhase(msg::Phase::Fold).getCount());
+}
@@ -0,0 +1,133 @@
+// Copyright (c) 2019 shaqsnake. All rights reserved.
+/**
+ * @Author: shaqsnake
+ * @Email: shaqsnake@gmail.com
+ * @Date: 2019-08-29 15:10:33
+ * @LastEditTime: 2019-09-02 15:48:03
+ * @Description: Unittests of character classes and scanning kernels.
+ */
+#include "Syntax.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * @description:
+ *     Get the kernels this CPU can run.
+ */
+std::vector<msg::syntax::LineScanner> getKernels() {
+    std::vector<msg::syntax::LineScanner> kernels{
+        msg::syntax::scanLineScalar};
+    if (msg::syntax::hasSse2())
+        kernels.push_back(msg::syntax::scanLineSse2);
+    if (msg::syntax::hasAvx2())
+        kernels.push_back(msg::syntax::scanLineAvx2);
+    return kernels;
+}
+
+} // namespace
+
+TEST(SyntaxTests, ScanLine) {
+    struct TestCase {
+        std::string line;
+        size_t end;
+        size_t colon;
+        bool clean;
+    };
+
+    std::string longName(40, 'x');
+    std::string longValue(70, 'v');
+    std::vector<TestCase> testCases{
+        {"", 0, msg::syntax::npos, true},
+        {"Host: a\r\n", 7, 4, true},
+        {"no colon at all", 15, msg::syntax::npos, true},
+        {"\r\nHost: a", 0, msg::syntax::npos, true},
+        {"\tfolded: \t value\r\n", 16, 7, true},
+        {longName + ":" + longValue + "\r\n", 111, 40, true},
+        {longName + longValue + ":\r\n", 111, 110, true},
+        {longName + "\r:" + longValue, 40, msg::syntax::npos, true},
+        {longValue + "\x7F" + longName, 111, msg::syntax::npos, false},
+        {longValue + "\xC3\xA9:" + longName, 113, 72, false},
+        {"a\nb: c\r\n\x01", 6, 3, false},
+        {longValue + "\r" + "\x01", 70, msg::syntax::npos, true},
+    };
+
+    auto kernels = getKernels();
+    size_t idx = 0;
+    for (const auto &testCase : testCases) {
+        for (auto kernel : kernels) {
+            auto scan = kernel(testCase.line.data(), testCase.line.size());
+            ASSERT_EQ(testCase.end, scan.end)
+                << ">>> Test is failed at " << idx << ". <<<";
+            ASSERT_EQ(testCase.colon, scan.colon)
+                << ">>> Test is failed at " << idx << ". <<<";
+            ASSERT_EQ(testCase.clean, scan.clean)
+                << ">>> Test is failed at " << idx << ". <<<";
+        }
+        ++idx;
+    }
+}
+
+TEST(SyntaxTests, ScanLineKernelsAgree) {
+    // Mostly field characters with the structural ones mixed in.
+    const std::string alphabet = "abcdefgh:: \t\r\n\x01\x7F\x80";
+    std::mt19937 random(20190829);
+    auto kernels = getKernels();
+    std::string line;
+    for (size_t idx = 0; idx < 20000; ++idx) {
+        line.assign(random() % 200, 'x');
+        size_t specials = random() % 4;
+        for (size_t i = 0; i < specials && !line.empty(); ++i) {
+            line[random() % line.size()] =
+                alphabet[random() % alphabet.size()];
+        }
+
+        auto expected = msg::syntax::scanLineScalar(line.data(), line.size());
+        for (auto kernel : kernels) {
+            auto scan = kernel(line.data(), line.size());
+            ASSERT_EQ(expected.end, scan.end)
+                << ">>> Test is failed at " << idx << ". <<<";
+            ASSERT_EQ(expected.colon, scan.colon)
+                << ">>> Test is failed at " << idx << ". <<<";
+            ASSERT_EQ(expected.clean, scan.clean)
+                << ">>> Test is failed at " << idx << ". <<<";
+        }
+    }
+}
+
+TEST(SyntaxTests, Crc32cKernelsAgree) {
+    std::vector<msg::syntax::ChecksumKernel> kernels{
+        msg::syntax::crc32cScalar};
+    if (msg::syntax::hasSse42())
+        kernels.push_back(msg::syntax::crc32cSse42);
+
+    std::string check = "123456789";
+    std::mt19937 random(17);
+    std::string data(300, '\0');
+    for (auto &ch : data) {
+        ch = static_cast<char>(random());
+    }
+
+    size_t idx = 0;
+    for (auto kernel : kernels) {
+        ASSERT_EQ(0u, kernel(0, check.data(), 0))
+            << ">>> Test is failed at " << idx << ". <<<";
+        ASSERT_EQ(0xE3069283u, kernel(0, check.data(), check.size()))
+            << ">>> Test is failed at " << idx << ". <<<";
+        for (size_t length = 0; length <= data.size(); length += 7) {
+            uint32_t whole = kernel(0, data.data(), length);
+            ASSERT_EQ(msg::syntax::crc32cScalar(0, data.data(), length), whole)
+                << ">>> Test is failed at " << idx << ", " << length
+                << ". <<<";
+            // A checksum continues over split buffers.
+            size_t half = length / 2;
+            ASSERT_EQ(whole, kernel(kernel(0, data.data(), half),
+                                    data.data() + half, length - half))
+                << ">>> Test is failed at " << idx << ", " << length
+                << ". <<<";
+        }
+        ++idx;
+    }
+}